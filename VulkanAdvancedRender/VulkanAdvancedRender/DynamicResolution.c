@@ -0,0 +1,111 @@
+#include "common.h"
+
+// Over the budget, the scale drops most of the way towards its estimate at once, so that missed frames are short lived,
+// while under it the scale only grows slowly, as a single cheap frame says little about the next ones.
+static const double DYNAMIC_RESOLUTION_DECREASE_RATE = 0.5;
+static const double DYNAMIC_RESOLUTION_INCREASE_RATE = 0.1;
+// The scale is held while the GPU time lies between this fraction of the budget and the budget, which keeps it from oscillating.
+static const double DYNAMIC_RESOLUTION_HOLD_RATIO = 0.85;
+// What the estimate aims at, in the middle of the hold band
+static const double DYNAMIC_RESOLUTION_TARGET_RATIO = 0.925;
+
+void InitializeDynamicResolution(DynamicResolution* controller, double gpuTimeBudget, float minScale)
+{
+    *controller = (DynamicResolution) {
+        .gpuTimeBudget = gpuTimeBudget,
+        .minScale = min(max(minScale, 0.1f), 1.0f),
+        .scale = 1.0f,
+        .lowestScale = 1.0f,
+        .highestScale = 0.0f,
+        .scaleSum = 0.0,
+        .sampleCount = 0,
+        .overBudgetCount = 0
+    };
+}
+
+float UpdateDynamicResolution(DynamicResolution* controller, double gpuDuration, float renderedScale)
+{
+    if (gpuDuration <= 0.0 || renderedScale <= 0.0f) return controller->scale;
+
+    const double budgetRatio = gpuDuration / controller->gpuTimeBudget;
+    if (budgetRatio > 1.0 || budgetRatio < DYNAMIC_RESOLUTION_HOLD_RATIO)
+    {
+        // The GPU time is taken as proportional to the pixel count, that is to the square of the scale.
+        // The estimate starts from the scale that the measured frame was rendered at, since the current one may have moved since then.
+        const double estimatedScale = renderedScale * sqrt(DYNAMIC_RESOLUTION_TARGET_RATIO / budgetRatio);
+        const double rate = budgetRatio > 1.0 ? DYNAMIC_RESOLUTION_DECREASE_RATE : DYNAMIC_RESOLUTION_INCREASE_RATE;
+        const double scale = controller->scale + (estimatedScale - controller->scale) * rate;
+        controller->scale = (float)min(max(scale, (double)controller->minScale), 1.0);
+    }
+
+    if (budgetRatio > 1.0) {
+        ++controller->overBudgetCount;
+    }
+    controller->lowestScale = min(controller->lowestScale, controller->scale);
+    controller->highestScale = max(controller->highestScale, controller->scale);
+    controller->scaleSum += controller->scale;
+    ++controller->sampleCount;
+
+    return controller->scale;
+}
+
+VkExtent2D GetScaledRenderExtent(VkExtent2D fullExtent, float scale)
+{
+    const uint32_t width = (uint32_t)ceilf((float)fullExtent.width * scale);
+    const uint32_t height = (uint32_t)ceilf((float)fullExtent.height * scale);
+    return (VkExtent2D) {
+        .width = min(max(width, 1U), fullExtent.width),
+        .height = min(max(height, 1U), fullExtent.height)
+    };
+}
+
+void RecordUpscaleBlit(VkCommandBuffer commandBuffer, VkImage srcImage, VkExtent2D srcExtent, VkImage dstImage, VkExtent2D dstExtent, VkImageLayout dstFinalLayout)
+{
+    VkImageMemoryBarrier dstBarrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .pNext = NULL,
+        .srcAccessMask = VK_ACCESS_NONE,
+        .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = dstImage,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        }
+    };
+    // The source stage is the one that the image acquired semaphore is waited at, so the transition stays behind the acquisition.
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &dstBarrier);
+
+    const VkImageBlit region = {
+        .srcSubresource = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1 },
+        .srcOffsets = { { 0, 0, 0 }, { (int32_t)srcExtent.width, (int32_t)srcExtent.height, 1 } },
+        .dstSubresource = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1 },
+        .dstOffsets = { { 0, 0, 0 }, { (int32_t)dstExtent.width, (int32_t)dstExtent.height, 1 } }
+    };
+    vkCmdBlitImage(commandBuffer, srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    1, &region, VK_FILTER_LINEAR);
+
+    // Like EndRenderTarget, a presented image only needs the layout, while an offscreen image is copied out afterwards.
+    const bool isCopiedOut = dstFinalLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    dstBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    dstBarrier.dstAccessMask = isCopiedOut ? VK_ACCESS_TRANSFER_READ_BIT : VK_ACCESS_NONE;
+    dstBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    dstBarrier.newLayout = dstFinalLayout;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, isCopiedOut ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                        0, 0, NULL, 0, NULL, 1, &dstBarrier);
+}
+
+void PrintDynamicResolutionStatistics(const DynamicResolution* controller)
+{
+    if (controller->sampleCount == 0) return;
+
+    printf("Dynamic resolution for a GPU time budget of %.3f ms: average scale %.1f%%, lowest %.1f%%, highest %.1f%%, %u of %u frames over budget\n",
+        controller->gpuTimeBudget, 100.0 * controller->scaleSum / (double)controller->sampleCount, 100.0 * controller->lowestScale,
+        100.0 * controller->highestScale, controller->overBudgetCount, controller->sampleCount);
+}
@@ -0,0 +1,77 @@
+#include "common.h"
+
+
+VkPipeline CreateCullingComputePipeline(VkDevice specDevice, const char* compSPVFilePath, VkPipelineLayout pipelineLayout, VkPipelineCache pipelineCache)
+{
+    VkShaderModule computeShaderModule = VK_NULL_HANDLE;
+    VkPipeline dstPipeline = VK_NULL_HANDLE;
+    VkResult res = VK_ERROR_INITIALIZATION_FAILED;
+
+    do
+    {
+        if (!CreateShaderModule(compSPVFilePath, &computeShaderModule)) break;
+
+        const uint32_t localSizeX = CULLING_WORK_GROUP_SIZE;
+
+        const VkSpecializationMapEntry mapEntry = {
+            .constantID = 0,
+            .offset = 0,
+            .size = sizeof(localSizeX)
+        };
+
+        const VkSpecializationInfo specializationInfo = {
+            .mapEntryCount = 1,
+            .pMapEntries = &mapEntry,
+            .dataSize = sizeof(localSizeX),
+            .pData = &localSizeX
+        };
+
+        PipelineCreationFeedbackRecord feedbackRecord;
+
+        const VkComputePipelineCreateInfo pipelineCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+            .pNext = PreparePipelineCreationFeedback(&feedbackRecord, NULL, 1U),
+            .flags = 0,
+            .stage = {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .pNext = NULL,
+                .flags = 0,
+                .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+                .module = computeShaderModule,
+                .pName = "main",
+                .pSpecializationInfo = &specializationInfo
+            },
+            .layout = pipelineLayout,
+            .basePipelineHandle = VK_NULL_HANDLE,
+            .basePipelineIndex = 0
+        };
+
+        const double startTime = GetCurrentTimeInMilliseconds();
+        res = vkCreateComputePipelines(specDevice, pipelineCache, 1, &pipelineCreateInfo, NULL, &dstPipeline);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreateComputePipelines failed: %d\n", res);
+            break;
+        }
+
+        RecordPipelineCreation("GPU culling", &feedbackRecord, GetCurrentTimeInMilliseconds() - startTime);
+    }
+    while (false);
+
+    if (computeShaderModule != VK_NULL_HANDLE) {
+        vkDestroyShaderModule(specDevice, computeShaderModule, NULL);
+    }
+
+    if (res == VK_SUCCESS) {
+        return dstPipeline;
+    }
+
+    if (dstPipeline != VK_NULL_HANDLE)
+    {
+        vkDestroyPipeline(specDevice, dstPipeline, NULL);
+        dstPipeline = VK_NULL_HANDLE;
+    }
+
+    return dstPipeline;
+}
+
@@ -2,12 +2,11 @@
 
 
 VkPipeline CreateGeometryShaderGraphicsPipeline(VkDevice specDevice, const char* vertSPVFilePath, const char* fragSPVFilePath, const char* geomSPVFilePath,
-                            VkPipelineLayout pipelineLayout, VkRenderPass renderPass, VkPipelineCache* outPipelineCache)
+                            const VertexLayout* vertexLayout, VkPipelineLayout pipelineLayout, const RenderTarget* renderTarget, VkPipelineCache pipelineCache)
 {
     VkShaderModule vertexShaderModule = VK_NULL_HANDLE;
     VkShaderModule fragmentShaderModule = VK_NULL_HANDLE;
     VkShaderModule geometryShaderModule = VK_NULL_HANDLE;
-    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
     VkPipeline dstPipeline = VK_NULL_HANDLE;
     VkResult res = VK_ERROR_INITIALIZATION_FAILED;
 
@@ -67,45 +66,20 @@ VkPipeline CreateGeometryShaderGraphicsPipeline(VkDevice specDevice, const char*
             }
         };
 
-        const VkVertexInputBindingDescription vertexInputBindings[] = {
-            // vertex coords buffer
-            {
-                .binding = VERTEX_BUFFER_LOCATION_INDEX,
-                .stride = sizeof(float[4]),
-                .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
-            },
-            // color buffer
-            {
-                .binding = COLOR_BUFFER_LOCATION_INDEX,
-                .stride = sizeof(float[4]),
-                .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
-            }
-        };
-
-        const VkVertexInputAttributeDescription vertexInputAttributes[] = {
-            // inPos attribute
-            {
-                .location = VERTEX_BUFFER_LOCATION_INDEX,
-                .binding = VERTEX_BUFFER_LOCATION_INDEX,
-                .format = VK_FORMAT_R32G32B32A32_SFLOAT,
-                .offset = 0
-            },
-            // inColor attribute
-            {
-                .location = COLOR_BUFFER_LOCATION_INDEX,
-                .binding = COLOR_BUFFER_LOCATION_INDEX,
-                .format = VK_FORMAT_R32G32B32A32_SFLOAT,
-                .offset = 0
-            }
-        };
+        // inPos and inColor attributes, from the streams of `vertexLayout` that hold them
+        VkVertexInputBindingDescription vertexInputBindings[MAX_VERTEX_STREAM_COUNT];
+        VkVertexInputAttributeDescription vertexInputAttributes[MAX_VERTEX_ATTRIBUTE_COUNT];
+        uint32_t vertexInputAttributeCount = 0;
+        const uint32_t vertexInputBindingCount = FillVertexInputDescriptions(vertexLayout, (1U << VERTEX_BUFFER_LOCATION_INDEX) | (1U << COLOR_BUFFER_LOCATION_INDEX),
+                                                                            vertexInputBindings, vertexInputAttributes, &vertexInputAttributeCount);
 
         const VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo = {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
             .pNext = NULL,
             .flags = 0,
-            .vertexBindingDescriptionCount = (uint32_t)(sizeof(vertexInputBindings) / sizeof(vertexInputBindings[0])),
+            .vertexBindingDescriptionCount = vertexInputBindingCount,
             .pVertexBindingDescriptions = vertexInputBindings,
-            .vertexAttributeDescriptionCount = (uint32_t)(sizeof(vertexInputAttributes) / sizeof(vertexInputAttributes[0])),
+            .vertexAttributeDescriptionCount = vertexInputAttributeCount,
             .pVertexAttributeDescriptions = vertexInputAttributes
         };
 
@@ -148,7 +122,7 @@ VkPipeline CreateGeometryShaderGraphicsPipeline(VkDevice specDevice, const char*
             .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
             .pNext = NULL,
             .flags = 0,
-            .rasterizationSamples = USE_MSAA_SAMPLE_COUNT > 0 ? (VkSampleCountFlagBits)(USE_MSAA_SAMPLE_COUNT) : VK_SAMPLE_COUNT_1_BIT,
+            .rasterizationSamples = renderTarget->sampleCount,
             .sampleShadingEnable = VK_FALSE,
             .minSampleShading = 0.0f,
             .pSampleMask = NULL,
@@ -213,10 +187,14 @@ VkPipeline CreateGeometryShaderGraphicsPipeline(VkDevice specDevice, const char*
             .pDynamicStates = (VkDynamicState[]) { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR }
         };
 
+        PipelineCreationFeedbackRecord feedbackRecord;
+        VkPipelineRenderingCreateInfoKHR renderingCreateInfo;
+        const uint32_t stageCount = (uint32_t)(sizeof(shaderStages) / sizeof(shaderStages[0]));
+
         const VkGraphicsPipelineCreateInfo pipelineCreateInfo = {
             .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-            .pNext = NULL,
-            .stageCount = (uint32_t)(sizeof(shaderStages) / sizeof(shaderStages[0])),
+            .pNext = PreparePipelineCreationFeedback(&feedbackRecord, PrepareRenderTargetPipelineInfo(renderTarget, &renderingCreateInfo, NULL), stageCount),
+            .stageCount = stageCount,
             .pStages = shaderStages,
             .pVertexInputState = &vertexInputStateCreateInfo,
             .pInputAssemblyState = &inputAssemblyStateCreateInfo,
@@ -228,33 +206,21 @@ VkPipeline CreateGeometryShaderGraphicsPipeline(VkDevice specDevice, const char*
             .pColorBlendState = &colorBlendStateCreateInfo,
             .pDynamicState = &dynamicStateCreateInfo,
             .layout = pipelineLayout,
-            .renderPass = renderPass,
+            .renderPass = renderTarget->renderPass,
             .subpass = 0,
             .basePipelineHandle = VK_NULL_HANDLE,
             .basePipelineIndex = 0
         };
 
-        const VkPipelineCacheCreateInfo pipelineCacheInfo = {
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
-            .pNext = NULL,
-            .flags = 0,
-            .initialDataSize = 0,
-            .pInitialData = NULL
-        };
-
-        res = vkCreatePipelineCache(specDevice, &pipelineCacheInfo, NULL, &pipelineCache);
-        if (res != VK_SUCCESS)
-        {
-            fprintf(stderr, "vkCreatePipelineCache failed: %d\n", res);
-            break;
-        }
-
+        const double startTime = GetCurrentTimeInMilliseconds();
         res = vkCreateGraphicsPipelines(specDevice, pipelineCache, 1, &pipelineCreateInfo, NULL, &dstPipeline);
         if (res != VK_SUCCESS)
         {
             fprintf(stderr, "vkCreateGraphicsPipelines failed: %d\n", res);
             break;
         }
+
+        RecordPipelineCreation("geometry shader", &feedbackRecord, GetCurrentTimeInMilliseconds() - startTime);
     }
     while (false);
 
@@ -268,15 +234,10 @@ VkPipeline CreateGeometryShaderGraphicsPipeline(VkDevice specDevice, const char*
         vkDestroyShaderModule(specDevice, fragmentShaderModule, NULL);
     }
 
-    if (res == VK_SUCCESS)
-    {
-        *outPipelineCache = pipelineCache;
+    if (res == VK_SUCCESS) {
         return dstPipeline;
     }
 
-    if (pipelineCache != VK_NULL_HANDLE) {
-        vkDestroyPipelineCache(specDevice, pipelineCache, NULL);
-    }
     if (dstPipeline != VK_NULL_HANDLE) {
         vkDestroyPipeline(specDevice, dstPipeline, NULL);
     }
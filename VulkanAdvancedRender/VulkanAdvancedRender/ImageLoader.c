@@ -0,0 +1,589 @@
+#include "common.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif // !_WIN32
+
+enum
+{
+    BMP_FILE_HEADER_SIZE = 14,
+    BMP_INFO_HEADER_MIN_SIZE = 40,
+    BMP_COMPRESSION_RGB = 0,
+    BMP_COMPRESSION_BITFIELDS = 3,
+
+    TGA_HEADER_SIZE = 18,
+    TGA_IMAGE_TYPE_TRUE_COLOR = 2,
+    TGA_IMAGE_TYPE_RLE_TRUE_COLOR = 10,
+    TGA_DESCRIPTOR_ALPHA_BITS_MASK = 0x0f,
+    TGA_DESCRIPTOR_RIGHT_TO_LEFT_BIT = 0x10,
+    TGA_DESCRIPTOR_TOP_TO_BOTTOM_BIT = 0x20,
+
+    KTX2_HEADER_SIZE = 80,          // the identifier, the header and the index up to the level index
+    KTX2_LEVEL_INDEX_ENTRY_SIZE = 24,
+
+    // The decoded levels start at multiples of this, which satisfies the bufferOffset alignment of vkCmdCopyBufferToImage for any format
+    IMAGE_LEVEL_ALIGNMENT = 16,
+    // Larger images are rejected before any device memory is allocated for them
+    MAX_IMAGE_FILE_DIMENSION = 16384
+};
+
+static const uint8_t s_ktx2Identifier[12] = { 0xab, 'K', 'T', 'X', ' ', '2', '0', 0xbb, '\r', '\n', 0x1a, '\n' };
+
+static inline uint16_t ReadU16LE(const uint8_t* src)
+{
+    return (uint16_t)(src[0] | (src[1] << 8));
+}
+
+static inline uint32_t ReadU32LE(const uint8_t* src)
+{
+    return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+static inline uint64_t ReadU64LE(const uint8_t* src)
+{
+    return (uint64_t)ReadU32LE(src) | ((uint64_t)ReadU32LE(&src[4]) << 32);
+}
+
+#ifdef _WIN32
+static const uint8_t* MapFileForReading(const char* path, size_t* outSize)
+{
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+
+    const uint8_t* data = NULL;
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0 && (uint64_t)fileSize.QuadPart <= SIZE_MAX)
+    {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping != NULL)
+        {
+            // The view keeps the mapping and the file open
+            data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+        *outSize = (size_t)fileSize.QuadPart;
+    }
+    CloseHandle(file);
+
+    return data;
+}
+
+static void UnmapFile(const uint8_t* data, size_t size)
+{
+    (void)size;
+    UnmapViewOfFile(data);
+}
+#else
+static const uint8_t* MapFileForReading(const char* path, size_t* outSize)
+{
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    const uint8_t* data = NULL;
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0 && (uint64_t)fileStat.st_size <= SIZE_MAX)
+    {
+        void* mapped = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED)
+        {
+            // The pixels are read front to back once
+            madvise(mapped, (size_t)fileStat.st_size, MADV_SEQUENTIAL);
+            data = mapped;
+        }
+        *outSize = (size_t)fileStat.st_size;
+    }
+    // The mapping keeps the file open
+    close(fd);
+
+    return data;
+}
+
+static void UnmapFile(const uint8_t* data, size_t size)
+{
+    munmap((void*)data, size);
+}
+#endif // _WIN32
+
+static const char* const s_imageFileTypeNames[IMAGE_FILE_TYPE_COUNT] = { "BMP", "TGA", "PPM", "KTX2" };
+
+const char* GetImageFileTypeName(ImageFileType type)
+{
+    return type < IMAGE_FILE_TYPE_COUNT ? s_imageFileTypeNames[type] : "unknown";
+}
+
+// Lays out the levels of the decoded image tightly, every level at a multiple of IMAGE_LEVEL_ALIGNMENT
+static void ComputeImageFileLevels(ImageFile* image)
+{
+    const TextureFormatInfo* formatInfo = GetTextureFormatInfo(image->format);
+    VkDeviceSize offset = 0;
+    for (uint32_t level = 0; level < image->levelCount; ++level)
+    {
+        image->levelOffsets[level] = offset;
+        image->levelSizes[level] = GetTextureLevelSize(formatInfo, image->width, image->height, level);
+        offset = (offset + image->levelSizes[level] + IMAGE_LEVEL_ALIGNMENT - 1) / IMAGE_LEVEL_ALIGNMENT * IMAGE_LEVEL_ALIGNMENT;
+    }
+    image->decodedSize = offset;
+}
+
+static bool ParseBMPHeader(const char* path, ImageFile* image)
+{
+    const uint8_t* data = image->fileData;
+    if (image->fileSize < BMP_FILE_HEADER_SIZE + BMP_INFO_HEADER_MIN_SIZE)
+    {
+        fprintf(stderr, "%s is too small for a BMP file!\n", path);
+        return false;
+    }
+
+    const uint32_t pixelOffset = ReadU32LE(&data[10]);
+    const uint32_t infoHeaderSize = ReadU32LE(&data[14]);
+    const int32_t width = (int32_t)ReadU32LE(&data[18]);
+    const int32_t height = (int32_t)ReadU32LE(&data[22]);
+    const uint32_t bitCount = ReadU16LE(&data[28]);
+    const uint32_t compression = ReadU32LE(&data[30]);
+    if (infoHeaderSize < BMP_INFO_HEADER_MIN_SIZE || (bitCount != 24 && bitCount != 32) ||
+        (compression != BMP_COMPRESSION_RGB && !(compression == BMP_COMPRESSION_BITFIELDS && bitCount == 32)))
+    {
+        fprintf(stderr, "%s is not an uncompressed 24-bit or 32-bit BMP file!\n", path);
+        return false;
+    }
+
+    // The alpha of BI_RGB is reserved. BI_BITFIELDS masks follow a 40 byte header, or are part of the larger ones.
+    image->format = VK_FORMAT_B8G8R8A8_UNORM;
+    image->isOpaque = true;
+    if (compression == BMP_COMPRESSION_BITFIELDS)
+    {
+        const size_t maskEnd = BMP_FILE_HEADER_SIZE + (size_t)max(infoHeaderSize, (uint32_t)BMP_INFO_HEADER_MIN_SIZE + 12U);
+        if (image->fileSize < maskEnd)
+        {
+            fprintf(stderr, "%s is missing its BMP color masks!\n", path);
+            return false;
+        }
+        const uint32_t redMask = ReadU32LE(&data[54]);
+        const uint32_t greenMask = ReadU32LE(&data[58]);
+        const uint32_t blueMask = ReadU32LE(&data[62]);
+        const uint32_t alphaMask = infoHeaderSize >= BMP_INFO_HEADER_MIN_SIZE + 16U ? ReadU32LE(&data[66]) : 0;
+        if (redMask == 0x00ff0000U && greenMask == 0x0000ff00U && blueMask == 0x000000ffU && (alphaMask == 0xff000000U || alphaMask == 0)) {
+            image->format = VK_FORMAT_B8G8R8A8_UNORM;
+        }
+        else if (redMask == 0x000000ffU && greenMask == 0x0000ff00U && blueMask == 0x00ff0000U && (alphaMask == 0xff000000U || alphaMask == 0)) {
+            image->format = VK_FORMAT_R8G8B8A8_UNORM;
+        }
+        else
+        {
+            fprintf(stderr, "%s has BMP color masks other than 8 bits per channel!\n", path);
+            return false;
+        }
+        image->isOpaque = alphaMask == 0;
+    }
+
+    // A negative height marks the rows stored from the top
+    const uint32_t absHeight = height < 0 ? (uint32_t)(-(int64_t)height) : (uint32_t)height;
+    if (width <= 0 || width > MAX_IMAGE_FILE_DIMENSION || absHeight == 0 || absHeight > MAX_IMAGE_FILE_DIMENSION)
+    {
+        fprintf(stderr, "%s has an invalid size of %d x %d!\n", path, width, height);
+        return false;
+    }
+
+    image->width = (uint32_t)width;
+    image->height = absHeight;
+    image->levelCount = 1;
+    image->srcLevelOffsets[0] = pixelOffset;
+    image->srcBytesPerPixel = bitCount / 8U;
+    image->srcRowPitch = ((size_t)image->width * bitCount + 31U) / 32U * 4U;
+    image->isBottomUp = height > 0;
+    if (pixelOffset > image->fileSize || image->srcRowPitch * image->height > image->fileSize - pixelOffset)
+    {
+        fprintf(stderr, "%s is shorter than its BMP pixels!\n", path);
+        return false;
+    }
+
+    return true;
+}
+
+static bool ParseTGAHeader(const char* path, ImageFile* image)
+{
+    const uint8_t* data = image->fileData;
+    if (image->fileSize < TGA_HEADER_SIZE)
+    {
+        fprintf(stderr, "%s is too small for a TGA file!\n", path);
+        return false;
+    }
+
+    const uint32_t idLength = data[0];
+    const uint32_t colorMapType = data[1];
+    const uint32_t imageType = data[2];
+    const uint32_t width = ReadU16LE(&data[12]);
+    const uint32_t height = ReadU16LE(&data[14]);
+    const uint32_t pixelDepth = data[16];
+    const uint32_t descriptor = data[17];
+    if (colorMapType != 0 || (imageType != TGA_IMAGE_TYPE_TRUE_COLOR && imageType != TGA_IMAGE_TYPE_RLE_TRUE_COLOR) ||
+        (pixelDepth != 24 && pixelDepth != 32) || (descriptor & TGA_DESCRIPTOR_RIGHT_TO_LEFT_BIT) != 0)
+    {
+        fprintf(stderr, "%s is not a left to right 24-bit or 32-bit true color TGA file!\n", path);
+        return false;
+    }
+    if (width == 0 || height == 0)
+    {
+        fprintf(stderr, "%s has an invalid size of %u x %u!\n", path, width, height);
+        return false;
+    }
+
+    image->format = VK_FORMAT_B8G8R8A8_UNORM;
+    image->isOpaque = (descriptor & TGA_DESCRIPTOR_ALPHA_BITS_MASK) == 0;
+    image->width = width;
+    image->height = height;
+    image->levelCount = 1;
+    image->srcLevelOffsets[0] = TGA_HEADER_SIZE + idLength;
+    image->srcBytesPerPixel = pixelDepth / 8U;
+    image->srcRowPitch = (size_t)width * image->srcBytesPerPixel;
+    image->isBottomUp = (descriptor & TGA_DESCRIPTOR_TOP_TO_BOTTOM_BIT) == 0;
+    image->isRunLengthEncoded = imageType == TGA_IMAGE_TYPE_RLE_TRUE_COLOR;
+
+    // The length of RLE pixels is only known while they are decoded
+    if (image->srcLevelOffsets[0] > image->fileSize ||
+        (!image->isRunLengthEncoded && image->srcRowPitch * height > image->fileSize - image->srcLevelOffsets[0]))
+    {
+        fprintf(stderr, "%s is shorter than its TGA pixels!\n", path);
+        return false;
+    }
+
+    return true;
+}
+
+// Skips the whitespace and the comments in front of a PPM header field, and parses it
+static bool ParsePPMField(const uint8_t* data, size_t size, size_t* pOffset, uint32_t* outValue)
+{
+    size_t offset = *pOffset;
+    while (offset < size)
+    {
+        if (data[offset] == '#')
+        {
+            while (offset < size && data[offset] != '\n') ++offset;
+        }
+        else if (data[offset] == ' ' || data[offset] == '\t' || data[offset] == '\r' || data[offset] == '\n') {
+            ++offset;
+        }
+        else break;
+    }
+
+    uint32_t value = 0;
+    const size_t start = offset;
+    while (offset < size && data[offset] >= '0' && data[offset] <= '9' && value <= MAX_IMAGE_FILE_DIMENSION) {
+        value = value * 10U + (uint32_t)(data[offset++] - '0');
+    }
+    *pOffset = offset;
+    *outValue = value;
+
+    return offset > start;
+}
+
+static bool ParsePPMHeader(const char* path, ImageFile* image)
+{
+    const uint8_t* data = image->fileData;
+    size_t offset = 2;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t maxValue = 0;
+    if (!ParsePPMField(data, image->fileSize, &offset, &width) || !ParsePPMField(data, image->fileSize, &offset, &height) ||
+        !ParsePPMField(data, image->fileSize, &offset, &maxValue) || offset >= image->fileSize)
+    {
+        fprintf(stderr, "%s has an invalid PPM header!\n", path);
+        return false;
+    }
+    if (maxValue != 255U)
+    {
+        fprintf(stderr, "%s is not an 8-bit PPM file!\n", path);
+        return false;
+    }
+    if (width == 0 || width > MAX_IMAGE_FILE_DIMENSION || height == 0 || height > MAX_IMAGE_FILE_DIMENSION)
+    {
+        fprintf(stderr, "%s has an invalid size of %u x %u!\n", path, width, height);
+        return false;
+    }
+
+    image->format = VK_FORMAT_R8G8B8A8_UNORM;
+    image->isOpaque = true;
+    image->width = width;
+    image->height = height;
+    image->levelCount = 1;
+    // A single whitespace separates the header from the pixels
+    image->srcLevelOffsets[0] = offset + 1U;
+    image->srcBytesPerPixel = 3U;
+    image->srcRowPitch = (size_t)width * 3U;
+    image->isBottomUp = false;
+    if (image->srcRowPitch * height > image->fileSize - image->srcLevelOffsets[0])
+    {
+        fprintf(stderr, "%s is shorter than its PPM pixels!\n", path);
+        return false;
+    }
+
+    return true;
+}
+
+static bool ParseKTX2Header(const char* path, ImageFile* image)
+{
+    const uint8_t* data = image->fileData;
+    if (image->fileSize < KTX2_HEADER_SIZE)
+    {
+        fprintf(stderr, "%s is too small for a KTX2 file!\n", path);
+        return false;
+    }
+
+    const VkFormat format = (VkFormat)ReadU32LE(&data[12]);
+    const uint32_t width = ReadU32LE(&data[20]);
+    const uint32_t height = ReadU32LE(&data[24]);
+    const uint32_t depth = ReadU32LE(&data[28]);
+    const uint32_t layerCount = ReadU32LE(&data[32]);
+    const uint32_t faceCount = ReadU32LE(&data[36]);
+    // 0 asks the loader to generate the levels, which the single level of the file does not prevent
+    const uint32_t levelCount = max(ReadU32LE(&data[40]), 1U);
+    const uint32_t supercompressionScheme = ReadU32LE(&data[44]);
+    // There is no CPU decoder to fall back on for ASTC, which most desktop GPUs cannot sample
+    const bool isASTC = (format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK) ||
+                        (format >= VK_FORMAT_ASTC_4x4_SFLOAT_BLOCK_EXT && format <= VK_FORMAT_ASTC_12x12_SFLOAT_BLOCK_EXT);
+    if (isASTC)
+    {
+        fprintf(stderr, "%s holds ASTC blocks (format %d), which are not supported. Re-encode it as BC1, BC3, BC7 or ETC2!\n", path, format);
+        return false;
+    }
+    if (GetTextureFormatInfo(format) == NULL)
+    {
+        fprintf(stderr, "%s has the unsupported KTX2 format %d!\n", path, format);
+        return false;
+    }
+    if (depth > 1 || layerCount > 1 || faceCount != 1 || supercompressionScheme != 0)
+    {
+        fprintf(stderr, "%s is not a plain 2D KTX2 texture without supercompression!\n", path);
+        return false;
+    }
+    if (width == 0 || width > MAX_IMAGE_FILE_DIMENSION || height == 0 || height > MAX_IMAGE_FILE_DIMENSION || levelCount > MAX_IMAGE_FILE_LEVEL_COUNT)
+    {
+        fprintf(stderr, "%s has an invalid size of %u x %u with %u levels!\n", path, width, height, levelCount);
+        return false;
+    }
+    if (image->fileSize - KTX2_HEADER_SIZE < (size_t)levelCount * KTX2_LEVEL_INDEX_ENTRY_SIZE)
+    {
+        fprintf(stderr, "%s is shorter than its KTX2 level index!\n", path);
+        return false;
+    }
+
+    image->format = format;
+    image->fileFormat = format;
+    image->isOpaque = false;
+    image->width = width;
+    image->height = height;
+    image->levelCount = levelCount;
+    ComputeImageFileLevels(image);
+
+    for (uint32_t level = 0; level < levelCount; ++level)
+    {
+        const uint8_t* entry = &data[KTX2_HEADER_SIZE + level * KTX2_LEVEL_INDEX_ENTRY_SIZE];
+        const uint64_t byteOffset = ReadU64LE(entry);
+        const uint64_t byteLength = ReadU64LE(&entry[8]);
+        if (byteLength != image->levelSizes[level] || byteOffset > image->fileSize || byteLength > image->fileSize - byteOffset)
+        {
+            fprintf(stderr, "Level %u of %s is not a tightly packed level inside the file!\n", level, path);
+            return false;
+        }
+        image->srcLevelOffsets[level] = (size_t)byteOffset;
+    }
+
+    return true;
+}
+
+bool OpenImageFile(const char* path, ImageFile* outImage)
+{
+    memset(outImage, 0, sizeof(*outImage));
+
+    outImage->fileData = MapFileForReading(path, &outImage->fileSize);
+    if (outImage->fileData == NULL)
+    {
+        fprintf(stderr, "Failed to map the image file %s!\n", path);
+        return false;
+    }
+
+    // TGA is the only one without a signature
+    const uint8_t* data = outImage->fileData;
+    const size_t size = outImage->fileSize;
+    bool parsed = false;
+    if (size >= sizeof(s_ktx2Identifier) && memcmp(data, s_ktx2Identifier, sizeof(s_ktx2Identifier)) == 0)
+    {
+        outImage->type = IMAGE_FILE_TYPE_KTX2;
+        parsed = ParseKTX2Header(path, outImage);
+    }
+    else if (size >= 2 && data[0] == 'B' && data[1] == 'M')
+    {
+        outImage->type = IMAGE_FILE_TYPE_BMP;
+        parsed = ParseBMPHeader(path, outImage);
+    }
+    else if (size >= 2 && data[0] == 'P' && data[1] == '6')
+    {
+        outImage->type = IMAGE_FILE_TYPE_PPM;
+        parsed = ParsePPMHeader(path, outImage);
+    }
+    else
+    {
+        outImage->type = IMAGE_FILE_TYPE_TGA;
+        parsed = ParseTGAHeader(path, outImage);
+    }
+
+    if (!parsed)
+    {
+        CloseImageFile(outImage);
+        return false;
+    }
+
+    if (outImage->type != IMAGE_FILE_TYPE_KTX2)
+    {
+        outImage->fileFormat = outImage->format;
+        ComputeImageFileLevels(outImage);
+    }
+
+    return true;
+}
+
+void CloseImageFile(ImageFile* image)
+{
+    if (image->fileData != NULL) {
+        UnmapFile(image->fileData, image->fileSize);
+    }
+    memset(image, 0, sizeof(*image));
+}
+
+// Expands 3-byte pixels to 4 bytes with an opaque alpha, keeping the channel order
+static void ExpandPixelsToFourChannels(uint8_t* dst, const uint8_t* src, uint32_t pixelCount)
+{
+    for (uint32_t x = 0; x < pixelCount; ++x)
+    {
+        const uint32_t pixel = (uint32_t)src[x * 3U] | ((uint32_t)src[x * 3U + 1U] << 8) | ((uint32_t)src[x * 3U + 2U] << 16) | 0xff000000U;
+        memcpy(&dst[x * 4U], &pixel, sizeof(pixel));
+    }
+}
+
+static bool DecodeTGARunLengthPixels(const ImageFile* image, uint8_t* dst)
+{
+    const uint8_t* src = &image->fileData[image->srcLevelOffsets[0]];
+    const uint8_t* srcEnd = &image->fileData[image->fileSize];
+    const uint32_t srcPixelSize = image->srcBytesPerPixel;
+    const size_t dstRowPitch = (size_t)image->width * 4U;
+
+    // Packets may run across rows, so the pixels are counted over the whole image.
+    uint32_t x = 0;
+    uint32_t y = 0;
+    while (y < image->height)
+    {
+        if (src >= srcEnd) return false;
+        const uint32_t header = *src++;
+        const uint32_t count = (header & 0x7fU) + 1U;
+        const bool isRun = (header & 0x80U) != 0;
+        if ((size_t)(srcEnd - src) < (size_t)(isRun ? 1U : count) * srcPixelSize) return false;
+
+        for (uint32_t i = 0; i < count && y < image->height; ++i)
+        {
+            const uint8_t* srcPixel = isRun ? src : &src[i * srcPixelSize];
+            const uint32_t pixel = (uint32_t)srcPixel[0] | ((uint32_t)srcPixel[1] << 8) | ((uint32_t)srcPixel[2] << 16) |
+                                    (srcPixelSize == 4U ? (uint32_t)srcPixel[3] << 24 : 0xff000000U);
+            const uint32_t dstRow = image->isBottomUp ? image->height - 1U - y : y;
+            memcpy(&dst[dstRow * dstRowPitch + x * 4U], &pixel, sizeof(pixel));
+
+            if (++x == image->width)
+            {
+                x = 0;
+                ++y;
+            }
+        }
+        src += (isRun ? 1U : count) * srcPixelSize;
+    }
+
+    return true;
+}
+
+bool RequestImageFileDecompression(ImageFile* image)
+{
+    const TextureFormatInfo* fileFormatInfo = GetTextureFormatInfo(image->fileFormat);
+    if (fileFormatInfo->decodeBlock == NULL)
+    {
+        fprintf(stderr, "%s blocks cannot be decompressed on the CPU!\n", fileFormatInfo->name);
+        return false;
+    }
+
+    image->format = fileFormatInfo->decodedFormat;
+    ComputeImageFileLevels(image);
+    return true;
+}
+
+// Decodes a level of 4 x 4 blocks into RGBA texels, leaving out the part of the edge blocks outside the level
+static bool DecompressBlockLevel(const TextureFormatInfo* formatInfo, const uint8_t* src, uint32_t width, uint32_t height, uint8_t* dst)
+{
+    const uint32_t blockCountX = (width + 3U) / 4U;
+    const uint32_t blockCountY = (height + 3U) / 4U;
+    for (uint32_t blockY = 0; blockY < blockCountY; ++blockY)
+    {
+        for (uint32_t blockX = 0; blockX < blockCountX; ++blockX)
+        {
+            uint8_t texels[TEXTURE_BLOCK_TEXEL_COUNT * 4];
+            if (!formatInfo->decodeBlock(&src[((size_t)blockY * blockCountX + blockX) * formatInfo->blockSize], texels)) return false;
+
+            const uint32_t columnCount = min(width - blockX * 4U, 4U);
+            const uint32_t rowCount = min(height - blockY * 4U, 4U);
+            for (uint32_t row = 0; row < rowCount; ++row) {
+                memcpy(&dst[(((size_t)blockY * 4U + row) * width + blockX * 4U) * 4U], &texels[row * 16U], columnCount * 4U);
+            }
+        }
+    }
+    return true;
+}
+
+bool DecodeImageFile(const ImageFile* image, void* dst)
+{
+    uint8_t* dstBytes = dst;
+
+    // KTX2 levels are already in their final layout, unless their blocks are decompressed.
+    if (image->type == IMAGE_FILE_TYPE_KTX2)
+    {
+        const TextureFormatInfo* fileFormatInfo = GetTextureFormatInfo(image->fileFormat);
+        for (uint32_t level = 0; level < image->levelCount; ++level)
+        {
+            const uint8_t* src = &image->fileData[image->srcLevelOffsets[level]];
+            if (image->format == image->fileFormat) {
+                memcpy(&dstBytes[image->levelOffsets[level]], src, (size_t)image->levelSizes[level]);
+            }
+            else if (!DecompressBlockLevel(fileFormatInfo, src, max(image->width >> level, 1U), max(image->height >> level, 1U), &dstBytes[image->levelOffsets[level]]))
+            {
+                fprintf(stderr, "Level %u holds %s blocks that cannot be decompressed on the CPU!\n", level, fileFormatInfo->name);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    if (image->isRunLengthEncoded)
+    {
+        if (!DecodeTGARunLengthPixels(image, dstBytes))
+        {
+            fprintf(stderr, "The RLE pixels of a TGA file end early!\n");
+            return false;
+        }
+        return true;
+    }
+
+    // The rows are written top to bottom into `dst`, which may be write-combined memory, while the mapped file is read in whichever order it stores them.
+    const size_t dstRowPitch = (size_t)image->width * 4U;
+    const uint8_t* pixels = &image->fileData[image->srcLevelOffsets[0]];
+    for (uint32_t y = 0; y < image->height; ++y)
+    {
+        const uint8_t* srcRow = &pixels[(image->isBottomUp ? image->height - 1U - y : y) * image->srcRowPitch];
+        uint8_t* dstRow = &dstBytes[y * dstRowPitch];
+        if (image->srcBytesPerPixel == 4U) {
+            memcpy(dstRow, srcRow, dstRowPitch);
+        }
+        else {
+            ExpandPixelsToFourChannels(dstRow, srcRow, image->width);
+        }
+    }
+
+    return true;
+}
+
@@ -0,0 +1,950 @@
+#include "common.h"
+#include <threads.h>
+
+// Device memory is allocated in large blocks per memory type and sub-allocated with a binary buddy allocator.
+// Every block is a complete binary tree whose leaves are MIN_SUBALLOCATION_SIZE bytes. A node at level `k` covers
+// (MIN_SUBALLOCATION_SIZE << k) bytes and its offset is a multiple of that size, so any power-of-two alignment up to
+// the node size is satisfied for free. `largestFreeLevels[node]` holds 1 + the level of the largest free node in its subtree,
+// or 0 when the whole subtree is in use.
+
+enum
+{
+    MIN_SUBALLOCATION_SIZE_LOG2 = 8,
+    MIN_SUBALLOCATION_SIZE = 1 << MIN_SUBALLOCATION_SIZE_LOG2,      // 256 bytes
+    MAX_MEMORY_BLOCK_SIZE_LOG2 = 26,            // 64MB
+    MIN_MEMORY_BLOCK_SIZE_LOG2 = 20,            // 1MB
+    MAX_MEMORY_BLOCKS_PER_POOL = 64
+};
+
+typedef enum ResourceTiling
+{
+    RESOURCE_TILING_LINEAR,                     // buffers and linear images
+    RESOURCE_TILING_OPTIMAL,                    // optimal tiling images
+    RESOURCE_TILING_COUNT
+} ResourceTiling;
+
+struct DeviceMemoryBlock
+{
+    VkDeviceMemory memory;
+    uint8_t* mappedData;
+    uint8_t* largestFreeLevels;
+    uint32_t levelCount;                        // the root node level, i.e. log2(block size / MIN_SUBALLOCATION_SIZE)
+    uint32_t allocationCount;
+    VkDeviceSize usedSize;
+};
+
+typedef struct DeviceMemoryPool
+{
+    DeviceMemoryBlock* blocks[MAX_MEMORY_BLOCKS_PER_POOL];
+    uint32_t blockCount;
+} DeviceMemoryPool;
+
+static struct
+{
+    VkDevice device;
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    VkDeviceSize bufferImageGranularity;
+    uint32_t maxMemoryAllocationCount;
+    // Linear and optimal resources only need separate blocks when the granularity is coarser than the smallest buddy node
+    bool separateOptimalResources;
+    uint32_t blockSizeLog2s[VK_MAX_MEMORY_HEAPS];
+    DeviceMemoryPool pools[VK_MAX_MEMORY_TYPES][RESOURCE_TILING_COUNT];
+    DeviceMemoryStatistics stats[VK_MAX_MEMORY_TYPES];
+    mtx_t lock;
+    bool initialized;
+} s_allocator;
+
+typedef struct MemoryUsagePolicy
+{
+    const char* name;
+    VkMemoryPropertyFlags requiredFlags;        // a type without all of these is never chosen
+    VkMemoryPropertyFlags preferredFlags;       // each present flag adds to the score
+    VkMemoryPropertyFlags unwantedFlags;        // each present flag subtracts from the score
+} MemoryUsagePolicy;
+
+static const MemoryUsagePolicy s_memoryUsagePolicies[DEVICE_MEMORY_USAGE_COUNT] = {
+    [DEVICE_MEMORY_USAGE_GPU_ONLY] = {
+        .name = "GPU only",
+        .requiredFlags = 0,
+        .preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        // Keep the small BAR heap free for the resources the CPU writes
+        .unwantedFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT
+    },
+    [DEVICE_MEMORY_USAGE_STAGING_UPLOAD] = {
+        .name = "staging upload",
+        .requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        .preferredFlags = 0,
+        // Sequential writes want write-combined system memory, not the BAR heap or cached memory
+        .unwantedFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT
+    },
+    [DEVICE_MEMORY_USAGE_READBACK] = {
+        .name = "readback",
+        .requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        // Reading uncached memory from the CPU is extremely slow
+        .preferredFlags = VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+        .unwantedFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+    },
+    [DEVICE_MEMORY_USAGE_DYNAMIC] = {
+        .name = "per-frame dynamic",
+        .requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        // Device local host visible memory (BAR / ReBAR) lets the GPU read the data without crossing PCIe
+        .preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        .unwantedFlags = VK_MEMORY_PROPERTY_HOST_CACHED_BIT
+    },
+    [DEVICE_MEMORY_USAGE_TRANSIENT] = {
+        .name = "transient attachment",
+        .requiredFlags = 0,
+        .preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT,
+        .unwantedFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+    }
+};
+
+static uint32_t CountBits(uint32_t value)
+{
+    uint32_t count = 0;
+    for (; value != 0; value &= value - 1U) {
+        ++count;
+    }
+    return count;
+}
+
+static uint32_t CeilLog2(VkDeviceSize value)
+{
+    uint32_t result = 0;
+    while ((VkDeviceSize)1 << result < value) {
+        ++result;
+    }
+    return result;
+}
+
+static uint32_t FloorLog2(VkDeviceSize value)
+{
+    uint32_t result = 0;
+    while (value > 1)
+    {
+        value >>= 1;
+        ++result;
+    }
+    return result;
+}
+
+static void UpdateBuddyParent(uint8_t* largestFreeLevels, uint32_t node, uint32_t level)
+{
+    const uint8_t left = largestFreeLevels[node * 2];
+    const uint8_t right = largestFreeLevels[node * 2 + 1];
+    // Both children are entirely free, so they merge back into this node.
+    if (left == level && right == level) {
+        largestFreeLevels[node] = (uint8_t)(level + 1);
+    }
+    else {
+        largestFreeLevels[node] = max(left, right);
+    }
+}
+
+// Returns the offset in units of MIN_SUBALLOCATION_SIZE, or UINT32_MAX if there is no free node at `level`
+static uint32_t AllocateBuddyNode(DeviceMemoryBlock* block, uint32_t level)
+{
+    uint8_t* largestFreeLevels = block->largestFreeLevels;
+    if (largestFreeLevels[1] < level + 1) return UINT32_MAX;
+
+    uint32_t node = 1;
+    for (uint32_t currLevel = block->levelCount; currLevel > level; --currLevel)
+    {
+        node *= 2;
+        if (largestFreeLevels[node] < level + 1) {
+            ++node;
+        }
+    }
+    largestFreeLevels[node] = 0;
+
+    const uint32_t unitOffset = (node - (1U << (block->levelCount - level))) << level;
+    for (uint32_t currLevel = level + 1; node > 1; ++currLevel)
+    {
+        node /= 2;
+        UpdateBuddyParent(largestFreeLevels, node, currLevel);
+    }
+    return unitOffset;
+}
+
+static void FreeBuddyNode(DeviceMemoryBlock* block, uint32_t unitOffset, uint32_t level)
+{
+    uint32_t node = (1U << (block->levelCount - level)) + (unitOffset >> level);
+    block->largestFreeLevels[node] = (uint8_t)(level + 1);
+    for (uint32_t currLevel = level + 1; node > 1; ++currLevel)
+    {
+        node /= 2;
+        UpdateBuddyParent(block->largestFreeLevels, node, currLevel);
+    }
+}
+
+static bool IsHostVisibleMemoryType(uint32_t memoryTypeIndex)
+{
+    return (s_allocator.memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+}
+
+// Allocates a VkDeviceMemory and maps it persistently if it is host visible
+static bool AllocateRawDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, const void* pNext, VkDeviceMemory* outMemory, uint8_t** outMappedData)
+{
+    const VkMemoryAllocateInfo memAllocInfo = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .pNext = pNext,
+        .allocationSize = size,
+        .memoryTypeIndex = memoryTypeIndex
+    };
+    VkResult res = vkAllocateMemory(s_allocator.device, &memAllocInfo, NULL, outMemory);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkAllocateMemory of %llu bytes for memory type %u failed: %d\n", (unsigned long long)size, memoryTypeIndex, res);
+        return false;
+    }
+
+    *outMappedData = NULL;
+    if (IsHostVisibleMemoryType(memoryTypeIndex))
+    {
+        res = vkMapMemory(s_allocator.device, *outMemory, 0, VK_WHOLE_SIZE, 0, (void**)outMappedData);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkMapMemory for memory type %u failed: %d\n", memoryTypeIndex, res);
+            vkFreeMemory(s_allocator.device, *outMemory, NULL);
+            *outMemory = VK_NULL_HANDLE;
+            return false;
+        }
+    }
+    return true;
+}
+
+static void FreeRawDeviceMemory(VkDeviceMemory memory, bool isMapped)
+{
+    if (isMapped) {
+        vkUnmapMemory(s_allocator.device, memory);
+    }
+    vkFreeMemory(s_allocator.device, memory, NULL);
+}
+
+static DeviceMemoryBlock* CreateMemoryBlock(uint32_t memoryTypeIndex)
+{
+    const uint32_t heapIndex = s_allocator.memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+    const uint32_t blockSizeLog2 = s_allocator.blockSizeLog2s[heapIndex];
+
+    DeviceMemoryBlock* block = calloc(1, sizeof(*block));
+    if (block == NULL) return NULL;
+
+    block->levelCount = blockSizeLog2 - MIN_SUBALLOCATION_SIZE_LOG2;
+    block->largestFreeLevels = malloc((size_t)2 << block->levelCount);
+    if (block->largestFreeLevels == NULL)
+    {
+        free(block);
+        return NULL;
+    }
+    if (!AllocateRawDeviceMemory((VkDeviceSize)1 << blockSizeLog2, memoryTypeIndex, NULL, &block->memory, &block->mappedData))
+    {
+        free(block->largestFreeLevels);
+        free(block);
+        return NULL;
+    }
+
+    // Every node starts out free
+    for (uint32_t depth = 0; depth <= block->levelCount; ++depth)
+    {
+        const uint32_t firstNode = 1U << depth;
+        memset(&block->largestFreeLevels[firstNode], (int)(block->levelCount - depth + 1), firstNode);
+    }
+
+    DeviceMemoryStatistics* stats = &s_allocator.stats[memoryTypeIndex];
+    ++stats->blockCount;
+    stats->blockBytes += (VkDeviceSize)1 << blockSizeLog2;
+    ++stats->deviceMemoryAllocationCount;
+
+    return block;
+}
+
+static void DestroyMemoryBlock(DeviceMemoryBlock* block, uint32_t memoryTypeIndex)
+{
+    DeviceMemoryStatistics* stats = &s_allocator.stats[memoryTypeIndex];
+    --stats->blockCount;
+    stats->blockBytes -= (VkDeviceSize)MIN_SUBALLOCATION_SIZE << block->levelCount;
+
+    FreeRawDeviceMemory(block->memory, block->mappedData != NULL);
+    free(block->largestFreeLevels);
+    free(block);
+}
+
+static uint32_t GetTotalDeviceMemoryCount(void)
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < s_allocator.memoryProperties.memoryTypeCount; ++i) {
+        count += s_allocator.stats[i].blockCount + s_allocator.stats[i].dedicatedAllocationCount;
+    }
+    return count;
+}
+
+uint32_t FindMemoryTypeIndex(uint32_t memoryTypeBits, DeviceMemoryUsage usage)
+{
+    const VkPhysicalDeviceMemoryProperties* memoryProperties = &s_allocator.memoryProperties;
+    const MemoryUsagePolicy* policy = &s_memoryUsagePolicies[usage];
+
+    // A preferred flag weighs twice as much as an unwanted one. On a tie the lower index wins, since the drivers list the faster types first.
+    uint32_t bestIndex = UINT32_MAX;
+    int bestScore = INT32_MIN;
+    for (uint32_t i = 0; i < memoryProperties->memoryTypeCount; ++i)
+    {
+        if ((memoryTypeBits & (1U << i)) == 0U) continue;
+
+        const VkMemoryPropertyFlags flags = memoryProperties->memoryTypes[i].propertyFlags;
+        if ((flags & policy->requiredFlags) != policy->requiredFlags) continue;
+        // Protected memory is only accessible from protected queues
+        if ((flags & VK_MEMORY_PROPERTY_PROTECTED_BIT) != 0) continue;
+
+        const int score = 10 * (int)CountBits(flags & policy->preferredFlags) - 5 * (int)CountBits(flags & policy->unwantedFlags);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestIndex = i;
+        }
+    }
+    return bestIndex;
+}
+
+VkMemoryPropertyFlags GetMemoryTypePropertyFlags(uint32_t memoryTypeIndex)
+{
+    if (memoryTypeIndex >= s_allocator.memoryProperties.memoryTypeCount) return 0;
+
+    return s_allocator.memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+}
+
+static void PrintMemoryPropertyFlags(VkMemoryPropertyFlags flags)
+{
+    static const struct { VkMemoryPropertyFlags flag; const char* name; } flagNames[] = {
+        { VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "DEVICE_LOCAL" },
+        { VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, "HOST_VISIBLE" },
+        { VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "HOST_COHERENT" },
+        { VK_MEMORY_PROPERTY_HOST_CACHED_BIT, "HOST_CACHED" },
+        { VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, "LAZILY_ALLOCATED" },
+        { VK_MEMORY_PROPERTY_PROTECTED_BIT, "PROTECTED" }
+    };
+
+    bool isFirst = true;
+    for (size_t i = 0; i < sizeof(flagNames) / sizeof(flagNames[0]); ++i)
+    {
+        if ((flags & flagNames[i].flag) == 0) continue;
+
+        printf("%s%s", isFirst ? "" : " | ", flagNames[i].name);
+        isFirst = false;
+    }
+    if (isFirst) {
+        printf("none");
+    }
+}
+
+static void PrintMemoryTypeReport(void)
+{
+    const VkPhysicalDeviceMemoryProperties* memoryProperties = &s_allocator.memoryProperties;
+    for (uint32_t i = 0; i < memoryProperties->memoryTypeCount; ++i)
+    {
+        const uint32_t heapIndex = memoryProperties->memoryTypes[i].heapIndex;
+        printf("    memory type %u (heap %u, %llu MB): ", i, heapIndex, (unsigned long long)(memoryProperties->memoryHeaps[heapIndex].size >> 20));
+        PrintMemoryPropertyFlags(memoryProperties->memoryTypes[i].propertyFlags);
+        puts("");
+    }
+
+    // Report the choice for resources that may live in any memory type; the real type bits of a resource may narrow it down.
+    const uint32_t allTypeBits = (1U << memoryProperties->memoryTypeCount) - 1U;
+    for (uint32_t usage = 0; usage < DEVICE_MEMORY_USAGE_COUNT; ++usage)
+    {
+        const uint32_t memoryTypeIndex = FindMemoryTypeIndex(allTypeBits, (DeviceMemoryUsage)usage);
+        if (memoryTypeIndex == UINT32_MAX) {
+            printf("    %-22s-> no suitable memory type\n", s_memoryUsagePolicies[usage].name);
+        }
+        else {
+            printf("    %-22s-> memory type %u\n", s_memoryUsagePolicies[usage].name, memoryTypeIndex);
+        }
+    }
+}
+
+bool InitializeDeviceMemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device)
+{
+    memset(&s_allocator, 0, sizeof(s_allocator));
+    if (mtx_init(&s_allocator.lock, mtx_plain) != thrd_success)
+    {
+        fprintf(stderr, "mtx_init for the device memory allocator failed!\n");
+        return false;
+    }
+
+    s_allocator.device = device;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &s_allocator.memoryProperties);
+
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(physicalDevice, &props);
+    s_allocator.bufferImageGranularity = props.limits.bufferImageGranularity;
+    s_allocator.maxMemoryAllocationCount = props.limits.maxMemoryAllocationCount;
+    s_allocator.separateOptimalResources = s_allocator.bufferImageGranularity > MIN_SUBALLOCATION_SIZE;
+
+    for (uint32_t i = 0; i < s_allocator.memoryProperties.memoryHeapCount; ++i)
+    {
+        // Small heaps (e.g. the 256MB BAR heap) get smaller blocks so that a few blocks do not exhaust them.
+        const uint32_t heapSizeLog2 = FloorLog2(s_allocator.memoryProperties.memoryHeaps[i].size);
+        uint32_t blockSizeLog2 = heapSizeLog2 > 3 ? heapSizeLog2 - 3 : 0;
+        blockSizeLog2 = min(blockSizeLog2, (uint32_t)MAX_MEMORY_BLOCK_SIZE_LOG2);
+        s_allocator.blockSizeLog2s[i] = max(blockSizeLog2, (uint32_t)MIN_MEMORY_BLOCK_SIZE_LOG2);
+    }
+
+    printf("Device memory allocator: bufferImageGranularity = %llu, maxMemoryAllocationCount = %u, %s blocks for linear and optimal resources\n",
+        (unsigned long long)s_allocator.bufferImageGranularity, s_allocator.maxMemoryAllocationCount,
+        s_allocator.separateOptimalResources ? "separate" : "shared");
+    PrintMemoryTypeReport();
+
+    s_allocator.initialized = true;
+    return true;
+}
+
+void DestroyDeviceMemoryAllocator(void)
+{
+    if (!s_allocator.initialized) return;
+
+    for (uint32_t typeIndex = 0; typeIndex < s_allocator.memoryProperties.memoryTypeCount; ++typeIndex)
+    {
+        for (uint32_t tiling = 0; tiling < RESOURCE_TILING_COUNT; ++tiling)
+        {
+            DeviceMemoryPool* pool = &s_allocator.pools[typeIndex][tiling];
+            for (uint32_t i = 0; i < pool->blockCount; ++i)
+            {
+                if (pool->blocks[i]->allocationCount > 0) {
+                    fprintf(stderr, "WARNING: %u allocations are still alive in a block of memory type %u!\n", pool->blocks[i]->allocationCount, typeIndex);
+                }
+                DestroyMemoryBlock(pool->blocks[i], typeIndex);
+            }
+            pool->blockCount = 0;
+        }
+    }
+
+    mtx_destroy(&s_allocator.lock);
+    s_allocator.initialized = false;
+}
+
+static bool AllocateDedicatedMemory(VkDeviceSize size, uint32_t memoryTypeIndex, const VkMemoryDedicatedAllocateInfo* dedicatedInfo,
+                                    DeviceMemoryAllocation* outAllocation)
+{
+    uint8_t* mappedData = NULL;
+    if (!AllocateRawDeviceMemory(size, memoryTypeIndex, dedicatedInfo, &outAllocation->memory, &mappedData)) return false;
+
+    outAllocation->offset = 0;
+    outAllocation->size = size;
+    outAllocation->mappedData = mappedData;
+    outAllocation->memoryTypeIndex = memoryTypeIndex;
+    outAllocation->block = NULL;
+
+    DeviceMemoryStatistics* stats = &s_allocator.stats[memoryTypeIndex];
+    ++stats->dedicatedAllocationCount;
+    stats->dedicatedBytes += size;
+    ++stats->deviceMemoryAllocationCount;
+    return true;
+}
+
+// `level` is the buddy level that holds the requested size and alignment
+static bool SubAllocateMemory(VkDeviceSize size, uint32_t level, uint32_t memoryTypeIndex, ResourceTiling tiling, DeviceMemoryAllocation* outAllocation)
+{
+    if (!s_allocator.separateOptimalResources) {
+        tiling = RESOURCE_TILING_LINEAR;
+    }
+    DeviceMemoryPool* pool = &s_allocator.pools[memoryTypeIndex][tiling];
+
+    DeviceMemoryBlock* block = NULL;
+    uint32_t unitOffset = UINT32_MAX;
+    for (uint32_t i = 0; i < pool->blockCount && unitOffset == UINT32_MAX; ++i)
+    {
+        block = pool->blocks[i];
+        unitOffset = AllocateBuddyNode(block, level);
+    }
+
+    if (unitOffset == UINT32_MAX)
+    {
+        if (pool->blockCount == MAX_MEMORY_BLOCKS_PER_POOL || GetTotalDeviceMemoryCount() >= s_allocator.maxMemoryAllocationCount) return false;
+
+        block = CreateMemoryBlock(memoryTypeIndex);
+        if (block == NULL) return false;
+
+        pool->blocks[pool->blockCount++] = block;
+        unitOffset = AllocateBuddyNode(block, level);
+    }
+
+    const VkDeviceSize nodeSize = (VkDeviceSize)MIN_SUBALLOCATION_SIZE << level;
+    block->usedSize += nodeSize;
+    ++block->allocationCount;
+
+    outAllocation->memory = block->memory;
+    outAllocation->offset = (VkDeviceSize)unitOffset << MIN_SUBALLOCATION_SIZE_LOG2;
+    outAllocation->size = size;
+    outAllocation->mappedData = block->mappedData != NULL ? block->mappedData + outAllocation->offset : NULL;
+    outAllocation->memoryTypeIndex = memoryTypeIndex;
+    outAllocation->block = block;
+    outAllocation->level = level;
+    outAllocation->tiling = (uint32_t)tiling;
+
+    DeviceMemoryStatistics* stats = &s_allocator.stats[memoryTypeIndex];
+    ++stats->subAllocationCount;
+    stats->usedBytes += nodeSize;
+    stats->requestedBytes += size;
+    return true;
+}
+
+static bool AllocateMemoryLocked(const VkMemoryRequirements* requirements, DeviceMemoryUsage usage, ResourceTiling tiling,
+                                const VkMemoryDedicatedAllocateInfo* dedicatedInfo, DeviceMemoryAllocation* outAllocation)
+{
+    const uint32_t memoryTypeIndex = FindMemoryTypeIndex(requirements->memoryTypeBits, usage);
+    if (memoryTypeIndex == UINT32_MAX)
+    {
+        fprintf(stderr, "No memory type in the type bits 0x%x is suitable for %s memory!\n", requirements->memoryTypeBits, s_memoryUsagePolicies[usage].name);
+        return false;
+    }
+
+    const uint32_t heapIndex = s_allocator.memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+    const uint32_t blockSizeLog2 = s_allocator.blockSizeLog2s[heapIndex];
+    const uint32_t sizeLog2 = CeilLog2(max(max(requirements->size, requirements->alignment), (VkDeviceSize)MIN_SUBALLOCATION_SIZE));
+
+    // Resources that want their own memory, or that would take more than half a block, bypass the blocks.
+    if (dedicatedInfo == NULL && sizeLog2 < blockSizeLog2)
+    {
+        if (SubAllocateMemory(requirements->size, sizeLog2 - MIN_SUBALLOCATION_SIZE_LOG2, memoryTypeIndex, tiling, outAllocation)) {
+            return true;
+        }
+        // Fall back to an allocation of the exact size, which may still fit into an almost full heap.
+    }
+
+    if (GetTotalDeviceMemoryCount() >= s_allocator.maxMemoryAllocationCount)
+    {
+        fprintf(stderr, "The number of device memory allocations has reached maxMemoryAllocationCount (%u)!\n", s_allocator.maxMemoryAllocationCount);
+        return false;
+    }
+    return AllocateDedicatedMemory(requirements->size, memoryTypeIndex, dedicatedInfo, outAllocation);
+}
+
+bool AllocateDeviceMemory(const VkMemoryRequirements* requirements, DeviceMemoryUsage usage, bool isOptimalTilingImage, DeviceMemoryAllocation* outAllocation)
+{
+    memset(outAllocation, 0, sizeof(*outAllocation));
+
+    mtx_lock(&s_allocator.lock);
+    const bool succeeded = AllocateMemoryLocked(requirements, usage, isOptimalTilingImage ? RESOURCE_TILING_OPTIMAL : RESOURCE_TILING_LINEAR, NULL, outAllocation);
+    mtx_unlock(&s_allocator.lock);
+    return succeeded;
+}
+
+bool AllocateAndBindBufferMemory(VkBuffer buffer, DeviceMemoryUsage usage, DeviceMemoryAllocation* outAllocation)
+{
+    memset(outAllocation, 0, sizeof(*outAllocation));
+
+    VkMemoryDedicatedRequirements dedicatedRequirements = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS,
+        .pNext = NULL
+    };
+    VkMemoryRequirements2 memoryRequirements = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2,
+        .pNext = &dedicatedRequirements
+    };
+    const VkBufferMemoryRequirementsInfo2 requirementsInfo = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2,
+        .pNext = NULL,
+        .buffer = buffer
+    };
+    vkGetBufferMemoryRequirements2(s_allocator.device, &requirementsInfo, &memoryRequirements);
+
+    const VkMemoryDedicatedAllocateInfo dedicatedInfo = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO,
+        .pNext = NULL,
+        .image = VK_NULL_HANDLE,
+        .buffer = buffer
+    };
+    const bool useDedicated = dedicatedRequirements.prefersDedicatedAllocation != VK_FALSE || dedicatedRequirements.requiresDedicatedAllocation != VK_FALSE;
+
+    mtx_lock(&s_allocator.lock);
+    bool succeeded = AllocateMemoryLocked(&memoryRequirements.memoryRequirements, usage, RESOURCE_TILING_LINEAR,
+                                        useDedicated ? &dedicatedInfo : NULL, outAllocation);
+    mtx_unlock(&s_allocator.lock);
+    if (!succeeded) return false;
+
+    const VkResult res = vkBindBufferMemory(s_allocator.device, buffer, outAllocation->memory, outAllocation->offset);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkBindBufferMemory failed: %d\n", res);
+        FreeDeviceMemory(outAllocation);
+        return false;
+    }
+    return true;
+}
+
+bool AllocateAndBindImageMemory(VkImage image, DeviceMemoryUsage usage, DeviceMemoryAllocation* outAllocation)
+{
+    memset(outAllocation, 0, sizeof(*outAllocation));
+
+    VkMemoryDedicatedRequirements dedicatedRequirements = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS,
+        .pNext = NULL
+    };
+    VkMemoryRequirements2 memoryRequirements = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2,
+        .pNext = &dedicatedRequirements
+    };
+    const VkImageMemoryRequirementsInfo2 requirementsInfo = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2,
+        .pNext = NULL,
+        .image = image
+    };
+    vkGetImageMemoryRequirements2(s_allocator.device, &requirementsInfo, &memoryRequirements);
+
+    const VkMemoryDedicatedAllocateInfo dedicatedInfo = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO,
+        .pNext = NULL,
+        .image = image,
+        .buffer = VK_NULL_HANDLE
+    };
+    const bool useDedicated = dedicatedRequirements.prefersDedicatedAllocation != VK_FALSE || dedicatedRequirements.requiresDedicatedAllocation != VK_FALSE;
+
+    // All the images in this project use the optimal tiling
+    mtx_lock(&s_allocator.lock);
+    bool succeeded = AllocateMemoryLocked(&memoryRequirements.memoryRequirements, usage, RESOURCE_TILING_OPTIMAL,
+                                        useDedicated ? &dedicatedInfo : NULL, outAllocation);
+    mtx_unlock(&s_allocator.lock);
+    if (!succeeded) return false;
+
+    const VkResult res = vkBindImageMemory(s_allocator.device, image, outAllocation->memory, outAllocation->offset);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkBindImageMemory failed: %d\n", res);
+        FreeDeviceMemory(outAllocation);
+        return false;
+    }
+    return true;
+}
+
+void FreeDeviceMemory(DeviceMemoryAllocation* allocation)
+{
+    if (allocation->memory == VK_NULL_HANDLE) return;
+
+    mtx_lock(&s_allocator.lock);
+
+    DeviceMemoryStatistics* stats = &s_allocator.stats[allocation->memoryTypeIndex];
+    DeviceMemoryBlock* block = allocation->block;
+    if (block == NULL)
+    {
+        FreeRawDeviceMemory(allocation->memory, allocation->mappedData != NULL);
+        --stats->dedicatedAllocationCount;
+        stats->dedicatedBytes -= allocation->size;
+    }
+    else
+    {
+        const VkDeviceSize nodeSize = (VkDeviceSize)MIN_SUBALLOCATION_SIZE << allocation->level;
+        FreeBuddyNode(block, (uint32_t)(allocation->offset >> MIN_SUBALLOCATION_SIZE_LOG2), allocation->level);
+        block->usedSize -= nodeSize;
+        --block->allocationCount;
+
+        --stats->subAllocationCount;
+        stats->usedBytes -= nodeSize;
+        stats->requestedBytes -= allocation->size;
+
+        // Keep one empty block per pool around so that allocation churn does not hit vkAllocateMemory every time.
+        DeviceMemoryPool* pool = &s_allocator.pools[allocation->memoryTypeIndex][allocation->tiling];
+        if (block->allocationCount == 0 && pool->blockCount > 1)
+        {
+            for (uint32_t i = 0; i < pool->blockCount; ++i)
+            {
+                if (pool->blocks[i] != block) continue;
+
+                pool->blocks[i] = pool->blocks[--pool->blockCount];
+                DestroyMemoryBlock(block, allocation->memoryTypeIndex);
+                break;
+            }
+        }
+    }
+
+    mtx_unlock(&s_allocator.lock);
+
+    memset(allocation, 0, sizeof(*allocation));
+}
+
+void GetDeviceMemoryStatistics(DeviceMemoryStatistics* outStats)
+{
+    memset(outStats, 0, sizeof(*outStats));
+
+    mtx_lock(&s_allocator.lock);
+    for (uint32_t i = 0; i < s_allocator.memoryProperties.memoryTypeCount; ++i)
+    {
+        const DeviceMemoryStatistics* stats = &s_allocator.stats[i];
+        outStats->blockCount += stats->blockCount;
+        outStats->dedicatedAllocationCount += stats->dedicatedAllocationCount;
+        outStats->subAllocationCount += stats->subAllocationCount;
+        outStats->deviceMemoryAllocationCount += stats->deviceMemoryAllocationCount;
+        outStats->blockBytes += stats->blockBytes;
+        outStats->dedicatedBytes += stats->dedicatedBytes;
+        outStats->usedBytes += stats->usedBytes;
+        outStats->requestedBytes += stats->requestedBytes;
+    }
+    mtx_unlock(&s_allocator.lock);
+}
+
+void PrintDeviceMemoryStatistics(void)
+{
+    mtx_lock(&s_allocator.lock);
+    puts("Device memory statistics:");
+    for (uint32_t i = 0; i < s_allocator.memoryProperties.memoryTypeCount; ++i)
+    {
+        const DeviceMemoryStatistics* stats = &s_allocator.stats[i];
+        if (stats->deviceMemoryAllocationCount == 0) continue;
+
+        printf("  memory type %u (heap %u): %u blocks of %.2f MB in total, %u sub-allocations using %.2f KB (%.2f KB requested), "
+            "%u dedicated allocations of %.2f KB, %u vkAllocateMemory calls so far\n",
+            i, s_allocator.memoryProperties.memoryTypes[i].heapIndex, stats->blockCount, (double)stats->blockBytes / (1024.0 * 1024.0),
+            stats->subAllocationCount, (double)stats->usedBytes / 1024.0, (double)stats->requestedBytes / 1024.0,
+            stats->dedicatedAllocationCount, (double)stats->dedicatedBytes / 1024.0, stats->deviceMemoryAllocationCount);
+    }
+    printf("  %u live device memory objects out of maxMemoryAllocationCount %u\n", GetTotalDeviceMemoryCount(), s_allocator.maxMemoryAllocationCount);
+    mtx_unlock(&s_allocator.lock);
+}
+
+enum
+{
+    CHURN_BENCHMARK_SLOT_COUNT = 512,
+    CHURN_BENCHMARK_MAX_SIZE_LOG2 = 20          // 1MB
+};
+
+static uint32_t NextChurnRandom(uint32_t* state)
+{
+    // xorshift32, so that both runs see exactly the same sequence
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static VkMemoryRequirements MakeChurnRequirements(uint32_t* randomState, uint32_t memoryTypeBits)
+{
+    // Log-uniform sizes between 256 bytes and 1MB, which resembles a mix of uniform, vertex and texture buffers
+    const uint32_t sizeLog2 = MIN_SUBALLOCATION_SIZE_LOG2 + NextChurnRandom(randomState) % (CHURN_BENCHMARK_MAX_SIZE_LOG2 - MIN_SUBALLOCATION_SIZE_LOG2 + 1);
+    const VkDeviceSize size = ((VkDeviceSize)1 << sizeLog2) + NextChurnRandom(randomState) % ((VkDeviceSize)1 << sizeLog2);
+    return (VkMemoryRequirements) {
+        .size = size,
+        .alignment = MIN_SUBALLOCATION_SIZE,
+        .memoryTypeBits = memoryTypeBits
+    };
+}
+
+bool RunDeviceMemoryChurnBenchmark(uint32_t iterationCount)
+{
+    // Query the memory types a device local storage buffer can live in
+    const VkBufferCreateInfo probeBufferCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .size = MIN_SUBALLOCATION_SIZE,
+        .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 0,
+        .pQueueFamilyIndices = NULL
+    };
+    VkBuffer probeBuffer = VK_NULL_HANDLE;
+    VkResult res = vkCreateBuffer(s_allocator.device, &probeBufferCreateInfo, NULL, &probeBuffer);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkCreateBuffer for the churn benchmark failed: %d\n", res);
+        return false;
+    }
+    VkMemoryRequirements probeRequirements;
+    vkGetBufferMemoryRequirements(s_allocator.device, probeBuffer, &probeRequirements);
+    vkDestroyBuffer(s_allocator.device, probeBuffer, NULL);
+
+    const uint32_t memoryTypeIndex = FindMemoryTypeIndex(probeRequirements.memoryTypeBits, DEVICE_MEMORY_USAGE_GPU_ONLY);
+    if (memoryTypeIndex == UINT32_MAX)
+    {
+        fprintf(stderr, "No device local memory type for the churn benchmark!\n");
+        return false;
+    }
+    const uint32_t slotCount = min((uint32_t)CHURN_BENCHMARK_SLOT_COUNT, s_allocator.maxMemoryAllocationCount / 2);
+
+    DeviceMemoryAllocation* allocations = calloc(slotCount, sizeof(*allocations));
+    VkDeviceMemory* rawMemories = calloc(slotCount, sizeof(*rawMemories));
+    if (allocations == NULL || rawMemories == NULL)
+    {
+        free(allocations);
+        free(rawMemories);
+        return false;
+    }
+
+    // Run 1: every slot goes through the sub-allocator
+    uint32_t randomState = 0x9E3779B9U;
+    uint32_t failureCount = 0;
+    uint32_t maxBlockCount = 0;
+    double startTime = GetCurrentTimeInMilliseconds();
+    for (uint32_t i = 0; i < iterationCount; ++i)
+    {
+        const uint32_t slot = NextChurnRandom(&randomState) % slotCount;
+        const VkMemoryRequirements requirements = MakeChurnRequirements(&randomState, 1U << memoryTypeIndex);
+        if (allocations[slot].memory != VK_NULL_HANDLE) {
+            FreeDeviceMemory(&allocations[slot]);
+        }
+        else if (!AllocateDeviceMemory(&requirements, DEVICE_MEMORY_USAGE_GPU_ONLY, false, &allocations[slot])) {
+            ++failureCount;
+        }
+        maxBlockCount = max(maxBlockCount, s_allocator.stats[memoryTypeIndex].blockCount);
+    }
+    const double subAllocationTime = GetCurrentTimeInMilliseconds() - startTime;
+
+    PrintDeviceMemoryStatistics();
+    for (uint32_t i = 0; i < slotCount; ++i) {
+        FreeDeviceMemory(&allocations[i]);
+    }
+
+    // Run 2: the same sequence with one vkAllocateMemory per resource
+    randomState = 0x9E3779B9U;
+    startTime = GetCurrentTimeInMilliseconds();
+    for (uint32_t i = 0; i < iterationCount; ++i)
+    {
+        const uint32_t slot = NextChurnRandom(&randomState) % slotCount;
+        const VkMemoryRequirements requirements = MakeChurnRequirements(&randomState, 1U << memoryTypeIndex);
+        if (rawMemories[slot] != VK_NULL_HANDLE)
+        {
+            vkFreeMemory(s_allocator.device, rawMemories[slot], NULL);
+            rawMemories[slot] = VK_NULL_HANDLE;
+        }
+        else
+        {
+            const VkMemoryAllocateInfo memAllocInfo = {
+                .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                .pNext = NULL,
+                .allocationSize = requirements.size,
+                .memoryTypeIndex = memoryTypeIndex
+            };
+            if (vkAllocateMemory(s_allocator.device, &memAllocInfo, NULL, &rawMemories[slot]) != VK_SUCCESS) {
+                rawMemories[slot] = VK_NULL_HANDLE;
+            }
+        }
+    }
+    const double rawAllocationTime = GetCurrentTimeInMilliseconds() - startTime;
+
+    for (uint32_t i = 0; i < slotCount; ++i)
+    {
+        if (rawMemories[i] != VK_NULL_HANDLE) {
+            vkFreeMemory(s_allocator.device, rawMemories[i], NULL);
+        }
+    }
+    free(allocations);
+    free(rawMemories);
+
+    printf("Allocation churn benchmark: %u operations over %u slots on memory type %u\n", iterationCount, slotCount, memoryTypeIndex);
+    printf("  sub-allocator: %.3f ms (%.3f us per operation), at most %u blocks, %u failures\n",
+        subAllocationTime, iterationCount > 0 ? subAllocationTime * 1000.0 / iterationCount : 0.0, maxBlockCount, failureCount);
+    printf("  vkAllocateMemory per resource: %.3f ms (%.3f us per operation)\n",
+        rawAllocationTime, iterationCount > 0 ? rawAllocationTime * 1000.0 / iterationCount : 0.0);
+
+    return failureCount == 0;
+}
+
+bool RunDeviceMemoryAllocatorSelfTest(void)
+{
+    const uint32_t allTypeBits = (1U << s_allocator.memoryProperties.memoryTypeCount) - 1U;
+    const uint32_t memoryTypeIndex = FindMemoryTypeIndex(allTypeBits, DEVICE_MEMORY_USAGE_GPU_ONLY);
+    DeviceMemoryStatistics stats;
+    GetDeviceMemoryStatistics(&stats);
+    if (memoryTypeIndex == UINT32_MAX || stats.deviceMemoryAllocationCount != 0)
+    {
+        fprintf(stderr, "The device memory allocator self-test needs a GPU only memory type and no allocation made before!\n");
+        return false;
+    }
+
+    const uint32_t blockSizeLog2 = s_allocator.blockSizeLog2s[s_allocator.memoryProperties.memoryTypes[memoryTypeIndex].heapIndex];
+    const VkMemoryRequirements leafRequirements = { .size = MIN_SUBALLOCATION_SIZE, .alignment = MIN_SUBALLOCATION_SIZE, .memoryTypeBits = 1U << memoryTypeIndex };
+    const VkMemoryRequirements nodeRequirements = { .size = 4 * MIN_SUBALLOCATION_SIZE, .alignment = MIN_SUBALLOCATION_SIZE, .memoryTypeBits = 1U << memoryTypeIndex };
+    bool succeeded = true;
+
+    // Buddy split and merge: the first two leaves of a new block are buddies, so a node of four leaves goes behind their parent,
+    // and once both are freed the same node fits at offset 0 again.
+    DeviceMemoryAllocation first = { 0 };
+    DeviceMemoryAllocation second = { 0 };
+    DeviceMemoryAllocation node = { 0 };
+    if (!AllocateDeviceMemory(&leafRequirements, DEVICE_MEMORY_USAGE_GPU_ONLY, false, &first) ||
+        !AllocateDeviceMemory(&leafRequirements, DEVICE_MEMORY_USAGE_GPU_ONLY, false, &second) ||
+        !AllocateDeviceMemory(&nodeRequirements, DEVICE_MEMORY_USAGE_GPU_ONLY, false, &node))
+    {
+        fprintf(stderr, "Allocating the buddy nodes of the self-test failed!\n");
+        FreeDeviceMemory(&first);
+        FreeDeviceMemory(&second);
+        FreeDeviceMemory(&node);
+        return false;
+    }
+    DeviceMemoryBlock* block = first.block;
+    succeeded &= CheckSelfTestCondition(block != NULL && second.block == block && node.block == block, "small requests share one block");
+    succeeded &= CheckSelfTestCondition(first.offset == 0 && second.offset == MIN_SUBALLOCATION_SIZE, "two leaves split off the start of a new block");
+    succeeded &= CheckSelfTestCondition(node.offset == 4 * MIN_SUBALLOCATION_SIZE, "a larger node skips the half used node of the leaves");
+    if (block == NULL) return false;
+
+    succeeded &= CheckSelfTestCondition(block->largestFreeLevels[1] == block->levelCount, "only the upper half of the block is left whole");
+    FreeDeviceMemory(&first);
+    FreeDeviceMemory(&second);
+    succeeded &= CheckSelfTestCondition(AllocateDeviceMemory(&nodeRequirements, DEVICE_MEMORY_USAGE_GPU_ONLY, false, &first) && first.offset == 0,
+                                        "the freed buddies merge into a node of four leaves");
+    FreeDeviceMemory(&first);
+    FreeDeviceMemory(&node);
+    succeeded &= CheckSelfTestCondition(block->largestFreeLevels[1] == block->levelCount + 1 && block->usedSize == 0 && block->allocationCount == 0,
+                                        "every node merges back into a single free block");
+
+    // Alignment rounding: the node of a request covers both its size and its alignment, rounded up to a power of two.
+    const VkMemoryRequirements alignedRequirements = { .size = 300, .alignment = 16 * MIN_SUBALLOCATION_SIZE, .memoryTypeBits = 1U << memoryTypeIndex };
+    const VkMemoryRequirements oddSizeRequirements = { .size = 5000, .alignment = MIN_SUBALLOCATION_SIZE, .memoryTypeBits = 1U << memoryTypeIndex };
+    DeviceMemoryAllocation aligned = { 0 };
+    DeviceMemoryAllocation oddSize = { 0 };
+    succeeded &= CheckSelfTestCondition(AllocateDeviceMemory(&leafRequirements, DEVICE_MEMORY_USAGE_GPU_ONLY, false, &first), "allocating a leaf");
+    succeeded &= CheckSelfTestCondition(AllocateDeviceMemory(&alignedRequirements, DEVICE_MEMORY_USAGE_GPU_ONLY, false, &aligned) &&
+                                        aligned.offset == alignedRequirements.alignment, "a small request with a large alignment is placed on that alignment");
+    succeeded &= CheckSelfTestCondition(AllocateDeviceMemory(&oddSizeRequirements, DEVICE_MEMORY_USAGE_GPU_ONLY, false, &oddSize) &&
+                                        oddSize.offset == 8192 && oddSize.size == oddSizeRequirements.size, "a size that is no power of two takes the next node size");
+    GetDeviceMemoryStatistics(&stats);
+    succeeded &= CheckSelfTestCondition(stats.usedBytes == MIN_SUBALLOCATION_SIZE + alignedRequirements.alignment + 8192 &&
+                                        stats.requestedBytes == leafRequirements.size + alignedRequirements.size + oddSizeRequirements.size,
+                                        "the used bytes count the rounded node sizes, the requested bytes the sizes asked for");
+    FreeDeviceMemory(&first);
+    FreeDeviceMemory(&aligned);
+    FreeDeviceMemory(&oddSize);
+
+    // bufferImageGranularity: the granularity of the device decides whether linear and optimal resources share the blocks, so each way is forced in turn.
+    const bool separateOptimalResources = s_allocator.separateOptimalResources;
+    DeviceMemoryAllocation linear = { 0 };
+    DeviceMemoryAllocation optimal = { 0 };
+    DeviceMemoryAllocation shared = { 0 };
+    s_allocator.separateOptimalResources = true;
+    succeeded &= CheckSelfTestCondition(AllocateDeviceMemory(&leafRequirements, DEVICE_MEMORY_USAGE_GPU_ONLY, false, &linear) &&
+                                        AllocateDeviceMemory(&leafRequirements, DEVICE_MEMORY_USAGE_GPU_ONLY, true, &optimal) &&
+                                        linear.memory != optimal.memory && optimal.offset == 0 && optimal.tiling == RESOURCE_TILING_OPTIMAL,
+                                        "a coarse granularity puts an optimal image into a block of its own");
+    s_allocator.separateOptimalResources = false;
+    succeeded &= CheckSelfTestCondition(AllocateDeviceMemory(&leafRequirements, DEVICE_MEMORY_USAGE_GPU_ONLY, true, &shared) &&
+                                        shared.memory == linear.memory && shared.offset == MIN_SUBALLOCATION_SIZE,
+                                        "a fine granularity puts an optimal image next to a buffer");
+    FreeDeviceMemory(&linear);
+    FreeDeviceMemory(&optimal);
+    FreeDeviceMemory(&shared);
+    s_allocator.separateOptimalResources = separateOptimalResources;
+
+    // Dedicated fallback: a request of a whole block bypasses the blocks.
+    const VkMemoryRequirements oversizedRequirements = {
+        .size = (VkDeviceSize)1 << blockSizeLog2,
+        .alignment = MIN_SUBALLOCATION_SIZE,
+        .memoryTypeBits = 1U << memoryTypeIndex
+    };
+    DeviceMemoryAllocation dedicated = { 0 };
+    succeeded &= CheckSelfTestCondition(AllocateDeviceMemory(&oversizedRequirements, DEVICE_MEMORY_USAGE_GPU_ONLY, false, &dedicated) &&
+                                        dedicated.block == NULL && dedicated.offset == 0, "an oversized request gets a dedicated allocation");
+    GetDeviceMemoryStatistics(&stats);
+    succeeded &= CheckSelfTestCondition(stats.dedicatedAllocationCount == 1 && stats.dedicatedBytes == oversizedRequirements.size && stats.blockCount == 2,
+                                        "a dedicated allocation is counted apart from the blocks");
+    FreeDeviceMemory(&dedicated);
+
+    // Statistics after free: nothing is in use any more, while the empty block of each pool is kept for the next allocations.
+    GetDeviceMemoryStatistics(&stats);
+    succeeded &= CheckSelfTestCondition(stats.subAllocationCount == 0 && stats.usedBytes == 0 && stats.requestedBytes == 0, "no sub-allocation is left after free");
+    succeeded &= CheckSelfTestCondition(stats.dedicatedAllocationCount == 0 && stats.dedicatedBytes == 0, "no dedicated allocation is left after free");
+    succeeded &= CheckSelfTestCondition(stats.blockCount == 2 && stats.blockBytes == (VkDeviceSize)2 << blockSizeLog2 && stats.deviceMemoryAllocationCount == 3,
+                                        "one empty block is kept per pool");
+
+    printf("Device memory allocator self-test on memory type %u with blocks of %llu KB: %s\n", memoryTypeIndex,
+        (unsigned long long)(((VkDeviceSize)1 << blockSizeLog2) >> 10), succeeded ? "passed" : "FAILED");
+    return succeeded;
+}
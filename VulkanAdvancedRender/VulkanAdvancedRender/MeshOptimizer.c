@@ -0,0 +1,281 @@
+#include "common.h"
+#include <float.h>
+
+
+enum
+{
+    // The cache that the vertex scores are tuned for, larger than the post-transform caches of most GPUs
+    FORSYTH_CACHE_SIZE = 32,
+    INVALID_INDEX = 0xffffffffU
+};
+
+// The scoring constants of Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+#define FORSYTH_CACHE_DECAY_POWER       1.5f
+#define FORSYTH_LAST_TRIANGLE_SCORE     0.75f
+#define FORSYTH_VALENCE_BOOST_SCALE     2.0f
+#define FORSYTH_VALENCE_BOOST_POWER     0.5f
+
+// Vertices near the front of the cache score higher, the ones of the last triangle a bit less so that the strip does not turn back on itself.
+// Vertices with few triangles left score higher as well, so that no lonely triangles are left behind.
+static float ComputeVertexScore(uint32_t cachePosition, uint32_t remainingTriangleCount)
+{
+    if (remainingTriangleCount == 0) return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition < 3) {
+        score = FORSYTH_LAST_TRIANGLE_SCORE;
+    }
+    else if (cachePosition < FORSYTH_CACHE_SIZE)
+    {
+        const float scaler = 1.0f / (float)(FORSYTH_CACHE_SIZE - 3);
+        score = powf(1.0f - (float)(cachePosition - 3) * scaler, FORSYTH_CACHE_DECAY_POWER);
+    }
+
+    return score + FORSYTH_VALENCE_BOOST_SCALE * powf((float)remainingTriangleCount, -FORSYTH_VALENCE_BOOST_POWER);
+}
+
+bool OptimizeVertexCache(uint32_t* dstIndices, const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount)
+{
+    const uint32_t triangleCount = indexCount / 3U;
+    if (triangleCount == 0) return true;
+
+    // The triangles of each vertex in CSR form. The first remainingCounts[v] of them have not been emitted yet.
+    uint32_t* adjacencyOffsets = calloc(vertexCount + 1, sizeof(*adjacencyOffsets));
+    uint32_t* adjacentTriangles = malloc(triangleCount * 3U * sizeof(*adjacentTriangles));
+    uint32_t* remainingCounts = calloc(vertexCount, sizeof(*remainingCounts));
+    uint32_t* cachePositions = malloc(vertexCount * sizeof(*cachePositions));
+    float* vertexScores = malloc(vertexCount * sizeof(*vertexScores));
+    float* triangleScores = malloc(triangleCount * sizeof(*triangleScores));
+    bool* isTriangleEmitted = calloc(triangleCount, sizeof(*isTriangleEmitted));
+    bool succeeded = false;
+
+    do
+    {
+        if (adjacencyOffsets == NULL || adjacentTriangles == NULL || remainingCounts == NULL || cachePositions == NULL ||
+            vertexScores == NULL || triangleScores == NULL || isTriangleEmitted == NULL)
+        {
+            fprintf(stderr, "Failed to allocate the vertex cache optimization data!\n");
+            break;
+        }
+
+        bool areIndicesValid = true;
+        for (uint32_t i = 0; i < triangleCount * 3U && areIndicesValid; ++i)
+        {
+            if (indices[i] >= vertexCount)
+            {
+                fprintf(stderr, "Index %u at %u is out of the %u vertices!\n", indices[i], i, vertexCount);
+                areIndicesValid = false;
+            }
+            else {
+                ++remainingCounts[indices[i]];
+            }
+        }
+        if (!areIndicesValid) break;
+
+        uint32_t offset = 0;
+        for (uint32_t v = 0; v < vertexCount; ++v)
+        {
+            adjacencyOffsets[v] = offset;
+            offset += remainingCounts[v];
+        }
+        adjacencyOffsets[vertexCount] = offset;
+
+        memset(remainingCounts, 0, vertexCount * sizeof(*remainingCounts));
+        for (uint32_t t = 0; t < triangleCount; ++t)
+        {
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                const uint32_t v = indices[t * 3U + k];
+                adjacentTriangles[adjacencyOffsets[v] + remainingCounts[v]++] = t;
+            }
+        }
+
+        for (uint32_t v = 0; v < vertexCount; ++v)
+        {
+            cachePositions[v] = INVALID_INDEX;
+            vertexScores[v] = ComputeVertexScore(INVALID_INDEX, remainingCounts[v]);
+        }
+        for (uint32_t t = 0; t < triangleCount; ++t)
+        {
+            const uint32_t* triangle = &indices[t * 3U];
+            triangleScores[t] = vertexScores[triangle[0]] + vertexScores[triangle[1]] + vertexScores[triangle[2]];
+        }
+
+        // The 3 vertices of the new triangle are pushed in front of the cache, so it holds up to 3 entries more than FORSYTH_CACHE_SIZE for a moment.
+        uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+        uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+        uint32_t cacheCount = 0;
+        uint32_t bestTriangle = INVALID_INDEX;
+        uint32_t nextUnemittedTriangle = 0;
+
+        for (uint32_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+        {
+            // Nothing in the cache has triangles left, so start over from the best of the remaining triangles.
+            if (bestTriangle == INVALID_INDEX)
+            {
+                float bestScore = -FLT_MAX;
+                for (uint32_t t = nextUnemittedTriangle; t < triangleCount; ++t)
+                {
+                    if (isTriangleEmitted[t]) continue;
+                    if (bestTriangle == INVALID_INDEX) {
+                        nextUnemittedTriangle = t;
+                    }
+                    if (triangleScores[t] > bestScore)
+                    {
+                        bestScore = triangleScores[t];
+                        bestTriangle = t;
+                    }
+                }
+            }
+
+            const uint32_t* triangle = &indices[bestTriangle * 3U];
+            memcpy(&dstIndices[emittedCount * 3U], triangle, 3U * sizeof(*triangle));
+            isTriangleEmitted[bestTriangle] = true;
+
+            uint32_t newCacheCount = 0;
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                const uint32_t v = triangle[k];
+                // A degenerate triangle references the same vertex more than once
+                if ((k > 0 && v == triangle[0]) || (k > 1 && v == triangle[1])) continue;
+                newCache[newCacheCount++] = v;
+
+                // Move the emitted triangle behind the remaining ones of the vertex
+                uint32_t* vertexTriangles = &adjacentTriangles[adjacencyOffsets[v]];
+                const uint32_t remainingCount = remainingCounts[v];
+                for (uint32_t i = 0; i < remainingCount; ++i)
+                {
+                    if (vertexTriangles[i] == bestTriangle)
+                    {
+                        vertexTriangles[i] = vertexTriangles[remainingCount - 1];
+                        vertexTriangles[remainingCount - 1] = bestTriangle;
+                        break;
+                    }
+                }
+                --remainingCounts[v];
+            }
+            for (uint32_t i = 0; i < cacheCount; ++i)
+            {
+                const uint32_t v = cache[i];
+                if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                    newCache[newCacheCount++] = v;
+                }
+            }
+
+            // Rescore every vertex that is or was in the cache, and the remaining triangles around them
+            bestTriangle = INVALID_INDEX;
+            float bestScore = -FLT_MAX;
+            for (uint32_t i = 0; i < newCacheCount; ++i)
+            {
+                const uint32_t v = newCache[i];
+                cachePositions[v] = i < FORSYTH_CACHE_SIZE ? i : INVALID_INDEX;
+                const float newScore = ComputeVertexScore(cachePositions[v], remainingCounts[v]);
+                const float scoreDelta = newScore - vertexScores[v];
+                vertexScores[v] = newScore;
+
+                const uint32_t* vertexTriangles = &adjacentTriangles[adjacencyOffsets[v]];
+                for (uint32_t j = 0; j < remainingCounts[v]; ++j)
+                {
+                    const uint32_t t = vertexTriangles[j];
+                    triangleScores[t] += scoreDelta;
+                    if (triangleScores[t] > bestScore)
+                    {
+                        bestScore = triangleScores[t];
+                        bestTriangle = t;
+                    }
+                }
+            }
+
+            cacheCount = min(newCacheCount, (uint32_t)FORSYTH_CACHE_SIZE);
+            memcpy(cache, newCache, cacheCount * sizeof(*cache));
+        }
+
+        succeeded = true;
+    }
+    while (false);
+
+    free(isTriangleEmitted);
+    free(triangleScores);
+    free(vertexScores);
+    free(cachePositions);
+    free(remainingCounts);
+    free(adjacentTriangles);
+    free(adjacencyOffsets);
+
+    return succeeded;
+}
+
+bool OptimizeVertexFetch(IndexedMesh* mesh)
+{
+    uint32_t* remap = malloc(mesh->vertexCount * sizeof(*remap));
+    MeshVertex* vertices = malloc(mesh->vertexCount * sizeof(*vertices));
+    if (remap == NULL || vertices == NULL)
+    {
+        fprintf(stderr, "Failed to allocate the vertex fetch optimization data!\n");
+        free(vertices);
+        free(remap);
+        return false;
+    }
+
+    memset(remap, 0xff, mesh->vertexCount * sizeof(*remap));
+    uint32_t newVertexCount = 0;
+    for (uint32_t i = 0; i < mesh->indexCount; ++i)
+    {
+        const uint32_t v = mesh->indices[i];
+        if (remap[v] == INVALID_INDEX)
+        {
+            remap[v] = newVertexCount;
+            vertices[newVertexCount++] = mesh->vertices[v];
+        }
+        mesh->indices[i] = remap[v];
+    }
+
+    free(mesh->vertices);
+    free(remap);
+    mesh->vertices = vertices;
+    mesh->vertexCount = newVertexCount;
+
+    return true;
+}
+
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+{
+    VertexCacheStatistics stats = { 0 };
+    uint32_t* cacheTimestamps = calloc(vertexCount, sizeof(*cacheTimestamps));
+    bool* isReferenced = calloc(vertexCount, sizeof(*isReferenced));
+    if (cacheTimestamps == NULL || isReferenced == NULL)
+    {
+        fprintf(stderr, "Failed to allocate the vertex cache analysis data!\n");
+        free(isReferenced);
+        free(cacheTimestamps);
+        return stats;
+    }
+
+    // A FIFO cache: a vertex is still in it when fewer than `cacheSize` vertices have been transformed since its own transform.
+    uint32_t timestamp = cacheSize + 1;
+    uint32_t referencedCount = 0;
+    for (uint32_t i = 0; i < indexCount; ++i)
+    {
+        const uint32_t v = indices[i];
+        if (timestamp - cacheTimestamps[v] > cacheSize)
+        {
+            cacheTimestamps[v] = timestamp++;
+            ++stats.transformedVertexCount;
+        }
+        if (!isReferenced[v])
+        {
+            isReferenced[v] = true;
+            ++referencedCount;
+        }
+    }
+
+    const uint32_t triangleCount = indexCount / 3U;
+    stats.acmr = triangleCount > 0 ? (float)stats.transformedVertexCount / (float)triangleCount : 0.0f;
+    stats.atvr = referencedCount > 0 ? (float)stats.transformedVertexCount / (float)referencedCount : 0.0f;
+
+    free(isReferenced);
+    free(cacheTimestamps);
+
+    return stats;
+}
+
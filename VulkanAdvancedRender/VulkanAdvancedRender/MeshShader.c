@@ -2,12 +2,11 @@
 
 
 VkPipeline CreateMeshShaderGraphicsPipeline(VkDevice specDevice, const char* taskSPVFilePath, const char* meshSPVFilePath, const char* fragmentSPVFilePath,
-                                    VkPipelineLayout pipelineLayout, VkRenderPass renderPass, VkPipelineCache *outPipelineCache)
+                                    uint32_t taskWorkGroupSize, uint32_t meshWorkGroupSize, VkPipelineLayout pipelineLayout, const RenderTarget* renderTarget, VkPipelineCache pipelineCache)
 {
     VkShaderModule taskShaderModule = VK_NULL_HANDLE;
     VkShaderModule meshShaderModule = VK_NULL_HANDLE;
     VkShaderModule fragmentShaderModule = VK_NULL_HANDLE;
-    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
     VkPipeline dstPipeline = VK_NULL_HANDLE;
     VkResult res = VK_ERROR_INITIALIZATION_FAILED;
 
@@ -19,20 +18,26 @@ VkPipeline CreateMeshShaderGraphicsPipeline(VkDevice specDevice, const char* tas
 
         const struct SpecializationConstants
         {
-            uint32_t local_size_x;
-            uint32_t payload_data_count;
-        } specConsts = { 128U, 1024U };
+            uint32_t mesh_local_size_x;
+            uint32_t task_local_size_x;
+        } specConsts = { meshWorkGroupSize, taskWorkGroupSize };
 
         const VkSpecializationMapEntry mapEntries[] = {
             {
                 .constantID = 0,
-                .offset = (uint32_t)offsetof(struct SpecializationConstants, local_size_x),
-                .size = sizeof(specConsts.local_size_x)
+                .offset = (uint32_t)offsetof(struct SpecializationConstants, mesh_local_size_x),
+                .size = sizeof(specConsts.mesh_local_size_x)
             },
             {
                 .constantID = 1,
-                .offset = (uint32_t)offsetof(struct SpecializationConstants, payload_data_count),
-                .size = sizeof(specConsts.payload_data_count)
+                .offset = (uint32_t)offsetof(struct SpecializationConstants, task_local_size_x),
+                .size = sizeof(specConsts.task_local_size_x)
+            },
+            // `meshlets_per_task`, which sizes the payload array in both shaders
+            {
+                .constantID = 2,
+                .offset = (uint32_t)offsetof(struct SpecializationConstants, task_local_size_x),
+                .size = sizeof(specConsts.task_local_size_x)
             }
         };
 
@@ -107,7 +112,7 @@ VkPipeline CreateMeshShaderGraphicsPipeline(VkDevice specDevice, const char* tas
             .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
             .pNext = NULL,
             .flags = 0,
-            .rasterizationSamples = USE_MSAA_SAMPLE_COUNT > 0 ? (VkSampleCountFlagBits)(USE_MSAA_SAMPLE_COUNT) : VK_SAMPLE_COUNT_1_BIT,
+            .rasterizationSamples = renderTarget->sampleCount,
             .sampleShadingEnable = VK_FALSE,
             .minSampleShading = 0.0f,
             .pSampleMask = NULL,
@@ -172,10 +177,14 @@ VkPipeline CreateMeshShaderGraphicsPipeline(VkDevice specDevice, const char* tas
             .pDynamicStates = (VkDynamicState[]) { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR }
         };
 
+        PipelineCreationFeedbackRecord feedbackRecord;
+        VkPipelineRenderingCreateInfoKHR renderingCreateInfo;
+        const uint32_t stageCount = (uint32_t)(sizeof(shaderStages) / sizeof(shaderStages[0]));
+
         const VkGraphicsPipelineCreateInfo pipelineCreateInfo = {
             .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-            .pNext = NULL,
-            .stageCount = (uint32_t)(sizeof(shaderStages) / sizeof(shaderStages[0])),
+            .pNext = PreparePipelineCreationFeedback(&feedbackRecord, PrepareRenderTargetPipelineInfo(renderTarget, &renderingCreateInfo, NULL), stageCount),
+            .stageCount = stageCount,
             .pStages = shaderStages,
             .pVertexInputState = NULL,
             .pInputAssemblyState = NULL,
@@ -187,33 +196,21 @@ VkPipeline CreateMeshShaderGraphicsPipeline(VkDevice specDevice, const char* tas
             .pColorBlendState = &colorBlendStateCreateInfo,
             .pDynamicState = &dynamicStateCreateInfo,
             .layout = pipelineLayout,
-            .renderPass = renderPass,
+            .renderPass = renderTarget->renderPass,
             .subpass = 0,
             .basePipelineHandle = VK_NULL_HANDLE,
             .basePipelineIndex = 0
         };
 
-        const VkPipelineCacheCreateInfo pipelineCacheInfo = {
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
-            .pNext = NULL,
-            .flags = 0,
-            .initialDataSize = 0,
-            .pInitialData = NULL
-        };
-
-        res = vkCreatePipelineCache(specDevice, &pipelineCacheInfo, NULL, &pipelineCache);
-        if (res != VK_SUCCESS)
-        {
-            fprintf(stderr, "vkCreatePipelineCache failed: %d\n", res);
-            break;
-        }
-
+        const double startTime = GetCurrentTimeInMilliseconds();
         res = vkCreateGraphicsPipelines(specDevice, pipelineCache, 1, &pipelineCreateInfo, NULL, &dstPipeline);
         if (res != VK_SUCCESS)
         {
             fprintf(stderr, "vkCreateGraphicsPipelines failed: %d\n", res);
             break;
         }
+
+        RecordPipelineCreation("mesh shader", &feedbackRecord, GetCurrentTimeInMilliseconds() - startTime);
     }
     while (false);
 
@@ -227,15 +224,217 @@ VkPipeline CreateMeshShaderGraphicsPipeline(VkDevice specDevice, const char* tas
         vkDestroyShaderModule(specDevice, fragmentShaderModule, NULL);
     }
 
-    if (res == VK_SUCCESS)
-    {
-        *outPipelineCache = pipelineCache;
+    if (res == VK_SUCCESS) {
         return dstPipeline;
     }
 
-    if (pipelineCache != VK_NULL_HANDLE) {
-        vkDestroyPipelineCache(specDevice, pipelineCache, NULL);
+    if (dstPipeline != VK_NULL_HANDLE)
+    {
+        vkDestroyPipeline(specDevice, dstPipeline, NULL);
+        dstPipeline = VK_NULL_HANDLE;
+    }
+
+    return dstPipeline;
+}
+
+VkPipeline CreateMeshletReferenceGraphicsPipeline(VkDevice specDevice, const char* vertSPVFilePath, const char* fragmentSPVFilePath,
+                                                VkPipelineLayout pipelineLayout, const RenderTarget* renderTarget, VkPipelineCache pipelineCache)
+{
+    VkShaderModule vertexShaderModule = VK_NULL_HANDLE;
+    VkShaderModule fragmentShaderModule = VK_NULL_HANDLE;
+    VkPipeline dstPipeline = VK_NULL_HANDLE;
+    VkResult res = VK_ERROR_INITIALIZATION_FAILED;
+
+    do
+    {
+        if (!CreateShaderModule(vertSPVFilePath, &vertexShaderModule)) break;
+        if (!CreateShaderModule(fragmentSPVFilePath, &fragmentShaderModule)) break;
+
+        const VkPipelineShaderStageCreateInfo shaderStages[] = {
+            // vertex shader
+            {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .pNext = NULL,
+                .flags = 0,
+                .stage = VK_SHADER_STAGE_VERTEX_BIT,
+                .module = vertexShaderModule,
+                .pName = "main",
+                .pSpecializationInfo = NULL
+            },
+            // fragment shader
+            {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .pNext = NULL,
+                .flags = 0,
+                .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+                .module = fragmentShaderModule,
+                .pName = "main",
+                .pSpecializationInfo = NULL
+            }
+        };
+
+        // The vertices are pulled from a storage buffer
+        const VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .vertexBindingDescriptionCount = 0,
+            .pVertexBindingDescriptions = NULL,
+            .vertexAttributeDescriptionCount = 0,
+            .pVertexAttributeDescriptions = NULL
+        };
+
+        const VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+            .primitiveRestartEnable = VK_FALSE
+        };
+
+        const VkPipelineViewportStateCreateInfo viewportStateCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .viewportCount = 1,
+            .pViewports = NULL,     // As the viewport state is dynamic, this member is ignored.
+            .scissorCount = 1,
+            .pScissors = NULL       // As the scissor state is dynamic, this member is ignored.
+        };
+
+        const VkPipelineRasterizationStateCreateInfo rasterizationStateCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .depthClampEnable = VK_FALSE,
+            .rasterizerDiscardEnable = VK_FALSE,
+            .polygonMode = VK_POLYGON_MODE_FILL,
+            .cullMode = VK_CULL_MODE_BACK_BIT,  // the same states as the mesh shader pipeline, so that both do the same work
+            .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+            .depthBiasEnable = VK_FALSE,
+            .depthBiasConstantFactor = 0.0f,
+            .depthBiasClamp = 1.0f,
+            .depthBiasSlopeFactor = 0.0f,
+            .lineWidth = 1.0f,
+        };
+
+        const VkPipelineMultisampleStateCreateInfo multisampleStateCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .rasterizationSamples = renderTarget->sampleCount,
+            .sampleShadingEnable = VK_FALSE,
+            .minSampleShading = 0.0f,
+            .pSampleMask = NULL,
+            .alphaToCoverageEnable = VK_FALSE,
+            .alphaToOneEnable = VK_FALSE
+        };
+
+        const VkStencilOpState stencilOpState = {
+            .failOp = VK_STENCIL_OP_KEEP,
+            .passOp = VK_STENCIL_OP_KEEP,
+            .depthFailOp = VK_STENCIL_OP_KEEP,
+            .compareOp = VK_COMPARE_OP_LESS_OR_EQUAL,
+            .compareMask = 0,
+            .writeMask = 0,
+            .reference = 0
+        };
+
+        const VkPipelineDepthStencilStateCreateInfo depthStencilStateCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .depthTestEnable = VK_TRUE,
+            .depthWriteEnable = VK_TRUE,
+            .depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL,
+            .depthBoundsTestEnable = VK_FALSE,
+            .stencilTestEnable = VK_FALSE,
+            .front = stencilOpState,
+            .back = stencilOpState,
+            .minDepthBounds = 0.0f,
+            .maxDepthBounds = 0.0f
+        };
+
+        const VkPipelineColorBlendAttachmentState attatchmentStates[1] = {
+            {
+                .blendEnable = VK_FALSE,
+                .srcColorBlendFactor = VK_BLEND_FACTOR_ZERO,
+                .dstColorBlendFactor = VK_BLEND_FACTOR_ZERO,
+                .colorBlendOp = VK_BLEND_OP_ADD,
+                .srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+                .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+                .alphaBlendOp = VK_BLEND_OP_ADD,
+                .colorWriteMask = 0x0fU
+            }
+        };
+
+        const VkPipelineColorBlendStateCreateInfo colorBlendStateCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .logicOpEnable = VK_FALSE,
+            .logicOp = VK_LOGIC_OP_CLEAR,
+            .attachmentCount = (uint32_t)(sizeof(attatchmentStates) / sizeof(attatchmentStates[0])),
+            .pAttachments = attatchmentStates,
+            .blendConstants = { 0.0f }
+        };
+
+        const VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .dynamicStateCount = 2U,
+            .pDynamicStates = (VkDynamicState[]) { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR }
+        };
+
+        PipelineCreationFeedbackRecord feedbackRecord;
+        VkPipelineRenderingCreateInfoKHR renderingCreateInfo;
+        const uint32_t stageCount = (uint32_t)(sizeof(shaderStages) / sizeof(shaderStages[0]));
+
+        const VkGraphicsPipelineCreateInfo pipelineCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+            .pNext = PreparePipelineCreationFeedback(&feedbackRecord, PrepareRenderTargetPipelineInfo(renderTarget, &renderingCreateInfo, NULL), stageCount),
+            .stageCount = stageCount,
+            .pStages = shaderStages,
+            .pVertexInputState = &vertexInputStateCreateInfo,
+            .pInputAssemblyState = &inputAssemblyStateCreateInfo,
+            .pTessellationState = NULL,
+            .pViewportState = &viewportStateCreateInfo,
+            .pRasterizationState = &rasterizationStateCreateInfo,
+            .pMultisampleState = &multisampleStateCreateInfo,
+            .pDepthStencilState = &depthStencilStateCreateInfo,
+            .pColorBlendState = &colorBlendStateCreateInfo,
+            .pDynamicState = &dynamicStateCreateInfo,
+            .layout = pipelineLayout,
+            .renderPass = renderTarget->renderPass,
+            .subpass = 0,
+            .basePipelineHandle = VK_NULL_HANDLE,
+            .basePipelineIndex = 0
+        };
+
+        const double startTime = GetCurrentTimeInMilliseconds();
+        res = vkCreateGraphicsPipelines(specDevice, pipelineCache, 1, &pipelineCreateInfo, NULL, &dstPipeline);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreateGraphicsPipelines failed: %d\n", res);
+            break;
+        }
+
+        RecordPipelineCreation("meshlet reference", &feedbackRecord, GetCurrentTimeInMilliseconds() - startTime);
+    }
+    while (false);
+
+    if (vertexShaderModule != VK_NULL_HANDLE) {
+        vkDestroyShaderModule(specDevice, vertexShaderModule, NULL);
     }
+    if (fragmentShaderModule != VK_NULL_HANDLE) {
+        vkDestroyShaderModule(specDevice, fragmentShaderModule, NULL);
+    }
+
+    if (res == VK_SUCCESS) {
+        return dstPipeline;
+    }
+
     if (dstPipeline != VK_NULL_HANDLE)
     {
         vkDestroyPipeline(specDevice, dstPipeline, NULL);
@@ -0,0 +1,374 @@
+#include "common.h"
+#include "VectorMath.h"
+#include <float.h>
+
+
+enum
+{
+    // Local vertex indices are stored in 8 bits
+    MESHLET_LOCAL_INDEX_LIMIT = 256,
+    INVALID_INDEX = 0xffffffffU
+};
+
+bool CreateSphereMesh(uint32_t sliceCount, uint32_t stackCount, float radius, IndexedMesh* outMesh)
+{
+    memset(outMesh, 0, sizeof(*outMesh));
+    if (sliceCount < 3 || stackCount < 2)
+    {
+        fprintf(stderr, "A sphere needs at least 3 slices and 2 stacks!\n");
+        return false;
+    }
+
+    const uint32_t rowLength = sliceCount + 1;
+    outMesh->vertexCount = rowLength * (stackCount + 1);
+    outMesh->indexCount = 2U * 3U * sliceCount * (stackCount - 1);
+    outMesh->vertices = malloc(outMesh->vertexCount * sizeof(*outMesh->vertices));
+    outMesh->indices = malloc(outMesh->indexCount * sizeof(*outMesh->indices));
+    if (outMesh->vertices == NULL || outMesh->indices == NULL)
+    {
+        fprintf(stderr, "Failed to allocate the sphere mesh!\n");
+        FreeIndexedMesh(outMesh);
+        return false;
+    }
+
+    // Stack 0 is the north pole (+y). The first and the last column of a row share their positions, only to keep the indexing regular.
+    for (uint32_t stack = 0; stack <= stackCount; ++stack)
+    {
+        const float phi = MATH_PI * (float)stack / (float)stackCount;
+        for (uint32_t slice = 0; slice <= sliceCount; ++slice)
+        {
+            const float theta = 2.0f * MATH_PI * (float)slice / (float)sliceCount;
+            MeshVertex* vertex = &outMesh->vertices[stack * rowLength + slice];
+            vertex->normal[0] = sinf(phi) * cosf(theta);
+            vertex->normal[1] = cosf(phi);
+            vertex->normal[2] = sinf(phi) * sinf(theta);
+            for (int i = 0; i < 3; ++i) {
+                vertex->position[i] = vertex->normal[i] * radius;
+            }
+        }
+    }
+
+    // Seen from outside, `a` is top right, `d` top left, `b` bottom right and `c` bottom left of each quad.
+    uint32_t* dst = outMesh->indices;
+    for (uint32_t stack = 0; stack < stackCount; ++stack)
+    {
+        for (uint32_t slice = 0; slice < sliceCount; ++slice)
+        {
+            const uint32_t a = stack * rowLength + slice;
+            const uint32_t b = a + rowLength;
+            const uint32_t c = b + 1;
+            const uint32_t d = a + 1;
+
+            // `a` and `d` coincide at the north pole, `b` and `c` at the south pole
+            if (stack > 0)
+            {
+                *dst++ = a;
+                *dst++ = b;
+                *dst++ = d;
+            }
+            if (stack + 1 < stackCount)
+            {
+                *dst++ = d;
+                *dst++ = b;
+                *dst++ = c;
+            }
+        }
+    }
+
+    return true;
+}
+
+void FreeIndexedMesh(IndexedMesh* mesh)
+{
+    free(mesh->vertices);
+    free(mesh->indices);
+    memset(mesh, 0, sizeof(*mesh));
+}
+
+static inline void Subtract3(float dst[3], const float a[3], const float b[3])
+{
+    for (int i = 0; i < 3; ++i) {
+        dst[i] = a[i] - b[i];
+    }
+}
+
+static inline float Dot3(const float a[3], const float b[3])
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// The length of the result is twice the area of the triangle. It points to the front side of a clockwise triangle.
+static void ComputeTriangleNormal(const IndexedMesh* mesh, uint32_t triangle, float dst[3])
+{
+    const uint32_t* indices = &mesh->indices[triangle * 3U];
+    float e1[3], e2[3];
+    Subtract3(e1, mesh->vertices[indices[2]].position, mesh->vertices[indices[0]].position);
+    Subtract3(e2, mesh->vertices[indices[1]].position, mesh->vertices[indices[0]].position);
+    dst[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    dst[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    dst[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+static void ComputeMeshletBounds(const IndexedMesh* mesh, const MeshletData* data, const Meshlet* meshlet, const uint32_t* meshletTriangles, MeshletBounds* dst)
+{
+    const uint32_t* vertexIndices = &data->vertexIndices[meshlet->vertexOffset];
+
+    // The sphere around the average vertex position is not the tightest, but it is close for these small patches.
+    float center[3] = { 0.0f, 0.0f, 0.0f };
+    for (uint32_t i = 0; i < meshlet->vertexCount; ++i)
+    {
+        for (int j = 0; j < 3; ++j) {
+            center[j] += mesh->vertices[vertexIndices[i]].position[j];
+        }
+    }
+    for (int j = 0; j < 3; ++j) {
+        center[j] /= (float)meshlet->vertexCount;
+    }
+
+    float maxDistanceSquared = 0.0f;
+    for (uint32_t i = 0; i < meshlet->vertexCount; ++i)
+    {
+        float offset[3];
+        Subtract3(offset, mesh->vertices[vertexIndices[i]].position, center);
+        const float distanceSquared = Dot3(offset, offset);
+        if (distanceSquared > maxDistanceSquared) {
+            maxDistanceSquared = distanceSquared;
+        }
+    }
+    memcpy(dst->center, center, sizeof(center));
+    dst->radius = sqrtf(maxDistanceSquared);
+
+    // The cone axis is the area weighted average normal
+    float axis[3] = { 0.0f, 0.0f, 0.0f };
+    for (uint32_t i = 0; i < meshlet->triangleCount; ++i)
+    {
+        float normal[3];
+        ComputeTriangleNormal(mesh, meshletTriangles[i], normal);
+        for (int j = 0; j < 3; ++j) {
+            axis[j] += normal[j];
+        }
+    }
+
+    const float axisLength = sqrtf(Dot3(axis, axis));
+    float minCosine = -1.0f;
+    if (axisLength > FLT_EPSILON)
+    {
+        for (int j = 0; j < 3; ++j) {
+            axis[j] /= axisLength;
+        }
+
+        minCosine = 1.0f;
+        for (uint32_t i = 0; i < meshlet->triangleCount; ++i)
+        {
+            float normal[3];
+            ComputeTriangleNormal(mesh, meshletTriangles[i], normal);
+            const float normalLength = sqrtf(Dot3(normal, normal));
+            if (normalLength <= FLT_EPSILON) continue;
+
+            const float cosine = Dot3(normal, axis) / normalLength;
+            if (cosine < minCosine) {
+                minCosine = cosine;
+            }
+        }
+    }
+
+    memcpy(dst->coneAxis, axis, sizeof(axis));
+    // A cone of 90 degrees or wider can always be seen from some side of the meshlet
+    dst->coneCutoff = minCosine > 0.0f ? sqrtf(1.0f - minCosine * minCosine) : 1.0f;
+}
+
+bool BuildMeshlets(const IndexedMesh* mesh, uint32_t maxVertexCount, uint32_t maxTriangleCount, MeshletData* outData)
+{
+    memset(outData, 0, sizeof(*outData));
+
+    if (maxVertexCount > MESHLET_LOCAL_INDEX_LIMIT) {
+        maxVertexCount = MESHLET_LOCAL_INDEX_LIMIT;
+    }
+    if (maxVertexCount < 3 || maxTriangleCount < 1)
+    {
+        fprintf(stderr, "A meshlet of %u vertices and %u triangles cannot hold any triangle!\n", maxVertexCount, maxTriangleCount);
+        return false;
+    }
+
+    const uint32_t triangleCount = mesh->indexCount / 3U;
+    const uint32_t vertexCount = mesh->vertexCount;
+
+    uint32_t* adjacencyOffsets = calloc(vertexCount + 1, sizeof(*adjacencyOffsets));
+    uint32_t* adjacentTriangles = malloc(triangleCount * 3U * sizeof(*adjacentTriangles));
+    uint32_t* localIndices = malloc(vertexCount * sizeof(*localIndices));
+    uint32_t* meshletTriangles = malloc(maxTriangleCount * sizeof(*meshletTriangles));
+    bool* emitted = calloc(triangleCount, sizeof(*emitted));
+
+    // A meshlet holds at least one triangle, so these are the worst case sizes.
+    outData->meshlets = malloc(triangleCount * sizeof(*outData->meshlets));
+    outData->bounds = malloc(triangleCount * sizeof(*outData->bounds));
+    outData->vertexIndices = malloc(triangleCount * 3U * sizeof(*outData->vertexIndices));
+    outData->triangles = malloc(triangleCount * sizeof(*outData->triangles));
+
+    bool succeeded = false;
+    do
+    {
+        if (adjacencyOffsets == NULL || adjacentTriangles == NULL || localIndices == NULL || meshletTriangles == NULL || emitted == NULL ||
+            outData->meshlets == NULL || outData->bounds == NULL || outData->vertexIndices == NULL || outData->triangles == NULL)
+        {
+            fprintf(stderr, "Failed to allocate the meshlet data!\n");
+            break;
+        }
+
+        // The triangles around each vertex, adjacentTriangles[adjacencyOffsets[v] .. adjacencyOffsets[v + 1]]
+        for (uint32_t i = 0; i < triangleCount * 3U; ++i) {
+            ++adjacencyOffsets[mesh->indices[i] + 1];
+        }
+        for (uint32_t v = 0; v < vertexCount; ++v) {
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        }
+        for (uint32_t i = 0; i < triangleCount * 3U; ++i) {
+            adjacentTriangles[adjacencyOffsets[mesh->indices[i]]++] = i / 3U;
+        }
+        // The fill above advanced each offset to the start of the next vertex, shift them back.
+        for (uint32_t v = vertexCount; v > 0; --v) {
+            adjacencyOffsets[v] = adjacencyOffsets[v - 1];
+        }
+        adjacencyOffsets[0] = 0;
+
+        for (uint32_t v = 0; v < vertexCount; ++v) {
+            localIndices[v] = INVALID_INDEX;
+        }
+
+        uint32_t emittedCount = 0;
+        uint32_t seedCursor = 0;
+        uint32_t nextSeed = INVALID_INDEX;
+
+        while (emittedCount < triangleCount)
+        {
+            // Grow from a triangle next to the former meshlet where possible, so that consecutive meshlets are close too.
+            uint32_t candidate = nextSeed;
+            if (candidate == INVALID_INDEX)
+            {
+                while (emitted[seedCursor]) ++seedCursor;
+                candidate = seedCursor;
+            }
+
+            Meshlet* meshlet = &outData->meshlets[outData->meshletCount];
+            meshlet->vertexOffset = outData->vertexIndexCount;
+            meshlet->triangleOffset = outData->triangleCount;
+            meshlet->vertexCount = 0;
+            meshlet->triangleCount = 0;
+            uint32_t* meshletVertices = &outData->vertexIndices[meshlet->vertexOffset];
+            float positionSum[3] = { 0.0f, 0.0f, 0.0f };
+
+            while (candidate != INVALID_INDEX)
+            {
+                uint32_t packedTriangle = 0;
+                for (uint32_t corner = 0; corner < 3; ++corner)
+                {
+                    const uint32_t v = mesh->indices[candidate * 3U + corner];
+                    if (localIndices[v] == INVALID_INDEX)
+                    {
+                        localIndices[v] = meshlet->vertexCount;
+                        meshletVertices[meshlet->vertexCount++] = v;
+                        for (int j = 0; j < 3; ++j) {
+                            positionSum[j] += mesh->vertices[v].position[j];
+                        }
+                    }
+                    packedTriangle |= localIndices[v] << (corner * 8U);
+                }
+                outData->triangles[meshlet->triangleOffset + meshlet->triangleCount] = packedTriangle;
+                meshletTriangles[meshlet->triangleCount++] = candidate;
+                emitted[candidate] = true;
+                ++emittedCount;
+
+                if (meshlet->triangleCount == maxTriangleCount) break;
+
+                // Among the triangles touching the meshlet, take the one adding the fewest vertices, then the one closest to the meshlet center.
+                float center[3];
+                for (int j = 0; j < 3; ++j) {
+                    center[j] = positionSum[j] / (float)meshlet->vertexCount;
+                }
+
+                candidate = INVALID_INDEX;
+                uint32_t bestNewVertexCount = 4;
+                float bestDistanceSquared = FLT_MAX;
+                for (uint32_t i = 0; i < meshlet->vertexCount; ++i)
+                {
+                    const uint32_t v = meshletVertices[i];
+                    for (uint32_t k = adjacencyOffsets[v]; k < adjacencyOffsets[v + 1]; ++k)
+                    {
+                        const uint32_t triangle = adjacentTriangles[k];
+                        if (emitted[triangle]) continue;
+
+                        const uint32_t* indices = &mesh->indices[triangle * 3U];
+                        uint32_t newVertexCount = 0;
+                        float distance[3] = { 0.0f, 0.0f, 0.0f };
+                        for (uint32_t corner = 0; corner < 3; ++corner)
+                        {
+                            if (localIndices[indices[corner]] == INVALID_INDEX) ++newVertexCount;
+                            for (int j = 0; j < 3; ++j) {
+                                distance[j] += mesh->vertices[indices[corner]].position[j] / 3.0f;
+                            }
+                        }
+                        if (meshlet->vertexCount + newVertexCount > maxVertexCount || newVertexCount > bestNewVertexCount) continue;
+
+                        Subtract3(distance, distance, center);
+                        const float distanceSquared = Dot3(distance, distance);
+                        if (newVertexCount < bestNewVertexCount || distanceSquared < bestDistanceSquared)
+                        {
+                            candidate = triangle;
+                            bestNewVertexCount = newVertexCount;
+                            bestDistanceSquared = distanceSquared;
+                        }
+                    }
+                }
+            }
+
+            // Any triangle left around this meshlet seeds the next one
+            nextSeed = INVALID_INDEX;
+            for (uint32_t i = 0; i < meshlet->vertexCount && nextSeed == INVALID_INDEX; ++i)
+            {
+                const uint32_t v = meshletVertices[i];
+                for (uint32_t k = adjacencyOffsets[v]; k < adjacencyOffsets[v + 1]; ++k)
+                {
+                    if (!emitted[adjacentTriangles[k]])
+                    {
+                        nextSeed = adjacentTriangles[k];
+                        break;
+                    }
+                }
+            }
+
+            ComputeMeshletBounds(mesh, outData, meshlet, meshletTriangles, &outData->bounds[outData->meshletCount]);
+
+            for (uint32_t i = 0; i < meshlet->vertexCount; ++i) {
+                localIndices[meshletVertices[i]] = INVALID_INDEX;
+            }
+
+            outData->vertexIndexCount += meshlet->vertexCount;
+            outData->triangleCount += meshlet->triangleCount;
+            ++outData->meshletCount;
+        }
+
+        succeeded = true;
+    }
+    while (false);
+
+    free(adjacencyOffsets);
+    free(adjacentTriangles);
+    free(localIndices);
+    free(meshletTriangles);
+    free(emitted);
+
+    if (!succeeded) {
+        FreeMeshlets(outData);
+    }
+    return succeeded;
+}
+
+void FreeMeshlets(MeshletData* data)
+{
+    free(data->meshlets);
+    free(data->bounds);
+    free(data->vertexIndices);
+    free(data->triangles);
+    memset(data, 0, sizeof(*data));
+}
+
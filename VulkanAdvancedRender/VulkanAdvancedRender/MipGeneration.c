@@ -0,0 +1,505 @@
+#include "common.h"
+
+enum { MIPMAP_WORK_GROUP_SIZE = 8 };
+
+// This MUST BE coherent with `mipgen_block` in mipgen.comp.glsl
+typedef struct MipmapPushConstants
+{
+    uint32_t dstWidth;
+    uint32_t dstHeight;
+    uint32_t swapRedBlue;       // the texture is BGRA, while the storage view of it is RGBA
+    uint32_t encodeSRGB;        // the texture is sRGB, while the storage view of it is UNORM
+} MipmapPushConstants;
+
+static const char* const s_mipmapGenerationNames[MIPMAP_GENERATION_COUNT] = {
+    "auto",
+    "blit",
+    "compute",
+    "none"
+};
+
+const char* GetMipmapGenerationName(MipmapGeneration generation)
+{
+    return generation < MIPMAP_GENERATION_COUNT ? s_mipmapGenerationNames[generation] : "unknown";
+}
+
+bool ParseMipmapGeneration(const char* name, MipmapGeneration* outGeneration)
+{
+    for (int i = 0; i < MIPMAP_GENERATION_COUNT; ++i)
+    {
+        if (strcmp(name, s_mipmapGenerationNames[i]) == 0)
+        {
+            *outGeneration = (MipmapGeneration)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t GetFullMipLevelCount(uint32_t width, uint32_t height)
+{
+    uint32_t levelCount = 1;
+    for (uint32_t size = max(width, height); size > 1; size >>= 1) {
+        ++levelCount;
+    }
+    return levelCount;
+}
+
+// The compute downsample writes through an R8G8B8A8_UNORM view, which every device supports as a storage image,
+// so it covers the 8-bit formats that can be viewed as that.
+static bool IsFormatComputeDownsampleable(VkFormat format)
+{
+    return format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB ||
+            format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+}
+
+MipmapGeneration ResolveMipmapGeneration(VkPhysicalDevice physicalDevice, VkFormat format, MipmapGeneration requested)
+{
+    if (requested == MIPMAP_GENERATION_NONE) return MIPMAP_GENERATION_NONE;
+
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+    const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    const bool isBlittable = (formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures;
+    const bool isDownsampleable = IsFormatComputeDownsampleable(format) &&
+                                (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) != 0;
+
+    if (requested == MIPMAP_GENERATION_COMPUTE && isDownsampleable) return MIPMAP_GENERATION_COMPUTE;
+    if (isBlittable) return MIPMAP_GENERATION_BLIT;
+    if (isDownsampleable) return MIPMAP_GENERATION_COMPUTE;
+
+    fprintf(stderr, "Format %d can neither be blitted nor downsampled in a compute shader, so the texture has no mip chain.\n", format);
+    return MIPMAP_GENERATION_NONE;
+}
+
+void RecordMipmapBlits(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height, uint32_t levelCount, uint32_t layerCount)
+{
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .pNext = NULL,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0U,
+            .levelCount = 1U,
+            .baseArrayLayer = 0U,
+            .layerCount = layerCount
+        }
+    };
+
+    // Each level is filtered from the one above it, which is done with as soon as it has been read.
+    for (uint32_t level = 1; level < levelCount; ++level)
+    {
+        barrier.subresourceRange.baseMipLevel = level - 1U;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+
+        const VkImageBlit blitRegion = {
+            .srcSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = level - 1U,
+                .baseArrayLayer = 0U,
+                .layerCount = layerCount
+            },
+            .srcOffsets = {
+                { .x = 0, .y = 0, .z = 0 },
+                { .x = (int32_t)max(width >> (level - 1U), 1U), .y = (int32_t)max(height >> (level - 1U), 1U), .z = 1 }
+            },
+            .dstSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = level,
+                .baseArrayLayer = 0U,
+                .layerCount = layerCount
+            },
+            .dstOffsets = {
+                { .x = 0, .y = 0, .z = 0 },
+                { .x = (int32_t)max(width >> level, 1U), .y = (int32_t)max(height >> level, 1U), .z = 1 }
+            }
+        };
+        vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blitRegion, VK_FILTER_LINEAR);
+
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+    }
+
+    // The last level is only ever written
+    barrier.subresourceRange.baseMipLevel = levelCount - 1U;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+}
+
+static VkPipeline CreateMipmapComputePipeline(VkDevice specDevice, const char* compSPVFilePath, VkPipelineLayout pipelineLayout, VkPipelineCache pipelineCache)
+{
+    VkShaderModule computeShaderModule = VK_NULL_HANDLE;
+    VkPipeline dstPipeline = VK_NULL_HANDLE;
+
+    do
+    {
+        if (!CreateShaderModule(compSPVFilePath, &computeShaderModule)) break;
+
+        PipelineCreationFeedbackRecord feedbackRecord;
+
+        const VkComputePipelineCreateInfo pipelineCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+            .pNext = PreparePipelineCreationFeedback(&feedbackRecord, NULL, 1U),
+            .flags = 0,
+            .stage = {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .pNext = NULL,
+                .flags = 0,
+                .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+                .module = computeShaderModule,
+                .pName = "main",
+                .pSpecializationInfo = NULL
+            },
+            .layout = pipelineLayout,
+            .basePipelineHandle = VK_NULL_HANDLE,
+            .basePipelineIndex = 0
+        };
+
+        const double startTime = GetCurrentTimeInMilliseconds();
+        const VkResult res = vkCreateComputePipelines(specDevice, pipelineCache, 1, &pipelineCreateInfo, NULL, &dstPipeline);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreateComputePipelines for mipmap generation failed: %d\n", res);
+            dstPipeline = VK_NULL_HANDLE;
+            break;
+        }
+
+        RecordPipelineCreation("mipmap generation", &feedbackRecord, GetCurrentTimeInMilliseconds() - startTime);
+    }
+    while (false);
+
+    if (computeShaderModule != VK_NULL_HANDLE) {
+        vkDestroyShaderModule(specDevice, computeShaderModule, NULL);
+    }
+
+    return dstPipeline;
+}
+
+static bool CreateMipmapComputePipelineAndLayouts(VkDevice specDevice, uint32_t levelCount, VkPipelineCache pipelineCache, MipmapComputeResources* resources)
+{
+    const VkDescriptorSetLayoutBinding layoutBindings[] = {
+        // source level
+        {
+            .binding = 0,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = NULL
+        },
+        // destination level
+        {
+            .binding = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = NULL
+        }
+    };
+
+    const VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .bindingCount = (uint32_t)(sizeof(layoutBindings) / sizeof(layoutBindings[0])),
+        .pBindings = layoutBindings
+    };
+    VkResult res = vkCreateDescriptorSetLayout(specDevice, &descriptorSetLayoutCreateInfo, NULL, &resources->descriptorSetLayout);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkCreateDescriptorSetLayout for mipmap generation failed: %d\n", res);
+        return false;
+    }
+
+    const VkPushConstantRange pushConstantRange = {
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset = 0,
+        .size = sizeof(MipmapPushConstants)
+    };
+    const VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .pNext = NULL,
+        .setLayoutCount = 1,
+        .pSetLayouts = &resources->descriptorSetLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstantRange
+    };
+    res = vkCreatePipelineLayout(specDevice, &pipelineLayoutCreateInfo, NULL, &resources->pipelineLayout);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkCreatePipelineLayout for mipmap generation failed: %d\n", res);
+        return false;
+    }
+
+    resources->pipeline = CreateMipmapComputePipeline(specDevice, "shaders/mipgen.comp.spv", resources->pipelineLayout, pipelineCache);
+    if (resources->pipeline == VK_NULL_HANDLE) return false;
+
+    // One set per generated level
+    const VkDescriptorPoolSize poolSizes[] = {
+        { .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = levelCount - 1U },
+        { .type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = levelCount - 1U }
+    };
+    const VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .maxSets = levelCount - 1U,
+        .poolSizeCount = (uint32_t)(sizeof(poolSizes) / sizeof(poolSizes[0])),
+        .pPoolSizes = poolSizes
+    };
+    res = vkCreateDescriptorPool(specDevice, &descriptorPoolCreateInfo, NULL, &resources->descriptorPool);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkCreateDescriptorPool for mipmap generation failed: %d\n", res);
+        return false;
+    }
+
+    // The source level is read with one bilinear tap in the middle of each 2x2 footprint
+    const VkSamplerCreateInfo samplerCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .magFilter = VK_FILTER_LINEAR,
+        .minFilter = VK_FILTER_LINEAR,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .mipLodBias = 0.0f,
+        .anisotropyEnable = VK_FALSE,
+        .maxAnisotropy = 0.0f,
+        .compareEnable = VK_FALSE,
+        .compareOp = VK_COMPARE_OP_NEVER,
+        .minLod = 0.0f,
+        .maxLod = 0.0f,
+        .borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK,
+        .unnormalizedCoordinates = VK_FALSE
+    };
+    res = vkCreateSampler(specDevice, &samplerCreateInfo, NULL, &resources->sampler);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkCreateSampler for mipmap generation failed: %d\n", res);
+        return false;
+    }
+
+    return true;
+}
+
+static bool CreateMipLevelView(VkDevice specDevice, VkImage image, VkFormat format, uint32_t level, uint32_t layerCount, MipmapComputeResources* resources)
+{
+    const VkImageViewCreateInfo imageViewCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .image = image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY,
+        .format = format,
+        .components = {
+            .r = VK_COMPONENT_SWIZZLE_IDENTITY,
+            .g = VK_COMPONENT_SWIZZLE_IDENTITY,
+            .b = VK_COMPONENT_SWIZZLE_IDENTITY,
+            .a = VK_COMPONENT_SWIZZLE_IDENTITY
+        },
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = level,
+            .levelCount = 1U,
+            .baseArrayLayer = 0U,
+            .layerCount = layerCount
+        }
+    };
+
+    const VkResult res = vkCreateImageView(specDevice, &imageViewCreateInfo, NULL, &resources->levelViews[resources->levelViewCount]);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkCreateImageView for mip level %u failed: %d\n", level, res);
+        return false;
+    }
+    ++resources->levelViewCount;
+
+    return true;
+}
+
+bool RecordMipmapCompute(VkDevice specDevice, VkCommandBuffer commandBuffer, VkImage image, VkFormat format, uint32_t width, uint32_t height,
+                        uint32_t levelCount, uint32_t layerCount, VkPipelineCache pipelineCache, MipmapComputeResources* outResources)
+{
+    memset(outResources, 0, sizeof(*outResources));
+    if (!CreateMipmapComputePipelineAndLayouts(specDevice, levelCount, pipelineCache, outResources)) return false;
+
+    // The first level has just been copied, and the others are only written by the compute shader before they are sampled.
+    const VkImageMemoryBarrier initialBarriers[] = {
+        {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext = NULL,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+            .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = image,
+            .subresourceRange = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0U, .levelCount = 1U, .baseArrayLayer = 0U, .layerCount = layerCount }
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext = NULL,
+            .srcAccessMask = VK_ACCESS_NONE,
+            .dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = image,
+            .subresourceRange = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 1U, .levelCount = levelCount - 1U, .baseArrayLayer = 0U, .layerCount = layerCount }
+        }
+    };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+        0, NULL, 0, NULL, (uint32_t)(sizeof(initialBarriers) / sizeof(initialBarriers[0])), initialBarriers);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, outResources->pipeline);
+
+    const bool isBGRA = format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+    const bool isSRGB = format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_B8G8R8A8_SRGB;
+    for (uint32_t level = 1; level < levelCount; ++level)
+    {
+        // Sampled through the texture format, so that sRGB is decoded and the channels come in RGBA order
+        const uint32_t srcViewIndex = outResources->levelViewCount;
+        if (!CreateMipLevelView(specDevice, image, format, level - 1U, layerCount, outResources)) return false;
+        if (!CreateMipLevelView(specDevice, image, VK_FORMAT_R8G8B8A8_UNORM, level, layerCount, outResources)) return false;
+
+        const VkDescriptorSetAllocateInfo allocInfo = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .pNext = NULL,
+            .descriptorPool = outResources->descriptorPool,
+            .descriptorSetCount = 1U,
+            .pSetLayouts = &outResources->descriptorSetLayout
+        };
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+        const VkResult res = vkAllocateDescriptorSets(specDevice, &allocInfo, &descriptorSet);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkAllocateDescriptorSets for mipmap generation failed: %d\n", res);
+            return false;
+        }
+
+        const VkDescriptorImageInfo srcImageInfo = {
+            .sampler = outResources->sampler,
+            .imageView = outResources->levelViews[srcViewIndex],
+            .imageLayout = level == 1U ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL
+        };
+        const VkDescriptorImageInfo dstImageInfo = {
+            .sampler = VK_NULL_HANDLE,
+            .imageView = outResources->levelViews[srcViewIndex + 1U],
+            .imageLayout = VK_IMAGE_LAYOUT_GENERAL
+        };
+        const VkWriteDescriptorSet descriptorWrites[] = {
+            {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .pNext = NULL,
+                .dstSet = descriptorSet,
+                .dstBinding = 0,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .pImageInfo = &srcImageInfo,
+                .pBufferInfo = NULL,
+                .pTexelBufferView = NULL
+            },
+            {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .pNext = NULL,
+                .dstSet = descriptorSet,
+                .dstBinding = 1,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                .pImageInfo = &dstImageInfo,
+                .pBufferInfo = NULL,
+                .pTexelBufferView = NULL
+            }
+        };
+        vkUpdateDescriptorSets(specDevice, (uint32_t)(sizeof(descriptorWrites) / sizeof(descriptorWrites[0])), descriptorWrites, 0, NULL);
+
+        const MipmapPushConstants pushConstants = {
+            .dstWidth = max(width >> level, 1U),
+            .dstHeight = max(height >> level, 1U),
+            .swapRedBlue = isBGRA ? 1U : 0U,
+            .encodeSRGB = isSRGB ? 1U : 0U
+        };
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, outResources->pipelineLayout, 0, 1, &descriptorSet, 0, NULL);
+        vkCmdPushConstants(commandBuffer, outResources->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), &pushConstants);
+        vkCmdDispatch(commandBuffer, (pushConstants.dstWidth + MIPMAP_WORK_GROUP_SIZE - 1U) / MIPMAP_WORK_GROUP_SIZE,
+                    (pushConstants.dstHeight + MIPMAP_WORK_GROUP_SIZE - 1U) / MIPMAP_WORK_GROUP_SIZE, layerCount);
+
+        // The level just written is the source of the next dispatch
+        const VkImageMemoryBarrier levelBarrier = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext = NULL,
+            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+            .oldLayout = VK_IMAGE_LAYOUT_GENERAL,
+            .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = image,
+            .subresourceRange = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = level, .levelCount = 1U, .baseArrayLayer = 0U, .layerCount = layerCount }
+        };
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &levelBarrier);
+    }
+
+    const VkImageMemoryBarrier finalBarrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .pNext = NULL,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_GENERAL,
+        .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
+        .subresourceRange = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 1U, .levelCount = levelCount - 1U, .baseArrayLayer = 0U, .layerCount = layerCount }
+    };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &finalBarrier);
+
+    return true;
+}
+
+void DestroyMipmapComputeResources(VkDevice specDevice, MipmapComputeResources* resources)
+{
+    for (uint32_t i = 0; i < resources->levelViewCount; ++i) {
+        vkDestroyImageView(specDevice, resources->levelViews[i], NULL);
+    }
+    if (resources->sampler != VK_NULL_HANDLE) {
+        vkDestroySampler(specDevice, resources->sampler, NULL);
+    }
+    if (resources->descriptorPool != VK_NULL_HANDLE) {
+        vkDestroyDescriptorPool(specDevice, resources->descriptorPool, NULL);
+    }
+    if (resources->pipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(specDevice, resources->pipeline, NULL);
+    }
+    if (resources->pipelineLayout != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(specDevice, resources->pipelineLayout, NULL);
+    }
+    if (resources->descriptorSetLayout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(specDevice, resources->descriptorSetLayout, NULL);
+    }
+    memset(resources, 0, sizeof(*resources));
+}
+
@@ -0,0 +1,336 @@
+#include "common.h"
+#include <threads.h>
+
+// File layout: PipelineCacheFileHeader immediately followed by the blob returned from vkGetPipelineCacheData
+enum
+{
+    PIPELINE_CACHE_FILE_MAGIC = 0x43504B56U,       // 'VKPC' in little endian
+    PIPELINE_CACHE_FILE_VERSION = 1U,
+    PIPELINE_CACHE_MAX_DATA_SIZE = 256 * 1024 * 1024
+};
+
+typedef struct PipelineCacheFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint32_t reserved;
+    uint64_t dataSize;
+    uint64_t dataHash;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+} PipelineCacheFileHeader;
+
+static struct PipelineCacheStatistics
+{
+    uint32_t hitCount;
+    uint32_t missCount;
+    uint32_t unknownCount;
+    double totalCreationTime;
+    size_t loadedDataSize;
+} s_pipelineCacheStats;
+
+static bool s_enablePipelineCreationFeedback = false;
+
+// Pipelines may be created on several worker threads at the same time
+static once_flag s_statsLockOnceFlag = ONCE_FLAG_INIT;
+static mtx_t s_statsLock;
+
+static void InitializeStatisticsLock(void)
+{
+    mtx_init(&s_statsLock, mtx_plain);
+}
+
+// 64-bit FNV-1a, only used to detect truncated or damaged cache files
+static uint64_t ComputeDataHash(const uint8_t* data, size_t size)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static bool ValidatePipelineCacheData(const VkPhysicalDeviceProperties* props, const PipelineCacheFileHeader* fileHeader, const uint8_t* data)
+{
+    if (fileHeader->magic != PIPELINE_CACHE_FILE_MAGIC || fileHeader->version != PIPELINE_CACHE_FILE_VERSION)
+    {
+        puts("Pipeline cache file has an unknown format, so it is ignored.");
+        return false;
+    }
+    if (fileHeader->vendorID != props->vendorID || fileHeader->deviceID != props->deviceID || fileHeader->driverVersion != props->driverVersion ||
+        memcmp(fileHeader->pipelineCacheUUID, props->pipelineCacheUUID, VK_UUID_SIZE) != 0)
+    {
+        puts("Pipeline cache file was written by another device or driver, so it is ignored.");
+        return false;
+    }
+    if (ComputeDataHash(data, (size_t)fileHeader->dataSize) != fileHeader->dataHash)
+    {
+        puts("Pipeline cache file is corrupt, so it is ignored.");
+        return false;
+    }
+
+    // Also check the header the implementation itself puts in front of the cache data
+    VkPipelineCacheHeaderVersionOne cacheHeader;
+    if (fileHeader->dataSize < sizeof(cacheHeader))
+    {
+        puts("Pipeline cache data is too small, so it is ignored.");
+        return false;
+    }
+    memcpy(&cacheHeader, data, sizeof(cacheHeader));
+    if (cacheHeader.headerSize < sizeof(cacheHeader) || cacheHeader.headerSize > fileHeader->dataSize ||
+        cacheHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+        cacheHeader.vendorID != props->vendorID || cacheHeader.deviceID != props->deviceID ||
+        memcmp(cacheHeader.pipelineCacheUUID, props->pipelineCacheUUID, VK_UUID_SIZE) != 0)
+    {
+        puts("Pipeline cache data header does not match the current device, so it is ignored.");
+        return false;
+    }
+
+    return true;
+}
+
+// Returns a malloc'ed buffer with the validated cache data, or NULL if there is no usable cache file
+static uint8_t* LoadPipelineCacheFile(const VkPhysicalDeviceProperties* props, const char* filePath, size_t* pDataSize)
+{
+    FILE* fp = GeneralOpenFile(filePath);
+    if (fp == NULL) return NULL;
+
+    uint8_t* data = NULL;
+    bool succeeded = false;
+    do
+    {
+        PipelineCacheFileHeader fileHeader;
+        if (fread(&fileHeader, sizeof(fileHeader), 1, fp) != 1)
+        {
+            puts("Pipeline cache file is truncated, so it is ignored.");
+            break;
+        }
+        if (fileHeader.dataSize == 0 || fileHeader.dataSize > PIPELINE_CACHE_MAX_DATA_SIZE)
+        {
+            puts("Pipeline cache file has an invalid data size, so it is ignored.");
+            break;
+        }
+
+        data = malloc((size_t)fileHeader.dataSize);
+        if (data == NULL)
+        {
+            fprintf(stderr, "Allocate pipeline cache data failed!\n");
+            break;
+        }
+        if (fread(data, 1, (size_t)fileHeader.dataSize, fp) != (size_t)fileHeader.dataSize)
+        {
+            puts("Pipeline cache file is truncated, so it is ignored.");
+            break;
+        }
+        if (!ValidatePipelineCacheData(props, &fileHeader, data)) break;
+
+        *pDataSize = (size_t)fileHeader.dataSize;
+        succeeded = true;
+    }
+    while (false);
+
+    fclose(fp);
+
+    if (!succeeded && data != NULL)
+    {
+        free(data);
+        data = NULL;
+    }
+    return data;
+}
+
+VkPipelineCache CreatePersistentPipelineCache(VkPhysicalDevice physicalDevice, VkDevice device, const char* filePath, bool enableCreationFeedback)
+{
+    VkPhysicalDeviceProperties props = { 0 };
+    vkGetPhysicalDeviceProperties(physicalDevice, &props);
+
+    call_once(&s_statsLockOnceFlag, InitializeStatisticsLock);
+    memset(&s_pipelineCacheStats, 0, sizeof(s_pipelineCacheStats));
+    s_enablePipelineCreationFeedback = enableCreationFeedback;
+
+    size_t dataSize = 0;
+    uint8_t* data = filePath != NULL ? LoadPipelineCacheFile(&props, filePath, &dataSize) : NULL;
+
+    VkPipelineCacheCreateInfo pipelineCacheInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .initialDataSize = dataSize,
+        .pInitialData = data
+    };
+
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+    VkResult res = vkCreatePipelineCache(device, &pipelineCacheInfo, NULL, &pipelineCache);
+    if (res != VK_SUCCESS && data != NULL)
+    {
+        // The implementation rejected the initial data, so just start from an empty cache.
+        fprintf(stderr, "vkCreatePipelineCache with %zu bytes of initial data failed: %d\n", dataSize, res);
+        pipelineCacheInfo.initialDataSize = 0;
+        pipelineCacheInfo.pInitialData = NULL;
+        dataSize = 0;
+        res = vkCreatePipelineCache(device, &pipelineCacheInfo, NULL, &pipelineCache);
+    }
+    if (data != NULL) {
+        free(data);
+    }
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkCreatePipelineCache failed: %d\n", res);
+        return VK_NULL_HANDLE;
+    }
+
+    s_pipelineCacheStats.loadedDataSize = dataSize;
+    if (dataSize > 0) {
+        printf("Pipeline cache: loaded %zu bytes from '%s'\n", dataSize, filePath);
+    }
+    else {
+        puts("Pipeline cache: starting with an empty cache");
+    }
+
+    return pipelineCache;
+}
+
+static bool ReplaceFile(const char* srcPath, const char* dstPath)
+{
+#ifdef _WIN32
+    return MoveFileExA(srcPath, dstPath, MOVEFILE_REPLACE_EXISTING) != FALSE;
+#else
+    return rename(srcPath, dstPath) == 0;
+#endif // _WIN32
+}
+
+bool SavePersistentPipelineCache(VkPhysicalDevice physicalDevice, VkDevice device, VkPipelineCache pipelineCache, const char* filePath)
+{
+    if (pipelineCache == VK_NULL_HANDLE || filePath == NULL) return false;
+
+    size_t dataSize = 0;
+    VkResult res = vkGetPipelineCacheData(device, pipelineCache, &dataSize, NULL);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkGetPipelineCacheData for size failed: %d\n", res);
+        return false;
+    }
+    if (dataSize == 0) return true;
+
+    // snprintf rather than sprintf_s, which maps to an unbounded sprintf outside of MSVC
+    char tmpPath[512];
+    const int tmpPathLength = snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", filePath);
+    if (tmpPathLength < 0 || (size_t)tmpPathLength >= sizeof(tmpPath))
+    {
+        fprintf(stderr, "The pipeline cache path '%s' is too long!\n", filePath);
+        return false;
+    }
+
+    uint8_t* data = malloc(dataSize);
+    if (data == NULL)
+    {
+        fprintf(stderr, "Allocate pipeline cache data failed!\n");
+        return false;
+    }
+
+    bool succeeded = false;
+    do
+    {
+        res = vkGetPipelineCacheData(device, pipelineCache, &dataSize, data);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkGetPipelineCacheData for content failed: %d\n", res);
+            break;
+        }
+
+        VkPhysicalDeviceProperties props = { 0 };
+        vkGetPhysicalDeviceProperties(physicalDevice, &props);
+
+        PipelineCacheFileHeader fileHeader = {
+            .magic = PIPELINE_CACHE_FILE_MAGIC,
+            .version = PIPELINE_CACHE_FILE_VERSION,
+            .vendorID = props.vendorID,
+            .deviceID = props.deviceID,
+            .driverVersion = props.driverVersion,
+            .reserved = 0,
+            .dataSize = dataSize,
+            .dataHash = ComputeDataHash(data, dataSize)
+        };
+        memcpy(fileHeader.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE);
+
+        // Write into a temporary file first so that an interrupted write never leaves a half written cache behind.
+        FILE* fp = GeneralOpenFileForWriting(tmpPath);
+        if (fp == NULL) break;
+
+        const bool written = fwrite(&fileHeader, sizeof(fileHeader), 1, fp) == 1 && fwrite(data, 1, dataSize, fp) == dataSize;
+        if (fclose(fp) != 0 || !written)
+        {
+            fprintf(stderr, "Write pipeline cache file '%s' failed!\n", tmpPath);
+            remove(tmpPath);
+            break;
+        }
+        if (!ReplaceFile(tmpPath, filePath))
+        {
+            fprintf(stderr, "Replace pipeline cache file '%s' failed!\n", filePath);
+            remove(tmpPath);
+            break;
+        }
+
+        printf("Pipeline cache: saved %zu bytes to '%s'\n", dataSize, filePath);
+        succeeded = true;
+    }
+    while (false);
+
+    free(data);
+
+    return succeeded;
+}
+
+const void* PreparePipelineCreationFeedback(PipelineCreationFeedbackRecord* record, const void* pNext, uint32_t stageCount)
+{
+    memset(record, 0, sizeof(*record));
+    if (!s_enablePipelineCreationFeedback) return pNext;
+
+    assert(stageCount <= MAX_PIPELINE_SHADER_STAGE_COUNT);
+
+    record->createInfo = (VkPipelineCreationFeedbackCreateInfo) {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO,
+        .pNext = pNext,
+        .pPipelineCreationFeedback = &record->pipelineFeedback,
+        .pipelineStageCreationFeedbackCount = stageCount,
+        .pPipelineStageCreationFeedbacks = record->stageFeedbacks
+    };
+    return &record->createInfo;
+}
+
+void RecordPipelineCreation(const char* pipelineName, const PipelineCreationFeedbackRecord* record, double creationTime)
+{
+    const char* resultStr = "unknown";
+    const VkPipelineCreationFeedbackFlags flags = record->pipelineFeedback.flags;
+
+    mtx_lock(&s_statsLock);
+    if ((flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT) == 0) {
+        ++s_pipelineCacheStats.unknownCount;
+    }
+    else if ((flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT) != 0)
+    {
+        ++s_pipelineCacheStats.hitCount;
+        resultStr = "hit";
+    }
+    else
+    {
+        ++s_pipelineCacheStats.missCount;
+        resultStr = "miss";
+    }
+    s_pipelineCacheStats.totalCreationTime += creationTime;
+    mtx_unlock(&s_statsLock);
+
+    printf("Pipeline '%s' created in %.3f ms (cache %s)\n", pipelineName, creationTime, resultStr);
+}
+
+void PrintPipelineCacheStatistics(void)
+{
+    printf("Pipeline cache statistics: %u hits, %u misses, %u without feedback, sum of creation times: %.3f ms, %s start\n",
+        s_pipelineCacheStats.hitCount, s_pipelineCacheStats.missCount, s_pipelineCacheStats.unknownCount, s_pipelineCacheStats.totalCreationTime,
+        s_pipelineCacheStats.loadedDataSize > 0 ? "warm" : "cold");
+}
+
@@ -0,0 +1,669 @@
+#include "common.h"
+
+typedef struct RenderGraphUsageInfo
+{
+    VkPipelineStageFlags stageMask;
+    VkAccessFlags accessMask;
+    VkImageLayout layout;           // VK_IMAGE_LAYOUT_UNDEFINED for a usage of buffers only
+} RenderGraphUsageInfo;
+
+static const VkAccessFlags RENDER_GRAPH_WRITE_ACCESS_MASK = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                                            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT |
+                                                            VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+static const RenderGraphUsageInfo s_usageInfos[RENDER_GRAPH_USAGE_COUNT] = {
+    [RENDER_GRAPH_USAGE_TRANSFER_READ] = {
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+    },
+    [RENDER_GRAPH_USAGE_TRANSFER_WRITE] = {
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+    },
+    [RENDER_GRAPH_USAGE_COMPUTE_READ] = {
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL
+    },
+    [RENDER_GRAPH_USAGE_COMPUTE_WRITE] = {
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL
+    },
+    [RENDER_GRAPH_USAGE_COMPUTE_READ_WRITE] = {
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL
+    },
+    [RENDER_GRAPH_USAGE_TASK_READ_WRITE] = {
+        VK_PIPELINE_STAGE_TASK_SHADER_BIT_EXT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED
+    },
+    [RENDER_GRAPH_USAGE_VERTEX_ATTRIBUTE_READ] = {
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED
+    },
+    [RENDER_GRAPH_USAGE_INDEX_READ] = {
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED
+    },
+    [RENDER_GRAPH_USAGE_INDIRECT_READ] = {
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED
+    },
+    [RENDER_GRAPH_USAGE_FRAGMENT_SAMPLED_READ] = {
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    },
+    [RENDER_GRAPH_USAGE_COLOR_ATTACHMENT_WRITE] = {
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+    },
+    [RENDER_GRAPH_USAGE_DEPTH_ATTACHMENT_WRITE] = {
+        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+    },
+    [RENDER_GRAPH_USAGE_HOST_READ] = {
+        VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT, VK_IMAGE_LAYOUT_GENERAL
+    }
+};
+
+// The barriers in front of one pass, issued with a single vkCmdPipelineBarrier
+typedef struct RenderGraphBarrierBatch
+{
+    VkPipelineStageFlags srcStageMask;
+    VkPipelineStageFlags dstStageMask;
+    uint32_t bufferBarrierCount;
+    uint32_t imageBarrierCount;
+    uint32_t executionBarrierCount;
+    VkBufferMemoryBarrier bufferBarriers[MAX_RENDER_GRAPH_PASS_USE_COUNT];
+    VkImageMemoryBarrier imageBarriers[MAX_RENDER_GRAPH_PASS_USE_COUNT];
+} RenderGraphBarrierBatch;
+
+static inline bool IsWriteAccess(VkAccessFlags accessMask)
+{
+    return (accessMask & RENDER_GRAPH_WRITE_ACCESS_MASK) != 0;
+}
+
+static inline VkDeviceSize AlignMemoryOffset(VkDeviceSize offset, VkDeviceSize alignment)
+{
+    return (offset + alignment - 1U) / alignment * alignment;
+}
+
+void InitializeRenderGraph(RenderGraph* graph, VkDevice device)
+{
+    *graph = (RenderGraph){ 0 };
+    graph->device = device;
+}
+
+static uint32_t AddRenderGraphResource(RenderGraph* graph, const char* name)
+{
+    if (graph->isCompiled || graph->resourceCount == MAX_RENDER_GRAPH_RESOURCE_COUNT)
+    {
+        fprintf(stderr, "The render graph cannot take the resource %s!\n", name);
+        return UINT32_MAX;
+    }
+
+    RenderGraphResource* resource = &graph->resources[graph->resourceCount];
+    *resource = (RenderGraphResource){ 0 };
+    resource->name = name;
+    resource->aliasedResource = UINT32_MAX;
+    resource->firstPass = UINT32_MAX;
+    resource->lastPass = UINT32_MAX;
+    resource->state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    return graph->resourceCount++;
+}
+
+uint32_t ImportRenderGraphBuffer(RenderGraph* graph, const char* name, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size)
+{
+    const uint32_t index = AddRenderGraphResource(graph, name);
+    if (index == UINT32_MAX) return UINT32_MAX;
+
+    RenderGraphResource* resource = &graph->resources[index];
+    resource->buffer = buffer;
+    resource->offset = offset;
+    resource->size = size;
+    return index;
+}
+
+uint32_t ImportRenderGraphImage(RenderGraph* graph, const char* name, VkImage image, const VkImageSubresourceRange* subresourceRange, VkImageLayout currentLayout)
+{
+    const uint32_t index = AddRenderGraphResource(graph, name);
+    if (index == UINT32_MAX) return UINT32_MAX;
+
+    RenderGraphResource* resource = &graph->resources[index];
+    resource->image = image;
+    resource->subresourceRange = *subresourceRange;
+    resource->state.layout = currentLayout;
+    return index;
+}
+
+uint32_t AddRenderGraphTransientImage(RenderGraph* graph, const char* name, const VkImageCreateInfo* createInfo, VkImageAspectFlags aspectMask)
+{
+    const uint32_t index = AddRenderGraphResource(graph, name);
+    if (index == UINT32_MAX) return UINT32_MAX;
+
+    RenderGraphResource* resource = &graph->resources[index];
+    resource->isTransient = true;
+    resource->transientCreateInfo = *createInfo;
+    resource->transientCreateInfo.pNext = NULL;
+    resource->transientCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    resource->subresourceRange = (VkImageSubresourceRange){
+        .aspectMask = aspectMask,
+        .baseMipLevel = 0,
+        .levelCount = createInfo->mipLevels,
+        .baseArrayLayer = 0,
+        .layerCount = createInfo->arrayLayers
+    };
+    return index;
+}
+
+uint32_t AddRenderGraphPass(RenderGraph* graph, const char* name, RenderGraphRecordProc recordProc)
+{
+    if (graph->isCompiled || graph->passCount == MAX_RENDER_GRAPH_PASS_COUNT)
+    {
+        fprintf(stderr, "The render graph cannot take the pass %s!\n", name);
+        return UINT32_MAX;
+    }
+
+    graph->passes[graph->passCount] = (RenderGraphPass){
+        .name = name,
+        .recordProc = recordProc,
+        .isEnabled = true,
+        .useCount = 0,
+        .uses = { { 0 } }
+    };
+    return graph->passCount++;
+}
+
+bool UseRenderGraphResource(RenderGraph* graph, uint32_t pass, uint32_t resource, RenderGraphUsage usage)
+{
+    if (graph->isCompiled || pass >= graph->passCount || resource >= graph->resourceCount || usage >= RENDER_GRAPH_USAGE_COUNT)
+    {
+        fprintf(stderr, "Invalid use of a resource in the render graph!\n");
+        return false;
+    }
+
+    RenderGraphPass* graphPass = &graph->passes[pass];
+    const RenderGraphResource* graphResource = &graph->resources[resource];
+    if (graphPass->useCount == MAX_RENDER_GRAPH_PASS_USE_COUNT)
+    {
+        fprintf(stderr, "The pass %s of the render graph uses too many resources!\n", graphPass->name);
+        return false;
+    }
+    if (graphResource->buffer == VK_NULL_HANDLE && s_usageInfos[usage].layout == VK_IMAGE_LAYOUT_UNDEFINED)
+    {
+        fprintf(stderr, "The image %s cannot be used as a buffer by the pass %s!\n", graphResource->name, graphPass->name);
+        return false;
+    }
+    // A pass both reading and writing a resource declares one usage with both, so that its barrier is derived from a single access
+    for (uint32_t i = 0; i < graphPass->useCount; ++i)
+    {
+        if (graphPass->uses[i].resource == resource)
+        {
+            fprintf(stderr, "The pass %s of the render graph uses %s more than once!\n", graphPass->name, graphResource->name);
+            return false;
+        }
+    }
+
+    graphPass->uses[graphPass->useCount++] = (RenderGraphPassUse){ .resource = resource, .usage = usage };
+    return true;
+}
+
+// Transient images are placed at the lowest offset whose former occupant is not used by any pass from the first pass of the image on.
+// Imported resources are not placed, only their passes are recorded.
+bool CompileRenderGraph(RenderGraph* graph)
+{
+    if (graph->isCompiled) return true;
+
+    uint32_t transientIndices[MAX_RENDER_GRAPH_RESOURCE_COUNT];
+    uint32_t transientCount = 0;
+    for (uint32_t r = 0; r < graph->resourceCount; ++r)
+    {
+        RenderGraphResource* resource = &graph->resources[r];
+        for (uint32_t p = 0; p < graph->passCount; ++p)
+        {
+            const RenderGraphPass* pass = &graph->passes[p];
+            for (uint32_t u = 0; u < pass->useCount; ++u)
+            {
+                if (pass->uses[u].resource != r) continue;
+                if (resource->firstPass == UINT32_MAX) {
+                    resource->firstPass = p;
+                }
+                resource->lastPass = p;
+            }
+        }
+
+        if (!resource->isTransient) continue;
+
+        // Sorted by the first pass, so that each image only has to look at the places that the former ones have left
+        uint32_t position = transientCount++;
+        while (position > 0 && graph->resources[transientIndices[position - 1]].firstPass > resource->firstPass)
+        {
+            transientIndices[position] = transientIndices[position - 1];
+            --position;
+        }
+        transientIndices[position] = r;
+    }
+
+    if (transientCount == 0)
+    {
+        graph->isCompiled = true;
+        return true;
+    }
+
+    // A place in the transient memory, shared by the images whose passes follow each other
+    struct
+    {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        uint32_t lastPass;
+        uint32_t firstResource;
+        uint32_t lastResource;
+    } places[MAX_RENDER_GRAPH_RESOURCE_COUNT];
+    uint32_t placeCount = 0;
+    VkMemoryRequirements memoryRequirements = { .size = 0, .alignment = 1, .memoryTypeBits = UINT32_MAX };
+
+    for (uint32_t i = 0; i < transientCount; ++i)
+    {
+        RenderGraphResource* resource = &graph->resources[transientIndices[i]];
+        VkResult res = vkCreateImage(graph->device, &resource->transientCreateInfo, NULL, &resource->image);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreateImage for the transient image %s failed: %d\n", resource->name, res);
+            return false;
+        }
+
+        VkMemoryRequirements imageRequirements = { 0 };
+        vkGetImageMemoryRequirements(graph->device, resource->image, &imageRequirements);
+        graph->unaliasedTransientSize = AlignMemoryOffset(graph->unaliasedTransientSize, imageRequirements.alignment) + imageRequirements.size;
+        memoryRequirements.memoryTypeBits &= imageRequirements.memoryTypeBits;
+        memoryRequirements.alignment = max(memoryRequirements.alignment, imageRequirements.alignment);
+
+        // The smallest free place that fits, an unused image never shares one
+        uint32_t bestPlace = UINT32_MAX;
+        for (uint32_t p = 0; p < placeCount && resource->firstPass != UINT32_MAX; ++p)
+        {
+            if (places[p].lastPass >= resource->firstPass || places[p].size < imageRequirements.size ||
+                places[p].offset % imageRequirements.alignment != 0) {
+                continue;
+            }
+            if (bestPlace == UINT32_MAX || places[p].size < places[bestPlace].size) {
+                bestPlace = p;
+            }
+        }
+
+        if (bestPlace == UINT32_MAX)
+        {
+            bestPlace = placeCount++;
+            places[bestPlace].offset = AlignMemoryOffset(memoryRequirements.size, imageRequirements.alignment);
+            places[bestPlace].size = imageRequirements.size;
+            places[bestPlace].firstResource = transientIndices[i];
+            memoryRequirements.size = places[bestPlace].offset + imageRequirements.size;
+        }
+        else {
+            resource->aliasedResource = places[bestPlace].lastResource;
+        }
+        places[bestPlace].lastPass = resource->lastPass;
+        places[bestPlace].lastResource = transientIndices[i];
+        resource->memoryOffset = places[bestPlace].offset;
+    }
+
+    // The first image of a place follows the last one of the former execution
+    for (uint32_t p = 0; p < placeCount; ++p)
+    {
+        if (places[p].firstResource != places[p].lastResource) {
+            graph->resources[places[p].firstResource].aliasedResource = places[p].lastResource;
+        }
+    }
+
+    if (memoryRequirements.memoryTypeBits == 0)
+    {
+        fprintf(stderr, "The transient images of the render graph have no memory type in common!\n");
+        return false;
+    }
+    if (!AllocateDeviceMemory(&memoryRequirements, DEVICE_MEMORY_USAGE_GPU_ONLY, true, &graph->transientMemory))
+    {
+        fprintf(stderr, "Allocating the transient memory of the render graph failed!\n");
+        return false;
+    }
+
+    for (uint32_t i = 0; i < transientCount; ++i)
+    {
+        RenderGraphResource* resource = &graph->resources[transientIndices[i]];
+        VkResult res = vkBindImageMemory(graph->device, resource->image, graph->transientMemory.memory, graph->transientMemory.offset + resource->memoryOffset);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkBindImageMemory for the transient image %s failed: %d\n", resource->name, res);
+            return false;
+        }
+
+        const VkImageViewCreateInfo viewCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .image = resource->image,
+            .viewType = resource->transientCreateInfo.arrayLayers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D,
+            .format = resource->transientCreateInfo.format,
+            .components = {
+                .r = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .g = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .b = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .a = VK_COMPONENT_SWIZZLE_IDENTITY
+            },
+            .subresourceRange = resource->subresourceRange
+        };
+        res = vkCreateImageView(graph->device, &viewCreateInfo, NULL, &resource->view);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreateImageView for the transient image %s failed: %d\n", resource->name, res);
+            return false;
+        }
+    }
+
+    graph->isCompiled = true;
+    return true;
+}
+
+void SetRenderGraphPassEnabled(RenderGraph* graph, uint32_t pass, bool isEnabled)
+{
+    if (pass < graph->passCount) {
+        graph->passes[pass].isEnabled = isEnabled;
+    }
+}
+
+VkImage GetRenderGraphImage(const RenderGraph* graph, uint32_t resource)
+{
+    return resource < graph->resourceCount ? graph->resources[resource].image : VK_NULL_HANDLE;
+}
+
+VkImageView GetRenderGraphImageView(const RenderGraph* graph, uint32_t resource)
+{
+    return resource < graph->resourceCount ? graph->resources[resource].view : VK_NULL_HANDLE;
+}
+
+// The stages and access types that read `resource` in `layout` from the pass at `passIndex` on, up to its next write or layout transition,
+// so that a single barrier makes a write visible to all of them
+static void CollectFollowingReads(const RenderGraph* graph, uint32_t passIndex, uint32_t resource, VkImageLayout layout,
+                                VkPipelineStageFlags* pStageMask, VkAccessFlags* pAccessMask)
+{
+    const bool isImage = graph->resources[resource].buffer == VK_NULL_HANDLE;
+    for (uint32_t p = passIndex; p < graph->passCount; ++p)
+    {
+        const RenderGraphPass* pass = &graph->passes[p];
+        if (!pass->isEnabled) continue;
+
+        for (uint32_t u = 0; u < pass->useCount; ++u)
+        {
+            if (pass->uses[u].resource != resource) continue;
+
+            const RenderGraphUsageInfo* info = &s_usageInfos[pass->uses[u].usage];
+            if (IsWriteAccess(info->accessMask) || (isImage && info->layout != layout)) return;
+            *pStageMask |= info->stageMask;
+            *pAccessMask |= info->accessMask;
+        }
+    }
+}
+
+// Adds what the access of `use` in the pass at `passIndex` has to wait for to `batch`, and updates the state of its resource
+static void AddResourceBarrier(RenderGraph* graph, uint32_t passIndex, const RenderGraphPassUse* use, RenderGraphBarrierBatch* batch)
+{
+    RenderGraphResource* resource = &graph->resources[use->resource];
+    RenderGraphResourceState* state = &resource->state;
+    const RenderGraphUsageInfo* info = &s_usageInfos[use->usage];
+    const bool isImage = resource->buffer == VK_NULL_HANDLE;
+    const bool isWrite = IsWriteAccess(info->accessMask);
+
+    // The contents of a transient image never outlive an execution, but its memory may still be accessed by the image it is aliased with.
+    if (resource->isTransient && !resource->isUsedInExecution && resource->aliasedResource != UINT32_MAX)
+    {
+        const RenderGraphResourceState* aliasedState = &graph->resources[resource->aliasedResource].state;
+        state->writeStages |= aliasedState->writeStages;
+        state->readStages |= aliasedState->readStages;
+        if (!aliasedState->isWriteAvailable)
+        {
+            state->writeAccess |= aliasedState->writeAccess;
+            state->isWriteAvailable = false;
+        }
+    }
+    resource->isUsedInExecution = true;
+
+    const bool changesLayout = isImage && state->layout != info->layout;
+    VkPipelineStageFlags srcStageMask = 0;
+    VkAccessFlags srcAccessMask = 0;
+    VkPipelineStageFlags dstStageMask = info->stageMask;
+    VkAccessFlags dstAccessMask = info->accessMask;
+
+    if (isWrite || changesLayout)
+    {
+        // Write after read only has to wait for the reads, while the last write is made available if no barrier has done it yet.
+        srcStageMask = state->writeStages | state->readStages;
+        if (!state->isWriteAvailable) {
+            srcAccessMask = state->writeAccess;
+        }
+        if (!isWrite) {
+            CollectFollowingReads(graph, passIndex, use->resource, info->layout, &dstStageMask, &dstAccessMask);
+        }
+    }
+    else if (state->writeStages != 0 && ((info->stageMask & ~state->visibleStages) != 0 || (info->accessMask & ~state->visibleAccess) != 0))
+    {
+        // Read after write, made visible at once to every read up to the next write
+        srcStageMask = state->writeStages;
+        srcAccessMask = state->writeAccess;
+        CollectFollowingReads(graph, passIndex, use->resource, info->layout, &dstStageMask, &dstAccessMask);
+    }
+    else
+    {
+        // Nothing written since the former reads, or the write is already visible to this access
+        if (info->stageMask != VK_PIPELINE_STAGE_HOST_BIT) {
+            state->readStages |= info->stageMask;
+        }
+        return;
+    }
+
+    const bool needsMemoryBarrier = srcAccessMask != 0 || changesLayout;
+    if (srcStageMask != 0 || needsMemoryBarrier)
+    {
+        batch->srcStageMask |= srcStageMask != 0 ? srcStageMask : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        batch->dstStageMask |= dstStageMask;
+
+        if (!needsMemoryBarrier) {
+            ++batch->executionBarrierCount;
+        }
+        else if (isImage)
+        {
+            batch->imageBarriers[batch->imageBarrierCount++] = (VkImageMemoryBarrier){
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                .pNext = NULL,
+                .srcAccessMask = srcAccessMask,
+                .dstAccessMask = dstAccessMask,
+                .oldLayout = state->layout,
+                .newLayout = info->layout,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = resource->image,
+                .subresourceRange = resource->subresourceRange
+            };
+        }
+        else
+        {
+            batch->bufferBarriers[batch->bufferBarrierCount++] = (VkBufferMemoryBarrier){
+                .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+                .pNext = NULL,
+                .srcAccessMask = srcAccessMask,
+                .dstAccessMask = dstAccessMask,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .buffer = resource->buffer,
+                .offset = resource->offset,
+                .size = resource->size
+            };
+        }
+    }
+
+    if (isImage) {
+        state->layout = info->layout;
+    }
+
+    if (isWrite)
+    {
+        state->writeStages = info->stageMask;
+        state->writeAccess = info->accessMask & RENDER_GRAPH_WRITE_ACCESS_MASK;
+        state->isWriteAvailable = false;
+        state->readStages = 0;
+        state->visibleStages = 0;
+        state->visibleAccess = 0;
+    }
+    else if (info->stageMask == VK_PIPELINE_STAGE_HOST_BIT)
+    {
+        // The host only reads after it has waited for the fence of the submission, and the resource is not accessed again before,
+        // so nothing that the device has done to it is pending any more.
+        state->writeStages = 0;
+        state->writeAccess = 0;
+        state->isWriteAvailable = true;
+        state->readStages = 0;
+        state->visibleStages = 0;
+        state->visibleAccess = 0;
+    }
+    else
+    {
+        // A layout transition is a write that has finished once the reads behind the barrier may start
+        if (changesLayout)
+        {
+            state->writeStages = dstStageMask;
+            state->writeAccess = 0;
+            state->readStages = 0;
+        }
+        state->isWriteAvailable = true;
+        state->visibleStages |= dstStageMask;
+        state->visibleAccess |= dstAccessMask;
+        state->readStages |= info->stageMask;
+    }
+}
+
+void ExecuteRenderGraph(RenderGraph* graph, VkCommandBuffer commandBuffer, const void* frameData)
+{
+    graph->lastExecution = (RenderGraphStatistics){ 0 };
+
+    for (uint32_t r = 0; r < graph->resourceCount; ++r)
+    {
+        RenderGraphResource* resource = &graph->resources[r];
+        resource->isUsedInExecution = false;
+        if (resource->isTransient) {
+            resource->state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        }
+    }
+
+    for (uint32_t p = 0; p < graph->passCount; ++p)
+    {
+        const RenderGraphPass* pass = &graph->passes[p];
+        if (!pass->isEnabled) continue;
+
+        RenderGraphBarrierBatch batch;
+        batch.srcStageMask = 0;
+        batch.dstStageMask = 0;
+        batch.bufferBarrierCount = 0;
+        batch.imageBarrierCount = 0;
+        batch.executionBarrierCount = 0;
+        for (uint32_t u = 0; u < pass->useCount; ++u) {
+            AddResourceBarrier(graph, p, &pass->uses[u], &batch);
+        }
+
+        if (batch.dstStageMask != 0)
+        {
+            vkCmdPipelineBarrier(commandBuffer, batch.srcStageMask, batch.dstStageMask, 0, 0, NULL,
+                                batch.bufferBarrierCount, batch.bufferBarriers, batch.imageBarrierCount, batch.imageBarriers);
+            ++graph->lastExecution.barrierBatchCount;
+            graph->lastExecution.bufferBarrierCount += batch.bufferBarrierCount;
+            graph->lastExecution.imageBarrierCount += batch.imageBarrierCount;
+            graph->lastExecution.executionBarrierCount += batch.executionBarrierCount;
+        }
+
+        if (pass->recordProc != NULL) {
+            pass->recordProc(commandBuffer, frameData);
+        }
+        ++graph->lastExecution.executedPassCount;
+    }
+}
+
+void PrintRenderGraphStatistics(const RenderGraph* graph)
+{
+    printf("Render graph: %u of %u passes in the last execution, %u barrier batches with %u buffer, %u image and %u execution only barriers\n",
+        graph->lastExecution.executedPassCount, graph->passCount, graph->lastExecution.barrierBatchCount, graph->lastExecution.bufferBarrierCount,
+        graph->lastExecution.imageBarrierCount, graph->lastExecution.executionBarrierCount);
+    if (graph->unaliasedTransientSize > 0)
+    {
+        printf("Render graph transient images: %llu bytes aliased into %llu bytes\n", (unsigned long long)graph->unaliasedTransientSize,
+            (unsigned long long)graph->transientMemory.size);
+    }
+}
+
+void DestroyRenderGraph(RenderGraph* graph)
+{
+    for (uint32_t r = 0; r < graph->resourceCount; ++r)
+    {
+        RenderGraphResource* resource = &graph->resources[r];
+        if (!resource->isTransient) continue;
+
+        if (resource->view != VK_NULL_HANDLE) {
+            vkDestroyImageView(graph->device, resource->view, NULL);
+        }
+        if (resource->image != VK_NULL_HANDLE) {
+            vkDestroyImage(graph->device, resource->image, NULL);
+        }
+        resource->view = VK_NULL_HANDLE;
+        resource->image = VK_NULL_HANDLE;
+    }
+    FreeDeviceMemory(&graph->transientMemory);
+    graph->resourceCount = 0;
+    graph->passCount = 0;
+    graph->isCompiled = false;
+}
+
+bool RunRenderGraphSelfTest(VkDevice device)
+{
+    RenderGraph* graph = calloc(1, sizeof(*graph));
+    if (graph == NULL) return false;
+
+    InitializeRenderGraph(graph, device);
+
+    const VkImageCreateInfo createInfo = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = VK_FORMAT_R8G8B8A8_UNORM,
+        .extent = { 256U, 256U, 1U },
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 0,
+        .pQueueFamilyIndices = NULL,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+    };
+
+    // `first` lives in passes 0 and 1, `overlapping` in 1 and 2, and `last` in 2 and 3, so only `first` and `last` can share their memory.
+    const uint32_t first = AddRenderGraphTransientImage(graph, "first", &createInfo, VK_IMAGE_ASPECT_COLOR_BIT);
+    const uint32_t overlapping = AddRenderGraphTransientImage(graph, "overlapping", &createInfo, VK_IMAGE_ASPECT_COLOR_BIT);
+    const uint32_t last = AddRenderGraphTransientImage(graph, "last", &createInfo, VK_IMAGE_ASPECT_COLOR_BIT);
+    uint32_t passes[4];
+    for (uint32_t i = 0; i < 4; ++i) {
+        passes[i] = AddRenderGraphPass(graph, "self-test pass", NULL);
+    }
+
+    bool succeeded = UseRenderGraphResource(graph, passes[0], first, RENDER_GRAPH_USAGE_COLOR_ATTACHMENT_WRITE);
+    succeeded &= UseRenderGraphResource(graph, passes[1], first, RENDER_GRAPH_USAGE_FRAGMENT_SAMPLED_READ);
+    succeeded &= UseRenderGraphResource(graph, passes[1], overlapping, RENDER_GRAPH_USAGE_COLOR_ATTACHMENT_WRITE);
+    succeeded &= UseRenderGraphResource(graph, passes[2], overlapping, RENDER_GRAPH_USAGE_FRAGMENT_SAMPLED_READ);
+    succeeded &= UseRenderGraphResource(graph, passes[2], last, RENDER_GRAPH_USAGE_COLOR_ATTACHMENT_WRITE);
+    succeeded &= UseRenderGraphResource(graph, passes[3], last, RENDER_GRAPH_USAGE_FRAGMENT_SAMPLED_READ);
+    succeeded = CheckSelfTestCondition(succeeded && CompileRenderGraph(graph), "the render graph with three transient images compiles");
+
+    if (succeeded)
+    {
+        const RenderGraphResource* resources = graph->resources;
+        succeeded &= CheckSelfTestCondition(resources[first].memoryOffset == resources[last].memoryOffset && resources[last].aliasedResource == first,
+                                            "an image whose passes follow those of another one takes its place");
+        succeeded &= CheckSelfTestCondition(resources[overlapping].memoryOffset != resources[first].memoryOffset &&
+                                            resources[overlapping].aliasedResource == UINT32_MAX, "an image in use during the passes of the others gets a place of its own");
+        succeeded &= CheckSelfTestCondition(resources[first].aliasedResource == last, "the first image of a place follows its last one of the former execution");
+        succeeded &= CheckSelfTestCondition(graph->transientMemory.size < graph->unaliasedTransientSize, "aliasing takes less memory than one place per image");
+    }
+
+    printf("Render graph self-test: %llu bytes of transient images aliased into %llu bytes, %s\n", (unsigned long long)graph->unaliasedTransientSize,
+        (unsigned long long)graph->transientMemory.size, succeeded ? "passed" : "FAILED");
+
+    DestroyRenderGraph(graph);
+    free(graph);
+    return succeeded;
+}
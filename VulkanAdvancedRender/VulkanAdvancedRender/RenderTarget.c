@@ -0,0 +1,164 @@
+#include "common.h"
+
+const void* PrepareRenderTargetPipelineInfo(const RenderTarget* target, VkPipelineRenderingCreateInfoKHR* outCreateInfo, const void* pNext)
+{
+    if (target->renderPass != VK_NULL_HANDLE) return pNext;
+
+    *outCreateInfo = (VkPipelineRenderingCreateInfoKHR) {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR,
+        .pNext = pNext,
+        .viewMask = 0,
+        .colorAttachmentCount = 1,
+        .pColorAttachmentFormats = &target->colorFormat,
+        .depthAttachmentFormat = target->depthFormat,
+        .stencilAttachmentFormat = VK_FORMAT_UNDEFINED
+    };
+    return outCreateInfo;
+}
+
+static VkImageMemoryBarrier MakeAttachmentBarrier(VkImage image, VkImageAspectFlags aspectMask, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask,
+                                                VkImageLayout oldLayout, VkImageLayout newLayout)
+{
+    return (VkImageMemoryBarrier) {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .pNext = NULL,
+        .srcAccessMask = srcAccessMask,
+        .dstAccessMask = dstAccessMask,
+        .oldLayout = oldLayout,
+        .newLayout = newLayout,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
+        .subresourceRange = {
+            .aspectMask = aspectMask,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        }
+    };
+}
+
+void BeginRenderTarget(VkCommandBuffer commandBuffer, const RenderTarget* target, const VkClearValue clearValues[2])
+{
+    const VkRect2D renderArea = {
+        .offset = { .x = 0, .y = 0 },
+        .extent = target->extent
+    };
+
+    if (target->renderPass != VK_NULL_HANDLE)
+    {
+        const VkRenderPassBeginInfo renderPassBeginInfo = {
+            .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+            .pNext = NULL,
+            .renderPass = target->renderPass,
+            .framebuffer = target->framebuffer,
+            .renderArea = renderArea,
+            // With MSAA, attachment[2] and attachment[3], i.e. the color and depth resolves, are VK_ATTACHMENT_LOAD_OP_DONT_CARE
+            .clearValueCount = 2,
+            .pClearValues = clearValues
+        };
+        if (target->sampleCount > VK_SAMPLE_COUNT_1_BIT)
+        {
+            const VkSubpassBeginInfoKHR subpassBeginInfo = {
+                .sType = VK_STRUCTURE_TYPE_SUBPASS_BEGIN_INFO_KHR,
+                .pNext = NULL,
+                .contents = VK_SUBPASS_CONTENTS_INLINE
+            };
+            target->cmdBeginRenderPass2(commandBuffer, &renderPassBeginInfo, &subpassBeginInfo);
+        }
+        else {
+            vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+        }
+        return;
+    }
+
+    // The same transitions as the initial layouts and the external dependencies of the render pass:
+    // none of the former contents are kept, so only the former attachment writes have to be waited for.
+    const bool isMultisampled = target->resolveImage != VK_NULL_HANDLE;
+    const VkImageMemoryBarrier barriers[] = {
+        MakeAttachmentBarrier(target->depthImage, VK_IMAGE_ASPECT_DEPTH_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL),
+        MakeAttachmentBarrier(target->colorImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_ACCESS_NONE,
+                            VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL),
+        MakeAttachmentBarrier(target->resolveImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_ACCESS_NONE,
+                            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
+    };
+    const VkPipelineStageFlags attachmentStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                                                VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    vkCmdPipelineBarrier(commandBuffer, attachmentStages, attachmentStages, 0, 0, NULL, 0, NULL,
+                        isMultisampled ? 3U : 2U, barriers);
+
+    // The depth is only needed during the pass, so unlike the render pass, the multisampled depth is not resolved
+    const VkRenderingAttachmentInfoKHR colorAttachment = {
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
+        .pNext = NULL,
+        .imageView = target->colorView,
+        .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        .resolveMode = isMultisampled ? VK_RESOLVE_MODE_AVERAGE_BIT_KHR : VK_RESOLVE_MODE_NONE_KHR,
+        .resolveImageView = target->resolveView,
+        .resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = isMultisampled ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE,
+        .clearValue = clearValues[0]
+    };
+    const VkRenderingAttachmentInfoKHR depthAttachment = {
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
+        .pNext = NULL,
+        .imageView = target->depthView,
+        .imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+        .resolveMode = VK_RESOLVE_MODE_NONE_KHR,
+        .resolveImageView = VK_NULL_HANDLE,
+        .resolveImageLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .clearValue = clearValues[1]
+    };
+    const VkRenderingInfoKHR renderingInfo = {
+        .sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR,
+        .pNext = NULL,
+        .flags = 0,
+        .renderArea = renderArea,
+        .layerCount = 1,
+        .viewMask = 0,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &colorAttachment,
+        .pDepthAttachment = &depthAttachment,
+        .pStencilAttachment = NULL
+    };
+    target->cmdBeginRendering(commandBuffer, &renderingInfo);
+}
+
+void EndRenderTarget(VkCommandBuffer commandBuffer, const RenderTarget* target)
+{
+    if (target->renderPass != VK_NULL_HANDLE)
+    {
+        if (target->sampleCount > VK_SAMPLE_COUNT_1_BIT)
+        {
+            const VkSubpassEndInfoKHR subpassEndInfo = {
+                .sType = VK_STRUCTURE_TYPE_SUBPASS_END_INFO_KHR,
+                .pNext = NULL
+            };
+            target->cmdEndRenderPass2(commandBuffer, &subpassEndInfo);
+        }
+        else {
+            vkCmdEndRenderPass(commandBuffer);
+        }
+        return;
+    }
+
+    target->cmdEndRendering(commandBuffer);
+
+    // A presented image only needs the layout, which the presentation engine waits for through the semaphore,
+    // while an offscreen image is copied out afterwards.
+    const bool isCopiedOut = target->finalColorLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    const VkImageMemoryBarrier barrier = MakeAttachmentBarrier(target->resolveImage != VK_NULL_HANDLE ? target->resolveImage : target->colorImage,
+                                                            VK_IMAGE_ASPECT_COLOR_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                                                            isCopiedOut ? VK_ACCESS_TRANSFER_READ_BIT : VK_ACCESS_NONE,
+                                                            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, target->finalColorLayout);
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                        isCopiedOut ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+}
@@ -0,0 +1,1014 @@
+#include "common.h"
+#include <float.h>
+
+enum
+{
+    BC1_PALETTE_SIZE = 4,
+    BC7_MODE6_PALETTE_SIZE = 16,
+    BC7_MODE6_INDEX_BITS = 4,
+    BC7_MODE_COUNT = 8,
+    BC7_PARTITION_COUNT = 64,
+    BC7_MAX_SUBSET_COUNT = 3,
+    PCA_ITERATION_COUNT = 8
+};
+
+// The interpolation weights of 2, 3 and 4-bit BC7 indices, in 64ths
+static const uint32_t s_bc7Weights2[4] = { 0, 21, 43, 64 };
+static const uint32_t s_bc7Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+static const uint32_t s_bc7Weights4[BC7_MODE6_PALETTE_SIZE] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+static bool DecodeBC1Block(const uint8_t* block, uint8_t dstRGBA[TEXTURE_BLOCK_TEXEL_COUNT * 4]);
+static bool DecodeBC3Block(const uint8_t* block, uint8_t dstRGBA[TEXTURE_BLOCK_TEXEL_COUNT * 4]);
+static bool DecodeBC7Block(const uint8_t* block, uint8_t dstRGBA[TEXTURE_BLOCK_TEXEL_COUNT * 4]);
+static bool DecodeETC2RGBBlock(const uint8_t* block, uint8_t dstRGBA[TEXTURE_BLOCK_TEXEL_COUNT * 4]);
+static bool DecodeETC2RGBA1Block(const uint8_t* block, uint8_t dstRGBA[TEXTURE_BLOCK_TEXEL_COUNT * 4]);
+static bool DecodeETC2RGBABlock(const uint8_t* block, uint8_t dstRGBA[TEXTURE_BLOCK_TEXEL_COUNT * 4]);
+
+static const TextureFormatInfo s_textureFormatInfos[] = {
+    { VK_FORMAT_R8G8B8A8_UNORM, "R8G8B8A8_UNORM", 1, 1, 4, VK_FORMAT_UNDEFINED, NULL },
+    { VK_FORMAT_R8G8B8A8_SRGB, "R8G8B8A8_SRGB", 1, 1, 4, VK_FORMAT_UNDEFINED, NULL },
+    { VK_FORMAT_B8G8R8A8_UNORM, "B8G8R8A8_UNORM", 1, 1, 4, VK_FORMAT_UNDEFINED, NULL },
+    { VK_FORMAT_B8G8R8A8_SRGB, "B8G8R8A8_SRGB", 1, 1, 4, VK_FORMAT_UNDEFINED, NULL },
+    { VK_FORMAT_BC1_RGB_UNORM_BLOCK, "BC1_RGB_UNORM", 4, 4, 8, VK_FORMAT_R8G8B8A8_UNORM, DecodeBC1Block },
+    { VK_FORMAT_BC1_RGB_SRGB_BLOCK, "BC1_RGB_SRGB", 4, 4, 8, VK_FORMAT_R8G8B8A8_SRGB, DecodeBC1Block },
+    { VK_FORMAT_BC1_RGBA_UNORM_BLOCK, "BC1_RGBA_UNORM", 4, 4, 8, VK_FORMAT_R8G8B8A8_UNORM, DecodeBC1Block },
+    { VK_FORMAT_BC1_RGBA_SRGB_BLOCK, "BC1_RGBA_SRGB", 4, 4, 8, VK_FORMAT_R8G8B8A8_SRGB, DecodeBC1Block },
+    { VK_FORMAT_BC3_UNORM_BLOCK, "BC3_UNORM", 4, 4, 16, VK_FORMAT_R8G8B8A8_UNORM, DecodeBC3Block },
+    { VK_FORMAT_BC3_SRGB_BLOCK, "BC3_SRGB", 4, 4, 16, VK_FORMAT_R8G8B8A8_SRGB, DecodeBC3Block },
+    { VK_FORMAT_BC7_UNORM_BLOCK, "BC7_UNORM", 4, 4, 16, VK_FORMAT_R8G8B8A8_UNORM, DecodeBC7Block },
+    { VK_FORMAT_BC7_SRGB_BLOCK, "BC7_SRGB", 4, 4, 16, VK_FORMAT_R8G8B8A8_SRGB, DecodeBC7Block },
+    // Mostly sampled as they are by mobile GPUs, and decompressed on the CPU elsewhere
+    { VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK, "ETC2_R8G8B8_UNORM", 4, 4, 8, VK_FORMAT_R8G8B8A8_UNORM, DecodeETC2RGBBlock },
+    { VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK, "ETC2_R8G8B8_SRGB", 4, 4, 8, VK_FORMAT_R8G8B8A8_SRGB, DecodeETC2RGBBlock },
+    { VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK, "ETC2_R8G8B8A1_UNORM", 4, 4, 8, VK_FORMAT_R8G8B8A8_UNORM, DecodeETC2RGBA1Block },
+    { VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK, "ETC2_R8G8B8A1_SRGB", 4, 4, 8, VK_FORMAT_R8G8B8A8_SRGB, DecodeETC2RGBA1Block },
+    { VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK, "ETC2_R8G8B8A8_UNORM", 4, 4, 16, VK_FORMAT_R8G8B8A8_UNORM, DecodeETC2RGBABlock },
+    { VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK, "ETC2_R8G8B8A8_SRGB", 4, 4, 16, VK_FORMAT_R8G8B8A8_SRGB, DecodeETC2RGBABlock }
+};
+
+const TextureFormatInfo* GetTextureFormatInfo(VkFormat format)
+{
+    for (size_t i = 0; i < sizeof(s_textureFormatInfos) / sizeof(s_textureFormatInfos[0]); ++i)
+    {
+        if (s_textureFormatInfos[i].format == format) {
+            return &s_textureFormatInfos[i];
+        }
+    }
+    return NULL;
+}
+
+VkDeviceSize GetTextureLevelSize(const TextureFormatInfo* formatInfo, uint32_t width, uint32_t height, uint32_t level)
+{
+    const uint32_t levelWidth = max(width >> level, 1U);
+    const uint32_t levelHeight = max(height >> level, 1U);
+    const uint32_t blockCountX = (levelWidth + formatInfo->blockWidth - 1U) / formatInfo->blockWidth;
+    const uint32_t blockCountY = (levelHeight + formatInfo->blockHeight - 1U) / formatInfo->blockHeight;
+    return (VkDeviceSize)blockCountX * blockCountY * formatInfo->blockSize;
+}
+
+// Finds the principal axis of the `channelCount` channels of the texels with a few power iterations.
+// Returns false when the texels are all the same.
+static bool ComputePrincipalAxis(const uint8_t texels[TEXTURE_BLOCK_TEXEL_COUNT * 4], uint32_t channelCount, float outMean[4], float outAxis[4])
+{
+    float covariance[4][4] = { { 0.0f } };
+    float minValues[4] = { 255.0f, 255.0f, 255.0f, 255.0f };
+    float maxValues[4] = { 0.0f };
+    for (uint32_t c = 0; c < 4; ++c) {
+        outMean[c] = 0.0f;
+    }
+    for (uint32_t i = 0; i < TEXTURE_BLOCK_TEXEL_COUNT; ++i)
+    {
+        for (uint32_t c = 0; c < channelCount; ++c)
+        {
+            const float value = texels[i * 4U + c];
+            outMean[c] += value;
+            minValues[c] = fminf(minValues[c], value);
+            maxValues[c] = fmaxf(maxValues[c], value);
+        }
+    }
+    for (uint32_t c = 0; c < channelCount; ++c) {
+        outMean[c] /= (float)TEXTURE_BLOCK_TEXEL_COUNT;
+    }
+    for (uint32_t i = 0; i < TEXTURE_BLOCK_TEXEL_COUNT; ++i)
+    {
+        for (uint32_t r = 0; r < channelCount; ++r)
+        {
+            for (uint32_t c = 0; c < channelCount; ++c) {
+                covariance[r][c] += ((float)texels[i * 4U + r] - outMean[r]) * ((float)texels[i * 4U + c] - outMean[c]);
+            }
+        }
+    }
+
+    // Starting from the extent of the bounding box converges quickly for the typical, mostly monotonic blocks
+    float axis[4] = { 0.0f };
+    float extent = 0.0f;
+    for (uint32_t c = 0; c < channelCount; ++c)
+    {
+        axis[c] = maxValues[c] - minValues[c];
+        extent += axis[c];
+    }
+    if (extent == 0.0f) return false;
+
+    for (int iteration = 0; iteration < PCA_ITERATION_COUNT; ++iteration)
+    {
+        float next[4] = { 0.0f };
+        float length = 0.0f;
+        for (uint32_t r = 0; r < channelCount; ++r)
+        {
+            for (uint32_t c = 0; c < channelCount; ++c) {
+                next[r] += covariance[r][c] * axis[c];
+            }
+            length = fmaxf(length, fabsf(next[r]));
+        }
+        if (length == 0.0f) break;
+
+        for (uint32_t c = 0; c < channelCount; ++c) {
+            axis[c] = next[c] / length;
+        }
+    }
+    for (uint32_t c = 0; c < 4; ++c) {
+        outAxis[c] = c < channelCount ? axis[c] : 0.0f;
+    }
+    return true;
+}
+
+// Fits the endpoints of the line through the texels along their principal axis
+static void FitEndpoints(const uint8_t texels[TEXTURE_BLOCK_TEXEL_COUNT * 4], uint32_t channelCount, float outLow[4], float outHigh[4])
+{
+    float mean[4];
+    float axis[4];
+    if (!ComputePrincipalAxis(texels, channelCount, mean, axis))
+    {
+        for (uint32_t c = 0; c < 4; ++c) {
+            outLow[c] = outHigh[c] = c < channelCount ? (float)texels[c] : 255.0f;
+        }
+        return;
+    }
+
+    float axisLengthSquared = 0.0f;
+    for (uint32_t c = 0; c < channelCount; ++c) {
+        axisLengthSquared += axis[c] * axis[c];
+    }
+    float minT = 0.0f;
+    float maxT = 0.0f;
+    for (uint32_t i = 0; i < TEXTURE_BLOCK_TEXEL_COUNT; ++i)
+    {
+        float t = 0.0f;
+        for (uint32_t c = 0; c < channelCount; ++c) {
+            t += ((float)texels[i * 4U + c] - mean[c]) * axis[c];
+        }
+        t /= axisLengthSquared;
+        minT = fminf(minT, t);
+        maxT = fmaxf(maxT, t);
+    }
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+        outLow[c] = c < channelCount ? fminf(fmaxf(mean[c] + minT * axis[c], 0.0f), 255.0f) : 255.0f;
+        outHigh[c] = c < channelCount ? fminf(fmaxf(mean[c] + maxT * axis[c], 0.0f), 255.0f) : 255.0f;
+    }
+}
+
+// Picks the palette entry closest to each texel, the palette being stored channel by channel with `paletteSize` a multiple of 4.
+// Returns the summed squared error.
+static uint32_t SelectPaletteIndices(const uint8_t texels[TEXTURE_BLOCK_TEXEL_COUNT * 4], const float palette[4][BC7_MODE6_PALETTE_SIZE], uint32_t paletteSize,
+                                    uint32_t channelCount, uint8_t outIndices[TEXTURE_BLOCK_TEXEL_COUNT])
+{
+    float totalError = 0.0f;
+    for (uint32_t i = 0; i < TEXTURE_BLOCK_TEXEL_COUNT; ++i)
+    {
+        float bestError = FLT_MAX;
+        uint32_t bestIndex = 0;
+#if USE_SSE_VECTOR_MATH
+        // Four palette entries at a time
+        const __m128 r = _mm_set1_ps((float)texels[i * 4U]);
+        const __m128 g = _mm_set1_ps((float)texels[i * 4U + 1U]);
+        const __m128 b = _mm_set1_ps((float)texels[i * 4U + 2U]);
+        const __m128 a = _mm_set1_ps(channelCount == 4U ? (float)texels[i * 4U + 3U] : 0.0f);
+        for (uint32_t p = 0; p < paletteSize; p += 4)
+        {
+            const __m128 dr = _mm_sub_ps(_mm_loadu_ps(&palette[0][p]), r);
+            const __m128 dg = _mm_sub_ps(_mm_loadu_ps(&palette[1][p]), g);
+            const __m128 db = _mm_sub_ps(_mm_loadu_ps(&palette[2][p]), b);
+            const __m128 da = channelCount == 4U ? _mm_sub_ps(_mm_loadu_ps(&palette[3][p]), a) : _mm_setzero_ps();
+            const __m128 errors = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_add_ps(_mm_mul_ps(db, db), _mm_mul_ps(da, da)));
+
+            float laneErrors[4];
+            _mm_storeu_ps(laneErrors, errors);
+            for (uint32_t lane = 0; lane < 4; ++lane)
+            {
+                if (laneErrors[lane] < bestError)
+                {
+                    bestError = laneErrors[lane];
+                    bestIndex = p + lane;
+                }
+            }
+        }
+#else
+        for (uint32_t p = 0; p < paletteSize; ++p)
+        {
+            float error = 0.0f;
+            for (uint32_t c = 0; c < channelCount; ++c)
+            {
+                const float d = palette[c][p] - (float)texels[i * 4U + c];
+                error += d * d;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                bestIndex = p;
+            }
+        }
+#endif // USE_SSE_VECTOR_MATH
+        outIndices[i] = (uint8_t)bestIndex;
+        totalError += bestError;
+    }
+    return (uint32_t)totalError;
+}
+
+// Solves the least squares endpoints of the texels for their indices, with `weights[index]` the share of the high endpoint
+static bool RefineEndpoints(const uint8_t texels[TEXTURE_BLOCK_TEXEL_COUNT * 4], const uint8_t indices[TEXTURE_BLOCK_TEXEL_COUNT], const float* weights,
+                            uint32_t channelCount, float outLow[4], float outHigh[4])
+{
+    float aa = 0.0f;
+    float ab = 0.0f;
+    float bb = 0.0f;
+    float ax[4] = { 0.0f };
+    float bx[4] = { 0.0f };
+    for (uint32_t i = 0; i < TEXTURE_BLOCK_TEXEL_COUNT; ++i)
+    {
+        const float beta = weights[indices[i]];
+        const float alpha = 1.0f - beta;
+        aa += alpha * alpha;
+        ab += alpha * beta;
+        bb += beta * beta;
+        for (uint32_t c = 0; c < channelCount; ++c)
+        {
+            ax[c] += alpha * (float)texels[i * 4U + c];
+            bx[c] += beta * (float)texels[i * 4U + c];
+        }
+    }
+
+    const float determinant = aa * bb - ab * ab;
+    if (fabsf(determinant) < 1e-6f) return false;
+
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+        outLow[c] = c < channelCount ? fminf(fmaxf((ax[c] * bb - bx[c] * ab) / determinant, 0.0f), 255.0f) : 255.0f;
+        outHigh[c] = c < channelCount ? fminf(fmaxf((bx[c] * aa - ax[c] * ab) / determinant, 0.0f), 255.0f) : 255.0f;
+    }
+    return true;
+}
+
+static inline uint32_t PackRGB565(const float color[4])
+{
+    const uint32_t r = (uint32_t)fminf(color[0] * (31.0f / 255.0f) + 0.5f, 31.0f);
+    const uint32_t g = (uint32_t)fminf(color[1] * (63.0f / 255.0f) + 0.5f, 63.0f);
+    const uint32_t b = (uint32_t)fminf(color[2] * (31.0f / 255.0f) + 0.5f, 31.0f);
+    return (r << 11) | (g << 5) | b;
+}
+
+static inline void UnpackRGB565(uint32_t packed, uint32_t dstRGB[3])
+{
+    const uint32_t r = (packed >> 11) & 31U;
+    const uint32_t g = (packed >> 5) & 63U;
+    const uint32_t b = packed & 31U;
+    dstRGB[0] = (r << 3) | (r >> 2);
+    dstRGB[1] = (g << 2) | (g >> 4);
+    dstRGB[2] = (b << 3) | (b >> 2);
+}
+
+// The colors of the four color mode of BC1, in the order of the indices
+static void BuildBC1Palette(uint32_t color0, uint32_t color1, float outPalette[4][BC7_MODE6_PALETTE_SIZE])
+{
+    uint32_t rgb0[3];
+    uint32_t rgb1[3];
+    UnpackRGB565(color0, rgb0);
+    UnpackRGB565(color1, rgb1);
+    for (uint32_t c = 0; c < 3; ++c)
+    {
+        outPalette[c][0] = (float)rgb0[c];
+        outPalette[c][1] = (float)rgb1[c];
+        outPalette[c][2] = (float)((2U * rgb0[c] + rgb1[c]) / 3U);
+        outPalette[c][3] = (float)((rgb0[c] + 2U * rgb1[c]) / 3U);
+    }
+}
+
+static uint32_t EncodeBC1Endpoints(const uint8_t texels[TEXTURE_BLOCK_TEXEL_COUNT * 4], const float low[4], const float high[4], uint8_t dst[8])
+{
+    uint32_t color0 = PackRGB565(high);
+    uint32_t color1 = PackRGB565(low);
+    // The four color mode needs color0 > color1
+    if (color0 < color1)
+    {
+        const uint32_t swapped = color0;
+        color0 = color1;
+        color1 = swapped;
+    }
+
+    uint8_t indices[TEXTURE_BLOCK_TEXEL_COUNT] = { 0 };
+    uint32_t error = 0;
+    if (color0 != color1)
+    {
+        float palette[4][BC7_MODE6_PALETTE_SIZE];
+        BuildBC1Palette(color0, color1, palette);
+        error = SelectPaletteIndices(texels, palette, BC1_PALETTE_SIZE, 3U, indices);
+    }
+    else
+    {
+        // A single color in the three color mode, where index 0 still is color0
+        uint32_t rgb[3];
+        UnpackRGB565(color0, rgb);
+        for (uint32_t i = 0; i < TEXTURE_BLOCK_TEXEL_COUNT; ++i)
+        {
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                const int32_t d = (int32_t)rgb[c] - (int32_t)texels[i * 4U + c];
+                error += (uint32_t)(d * d);
+            }
+        }
+    }
+
+    uint32_t indexBits = 0;
+    for (uint32_t i = 0; i < TEXTURE_BLOCK_TEXEL_COUNT; ++i) {
+        indexBits |= (uint32_t)indices[i] << (2U * i);
+    }
+    const uint8_t block[8] = {
+        (uint8_t)color0, (uint8_t)(color0 >> 8), (uint8_t)color1, (uint8_t)(color1 >> 8),
+        (uint8_t)indexBits, (uint8_t)(indexBits >> 8), (uint8_t)(indexBits >> 16), (uint8_t)(indexBits >> 24)
+    };
+    memcpy(dst, block, sizeof(block));
+
+    return error;
+}
+
+void EncodeBC1Block(const uint8_t srcRGBA[TEXTURE_BLOCK_TEXEL_COUNT * 4], uint8_t dst[8])
+{
+    float low[4];
+    float high[4];
+    FitEndpoints(srcRGBA, 3U, low, high);
+    const uint32_t error = EncodeBC1Endpoints(srcRGBA, low, high, dst);
+
+    // One least squares pass over the indices of the first fit, kept if it does better
+    static const float weights[BC1_PALETTE_SIZE] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+    uint8_t indices[TEXTURE_BLOCK_TEXEL_COUNT];
+    const uint32_t indexBits = (uint32_t)dst[4] | ((uint32_t)dst[5] << 8) | ((uint32_t)dst[6] << 16) | ((uint32_t)dst[7] << 24);
+    for (uint32_t i = 0; i < TEXTURE_BLOCK_TEXEL_COUNT; ++i) {
+        indices[i] = (uint8_t)((indexBits >> (2U * i)) & 3U);
+    }
+    // `weights` are the share of color0, which RefineEndpoints calls the high endpoint
+    if (RefineEndpoints(srcRGBA, indices, weights, 3U, low, high))
+    {
+        uint8_t refined[8];
+        if (EncodeBC1Endpoints(srcRGBA, low, high, refined) < error) {
+            memcpy(dst, refined, sizeof(refined));
+        }
+    }
+}
+
+static bool DecodeBC1Block(const uint8_t* block, uint8_t dstRGBA[TEXTURE_BLOCK_TEXEL_COUNT * 4])
+{
+    const uint32_t color0 = (uint32_t)block[0] | ((uint32_t)block[1] << 8);
+    const uint32_t color1 = (uint32_t)block[2] | ((uint32_t)block[3] << 8);
+    uint32_t rgb0[3];
+    uint32_t rgb1[3];
+    UnpackRGB565(color0, rgb0);
+    UnpackRGB565(color1, rgb1);
+
+    uint8_t palette[4][4];
+    for (uint32_t c = 0; c < 3; ++c)
+    {
+        palette[0][c] = (uint8_t)rgb0[c];
+        palette[1][c] = (uint8_t)rgb1[c];
+        palette[2][c] = (uint8_t)(color0 > color1 ? (2U * rgb0[c] + rgb1[c]) / 3U : (rgb0[c] + rgb1[c]) / 2U);
+        palette[3][c] = (uint8_t)(color0 > color1 ? (rgb0[c] + 2U * rgb1[c]) / 3U : 0U);
+    }
+    palette[0][3] = palette[1][3] = palette[2][3] = 255U;
+    // The three color mode has transparent black as its fourth color
+    palette[3][3] = color0 > color1 ? 255U : 0U;
+
+    const uint32_t indexBits = (uint32_t)block[4] | ((uint32_t)block[5] << 8) | ((uint32_t)block[6] << 16) | ((uint32_t)block[7] << 24);
+    for (uint32_t i = 0; i < TEXTURE_BLOCK_TEXEL_COUNT; ++i) {
+        memcpy(&dstRGBA[i * 4U], palette[(indexBits >> (2U * i)) & 3U], 4);
+    }
+    return true;
+}
+
+static bool DecodeBC3Block(const uint8_t* block, uint8_t dstRGBA[TEXTURE_BLOCK_TEXEL_COUNT * 4])
+{
+    // The color half is BC1 that is always in the four color mode
+    uint8_t colorBlock[8];
+    memcpy(colorBlock, &block[8], sizeof(colorBlock));
+    const uint32_t color0 = (uint32_t)colorBlock[0] | ((uint32_t)colorBlock[1] << 8);
+    const uint32_t color1 = (uint32_t)colorBlock[2] | ((uint32_t)colorBlock[3] << 8);
+    uint32_t rgb0[3];
+    uint32_t rgb1[3];
+    UnpackRGB565(color0, rgb0);
+    UnpackRGB565(color1, rgb1);
+    uint8_t colors[4][3];
+    for (uint32_t c = 0; c < 3; ++c)
+    {
+        colors[0][c] = (uint8_t)rgb0[c];
+        colors[1][c] = (uint8_t)rgb1[c];
+        colors[2][c] = (uint8_t)((2U * rgb0[c] + rgb1[c]) / 3U);
+        colors[3][c] = (uint8_t)((rgb0[c] + 2U * rgb1[c]) / 3U);
+    }
+
+    const uint32_t alpha0 = block[0];
+    const uint32_t alpha1 = block[1];
+    uint8_t alphas[8] = { (uint8_t)alpha0, (uint8_t)alpha1 };
+    for (uint32_t i = 2; i < 8; ++i)
+    {
+        if (alpha0 > alpha1) {
+            alphas[i] = (uint8_t)(((8U - i) * alpha0 + (i - 1U) * alpha1) / 7U);
+        }
+        else {
+            alphas[i] = i < 6 ? (uint8_t)(((6U - i) * alpha0 + (i - 1U) * alpha1) / 5U) : (i == 6 ? 0U : 255U);
+        }
+    }
+
+    uint64_t alphaBits = 0;
+    for (uint32_t i = 0; i < 6; ++i) {
+        alphaBits |= (uint64_t)block[2U + i] << (8U * i);
+    }
+    const uint32_t colorBits = (uint32_t)colorBlock[4] | ((uint32_t)colorBlock[5] << 8) | ((uint32_t)colorBlock[6] << 16) | ((uint32_t)colorBlock[7] << 24);
+    for (uint32_t i = 0; i < TEXTURE_BLOCK_TEXEL_COUNT; ++i)
+    {
+        memcpy(&dstRGBA[i * 4U], colors[(colorBits >> (2U * i)) & 3U], 3);
+        dstRGBA[i * 4U + 3U] = alphas[(alphaBits >> (3U * i)) & 7U];
+    }
+    return true;
+}
+
+static void WriteBlockBits(uint8_t* block, uint32_t* pBitOffset, uint32_t value, uint32_t bitCount)
+{
+    for (uint32_t i = 0; i < bitCount; ++i, ++*pBitOffset)
+    {
+        if ((value >> i) & 1U) {
+            block[*pBitOffset >> 3] |= (uint8_t)(1U << (*pBitOffset & 7U));
+        }
+    }
+}
+
+static uint32_t ReadBlockBits(const uint8_t* block, uint32_t* pBitOffset, uint32_t bitCount)
+{
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < bitCount; ++i, ++*pBitOffset) {
+        value |= (uint32_t)((block[*pBitOffset >> 3] >> (*pBitOffset & 7U)) & 1U) << i;
+    }
+    return value;
+}
+
+// The endpoints of mode 6 are 7 bits per channel plus a p-bit shared by the channels of each endpoint
+typedef struct BC7Mode6Endpoints
+{
+    uint32_t values[2][4];      // 7 bits
+    uint32_t pBits[2];
+} BC7Mode6Endpoints;
+
+static void BuildBC7Mode6Palette(const BC7Mode6Endpoints* endpoints, float outPalette[4][BC7_MODE6_PALETTE_SIZE])
+{
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+        const uint32_t low = (endpoints->values[0][c] << 1) | endpoints->pBits[0];
+        const uint32_t high = (endpoints->values[1][c] << 1) | endpoints->pBits[1];
+        for (uint32_t p = 0; p < BC7_MODE6_PALETTE_SIZE; ++p) {
+            outPalette[c][p] = (float)(((64U - s_bc7Weights4[p]) * low + s_bc7Weights4[p] * high + 32U) >> 6);
+        }
+    }
+}
+
+// Tries the four p-bit combinations for the endpoints, keeping the best one in `pBest` when it beats `bestError`
+static uint32_t SearchBC7Mode6Endpoints(const uint8_t texels[TEXTURE_BLOCK_TEXEL_COUNT * 4], const float low[4], const float high[4], uint32_t bestError,
+                                        BC7Mode6Endpoints* pBest, uint8_t bestIndices[TEXTURE_BLOCK_TEXEL_COUNT])
+{
+    for (uint32_t pBitCombination = 0; pBitCombination < 4; ++pBitCombination)
+    {
+        BC7Mode6Endpoints endpoints = { .pBits = { pBitCombination & 1U, pBitCombination >> 1 } };
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            endpoints.values[0][c] = (uint32_t)fminf(fmaxf((low[c] - (float)endpoints.pBits[0]) * 0.5f + 0.5f, 0.0f), 127.0f);
+            endpoints.values[1][c] = (uint32_t)fminf(fmaxf((high[c] - (float)endpoints.pBits[1]) * 0.5f + 0.5f, 0.0f), 127.0f);
+        }
+
+        float palette[4][BC7_MODE6_PALETTE_SIZE];
+        BuildBC7Mode6Palette(&endpoints, palette);
+        uint8_t indices[TEXTURE_BLOCK_TEXEL_COUNT];
+        const uint32_t error = SelectPaletteIndices(texels, palette, BC7_MODE6_PALETTE_SIZE, 4U, indices);
+        if (error < bestError)
+        {
+            bestError = error;
+            *pBest = endpoints;
+            memcpy(bestIndices, indices, TEXTURE_BLOCK_TEXEL_COUNT);
+        }
+    }
+    return bestError;
+}
+
+// Only mode 6 is encoded, a single subset of RGBA endpoints with 4-bit indices, which suits smooth photographic content best of the modes.
+void EncodeBC7Block(const uint8_t srcRGBA[TEXTURE_BLOCK_TEXEL_COUNT * 4], uint8_t dst[16])
+{
+    float low[4];
+    float high[4];
+    FitEndpoints(srcRGBA, 4U, low, high);
+
+    BC7Mode6Endpoints endpoints = { 0 };
+    uint8_t indices[TEXTURE_BLOCK_TEXEL_COUNT] = { 0 };
+    uint32_t error = SearchBC7Mode6Endpoints(srcRGBA, low, high, UINT32_MAX, &endpoints, indices);
+
+    float weights[BC7_MODE6_PALETTE_SIZE];
+    for (uint32_t p = 0; p < BC7_MODE6_PALETTE_SIZE; ++p) {
+        weights[p] = (float)s_bc7Weights4[p] / 64.0f;
+    }
+    if (error > 0 && RefineEndpoints(srcRGBA, indices, weights, 4U, low, high)) {
+        error = SearchBC7Mode6Endpoints(srcRGBA, low, high, error, &endpoints, indices);
+    }
+
+    // The most significant index bit of the first texel is implied to be 0, which swapping the endpoints guarantees
+    if (indices[0] >= BC7_MODE6_PALETTE_SIZE / 2)
+    {
+        const BC7Mode6Endpoints swapped = endpoints;
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            endpoints.values[0][c] = swapped.values[1][c];
+            endpoints.values[1][c] = swapped.values[0][c];
+        }
+        endpoints.pBits[0] = swapped.pBits[1];
+        endpoints.pBits[1] = swapped.pBits[0];
+        for (uint32_t i = 0; i < TEXTURE_BLOCK_TEXEL_COUNT; ++i) {
+            indices[i] = (uint8_t)(BC7_MODE6_PALETTE_SIZE - 1U - indices[i]);
+        }
+    }
+
+    memset(dst, 0, 16);
+    uint32_t bitOffset = 0;
+    WriteBlockBits(dst, &bitOffset, 1U << 6, 7);
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+        WriteBlockBits(dst, &bitOffset, endpoints.values[0][c], 7);
+        WriteBlockBits(dst, &bitOffset, endpoints.values[1][c], 7);
+    }
+    WriteBlockBits(dst, &bitOffset, endpoints.pBits[0], 1);
+    WriteBlockBits(dst, &bitOffset, endpoints.pBits[1], 1);
+    for (uint32_t i = 0; i < TEXTURE_BLOCK_TEXEL_COUNT; ++i) {
+        WriteBlockBits(dst, &bitOffset, indices[i], i == 0 ? BC7_MODE6_INDEX_BITS - 1U : BC7_MODE6_INDEX_BITS);
+    }
+}
+
+// How the 128 bits of a block are split in each BC7 mode
+typedef struct BC7ModeInfo
+{
+    uint32_t subsetCount;
+    uint32_t partitionBits;
+    uint32_t rotationBits;
+    uint32_t indexSelectionBits;
+    uint32_t colorBits;
+    uint32_t alphaBits;             // 0 for the modes without alpha, which decode to opaque texels
+    uint32_t endpointPBits;         // one p-bit per endpoint
+    uint32_t sharedPBits;           // one p-bit shared by both endpoints of a subset
+    uint32_t indexBits;
+    uint32_t secondaryIndexBits;    // the separate alpha or color indices of modes 4 and 5
+} BC7ModeInfo;
+
+static const BC7ModeInfo s_bc7Modes[BC7_MODE_COUNT] = {
+    { 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+    { 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+    { 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+    { 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+    { 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+    { 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+    { 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+    { 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 }
+};
+
+// The subset of every texel of the 2 subset partitions, one bit per texel in row order
+static const uint16_t s_bc7Partitions2[BC7_PARTITION_COUNT] = {
+    0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80, 0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+    0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce, 0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c,
+    0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a, 0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660,
+    0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6, 0x639c, 0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22
+};
+
+// The subset of every texel of the 3 subset partitions, two bits per texel in row order
+static const uint32_t s_bc7Partitions3[BC7_PARTITION_COUNT] = {
+    0xaa685050, 0x6a5a5040, 0x5a5a4200, 0x5450a0a8, 0xa5a50000, 0xa0a05050, 0x5555a0a0, 0x5a5a5050,
+    0xaa550000, 0xaa555500, 0xaaaa5500, 0x90909090, 0x94949494, 0xa4a4a4a4, 0xa9a59450, 0x2a0a4250,
+    0xa5945040, 0x0a425054, 0xa5a5a500, 0x55a0a0a0, 0xa8a85454, 0x6a6a4040, 0xa4a45000, 0x1a1a0500,
+    0x0050a4a4, 0xaaa59090, 0x14696914, 0x69691400, 0xa08585a0, 0xaa821414, 0x50a4a450, 0x6a5a0200,
+    0xa9a58000, 0x5090a0a8, 0xa8a09050, 0x24242424, 0x00aa5500, 0x24924924, 0x24499224, 0x50a50a50,
+    0x500aa550, 0xaaaa4444, 0x66660000, 0xa5a0a5a0, 0x50a050a0, 0x69286928, 0x44aaaa44, 0x66666600,
+    0xaa444444, 0x54a854a8, 0x95809580, 0x96969600, 0xa85454a8, 0x80959580, 0xaa141414, 0x96960000,
+    0xaaaa1414, 0xa05050a0, 0xa0a5a5a0, 0x96000000, 0x40804080, 0xa9a8a9a8, 0xaaaaaa44, 0x2a4a5254
+};
+
+// The texels whose index drops its most significant bit, besides texel 0 of subset 0: the anchor of subset 1 in the 2 subset partitions,
+// and of subsets 1 and 2 in the 3 subset ones
+static const uint8_t s_bc7Anchors2[BC7_PARTITION_COUNT] = {
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+    15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+     6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15
+};
+static const uint8_t s_bc7Anchors3[2][BC7_PARTITION_COUNT] = {
+    {
+         3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,
+         3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,  8,  5, 15, 15,
+         8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,
+         3, 15,  5,  5,  5,  8,  5, 10,  5, 10,  8, 13, 15, 12,  3,  3
+    },
+    {
+        15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8,
+        15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10, 15, 15, 10,  8,
+        15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8,
+        15,  3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  3, 15, 15,  8
+    }
+};
+
+static uint32_t GetBC7Subset(uint32_t subsetCount, uint32_t partition, uint32_t texel)
+{
+    switch (subsetCount)
+    {
+    case 2:
+        return (s_bc7Partitions2[partition] >> texel) & 1U;
+    case 3:
+        return (s_bc7Partitions3[partition] >> (2U * texel)) & 3U;
+    default:
+        return 0;
+    }
+}
+
+static bool IsBC7AnchorTexel(uint32_t subsetCount, uint32_t partition, uint32_t texel)
+{
+    switch (subsetCount)
+    {
+    case 2:
+        return texel == 0 || texel == s_bc7Anchors2[partition];
+    case 3:
+        return texel == 0 || texel == s_bc7Anchors3[0][partition] || texel == s_bc7Anchors3[1][partition];
+    default:
+        return texel == 0;
+    }
+}
+
+static const uint32_t* GetBC7Weights(uint32_t indexBits)
+{
+    return indexBits == 2U ? s_bc7Weights2 : (indexBits == 3U ? s_bc7Weights3 : s_bc7Weights4);
+}
+
+static bool DecodeBC7Block(const uint8_t* block, uint8_t dstRGBA[TEXTURE_BLOCK_TEXEL_COUNT * 4])
+{
+    // The mode is the number of 0 bits before the first 1
+    uint32_t mode = 0;
+    while (mode < BC7_MODE_COUNT && ((block[0] >> mode) & 1U) == 0) {
+        ++mode;
+    }
+    if (mode == BC7_MODE_COUNT)
+    {
+        // The reserved mode decodes to transparent black
+        memset(dstRGBA, 0, TEXTURE_BLOCK_TEXEL_COUNT * 4);
+        return true;
+    }
+
+    const BC7ModeInfo* modeInfo = &s_bc7Modes[mode];
+    uint32_t bitOffset = mode + 1U;
+    const uint32_t partition = ReadBlockBits(block, &bitOffset, modeInfo->partitionBits);
+    const uint32_t rotation = ReadBlockBits(block, &bitOffset, modeInfo->rotationBits);
+    const uint32_t indexSelection = ReadBlockBits(block, &bitOffset, modeInfo->indexSelectionBits);
+
+    // Each channel of all the endpoints comes before the next channel, and the p-bits after all of them
+    const uint32_t endpointCount = modeInfo->subsetCount * 2U;
+    uint32_t endpoints[BC7_MAX_SUBSET_COUNT * 2][4];
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+        for (uint32_t e = 0; e < endpointCount; ++e) {
+            endpoints[e][c] = ReadBlockBits(block, &bitOffset, c < 3 ? modeInfo->colorBits : modeInfo->alphaBits);
+        }
+    }
+    uint32_t pBits[BC7_MAX_SUBSET_COUNT * 2] = { 0 };
+    for (uint32_t e = 0; e < endpointCount && modeInfo->endpointPBits != 0; ++e) {
+        pBits[e] = ReadBlockBits(block, &bitOffset, 1);
+    }
+    for (uint32_t s = 0; s < modeInfo->subsetCount && modeInfo->sharedPBits != 0; ++s) {
+        pBits[2U * s] = pBits[2U * s + 1U] = ReadBlockBits(block, &bitOffset, 1);
+    }
+
+    // The p-bit is appended below the stored bits, and the high bits are replicated into the missing low ones
+    const uint32_t pBitCount = modeInfo->endpointPBits | modeInfo->sharedPBits;
+    for (uint32_t e = 0; e < endpointCount; ++e)
+    {
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            const uint32_t storedBits = c < 3 ? modeInfo->colorBits : modeInfo->alphaBits;
+            if (storedBits == 0)
+            {
+                endpoints[e][c] = 255U;
+                continue;
+            }
+            const uint32_t bitCount = storedBits + pBitCount;
+            const uint32_t value = ((endpoints[e][c] << pBitCount) | (pBitCount != 0 ? pBits[e] : 0U)) << (8U - bitCount);
+            endpoints[e][c] = value | (value >> bitCount);
+        }
+    }
+
+    uint32_t indices[TEXTURE_BLOCK_TEXEL_COUNT];
+    uint32_t secondaryIndices[TEXTURE_BLOCK_TEXEL_COUNT] = { 0 };
+    for (uint32_t i = 0; i < TEXTURE_BLOCK_TEXEL_COUNT; ++i) {
+        indices[i] = ReadBlockBits(block, &bitOffset, modeInfo->indexBits - (IsBC7AnchorTexel(modeInfo->subsetCount, partition, i) ? 1U : 0U));
+    }
+    for (uint32_t i = 0; i < TEXTURE_BLOCK_TEXEL_COUNT && modeInfo->secondaryIndexBits != 0; ++i) {
+        secondaryIndices[i] = ReadBlockBits(block, &bitOffset, modeInfo->secondaryIndexBits - (i == 0 ? 1U : 0U));
+    }
+
+    const uint32_t* weights = GetBC7Weights(modeInfo->indexBits);
+    const uint32_t* secondaryWeights = GetBC7Weights(modeInfo->secondaryIndexBits);
+    for (uint32_t i = 0; i < TEXTURE_BLOCK_TEXEL_COUNT; ++i)
+    {
+        const uint32_t subset = GetBC7Subset(modeInfo->subsetCount, partition, i);
+        uint32_t colorWeight = weights[indices[i]];
+        uint32_t alphaWeight = colorWeight;
+        // The secondary indices interpolate the alpha, unless the index selection bit of mode 4 gives them the color
+        if (modeInfo->secondaryIndexBits != 0)
+        {
+            alphaWeight = secondaryWeights[secondaryIndices[i]];
+            if (indexSelection != 0)
+            {
+                const uint32_t swapped = colorWeight;
+                colorWeight = alphaWeight;
+                alphaWeight = swapped;
+            }
+        }
+
+        uint8_t* texel = &dstRGBA[i * 4U];
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            const uint32_t weight = c < 3 ? colorWeight : alphaWeight;
+            texel[c] = (uint8_t)(((64U - weight) * endpoints[2U * subset][c] + weight * endpoints[2U * subset + 1U][c] + 32U) >> 6);
+        }
+        // Rotations 1 to 3 swap the alpha with the red, green or blue channel
+        if (rotation != 0)
+        {
+            const uint8_t swapped = texel[3];
+            texel[3] = texel[rotation - 1U];
+            texel[rotation - 1U] = swapped;
+        }
+    }
+    return true;
+}
+
+// The intensity modifiers of the individual and differential modes of ETC1 and ETC2, by table codeword and pixel index
+static const int32_t s_etcModifiers[8][4] = {
+    { 2, 8, -2, -8 },
+    { 5, 17, -5, -17 },
+    { 9, 29, -9, -29 },
+    { 13, 42, -13, -42 },
+    { 18, 60, -18, -60 },
+    { 24, 80, -24, -80 },
+    { 33, 106, -33, -106 },
+    { 47, 183, -47, -183 }
+};
+
+// The distances between the paint colors of the T and H modes
+static const int32_t s_etcDistances[8] = { 3, 6, 11, 16, 23, 32, 41, 64 };
+
+// The alpha modifiers of EAC, by table index and texel index, scaled by the multiplier of the block
+static const int32_t s_eacModifiers[16][8] = {
+    { -3, -6, -9, -15, 2, 5, 8, 14 },
+    { -3, -7, -10, -13, 2, 6, 9, 12 },
+    { -2, -5, -8, -13, 1, 4, 7, 12 },
+    { -2, -4, -6, -13, 1, 3, 5, 12 },
+    { -3, -6, -8, -12, 2, 5, 7, 11 },
+    { -3, -7, -9, -11, 2, 6, 8, 10 },
+    { -4, -7, -8, -11, 3, 6, 7, 10 },
+    { -3, -5, -8, -11, 2, 4, 7, 10 },
+    { -2, -6, -8, -10, 1, 5, 7, 9 },
+    { -2, -5, -8, -10, 1, 4, 7, 9 },
+    { -2, -4, -8, -10, 1, 3, 7, 9 },
+    { -2, -5, -7, -10, 1, 4, 6, 9 },
+    { -3, -4, -7, -10, 2, 3, 6, 9 },
+    { -1, -2, -3, -10, 0, 1, 2, 9 },
+    { -4, -6, -8, -9, 3, 5, 7, 8 },
+    { -3, -5, -7, -9, 2, 4, 6, 8 }
+};
+
+// ETC2 and EAC blocks are big endian
+static inline uint64_t ReadBlockU64BE(const uint8_t* block)
+{
+    uint64_t value = 0;
+    for (uint32_t i = 0; i < 8; ++i) {
+        value = (value << 8) | block[i];
+    }
+    return value;
+}
+
+static inline uint8_t ClampToByte(int32_t value)
+{
+    return (uint8_t)(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+// Widens a channel of 4 to 7 bits to 8 bits by replicating its high bits
+static inline int32_t ExtendETCChannel(uint32_t value, uint32_t bitCount)
+{
+    return (int32_t)((value << (8U - bitCount)) | (value >> (2U * bitCount - 8U)));
+}
+
+static inline int32_t SignExtend3(uint32_t value)
+{
+    return (int32_t)(value ^ 4U) - 4;
+}
+
+// The pixel index of the texel at (x, y), whose bits are stored column by column
+static inline uint32_t GetETCPixelIndex(uint32_t pixelBits, uint32_t x, uint32_t y)
+{
+    const uint32_t bit = x * 4U + y;
+    return (((pixelBits >> (bit + 16U)) & 1U) << 1) | ((pixelBits >> bit) & 1U);
+}
+
+// The planar mode stores the colors at the origin, at the horizontal and at the vertical end of the block, and interpolates them
+static void DecodeETC2PlanarBlock(uint32_t high, uint32_t low, uint8_t dstRGBA[TEXTURE_BLOCK_TEXEL_COUNT * 4])
+{
+    const int32_t origin[3] = {
+        ExtendETCChannel((high >> 25) & 63U, 6U),
+        ExtendETCChannel((((high >> 24) & 1U) << 6) | ((high >> 17) & 63U), 7U),
+        ExtendETCChannel((((high >> 16) & 1U) << 5) | (((high >> 11) & 3U) << 3) | ((high >> 7) & 7U), 6U)
+    };
+    const int32_t horizontal[3] = {
+        ExtendETCChannel((((high >> 2) & 31U) << 1) | (high & 1U), 6U),
+        ExtendETCChannel((low >> 25) & 127U, 7U),
+        ExtendETCChannel((low >> 19) & 63U, 6U)
+    };
+    const int32_t vertical[3] = {
+        ExtendETCChannel((low >> 13) & 63U, 6U),
+        ExtendETCChannel((low >> 6) & 127U, 7U),
+        ExtendETCChannel(low & 63U, 6U)
+    };
+    for (uint32_t y = 0; y < 4; ++y)
+    {
+        for (uint32_t x = 0; x < 4; ++x)
+        {
+            uint8_t* texel = &dstRGBA[(y * 4U + x) * 4U];
+            for (uint32_t c = 0; c < 3; ++c) {
+                texel[c] = ClampToByte(((int32_t)x * (horizontal[c] - origin[c]) + (int32_t)y * (vertical[c] - origin[c]) + 4 * origin[c] + 2) / 4);
+            }
+            texel[3] = 255U;
+        }
+    }
+}
+
+// Decodes the ETC2 color of a block. With punch-through alpha, the differential bit tells whether the block is opaque instead,
+// and there is no individual mode.
+static void DecodeETC2ColorBlock(const uint8_t* block, bool hasPunchThroughAlpha, uint8_t dstRGBA[TEXTURE_BLOCK_TEXEL_COUNT * 4])
+{
+    const uint64_t bits = ReadBlockU64BE(block);
+    const uint32_t high = (uint32_t)(bits >> 32);
+    const uint32_t pixelBits = (uint32_t)bits;
+    const bool isDifferential = hasPunchThroughAlpha || ((high >> 1) & 1U) != 0;
+    const bool isOpaque = !hasPunchThroughAlpha || ((high >> 1) & 1U) != 0;
+
+    // The 4 paint colors of the T and H modes, or the 2 base colors of the individual and differential modes
+    int32_t colors[4][3];
+    bool isPaintMode = false;
+    if (!isDifferential)
+    {
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            colors[0][c] = ExtendETCChannel((high >> (28U - 8U * c)) & 15U, 4U);
+            colors[1][c] = ExtendETCChannel((high >> (24U - 8U * c)) & 15U, 4U);
+        }
+    }
+    else
+    {
+        // A base color whose differential color overflows selects the T, H or planar mode instead
+        int32_t bases[3];
+        int32_t sums[3];
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            bases[c] = (int32_t)((high >> (27U - 8U * c)) & 31U);
+            sums[c] = bases[c] + SignExtend3((high >> (24U - 8U * c)) & 7U);
+        }
+
+        if (sums[0] < 0 || sums[0] > 31)
+        {
+            // T mode
+            const int32_t color0[3] = {
+                ExtendETCChannel((((high >> 27) & 3U) << 2) | ((high >> 24) & 3U), 4U),
+                ExtendETCChannel((high >> 20) & 15U, 4U),
+                ExtendETCChannel((high >> 16) & 15U, 4U)
+            };
+            const int32_t color1[3] = {
+                ExtendETCChannel((high >> 12) & 15U, 4U),
+                ExtendETCChannel((high >> 8) & 15U, 4U),
+                ExtendETCChannel((high >> 4) & 15U, 4U)
+            };
+            const int32_t distance = s_etcDistances[(((high >> 2) & 3U) << 1) | (high & 1U)];
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                colors[0][c] = color0[c];
+                colors[1][c] = color1[c] + distance;
+                colors[2][c] = color1[c];
+                colors[3][c] = color1[c] - distance;
+            }
+            isPaintMode = true;
+        }
+        else if (sums[1] < 0 || sums[1] > 31)
+        {
+            // H mode, whose distance takes a third bit from the order of the two colors
+            const uint32_t packed0 = (((high >> 27) & 15U) << 8) | (((((high >> 24) & 7U) << 1) | ((high >> 20) & 1U)) << 4) |
+                                    ((((high >> 19) & 1U) << 3) | ((high >> 15) & 7U));
+            const uint32_t packed1 = (((high >> 11) & 15U) << 8) | (((high >> 7) & 15U) << 4) | ((high >> 3) & 15U);
+            const int32_t distance = s_etcDistances[(((high >> 2) & 1U) << 2) | ((high & 1U) << 1) | (packed0 >= packed1 ? 1U : 0U)];
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                const int32_t color0 = ExtendETCChannel((packed0 >> (8U - 4U * c)) & 15U, 4U);
+                const int32_t color1 = ExtendETCChannel((packed1 >> (8U - 4U * c)) & 15U, 4U);
+                colors[0][c] = color0 + distance;
+                colors[1][c] = color0 - distance;
+                colors[2][c] = color1 + distance;
+                colors[3][c] = color1 - distance;
+            }
+            isPaintMode = true;
+        }
+        else if (sums[2] < 0 || sums[2] > 31)
+        {
+            // The planar mode is opaque even with punch-through alpha
+            DecodeETC2PlanarBlock(high, pixelBits, dstRGBA);
+            return;
+        }
+        else
+        {
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                colors[0][c] = ExtendETCChannel((uint32_t)bases[c], 5U);
+                colors[1][c] = ExtendETCChannel((uint32_t)sums[c], 5U);
+            }
+        }
+    }
+
+    const bool isFlipped = (high & 1U) != 0;
+    for (uint32_t y = 0; y < 4; ++y)
+    {
+        for (uint32_t x = 0; x < 4; ++x)
+        {
+            const uint32_t pixelIndex = GetETCPixelIndex(pixelBits, x, y);
+            uint8_t* texel = &dstRGBA[(y * 4U + x) * 4U];
+            // Pixel index 2 of a non-opaque block is transparent black
+            if (!isOpaque && pixelIndex == 2U)
+            {
+                memset(texel, 0, 4);
+                continue;
+            }
+
+            if (isPaintMode)
+            {
+                for (uint32_t c = 0; c < 3; ++c) {
+                    texel[c] = ClampToByte(colors[pixelIndex][c]);
+                }
+            }
+            else
+            {
+                // The two subblocks are side by side, or one above the other when flipped
+                const uint32_t subblock = isFlipped ? y / 2U : x / 2U;
+                const uint32_t table = (high >> (subblock == 0 ? 5U : 2U)) & 7U;
+                // A non-opaque block has no modifier for pixel index 0
+                const int32_t modifier = !isOpaque && pixelIndex == 0 ? 0 : s_etcModifiers[table][pixelIndex];
+                for (uint32_t c = 0; c < 3; ++c) {
+                    texel[c] = ClampToByte(colors[subblock][c] + modifier);
+                }
+            }
+            texel[3] = 255U;
+        }
+    }
+}
+
+static void DecodeEACAlphaBlock(const uint8_t* block, uint8_t dstRGBA[TEXTURE_BLOCK_TEXEL_COUNT * 4])
+{
+    const uint64_t bits = ReadBlockU64BE(block);
+    const int32_t base = (int32_t)(bits >> 56);
+    const int32_t multiplier = (int32_t)((bits >> 52) & 15U);
+    const int32_t* modifiers = s_eacModifiers[(bits >> 48) & 15U];
+    // The 3-bit texel indices follow column by column from the most significant bits
+    for (uint32_t i = 0; i < TEXTURE_BLOCK_TEXEL_COUNT; ++i)
+    {
+        const uint32_t x = i / 4U;
+        const uint32_t y = i % 4U;
+        dstRGBA[(y * 4U + x) * 4U + 3U] = ClampToByte(base + modifiers[(bits >> (45U - 3U * i)) & 7U] * multiplier);
+    }
+}
+
+static bool DecodeETC2RGBBlock(const uint8_t* block, uint8_t dstRGBA[TEXTURE_BLOCK_TEXEL_COUNT * 4])
+{
+    DecodeETC2ColorBlock(block, false, dstRGBA);
+    return true;
+}
+
+static bool DecodeETC2RGBA1Block(const uint8_t* block, uint8_t dstRGBA[TEXTURE_BLOCK_TEXEL_COUNT * 4])
+{
+    DecodeETC2ColorBlock(block, true, dstRGBA);
+    return true;
+}
+
+// The EAC alpha half comes before the ETC2 color half
+static bool DecodeETC2RGBABlock(const uint8_t* block, uint8_t dstRGBA[TEXTURE_BLOCK_TEXEL_COUNT * 4])
+{
+    DecodeETC2ColorBlock(&block[8], false, dstRGBA);
+    DecodeEACAlphaBlock(block, dstRGBA);
+    return true;
+}
@@ -0,0 +1,424 @@
+#include "common.h"
+
+enum
+{
+    KTX2_HEADER_SIZE = 80,
+    KTX2_LEVEL_INDEX_ENTRY_SIZE = 24,
+    KTX2_DFD_SIZE = 44,                 // the total size field, a basic descriptor block and one sample
+
+    KHR_DF_MODEL_BC1A = 128,
+    KHR_DF_MODEL_BC7 = 134,
+    KHR_DF_PRIMARIES_BT709 = 1,
+    KHR_DF_TRANSFER_LINEAR = 1,
+    KHR_DF_TRANSFER_SRGB = 2,
+
+    // Block rows encoded per job
+    ENCODE_JOB_BLOCK_ROW_COUNT = 4
+};
+
+static const uint8_t s_ktx2Identifier[12] = { 0xab, 'K', 'T', 'X', ' ', '2', '0', 0xbb, '\r', '\n', 0x1a, '\n' };
+
+typedef struct TextureEncodingName
+{
+    const char* name;
+    VkFormat format;
+} TextureEncodingName;
+
+static const TextureEncodingName s_textureEncodingNames[] = {
+    { "bc1", VK_FORMAT_BC1_RGB_UNORM_BLOCK },
+    { "bc1-srgb", VK_FORMAT_BC1_RGB_SRGB_BLOCK },
+    { "bc7", VK_FORMAT_BC7_UNORM_BLOCK },
+    { "bc7-srgb", VK_FORMAT_BC7_SRGB_BLOCK }
+};
+
+bool ParseTextureEncodingFormat(const char* name, VkFormat* outFormat)
+{
+    for (size_t i = 0; i < sizeof(s_textureEncodingNames) / sizeof(s_textureEncodingNames[0]); ++i)
+    {
+        if (strcmp(name, s_textureEncodingNames[i].name) == 0)
+        {
+            *outFormat = s_textureEncodingNames[i].format;
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline bool IsSRGBEncoding(VkFormat format)
+{
+    return format == VK_FORMAT_BC1_RGB_SRGB_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK;
+}
+
+// One run of ENCODE_JOB_BLOCK_ROW_COUNT block rows of a level, which also measures the error of its decoded blocks
+typedef struct TextureEncodeJob
+{
+    const TextureFormatInfo* formatInfo;
+    const uint8_t* srcRGBA;
+    uint32_t width;
+    uint32_t height;
+    uint32_t firstBlockRow;
+    uint32_t blockRowCount;
+    uint8_t* dst;                   // the first block of the level
+    uint64_t squaredError;
+} TextureEncodeJob;
+
+static void EncodeTextureJobProc(void* jobData)
+{
+    TextureEncodeJob* job = jobData;
+    const TextureFormatInfo* formatInfo = job->formatInfo;
+    const uint32_t blockCountX = (job->width + 3U) / 4U;
+    const bool isBC1 = formatInfo->blockSize == 8U;
+
+    uint64_t squaredError = 0;
+    for (uint32_t blockY = job->firstBlockRow; blockY < job->firstBlockRow + job->blockRowCount; ++blockY)
+    {
+        for (uint32_t blockX = 0; blockX < blockCountX; ++blockX)
+        {
+            // The edge texels are repeated into the part of a block outside the level
+            uint8_t texels[TEXTURE_BLOCK_TEXEL_COUNT * 4];
+            for (uint32_t i = 0; i < TEXTURE_BLOCK_TEXEL_COUNT; ++i)
+            {
+                const uint32_t x = min(blockX * 4U + (i & 3U), job->width - 1U);
+                const uint32_t y = min(blockY * 4U + (i >> 2), job->height - 1U);
+                memcpy(&texels[i * 4U], &job->srcRGBA[((size_t)y * job->width + x) * 4U], 4);
+            }
+
+            uint8_t* block = &job->dst[((size_t)blockY * blockCountX + blockX) * formatInfo->blockSize];
+            if (isBC1) {
+                EncodeBC1Block(texels, block);
+            }
+            else {
+                EncodeBC7Block(texels, block);
+            }
+
+            uint8_t decoded[TEXTURE_BLOCK_TEXEL_COUNT * 4];
+            formatInfo->decodeBlock(block, decoded);
+            for (uint32_t i = 0; i < TEXTURE_BLOCK_TEXEL_COUNT; ++i)
+            {
+                if (blockX * 4U + (i & 3U) >= job->width || blockY * 4U + (i >> 2) >= job->height) continue;
+
+                // BC1 has no alpha to compare
+                for (uint32_t c = 0; c < (isBC1 ? 3U : 4U); ++c)
+                {
+                    const int32_t d = (int32_t)decoded[i * 4U + c] - (int32_t)texels[i * 4U + c];
+                    squaredError += (uint64_t)(d * d);
+                }
+            }
+        }
+    }
+    job->squaredError = squaredError;
+}
+
+static float s_srgbToLinear[256];
+
+static void InitializeSRGBTable(void)
+{
+    for (int i = 0; i < 256; ++i)
+    {
+        const float value = (float)i / 255.0f;
+        s_srgbToLinear[i] = value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+    }
+}
+
+static inline uint8_t LinearToSRGBByte(float value)
+{
+    const float encoded = value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+    return (uint8_t)fminf(fmaxf(encoded * 255.0f + 0.5f, 0.0f), 255.0f);
+}
+
+// Averages the 2 x 2 texels of `src` under each texel of the next level, repeating the last row or column of odd sizes.
+// The colors of sRGB textures are averaged in linear space.
+static void DownsampleLevel(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, bool isSRGB, uint8_t* dst)
+{
+    const uint32_t dstWidth = max(srcWidth >> 1, 1U);
+    const uint32_t dstHeight = max(srcHeight >> 1, 1U);
+    for (uint32_t y = 0; y < dstHeight; ++y)
+    {
+        const uint32_t y0 = min(y * 2U, srcHeight - 1U);
+        const uint32_t y1 = min(y * 2U + 1U, srcHeight - 1U);
+        for (uint32_t x = 0; x < dstWidth; ++x)
+        {
+            const uint32_t x0 = min(x * 2U, srcWidth - 1U);
+            const uint32_t x1 = min(x * 2U + 1U, srcWidth - 1U);
+            const uint8_t* texels[4] = {
+                &src[((size_t)y0 * srcWidth + x0) * 4U], &src[((size_t)y0 * srcWidth + x1) * 4U],
+                &src[((size_t)y1 * srcWidth + x0) * 4U], &src[((size_t)y1 * srcWidth + x1) * 4U]
+            };
+            uint8_t* dstTexel = &dst[((size_t)y * dstWidth + x) * 4U];
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                if (isSRGB && c < 3)
+                {
+                    const float sum = s_srgbToLinear[texels[0][c]] + s_srgbToLinear[texels[1][c]] + s_srgbToLinear[texels[2][c]] + s_srgbToLinear[texels[3][c]];
+                    dstTexel[c] = LinearToSRGBByte(sum * 0.25f);
+                }
+                else {
+                    dstTexel[c] = (uint8_t)(((uint32_t)texels[0][c] + texels[1][c] + texels[2][c] + texels[3][c] + 2U) >> 2);
+                }
+            }
+        }
+    }
+}
+
+// Reads the first level of `image` as RGBA, with an opaque alpha where the file has none
+static uint8_t* LoadImageFileAsRGBA(const char* path, const ImageFile* image)
+{
+    if (image->format != VK_FORMAT_R8G8B8A8_UNORM && image->format != VK_FORMAT_R8G8B8A8_SRGB &&
+        image->format != VK_FORMAT_B8G8R8A8_UNORM && image->format != VK_FORMAT_B8G8R8A8_SRGB)
+    {
+        fprintf(stderr, "%s is already compressed!\n", path);
+        return NULL;
+    }
+
+    uint8_t* texels = malloc((size_t)image->decodedSize);
+    if (texels == NULL)
+    {
+        fprintf(stderr, "Allocating the texels of %s failed!\n", path);
+        return NULL;
+    }
+    if (!DecodeImageFile(image, texels))
+    {
+        free(texels);
+        return NULL;
+    }
+
+    const bool isBGRA = image->format == VK_FORMAT_B8G8R8A8_UNORM || image->format == VK_FORMAT_B8G8R8A8_SRGB;
+    const size_t texelCount = (size_t)image->width * image->height;
+    for (size_t i = 0; i < texelCount; ++i)
+    {
+        uint8_t* texel = &texels[i * 4U];
+        if (isBGRA)
+        {
+            const uint8_t blue = texel[0];
+            texel[0] = texel[2];
+            texel[2] = blue;
+        }
+        if (image->isOpaque) {
+            texel[3] = 255U;
+        }
+    }
+    return texels;
+}
+
+static inline void StoreU32LE(uint8_t* dst, uint32_t value)
+{
+    dst[0] = (uint8_t)value;
+    dst[1] = (uint8_t)(value >> 8);
+    dst[2] = (uint8_t)(value >> 16);
+    dst[3] = (uint8_t)(value >> 24);
+}
+
+static inline void StoreU64LE(uint8_t* dst, uint64_t value)
+{
+    StoreU32LE(dst, (uint32_t)value);
+    StoreU32LE(&dst[4], (uint32_t)(value >> 32));
+}
+
+// Writes a KTX2 file with the levels in `levelData`, laid out one after another from the largest level.
+// The file stores them from the smallest one, as the specification asks for.
+static bool WriteKTX2File(const char* path, const TextureFormatInfo* formatInfo, uint32_t width, uint32_t height, uint32_t levelCount,
+                        const uint8_t* levelData, const VkDeviceSize* levelOffsets, const VkDeviceSize* levelSizes)
+{
+    const uint32_t dfdOffset = KTX2_HEADER_SIZE + levelCount * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+    const size_t levelAlignment = formatInfo->blockSize;
+
+    size_t fileSize = (dfdOffset + KTX2_DFD_SIZE + levelAlignment - 1U) / levelAlignment * levelAlignment;
+    size_t fileLevelOffsets[MAX_IMAGE_FILE_LEVEL_COUNT];
+    for (uint32_t i = levelCount; i-- > 0; )
+    {
+        fileLevelOffsets[i] = fileSize;
+        fileSize += (size_t)(levelSizes[i] + levelAlignment - 1U) / levelAlignment * levelAlignment;
+    }
+
+    uint8_t* file = calloc(fileSize, 1);
+    if (file == NULL)
+    {
+        fprintf(stderr, "Allocating %zu bytes for %s failed!\n", fileSize, path);
+        return false;
+    }
+
+    memcpy(file, s_ktx2Identifier, sizeof(s_ktx2Identifier));
+    StoreU32LE(&file[12], formatInfo->format);
+    StoreU32LE(&file[16], 1U);              // typeSize of block compressed formats
+    StoreU32LE(&file[20], width);
+    StoreU32LE(&file[24], height);
+    StoreU32LE(&file[28], 0);               // pixelDepth
+    StoreU32LE(&file[32], 0);               // layerCount, not an array
+    StoreU32LE(&file[36], 1U);              // faceCount
+    StoreU32LE(&file[40], levelCount);
+    StoreU32LE(&file[44], 0);               // supercompressionScheme
+    StoreU32LE(&file[48], dfdOffset);
+    StoreU32LE(&file[52], KTX2_DFD_SIZE);
+    // No key/value data and no supercompression global data
+
+    for (uint32_t i = 0; i < levelCount; ++i)
+    {
+        uint8_t* entry = &file[KTX2_HEADER_SIZE + i * KTX2_LEVEL_INDEX_ENTRY_SIZE];
+        StoreU64LE(entry, fileLevelOffsets[i]);
+        StoreU64LE(&entry[8], levelSizes[i]);
+        StoreU64LE(&entry[16], levelSizes[i]);
+        memcpy(&file[fileLevelOffsets[i]], &levelData[levelOffsets[i]], (size_t)levelSizes[i]);
+    }
+
+    // A basic data format descriptor with one sample covering the whole block
+    const bool isBC1 = formatInfo->blockSize == 8U;
+    uint8_t* dfd = &file[dfdOffset];
+    StoreU32LE(dfd, KTX2_DFD_SIZE);
+    StoreU32LE(&dfd[4], 0);                                                 // vendorId and descriptorType: Khronos basic
+    StoreU32LE(&dfd[8], 2U | ((KTX2_DFD_SIZE - 4U) << 16));                 // versionNumber and descriptorBlockSize
+    StoreU32LE(&dfd[12], (isBC1 ? KHR_DF_MODEL_BC1A : KHR_DF_MODEL_BC7) | (KHR_DF_PRIMARIES_BT709 << 8) |
+                        ((IsSRGBEncoding(formatInfo->format) ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR) << 16));
+    StoreU32LE(&dfd[16], 3U | (3U << 8));                                   // texelBlockDimension, minus 1
+    StoreU32LE(&dfd[20], formatInfo->blockSize);                            // bytesPlane0
+    StoreU32LE(&dfd[24], 0);
+    StoreU32LE(&dfd[28], (formatInfo->blockSize * 8U - 1U) << 16);          // bitOffset 0, bitLength minus 1, color channel
+    StoreU32LE(&dfd[32], 0);                                                // samplePosition
+    StoreU32LE(&dfd[36], 0);                                                // sampleLower
+    StoreU32LE(&dfd[40], UINT32_MAX);                                       // sampleUpper
+
+    bool succeeded = false;
+    FILE* fp = fopen(path, "wb");
+    if (fp != NULL)
+    {
+        succeeded = fwrite(file, 1, fileSize, fp) == fileSize;
+        succeeded = fclose(fp) == 0 && succeeded;
+    }
+    if (!succeeded) {
+        fprintf(stderr, "Writing %s failed!\n", path);
+    }
+
+    free(file);
+    return succeeded;
+}
+
+bool EncodeTextureFile(const char* srcPath, const char* dstPath, VkFormat format, uint32_t threadCount)
+{
+    const TextureFormatInfo* formatInfo = GetTextureFormatInfo(format);
+    if (formatInfo == NULL || formatInfo->decodeBlock == NULL || formatInfo->blockWidth != 4U)
+    {
+        fprintf(stderr, "Format %d cannot be encoded!\n", format);
+        return false;
+    }
+
+    ImageFile image;
+    if (!OpenImageFile(srcPath, &image)) return false;
+
+    const bool isSRGB = IsSRGBEncoding(format);
+    const uint32_t width = image.width;
+    const uint32_t height = image.height;
+    const uint32_t levelCount = GetFullMipLevelCount(width, height);
+    if (!image.isOpaque && formatInfo->blockSize == 8U) {
+        printf("BC1 has no alpha, so the alpha of %s is dropped.\n", srcPath);
+    }
+
+    uint8_t* srcLevels = NULL;
+    uint8_t* dstLevels = NULL;
+    TextureEncodeJob* jobs = NULL;
+    bool succeeded = false;
+
+    do
+    {
+        uint8_t* srcTexels = LoadImageFileAsRGBA(srcPath, &image);
+        CloseImageFile(&image);
+        if (srcTexels == NULL) break;
+
+        // The source and encoded levels are each packed one after another
+        VkDeviceSize srcLevelOffsets[MAX_IMAGE_FILE_LEVEL_COUNT];
+        VkDeviceSize dstLevelOffsets[MAX_IMAGE_FILE_LEVEL_COUNT];
+        VkDeviceSize dstLevelSizes[MAX_IMAGE_FILE_LEVEL_COUNT];
+        VkDeviceSize srcSize = 0;
+        VkDeviceSize dstSize = 0;
+        uint32_t jobCount = 0;
+        for (uint32_t level = 0; level < levelCount; ++level)
+        {
+            srcLevelOffsets[level] = srcSize;
+            srcSize += (VkDeviceSize)max(width >> level, 1U) * max(height >> level, 1U) * 4U;
+            dstLevelOffsets[level] = dstSize;
+            dstLevelSizes[level] = GetTextureLevelSize(formatInfo, width, height, level);
+            dstSize += dstLevelSizes[level];
+            const uint32_t blockRowCount = (max(height >> level, 1U) + 3U) / 4U;
+            jobCount += (blockRowCount + ENCODE_JOB_BLOCK_ROW_COUNT - 1U) / ENCODE_JOB_BLOCK_ROW_COUNT;
+        }
+
+        srcLevels = malloc((size_t)srcSize);
+        dstLevels = malloc((size_t)dstSize);
+        jobs = malloc(jobCount * sizeof(*jobs));
+        if (srcLevels == NULL || dstLevels == NULL || jobs == NULL)
+        {
+            fprintf(stderr, "Allocating the levels of %s failed!\n", srcPath);
+            free(srcTexels);
+            break;
+        }
+        memcpy(srcLevels, srcTexels, (size_t)width * height * 4U);
+        free(srcTexels);
+
+        const double startTime = GetCurrentTimeInMilliseconds();
+        if (isSRGB) {
+            InitializeSRGBTable();
+        }
+        for (uint32_t level = 1; level < levelCount; ++level) {
+            DownsampleLevel(&srcLevels[srcLevelOffsets[level - 1U]], max(width >> (level - 1U), 1U), max(height >> (level - 1U), 1U), isSRGB,
+                            &srcLevels[srcLevelOffsets[level]]);
+        }
+        const double mipTime = GetCurrentTimeInMilliseconds() - startTime;
+
+        jobCount = 0;
+        for (uint32_t level = 0; level < levelCount; ++level)
+        {
+            const uint32_t levelHeight = max(height >> level, 1U);
+            const uint32_t blockRowCount = (levelHeight + 3U) / 4U;
+            for (uint32_t row = 0; row < blockRowCount; row += ENCODE_JOB_BLOCK_ROW_COUNT)
+            {
+                jobs[jobCount++] = (TextureEncodeJob){
+                    .formatInfo = formatInfo,
+                    .srcRGBA = &srcLevels[srcLevelOffsets[level]],
+                    .width = max(width >> level, 1U),
+                    .height = levelHeight,
+                    .firstBlockRow = row,
+                    .blockRowCount = min(blockRowCount - row, (uint32_t)ENCODE_JOB_BLOCK_ROW_COUNT),
+                    .dst = &dstLevels[dstLevelOffsets[level]],
+                    .squaredError = 0
+                };
+            }
+        }
+
+        const uint32_t usedThreadCount = min(threadCount > 0 ? threadCount : GetLogicalProcessorCount(), jobCount);
+        const double encodeStartTime = GetCurrentTimeInMilliseconds();
+        RunJobsInParallel(EncodeTextureJobProc, jobs, sizeof(jobs[0]), jobCount, usedThreadCount);
+        const double encodeTime = GetCurrentTimeInMilliseconds() - encodeStartTime;
+
+        // The quality of every level and of the whole chain, over the channels the format keeps
+        const uint32_t channelCount = formatInfo->blockSize == 8U ? 3U : 4U;
+        printf("Encoded %s (%u x %u, %u levels) to %s on %u thread%s: mips in %.3f ms, blocks in %.3f ms (%.2f Mtexels/s)\n", srcPath, width, height,
+            levelCount, formatInfo->name, usedThreadCount, usedThreadCount > 1 ? "s" : "", mipTime, encodeTime, (double)srcSize / 4.0 / 1000.0 / encodeTime);
+        uint64_t totalSquaredError = 0;
+        uint32_t jobIndex = 0;
+        for (uint32_t level = 0; level < levelCount; ++level)
+        {
+            uint64_t levelSquaredError = 0;
+            const uint8_t* levelDst = &dstLevels[dstLevelOffsets[level]];
+            for (; jobIndex < jobCount && jobs[jobIndex].dst == levelDst; ++jobIndex) {
+                levelSquaredError += jobs[jobIndex].squaredError;
+            }
+            totalSquaredError += levelSquaredError;
+
+            const double sampleCount = (double)max(width >> level, 1U) * max(height >> level, 1U) * channelCount;
+            const double mse = (double)levelSquaredError / sampleCount;
+            printf("  level %2u: %5u x %-5u PSNR %6.2f dB\n", level, max(width >> level, 1U), max(height >> level, 1U),
+                mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : 99.99);
+        }
+        const double totalMSE = (double)totalSquaredError / ((double)srcSize / 4.0 * channelCount);
+        printf("  all levels: PSNR %.2f dB, %.1f KB instead of %.1f KB as RGBA8 (%.1fx smaller)\n", totalMSE > 0.0 ? 10.0 * log10(255.0 * 255.0 / totalMSE) : 99.99,
+            (double)dstSize / 1024.0, (double)srcSize / 1024.0, (double)srcSize / (double)dstSize);
+
+        succeeded = WriteKTX2File(dstPath, formatInfo, width, height, levelCount, dstLevels, dstLevelOffsets, dstLevelSizes);
+    }
+    while (false);
+
+    free(jobs);
+    free(dstLevels);
+    free(srcLevels);
+
+    return succeeded;
+}
+
@@ -0,0 +1,363 @@
+#include "common.h"
+
+enum
+{
+    TEXTURE_UPLOAD_BENCHMARK_STAGING_PATH,      // a staging buffer copied into the image by the queue
+    TEXTURE_UPLOAD_BENCHMARK_HOST_COPY_PATH,    // VK_EXT_host_image_copy, written by the CPU without any command
+    TEXTURE_UPLOAD_BENCHMARK_PATH_COUNT,
+
+    // Large enough for the copy to dominate the submission overhead, with a full mip chain like a loaded texture
+    TEXTURE_UPLOAD_BENCHMARK_SIZE = 2048
+};
+
+typedef struct TextureUploadMeasurement
+{
+    double totalTime;
+    double minTime;
+    VkDeviceSize peakMemorySize;
+    uint32_t count;
+} TextureUploadMeasurement;
+
+static VkImage CreateUploadBenchmarkImage(VkDevice specDevice, const ImageFile* layout, VkImageUsageFlags usage, DeviceMemoryAllocation* outMemory)
+{
+    const VkImageCreateInfo imageCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = layout->format,
+        .extent = { .width = layout->width, .height = layout->height, .depth = 1U },
+        .mipLevels = layout->levelCount,
+        .arrayLayers = 1U,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 0,
+        .pQueueFamilyIndices = NULL,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+    };
+    VkImage image = VK_NULL_HANDLE;
+    const VkResult res = vkCreateImage(specDevice, &imageCreateInfo, NULL, &image);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkCreateImage for the texture upload benchmark failed: %d\n", res);
+        return VK_NULL_HANDLE;
+    }
+
+    if (!AllocateAndBindImageMemory(image, DEVICE_MEMORY_USAGE_GPU_ONLY, outMemory))
+    {
+        fprintf(stderr, "Allocating the memory for the texture upload benchmark image failed!\n");
+        vkDestroyImage(specDevice, image, NULL);
+        return VK_NULL_HANDLE;
+    }
+
+    return image;
+}
+
+static void RecordUploadMeasurement(TextureUploadMeasurement* measurement, double time, VkDeviceSize memorySize)
+{
+    measurement->totalTime += time;
+    measurement->minTime = measurement->count == 0 ? time : min(measurement->minTime, time);
+    measurement->peakMemorySize = max(measurement->peakMemorySize, memorySize);
+    measurement->count++;
+}
+
+// One upload the way a texture is loaded without host image copies: a fresh staging buffer filled by the CPU, copied by the queue,
+// and the image handed over to the fragment shader, measured until the fence signals. `fence` is left unsignaled.
+static bool MeasureStagingUpload(VkDevice specDevice, VkQueue queue, VkCommandBuffer cmdBuf, VkFence fence, VkImage image, VkDeviceSize imageMemorySize,
+                                const ImageFile* layout, const uint8_t* srcData, TextureUploadMeasurement* measurement)
+{
+    VkBuffer stagingBuffer = VK_NULL_HANDLE;
+    DeviceMemoryAllocation stagingMemory = { 0 };
+    VkResult res = VK_ERROR_INITIALIZATION_FAILED;
+    bool succeeded = false;
+
+    const double startTime = GetCurrentTimeInMilliseconds();
+    do
+    {
+        const VkBufferCreateInfo bufferCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .size = layout->decodedSize,
+            .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = NULL
+        };
+        res = vkCreateBuffer(specDevice, &bufferCreateInfo, NULL, &stagingBuffer);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreateBuffer for the texture upload benchmark failed: %d\n", res);
+            break;
+        }
+        if (!AllocateAndBindBufferMemory(stagingBuffer, DEVICE_MEMORY_USAGE_STAGING_UPLOAD, &stagingMemory))
+        {
+            fprintf(stderr, "Allocating the memory for the texture upload benchmark staging buffer failed!\n");
+            break;
+        }
+        memcpy(stagingMemory.mappedData, srcData, (size_t)layout->decodedSize);
+
+        const VkCommandBufferBeginInfo beginInfo = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .pNext = NULL,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+            .pInheritanceInfo = NULL
+        };
+        res = vkBeginCommandBuffer(cmdBuf, &beginInfo);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkBeginCommandBuffer for the texture upload benchmark failed: %d\n", res);
+            break;
+        }
+
+        VkImageMemoryBarrier imageBarrier = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext = NULL,
+            .srcAccessMask = 0,
+            .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = image,
+            .subresourceRange = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = 0U,
+                .levelCount = layout->levelCount,
+                .baseArrayLayer = 0U,
+                .layerCount = 1U
+            }
+        };
+        vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &imageBarrier);
+
+        VkBufferImageCopy copyRegions[MAX_IMAGE_FILE_LEVEL_COUNT];
+        for (uint32_t level = 0; level < layout->levelCount; ++level)
+        {
+            copyRegions[level] = (VkBufferImageCopy){
+                .bufferOffset = layout->levelOffsets[level],
+                .bufferRowLength = 0U,      // tightly packed
+                .bufferImageHeight = 0U,
+                .imageSubresource = {
+                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .mipLevel = level,
+                    .baseArrayLayer = 0U,
+                    .layerCount = 1U
+                },
+                .imageOffset = { .x = 0U, .y = 0U, .z = 0U },
+                .imageExtent = { .width = max(layout->width >> level, 1U), .height = max(layout->height >> level, 1U), .depth = 1U }
+            };
+        }
+        vkCmdCopyBufferToImage(cmdBuf, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layout->levelCount, copyRegions);
+
+        imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        imageBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &imageBarrier);
+
+        res = vkEndCommandBuffer(cmdBuf);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkEndCommandBuffer for the texture upload benchmark failed: %d\n", res);
+            break;
+        }
+
+        const VkSubmitInfo submitInfo = {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .pNext = NULL,
+            .waitSemaphoreCount = 0,
+            .pWaitSemaphores = NULL,
+            .pWaitDstStageMask = NULL,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &cmdBuf,
+            .signalSemaphoreCount = 0,
+            .pSignalSemaphores = NULL
+        };
+        res = vkQueueSubmit(queue, 1, &submitInfo, fence);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkQueueSubmit for the texture upload benchmark failed: %d\n", res);
+            break;
+        }
+        vkWaitForFences(specDevice, 1, &fence, VK_TRUE, UINT64_MAX);
+        vkResetFences(specDevice, 1, &fence);
+
+        succeeded = true;
+    }
+    while (false);
+
+    // Both the image and its staging memory are alive until the copy completes
+    const VkDeviceSize memorySize = imageMemorySize + stagingMemory.size;
+    if (stagingBuffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(specDevice, stagingBuffer, NULL);
+    }
+    FreeDeviceMemory(&stagingMemory);
+
+    if (succeeded) {
+        RecordUploadMeasurement(measurement, GetCurrentTimeInMilliseconds() - startTime, memorySize);
+    }
+    return succeeded;
+}
+
+bool RunTextureUploadBenchmark(VkPhysicalDevice physicalDevice, VkDevice specDevice, VkQueue queue, VkCommandPool commandPool,
+                            const HostImageCopySupport* hostImageCopy, uint32_t iterationCount)
+{
+    // A tightly packed RGBA8 mip chain, laid out like a decoded image file
+    ImageFile layout = {
+        .format = VK_FORMAT_R8G8B8A8_UNORM,
+        .fileFormat = VK_FORMAT_R8G8B8A8_UNORM,
+        .width = TEXTURE_UPLOAD_BENCHMARK_SIZE,
+        .height = TEXTURE_UPLOAD_BENCHMARK_SIZE,
+        .levelCount = GetFullMipLevelCount(TEXTURE_UPLOAD_BENCHMARK_SIZE, TEXTURE_UPLOAD_BENCHMARK_SIZE)
+    };
+    for (uint32_t level = 0; level < layout.levelCount; ++level)
+    {
+        layout.levelOffsets[level] = layout.decodedSize;
+        layout.levelSizes[level] = (VkDeviceSize)max(layout.width >> level, 1U) * max(layout.height >> level, 1U) * 4U;
+        layout.decodedSize += layout.levelSizes[level];
+    }
+
+    // Where the host image copy leaves the image: read only by shaders when the device allows it, like an uploaded texture
+    const VkImageUsageFlags hostCopyUsage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT;
+    VkImageLayout hostCopyLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    bool isHostCopyOptimal = false;
+    bool canCopyFromHost = CanCopyImageFromHost(physicalDevice, hostImageCopy, layout.format, hostCopyUsage, 0, hostCopyLayout, &isHostCopyOptimal);
+    if (!canCopyFromHost)
+    {
+        hostCopyLayout = VK_IMAGE_LAYOUT_GENERAL;
+        canCopyFromHost = CanCopyImageFromHost(physicalDevice, hostImageCopy, layout.format, hostCopyUsage, 0, hostCopyLayout, &isHostCopyOptimal);
+    }
+
+    uint8_t* srcData = NULL;
+    VkImage images[TEXTURE_UPLOAD_BENCHMARK_PATH_COUNT] = { VK_NULL_HANDLE, VK_NULL_HANDLE };
+    DeviceMemoryAllocation imageMemories[TEXTURE_UPLOAD_BENCHMARK_PATH_COUNT] = { 0 };
+    VkCommandBuffer cmdBuf = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE;
+    VkResult res = VK_ERROR_INITIALIZATION_FAILED;
+    bool succeeded = false;
+
+    do
+    {
+        srcData = malloc((size_t)layout.decodedSize);
+        if (srcData == NULL)
+        {
+            fprintf(stderr, "Lack of system memory for the texture upload benchmark!\n");
+            break;
+        }
+        // Any pattern will do as long as no driver can take a shortcut for it
+        uint32_t seed = 0x9e3779b9U;
+        for (VkDeviceSize i = 0; i < layout.decodedSize; i += 4)
+        {
+            seed = seed * 1664525U + 1013904223U;
+            memcpy(&srcData[i], &seed, 4);
+        }
+
+        images[TEXTURE_UPLOAD_BENCHMARK_STAGING_PATH] = CreateUploadBenchmarkImage(specDevice, &layout, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                                                                                &imageMemories[TEXTURE_UPLOAD_BENCHMARK_STAGING_PATH]);
+        if (images[TEXTURE_UPLOAD_BENCHMARK_STAGING_PATH] == VK_NULL_HANDLE) break;
+
+        if (canCopyFromHost)
+        {
+            images[TEXTURE_UPLOAD_BENCHMARK_HOST_COPY_PATH] = CreateUploadBenchmarkImage(specDevice, &layout, hostCopyUsage,
+                                                                                        &imageMemories[TEXTURE_UPLOAD_BENCHMARK_HOST_COPY_PATH]);
+            if (images[TEXTURE_UPLOAD_BENCHMARK_HOST_COPY_PATH] == VK_NULL_HANDLE) break;
+        }
+
+        const VkCommandBufferAllocateInfo cmdBufAllocInfo = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .pNext = NULL,
+            .commandPool = commandPool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1
+        };
+        res = vkAllocateCommandBuffers(specDevice, &cmdBufAllocInfo, &cmdBuf);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkAllocateCommandBuffers for the texture upload benchmark failed: %d\n", res);
+            break;
+        }
+
+        const VkFenceCreateInfo fenceCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0
+        };
+        res = vkCreateFence(specDevice, &fenceCreateInfo, NULL, &fence);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreateFence for the texture upload benchmark failed: %d\n", res);
+            break;
+        }
+
+        // Alternate the paths, so that clock ramp-up and cache warmth hit both of them alike
+        TextureUploadMeasurement measurements[TEXTURE_UPLOAD_BENCHMARK_PATH_COUNT] = { 0 };
+        bool measured = true;
+        for (uint32_t iteration = 0; iteration < iterationCount && measured; ++iteration)
+        {
+            measured = MeasureStagingUpload(specDevice, queue, cmdBuf, fence, images[TEXTURE_UPLOAD_BENCHMARK_STAGING_PATH],
+                                            imageMemories[TEXTURE_UPLOAD_BENCHMARK_STAGING_PATH].size, &layout, srcData,
+                                            &measurements[TEXTURE_UPLOAD_BENCHMARK_STAGING_PATH]);
+            if (!measured || !canCopyFromHost) continue;
+
+            // Nothing is submitted: the copy is complete, and visible to the device, as soon as the call returns
+            const double startTime = GetCurrentTimeInMilliseconds();
+            measured = CopyImageDataFromHost(specDevice, hostImageCopy, images[TEXTURE_UPLOAD_BENCHMARK_HOST_COPY_PATH], &layout, srcData,
+                                            layout.levelCount, 1U, layout.decodedSize, hostCopyLayout);
+            if (measured)
+            {
+                RecordUploadMeasurement(&measurements[TEXTURE_UPLOAD_BENCHMARK_HOST_COPY_PATH], GetCurrentTimeInMilliseconds() - startTime,
+                                        imageMemories[TEXTURE_UPLOAD_BENCHMARK_HOST_COPY_PATH].size);
+            }
+        }
+        if (!measured) break;
+
+        const double sizeInMB = (double)layout.decodedSize / (1024.0 * 1024.0);
+        printf("Texture upload benchmark: %ux%u RGBA8 with %u levels, %.2f MB, %u iterations\n", layout.width, layout.height, layout.levelCount,
+                sizeInMB, iterationCount);
+
+        const char* const pathNames[TEXTURE_UPLOAD_BENCHMARK_PATH_COUNT] = { "staging buffer + copy", "host image copy" };
+        for (uint32_t path = 0; path < TEXTURE_UPLOAD_BENCHMARK_PATH_COUNT; ++path)
+        {
+            const TextureUploadMeasurement* measurement = &measurements[path];
+            if (measurement->count == 0) continue;
+
+            const double averageTime = measurement->totalTime / measurement->count;
+            printf("  %-22s avg %.3f ms, min %.3f ms, %.1f MB/s, peak device memory %.2f MB\n", pathNames[path], averageTime, measurement->minTime,
+                    averageTime > 0.0 ? sizeInMB * 1000.0 / averageTime : 0.0, (double)measurement->peakMemorySize / (1024.0 * 1024.0));
+        }
+        if (canCopyFromHost)
+        {
+            printf("  The host copies leave the image in %s, %s for the device to access\n",
+                    hostCopyLayout == VK_IMAGE_LAYOUT_GENERAL ? "GENERAL" : "SHADER_READ_ONLY_OPTIMAL", isHostCopyOptimal ? "optimal" : "not optimal");
+        }
+        else
+        {
+            printf("  Host image copies are %s, so only the staging path is measured\n",
+                    hostImageCopy == NULL ? "not available" : "not supported for this format and layout");
+        }
+
+        succeeded = true;
+    }
+    while (false);
+
+    if (fence != VK_NULL_HANDLE) {
+        vkDestroyFence(specDevice, fence, NULL);
+    }
+    if (cmdBuf != VK_NULL_HANDLE) {
+        vkFreeCommandBuffers(specDevice, commandPool, 1, &cmdBuf);
+    }
+    for (int i = 0; i < TEXTURE_UPLOAD_BENCHMARK_PATH_COUNT; ++i)
+    {
+        if (images[i] != VK_NULL_HANDLE) {
+            vkDestroyImage(specDevice, images[i], NULL);
+        }
+        FreeDeviceMemory(&imageMemories[i]);
+    }
+    if (srcData != NULL) {
+        free(srcData);
+    }
+
+    return succeeded;
+}
@@ -0,0 +1,80 @@
+#include "common.h"
+#include <threads.h>
+#include <stdatomic.h>
+
+enum { MAX_WORKER_THREAD_COUNT = 64 };
+
+typedef struct ParallelJobContext
+{
+    ParallelJobProc jobProc;
+    uint8_t* jobs;
+    size_t jobSize;
+    uint32_t jobCount;
+    atomic_uint nextJobIndex;
+} ParallelJobContext;
+
+uint32_t GetLogicalProcessorCount(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    return max((uint32_t)systemInfo.dwNumberOfProcessors, 1U);
+#else
+    const long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (uint32_t)count : 1U;
+#endif // _WIN32
+}
+
+static int WorkerThreadProc(void* arg)
+{
+    ParallelJobContext* context = arg;
+    // Each worker keeps grabbing the next job until all of them are taken
+    while (true)
+    {
+        const uint32_t jobIndex = atomic_fetch_add(&context->nextJobIndex, 1U);
+        if (jobIndex >= context->jobCount) break;
+
+        context->jobProc(context->jobs + jobIndex * context->jobSize);
+    }
+    return 0;
+}
+
+void RunJobsInParallel(ParallelJobProc jobProc, void* jobs, size_t jobSize, uint32_t jobCount, uint32_t threadCount)
+{
+    if (jobCount == 0) return;
+
+    if (threadCount == 0) {
+        threadCount = GetLogicalProcessorCount();
+    }
+    threadCount = min(threadCount, jobCount);
+    threadCount = min(threadCount, (uint32_t)MAX_WORKER_THREAD_COUNT);
+
+    ParallelJobContext context = {
+        .jobProc = jobProc,
+        .jobs = jobs,
+        .jobSize = jobSize,
+        .jobCount = jobCount
+    };
+    atomic_init(&context.nextJobIndex, 0U);
+
+    thrd_t workers[MAX_WORKER_THREAD_COUNT];
+    uint32_t workerCount = 0;
+    for (uint32_t i = 1; i < threadCount; ++i)
+    {
+        if (thrd_create(&workers[workerCount], WorkerThreadProc, &context) != thrd_success)
+        {
+            // The remaining jobs will just be picked up by the threads that are already running.
+            fprintf(stderr, "thrd_create for worker thread @%u failed!\n", i);
+            break;
+        }
+        ++workerCount;
+    }
+
+    // The calling thread works on the jobs as well
+    WorkerThreadProc(&context);
+
+    for (uint32_t i = 0; i < workerCount; ++i) {
+        thrd_join(workers[i], NULL);
+    }
+}
+
@@ -0,0 +1,675 @@
+#include "common.h"
+
+
+static bool CreateStagingRing(UploadManager* manager)
+{
+    const VkBufferCreateInfo bufferCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .size = UPLOAD_STAGING_RING_SIZE,
+        .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 1,
+        .pQueueFamilyIndices = &manager->queueFamilyIndex
+    };
+    const VkResult res = vkCreateBuffer(manager->device, &bufferCreateInfo, NULL, &manager->stagingBuffer);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkCreateBuffer for the upload staging ring failed: %d\n", res);
+        return false;
+    }
+
+    // Staging allocations are persistently mapped, so the ring is written through the same pointer for the whole lifetime of the manager
+    if (!AllocateAndBindBufferMemory(manager->stagingBuffer, DEVICE_MEMORY_USAGE_STAGING_UPLOAD, &manager->stagingMemory))
+    {
+        fprintf(stderr, "Allocating the upload staging ring memory failed!\n");
+        return false;
+    }
+    return true;
+}
+
+bool CreateUploadManager(VkDevice device, uint32_t graphicsQueueFamilyIndex, uint32_t transferQueueFamilyIndex, VkCommandBuffer inlineCommandBuffer,
+                        UploadManager* outManager)
+{
+    *outManager = (UploadManager){ 0 };
+    outManager->device = device;
+    outManager->graphicsQueueFamilyIndex = graphicsQueueFamilyIndex;
+    outManager->queueFamilyIndex = graphicsQueueFamilyIndex;
+
+    // The copies are submitted together with the commands of the graphics queue
+    if (inlineCommandBuffer != VK_NULL_HANDLE)
+    {
+        outManager->inlineCommandBuffer = inlineCommandBuffer;
+        if (!CreateStagingRing(outManager))
+        {
+            DestroyUploadManager(outManager);
+            return false;
+        }
+        return true;
+    }
+
+    if (transferQueueFamilyIndex != UINT32_MAX) {
+        outManager->queueFamilyIndex = transferQueueFamilyIndex;
+    }
+    vkGetDeviceQueue(device, outManager->queueFamilyIndex, 0, &outManager->queue);
+
+    // Timeline semaphores are core since Vulkan 1.2 and come from VK_KHR_timeline_semaphore before
+    outManager->getSemaphoreCounterValue = (PFN_vkGetSemaphoreCounterValue)vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValue");
+    if (outManager->getSemaphoreCounterValue == NULL) {
+        outManager->getSemaphoreCounterValue = (PFN_vkGetSemaphoreCounterValue)vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValueKHR");
+    }
+    outManager->waitSemaphores = (PFN_vkWaitSemaphores)vkGetDeviceProcAddr(device, "vkWaitSemaphores");
+    if (outManager->waitSemaphores == NULL) {
+        outManager->waitSemaphores = (PFN_vkWaitSemaphores)vkGetDeviceProcAddr(device, "vkWaitSemaphoresKHR");
+    }
+    if (outManager->getSemaphoreCounterValue == NULL || outManager->waitSemaphores == NULL)
+    {
+        fprintf(stderr, "The timeline semaphore functions are not available!\n");
+        return false;
+    }
+
+    bool succeeded = false;
+    do
+    {
+        const VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+            .pNext = NULL,
+            .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+            .initialValue = 0
+        };
+        const VkSemaphoreCreateInfo semaphoreCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+            .pNext = &semaphoreTypeCreateInfo,
+            .flags = 0
+        };
+        VkResult res = vkCreateSemaphore(device, &semaphoreCreateInfo, NULL, &outManager->timelineSemaphore);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreateSemaphore for the upload timeline failed: %d\n", res);
+            break;
+        }
+
+        const VkCommandPoolCreateInfo commandPoolCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            .pNext = NULL,
+            .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+            .queueFamilyIndex = outManager->queueFamilyIndex
+        };
+        res = vkCreateCommandPool(device, &commandPoolCreateInfo, NULL, &outManager->commandPool);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreateCommandPool for uploads failed: %d\n", res);
+            break;
+        }
+
+        const VkCommandBufferAllocateInfo commandBufferAllocateInfo = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .pNext = NULL,
+            .commandPool = outManager->commandPool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = UPLOAD_BATCH_COUNT
+        };
+        res = vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, outManager->commandBuffers);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkAllocateCommandBuffers for uploads failed: %d\n", res);
+            break;
+        }
+
+        if (!CreateStagingRing(outManager)) break;
+
+        succeeded = true;
+    }
+    while (false);
+
+    if (!succeeded)
+    {
+        DestroyUploadManager(outManager);
+        return false;
+    }
+
+    printf("Uploads go to the %s queue family %u\n", transferQueueFamilyIndex != UINT32_MAX ? "dedicated transfer" : "graphics", outManager->queueFamilyIndex);
+    return true;
+}
+
+void DestroyUploadManager(UploadManager* manager)
+{
+    if (manager->commandPool != VK_NULL_HANDLE)
+    {
+        if (manager->commandBuffers[0] != VK_NULL_HANDLE) {
+            vkFreeCommandBuffers(manager->device, manager->commandPool, UPLOAD_BATCH_COUNT, manager->commandBuffers);
+        }
+        vkDestroyCommandPool(manager->device, manager->commandPool, NULL);
+        manager->commandPool = VK_NULL_HANDLE;
+    }
+    for (uint32_t i = 0; i < UPLOAD_BATCH_COUNT; ++i) {
+        manager->commandBuffers[i] = VK_NULL_HANDLE;
+    }
+    if (manager->timelineSemaphore != VK_NULL_HANDLE)
+    {
+        vkDestroySemaphore(manager->device, manager->timelineSemaphore, NULL);
+        manager->timelineSemaphore = VK_NULL_HANDLE;
+    }
+    if (manager->stagingBuffer != VK_NULL_HANDLE)
+    {
+        vkDestroyBuffer(manager->device, manager->stagingBuffer, NULL);
+        manager->stagingBuffer = VK_NULL_HANDLE;
+    }
+    FreeDeviceMemory(&manager->stagingMemory);
+    manager->inlineCommandBuffer = VK_NULL_HANDLE;
+    manager->isRecording = false;
+    manager->pendingTransferCount = 0;
+    manager->pendingCopyCount = 0;
+}
+
+uint64_t GetCompletedUploadValue(const UploadManager* manager)
+{
+    if (manager->timelineSemaphore == VK_NULL_HANDLE) {
+        return manager->lastSubmittedValue;
+    }
+
+    uint64_t value = 0;
+    const VkResult res = manager->getSemaphoreCounterValue(manager->device, manager->timelineSemaphore, &value);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkGetSemaphoreCounterValue for the upload timeline failed: %d\n", res);
+        return 0;
+    }
+    return value;
+}
+
+// Gives the space of the completed batches back to the staging ring
+static void ReclaimStagingMemory(UploadManager* manager)
+{
+    if (manager->timelineSemaphore == VK_NULL_HANDLE) return;
+
+    const uint64_t completedValue = GetCompletedUploadValue(manager);
+    const double currentTime = GetCurrentTimeInMilliseconds();
+    for (uint32_t i = 0; i < UPLOAD_BATCH_COUNT; ++i)
+    {
+        if (manager->batchStagingSizes[i] == 0 || manager->batchValues[i] > completedValue) continue;
+
+        // The batches complete in the order of submission, which is the order of their space in the ring
+        manager->stagingUsedSize -= manager->batchStagingSizes[i];
+        manager->statistics.completedSize += manager->batchUploadSizes[i];
+        manager->statistics.completedTime += currentTime - manager->batchStartTimes[i];
+        manager->batchStagingSizes[i] = 0;
+        manager->batchUploadSizes[i] = 0;
+    }
+    if (manager->stagingUsedSize == 0) {
+        manager->stagingHead = 0;
+    }
+}
+
+VkCommandBuffer BeginUploadBatch(UploadManager* manager, bool waitsForBatch)
+{
+    if (manager->timelineSemaphore == VK_NULL_HANDLE) {
+        return manager->inlineCommandBuffer;
+    }
+    if (manager->isRecording) {
+        return manager->commandBuffers[manager->currentBatchIndex];
+    }
+
+    // The command buffers are used round robin, so the one to record is the one of the oldest batch
+    const uint32_t batchIndex = (uint32_t)(manager->lastSubmittedValue % UPLOAD_BATCH_COUNT);
+    const uint64_t previousValue = manager->batchValues[batchIndex];
+    if (previousValue > GetCompletedUploadValue(manager))
+    {
+        if (!waitsForBatch) return VK_NULL_HANDLE;
+
+        const VkSemaphoreWaitInfo waitInfo = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .semaphoreCount = 1,
+            .pSemaphores = &manager->timelineSemaphore,
+            .pValues = &previousValue
+        };
+        const VkResult res = manager->waitSemaphores(manager->device, &waitInfo, UINT64_MAX);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkWaitSemaphores for upload batch %u failed: %d\n", batchIndex, res);
+            return VK_NULL_HANDLE;
+        }
+    }
+    // The staging space of the previous batch of this command buffer must be reclaimed before the slot is overwritten on submission
+    ReclaimStagingMemory(manager);
+
+    const VkCommandBufferBeginInfo beginInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = NULL,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = NULL
+    };
+    const VkResult res = vkBeginCommandBuffer(manager->commandBuffers[batchIndex], &beginInfo);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkBeginCommandBuffer for upload batch %u failed: %d\n", batchIndex, res);
+        return VK_NULL_HANDLE;
+    }
+
+    manager->currentBatchIndex = batchIndex;
+    manager->isRecording = true;
+    return manager->commandBuffers[batchIndex];
+}
+
+// Records the queued copies, one command per destination with all its regions
+static bool FlushUploadCopies(UploadManager* manager)
+{
+    if (manager->pendingCopyCount == 0) return true;
+
+    const VkCommandBuffer commandBuffer = BeginUploadBatch(manager, true);
+    if (commandBuffer == VK_NULL_HANDLE) return false;
+
+    VkBufferCopy bufferRegions[MAX_UPLOAD_COPY_COUNT];
+    VkBufferImageCopy imageRegions[MAX_UPLOAD_COPY_COUNT];
+    bool isRecorded[MAX_UPLOAD_COPY_COUNT] = { false };
+    for (uint32_t i = 0; i < manager->pendingCopyCount; ++i)
+    {
+        if (isRecorded[i]) continue;
+
+        const UploadCopy* first = &manager->pendingCopies[i];
+        uint32_t regionCount = 0;
+        for (uint32_t j = i; j < manager->pendingCopyCount; ++j)
+        {
+            const UploadCopy* copy = &manager->pendingCopies[j];
+            if (isRecorded[j] || copy->dstBuffer != first->dstBuffer || copy->dstImage != first->dstImage) continue;
+
+            isRecorded[j] = true;
+            ++manager->statistics.copyRegionCount;
+            if (first->dstImage != VK_NULL_HANDLE)
+            {
+                imageRegions[regionCount++] = copy->imageRegion;
+                continue;
+            }
+
+            // A copy that continues the previous one both in the ring and in the destination only extends its region
+            VkBufferCopy* previous = regionCount > 0 ? &bufferRegions[regionCount - 1] : NULL;
+            if (previous != NULL && previous->srcOffset + previous->size == copy->bufferRegion.srcOffset &&
+                previous->dstOffset + previous->size == copy->bufferRegion.dstOffset) {
+                previous->size += copy->bufferRegion.size;
+            }
+            else {
+                bufferRegions[regionCount++] = copy->bufferRegion;
+            }
+        }
+
+        if (first->dstImage != VK_NULL_HANDLE) {
+            vkCmdCopyBufferToImage(commandBuffer, manager->stagingBuffer, first->dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regionCount, imageRegions);
+        }
+        else {
+            vkCmdCopyBuffer(commandBuffer, manager->stagingBuffer, first->dstBuffer, regionCount, bufferRegions);
+        }
+        ++manager->statistics.copyCommandCount;
+    }
+    manager->pendingCopyCount = 0;
+    return true;
+}
+
+bool SubmitUploadBatch(UploadManager* manager, uint64_t* outBatchValue)
+{
+    *outBatchValue = manager->lastSubmittedValue;
+    if (!FlushUploadCopies(manager)) return false;
+    if (!manager->isRecording) return true;
+
+    const VkCommandBuffer commandBuffer = manager->commandBuffers[manager->currentBatchIndex];
+    manager->isRecording = false;
+
+    VkResult res = vkEndCommandBuffer(commandBuffer);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkEndCommandBuffer for upload batch %u failed: %d\n", manager->currentBatchIndex, res);
+        return false;
+    }
+
+    const uint64_t signalValue = manager->lastSubmittedValue + 1U;
+    const VkTimelineSemaphoreSubmitInfo timelineSubmitInfo = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .pNext = NULL,
+        .waitSemaphoreValueCount = 0,
+        .pWaitSemaphoreValues = NULL,
+        .signalSemaphoreValueCount = 1,
+        .pSignalSemaphoreValues = &signalValue
+    };
+    const VkSubmitInfo submitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = &timelineSubmitInfo,
+        .waitSemaphoreCount = 0,
+        .pWaitSemaphores = NULL,
+        .pWaitDstStageMask = NULL,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &commandBuffer,
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores = &manager->timelineSemaphore
+    };
+    res = vkQueueSubmit(manager->queue, 1, &submitInfo, VK_NULL_HANDLE);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkQueueSubmit for upload batch %u failed: %d\n", manager->currentBatchIndex, res);
+        return false;
+    }
+
+    // The allocations whose copies have not been queued yet are read by a later batch, so their space stays with the next one
+    const bool ownsStaging = manager->recordingQueuedSize > 0;
+    manager->batchValues[manager->currentBatchIndex] = signalValue;
+    manager->batchStagingSizes[manager->currentBatchIndex] = manager->recordingQueuedSize;
+    manager->batchUploadSizes[manager->currentBatchIndex] = ownsStaging ? manager->recordingUploadSize : 0;
+    manager->batchStartTimes[manager->currentBatchIndex] = manager->recordingStartTime;
+    manager->recordingStagingSize -= manager->recordingQueuedSize;
+    manager->recordingLastAllocationPosition -= min(manager->recordingLastAllocationPosition, manager->recordingQueuedSize);
+    manager->recordingQueuedSize = 0;
+    if (ownsStaging) {
+        manager->recordingUploadSize = 0;
+    }
+    manager->lastSubmittedValue = signalValue;
+    ++manager->submittedBatchCount;
+    *outBatchValue = signalValue;
+    return true;
+}
+
+void* AllocateUploadStagingMemory(UploadManager* manager, VkDeviceSize size, VkDeviceSize alignment, bool waitsForSpace, VkDeviceSize* outOffset)
+{
+    const VkDeviceSize capacity = UPLOAD_STAGING_RING_SIZE;
+    if (size == 0 || size > capacity)
+    {
+        ++manager->statistics.failedAllocationCount;
+        return NULL;
+    }
+
+    const VkDeviceSize alignMask = alignment - 1U;
+    VkDeviceSize offset;
+    VkDeviceSize requiredSize;
+    while (true)
+    {
+        ReclaimStagingMemory(manager);
+
+        // An allocation that does not fit before the end of the ring starts over at its beginning, and the tail it skips is used up as well.
+        offset = (manager->stagingHead + alignMask) & ~alignMask;
+        requiredSize = offset - manager->stagingHead + size;
+        if (offset + size > capacity)
+        {
+            offset = 0;
+            requiredSize = capacity - manager->stagingHead + size;
+        }
+        if (requiredSize <= capacity - manager->stagingUsedSize) break;
+
+        if (!waitsForSpace || manager->timelineSemaphore == VK_NULL_HANDLE)
+        {
+            ++manager->statistics.failedAllocationCount;
+            return NULL;
+        }
+
+        // The space of the batch being recorded can only be reclaimed after it has been submitted, and only up to its last queued copy
+        uint64_t batchValue;
+        if (!SubmitUploadBatch(manager, &batchValue)) return NULL;
+
+        uint64_t oldestValue = UINT64_MAX;
+        for (uint32_t i = 0; i < UPLOAD_BATCH_COUNT; ++i)
+        {
+            if (manager->batchStagingSizes[i] != 0) {
+                oldestValue = min(oldestValue, manager->batchValues[i]);
+            }
+        }
+        if (oldestValue == UINT64_MAX)
+        {
+            // The rest of the ring holds data whose copies have not been queued yet, which must not be waited for
+            ++manager->statistics.failedAllocationCount;
+            return NULL;
+        }
+
+        const VkSemaphoreWaitInfo waitInfo = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .semaphoreCount = 1,
+            .pSemaphores = &manager->timelineSemaphore,
+            .pValues = &oldestValue
+        };
+        const VkResult res = manager->waitSemaphores(manager->device, &waitInfo, UINT64_MAX);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkWaitSemaphores for staging ring space failed: %d\n", res);
+            return NULL;
+        }
+        ++manager->statistics.stallCount;
+    }
+
+    if (manager->recordingUploadSize == 0) {
+        manager->recordingStartTime = GetCurrentTimeInMilliseconds();
+    }
+    manager->recordingLastAllocationPosition = manager->recordingStagingSize + requiredSize - size;
+    manager->stagingHead = offset + size;
+    manager->stagingUsedSize += requiredSize;
+    manager->recordingStagingSize += requiredSize;
+    manager->recordingUploadSize += size;
+
+    UploadStatistics* stats = &manager->statistics;
+    ++stats->allocationCount;
+    stats->allocatedSize += size;
+    stats->peakUsedSize = max(stats->peakUsedSize, manager->stagingUsedSize);
+
+    *outOffset = offset;
+    return (uint8_t*)manager->stagingMemory.mappedData + offset;
+}
+
+// Hands the staging space read by a copy to the batch being recorded. A copy out of the newest allocation takes all of it, an older one up to its end,
+// only the first byte for an image region whose size depends on its format.
+static bool MarkStagingQueued(UploadManager* manager, VkDeviceSize srcOffset, VkDeviceSize size)
+{
+    if (manager->timelineSemaphore == VK_NULL_HANDLE) return true;
+
+    const VkDeviceSize capacity = UPLOAD_STAGING_RING_SIZE;
+    const VkDeviceSize recordingStart = (manager->stagingHead + capacity - manager->recordingStagingSize) % capacity;
+    const VkDeviceSize position = (srcOffset + capacity - recordingStart) % capacity;
+    if (position >= manager->recordingStagingSize)
+    {
+        fprintf(stderr, "The upload from staging offset %llu is queued after its space has been handed to a submitted batch!\n", (unsigned long long)srcOffset);
+        return false;
+    }
+
+    const VkDeviceSize end = position >= manager->recordingLastAllocationPosition ? manager->recordingStagingSize :
+                                                                                    min(position + max(size, 1U), manager->recordingStagingSize);
+    manager->recordingQueuedSize = max(manager->recordingQueuedSize, end);
+    return true;
+}
+
+static UploadCopy* AddUploadCopy(UploadManager* manager, VkDeviceSize srcOffset, VkDeviceSize size)
+{
+    if (!MarkStagingQueued(manager, srcOffset, size)) return NULL;
+    if (manager->pendingCopyCount == MAX_UPLOAD_COPY_COUNT && !FlushUploadCopies(manager)) return NULL;
+    return &manager->pendingCopies[manager->pendingCopyCount++];
+}
+
+bool QueueBufferUpload(UploadManager* manager, VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize srcOffset, VkDeviceSize size)
+{
+    UploadCopy* copy = AddUploadCopy(manager, srcOffset, size);
+    if (copy == NULL) return false;
+
+    copy->dstBuffer = dstBuffer;
+    copy->dstImage = VK_NULL_HANDLE;
+    copy->bufferRegion = (VkBufferCopy){ .srcOffset = srcOffset, .dstOffset = dstOffset, .size = size };
+    return true;
+}
+
+bool QueueImageUpload(UploadManager* manager, VkImage dstImage, const VkBufferImageCopy* region)
+{
+    UploadCopy* copy = AddUploadCopy(manager, region->bufferOffset, 0);
+    if (copy == NULL) return false;
+
+    copy->dstBuffer = VK_NULL_HANDLE;
+    copy->dstImage = dstImage;
+    copy->imageRegion = *region;
+    return true;
+}
+
+void CompleteInlineUploads(UploadManager* manager)
+{
+    if (manager->timelineSemaphore != VK_NULL_HANDLE) return;
+
+    if (manager->recordingUploadSize > 0)
+    {
+        manager->statistics.completedSize += manager->recordingUploadSize;
+        manager->statistics.completedTime += GetCurrentTimeInMilliseconds() - manager->recordingStartTime;
+    }
+    manager->stagingHead = 0;
+    manager->stagingUsedSize = 0;
+    manager->recordingStagingSize = 0;
+    manager->recordingQueuedSize = 0;
+    manager->recordingLastAllocationPosition = 0;
+    manager->recordingUploadSize = 0;
+}
+
+void PrintUploadStatistics(UploadManager* manager)
+{
+    ReclaimStagingMemory(manager);
+
+    const double megabyte = 1024.0 * 1024.0;
+    const UploadStatistics* stats = &manager->statistics;
+    printf("Staging ring: %u allocation(s) of %.2f MB, peak %.2f of %.2f MB in use, %u stall(s), %u fallback(s); %u queued copies recorded in %u command(s)\n",
+        stats->allocationCount, (double)stats->allocatedSize / megabyte, (double)stats->peakUsedSize / megabyte, (double)UPLOAD_STAGING_RING_SIZE / megabyte,
+        stats->stallCount, stats->failedAllocationCount, stats->copyRegionCount, stats->copyCommandCount);
+    if (stats->completedTime > 0.0)
+    {
+        printf("Upload throughput: %.2f MB completed at %.1f MB/s, from the staging writes to the observed completion\n", (double)stats->completedSize / megabyte,
+            (double)stats->completedSize / megabyte / (stats->completedTime / 1000.0));
+    }
+}
+
+// Returns the slot of the acquire half when the upload queue family is not the graphics one, NULL if there is no need for an ownership transfer.
+// `outSucceeded` is false when every slot is taken.
+static UploadOwnershipTransfer* AddOwnershipTransfer(UploadManager* manager, VkPipelineStageFlags dstStageMask, bool* outSucceeded)
+{
+    *outSucceeded = true;
+    if (manager->queueFamilyIndex == manager->graphicsQueueFamilyIndex) return NULL;
+
+    if (manager->pendingTransferCount == MAX_UPLOAD_OWNERSHIP_TRANSFER_COUNT)
+    {
+        fprintf(stderr, "Too many queue family ownership transfers are waiting for their acquire barriers!\n");
+        *outSucceeded = false;
+        return NULL;
+    }
+
+    UploadOwnershipTransfer* transfer = &manager->pendingTransfers[manager->pendingTransferCount++];
+    transfer->batchValue = manager->lastSubmittedValue + 1U;
+    transfer->dstStageMask = dstStageMask;
+    return transfer;
+}
+
+bool ReleaseUploadedBuffer(UploadManager* manager, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, VkPipelineStageFlags dstStageMask,
+                        VkAccessFlags dstAccessMask)
+{
+    // The barrier has to follow the copies into the resource
+    if (!FlushUploadCopies(manager)) return false;
+    const VkCommandBuffer commandBuffer = BeginUploadBatch(manager, true);
+    if (commandBuffer == VK_NULL_HANDLE)
+    {
+        fprintf(stderr, "No upload batch can be recorded!\n");
+        return false;
+    }
+
+    bool succeeded;
+    UploadOwnershipTransfer* transfer = AddOwnershipTransfer(manager, dstStageMask, &succeeded);
+    if (!succeeded) return false;
+
+    // The destination access mask is ignored by a release, whose visibility operation is done by the acquire on the graphics queue
+    VkBufferMemoryBarrier bufferBarrier = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .pNext = NULL,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = transfer != NULL ? VK_ACCESS_NONE : dstAccessMask,
+        .srcQueueFamilyIndex = manager->queueFamilyIndex,
+        .dstQueueFamilyIndex = manager->graphicsQueueFamilyIndex,
+        .buffer = buffer,
+        .offset = offset,
+        .size = size
+    };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, transfer != NULL ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : dstStageMask, 0,
+                        0, NULL, 1, &bufferBarrier, 0, NULL);
+
+    if (transfer != NULL)
+    {
+        bufferBarrier.srcAccessMask = VK_ACCESS_NONE;
+        bufferBarrier.dstAccessMask = dstAccessMask;
+        transfer->isImage = false;
+        transfer->bufferBarrier = bufferBarrier;
+    }
+    return true;
+}
+
+bool ReleaseUploadedImage(UploadManager* manager, VkImage image, const VkImageSubresourceRange* subresourceRange, VkImageLayout oldLayout,
+                        VkImageLayout newLayout, VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask)
+{
+    // The barrier has to follow the copies into the resource
+    if (!FlushUploadCopies(manager)) return false;
+    const VkCommandBuffer commandBuffer = BeginUploadBatch(manager, true);
+    if (commandBuffer == VK_NULL_HANDLE)
+    {
+        fprintf(stderr, "No upload batch can be recorded!\n");
+        return false;
+    }
+
+    bool succeeded;
+    UploadOwnershipTransfer* transfer = AddOwnershipTransfer(manager, dstStageMask, &succeeded);
+    if (!succeeded) return false;
+
+    // The release and the acquire both name the same layouts, and the transition happens once between them
+    VkImageMemoryBarrier imageBarrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .pNext = NULL,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = transfer != NULL ? VK_ACCESS_NONE : dstAccessMask,
+        .oldLayout = oldLayout,
+        .newLayout = newLayout,
+        .srcQueueFamilyIndex = manager->queueFamilyIndex,
+        .dstQueueFamilyIndex = manager->graphicsQueueFamilyIndex,
+        .image = image,
+        .subresourceRange = *subresourceRange
+    };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, transfer != NULL ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : dstStageMask, 0,
+                        0, NULL, 0, NULL, 1, &imageBarrier);
+
+    if (transfer != NULL)
+    {
+        imageBarrier.srcAccessMask = VK_ACCESS_NONE;
+        imageBarrier.dstAccessMask = dstAccessMask;
+        transfer->isImage = true;
+        transfer->imageBarrier = imageBarrier;
+    }
+    return true;
+}
+
+void RecordUploadAcquireBarriers(UploadManager* manager, VkCommandBuffer commandBuffer, uint64_t batchValue)
+{
+    VkBufferMemoryBarrier bufferBarriers[MAX_UPLOAD_OWNERSHIP_TRANSFER_COUNT];
+    VkImageMemoryBarrier imageBarriers[MAX_UPLOAD_OWNERSHIP_TRANSFER_COUNT];
+    uint32_t bufferBarrierCount = 0;
+    uint32_t imageBarrierCount = 0;
+    uint32_t remainingCount = 0;
+    VkPipelineStageFlags dstStageMask = 0;
+
+    for (uint32_t i = 0; i < manager->pendingTransferCount; ++i)
+    {
+        const UploadOwnershipTransfer* transfer = &manager->pendingTransfers[i];
+        if (transfer->batchValue > batchValue)
+        {
+            manager->pendingTransfers[remainingCount++] = *transfer;
+            continue;
+        }
+
+        if (transfer->isImage) {
+            imageBarriers[imageBarrierCount++] = transfer->imageBarrier;
+        }
+        else {
+            bufferBarriers[bufferBarrierCount++] = transfer->bufferBarrier;
+        }
+        dstStageMask |= transfer->dstStageMask;
+    }
+    manager->pendingTransferCount = remainingCount;
+    if (bufferBarrierCount + imageBarrierCount == 0) return;
+
+    // The source stages are those of the destination, which the wait for the upload batch of the submission blocks
+    vkCmdPipelineBarrier(commandBuffer, dstStageMask, dstStageMask, 0, 0, NULL, bufferBarrierCount, bufferBarriers, imageBarrierCount, imageBarriers);
+    manager->ownershipTransferCount += bufferBarrierCount + imageBarrierCount;
+}
+
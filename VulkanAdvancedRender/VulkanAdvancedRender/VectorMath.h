@@ -0,0 +1,147 @@
+#pragma once
+
+#include <math.h>
+#include <string.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define USE_SSE_VECTOR_MATH     1
+#include <emmintrin.h>
+#else
+#define USE_SSE_VECTOR_MATH     0
+#endif
+
+#define MATH_PI     3.14159265358979323846f
+
+// 4x4 float matrix in the column major order of GLSL, so it can be copied into a uniform block as a `mat4` directly.
+// m[c][r] is the element at column `c` and row `r`. Vectors are column vectors, i.e. v' = M * v.
+typedef union Mat4
+{
+    float m[4][4];
+#if USE_SSE_VECTOR_MATH
+    __m128 columns[4];
+#endif
+} Mat4;
+
+static inline float DegreesToRadians(float degrees)
+{
+    return degrees * (MATH_PI / 180.0f);
+}
+
+static inline Mat4 Mat4Identity(void)
+{
+    const Mat4 result = { .m = {
+        { 1.0f, 0.0f, 0.0f, 0.0f },
+        { 0.0f, 1.0f, 0.0f, 0.0f },
+        { 0.0f, 0.0f, 1.0f, 0.0f },
+        { 0.0f, 0.0f, 0.0f, 1.0f }
+    } };
+    return result;
+}
+
+// Returns a * b
+static inline Mat4 Mat4Multiply(const Mat4* a, const Mat4* b)
+{
+    Mat4 result;
+#if USE_SSE_VECTOR_MATH
+    // Column j of the result is the linear combination of the columns of `a` weighted by column j of `b`
+    for (int j = 0; j < 4; ++j)
+    {
+        __m128 column = _mm_mul_ps(a->columns[0], _mm_set1_ps(b->m[j][0]));
+        column = _mm_add_ps(column, _mm_mul_ps(a->columns[1], _mm_set1_ps(b->m[j][1])));
+        column = _mm_add_ps(column, _mm_mul_ps(a->columns[2], _mm_set1_ps(b->m[j][2])));
+        column = _mm_add_ps(column, _mm_mul_ps(a->columns[3], _mm_set1_ps(b->m[j][3])));
+        result.columns[j] = column;
+    }
+#else
+    for (int j = 0; j < 4; ++j)
+    {
+        for (int i = 0; i < 4; ++i) {
+            result.m[j][i] = a->m[0][i] * b->m[j][0] + a->m[1][i] * b->m[j][1] + a->m[2][i] * b->m[j][2] + a->m[3][i] * b->m[j][3];
+        }
+    }
+#endif
+    return result;
+}
+
+// glTranslate(x, y, z)
+static inline Mat4 Mat4Translate(float x, float y, float z)
+{
+    Mat4 result = Mat4Identity();
+    result.m[3][0] = x;
+    result.m[3][1] = y;
+    result.m[3][2] = z;
+    return result;
+}
+
+// glRotate(radian, 1.0, 0.0, 0.0)
+static inline Mat4 Mat4RotateX(float radian)
+{
+    const float c = cosf(radian);
+    const float s = sinf(radian);
+    Mat4 result = Mat4Identity();
+    result.m[1][1] = c;
+    result.m[1][2] = s;
+    result.m[2][1] = -s;
+    result.m[2][2] = c;
+    return result;
+}
+
+// glRotate(radian, 0.0, 1.0, 0.0)
+static inline Mat4 Mat4RotateY(float radian)
+{
+    const float c = cosf(radian);
+    const float s = sinf(radian);
+    Mat4 result = Mat4Identity();
+    result.m[0][0] = c;
+    result.m[0][2] = -s;
+    result.m[2][0] = s;
+    result.m[2][2] = c;
+    return result;
+}
+
+// glRotate(radian, 0.0, 0.0, 1.0)
+static inline Mat4 Mat4RotateZ(float radian)
+{
+    const float c = cosf(radian);
+    const float s = sinf(radian);
+    Mat4 result = Mat4Identity();
+    result.m[0][0] = c;
+    result.m[0][1] = s;
+    result.m[1][0] = -s;
+    result.m[1][1] = c;
+    return result;
+}
+
+// glOrtho(left, right, bottom, top, near, far)
+static inline Mat4 Mat4Ortho(float left, float right, float bottom, float top, float nearZ, float farZ)
+{
+    Mat4 result = Mat4Identity();
+    result.m[0][0] = 2.0f / (right - left);
+    result.m[1][1] = 2.0f / (top - bottom);
+    result.m[2][2] = -2.0f / (farZ - nearZ);
+    result.m[3][0] = -(right + left) / (right - left);
+    result.m[3][1] = -(top + bottom) / (top - bottom);
+    result.m[3][2] = -(farZ + nearZ) / (farZ - nearZ);
+    return result;
+}
+
+// Builds projection * translation * rotation, i.e. the object is rotated around its own origin first.
+static inline Mat4 Mat4ModelViewProjection(const Mat4* projection, const Mat4* translation, const Mat4* rotation)
+{
+    const Mat4 modelView = Mat4Multiply(translation, rotation);
+    return Mat4Multiply(projection, &modelView);
+}
+
+// `dst` needs no particular alignment, e.g. an element of a mapped uniform buffer
+static inline void Mat4Store(float dst[16], const Mat4* src)
+{
+#if USE_SSE_VECTOR_MATH
+    _mm_storeu_ps(&dst[0], src->columns[0]);
+    _mm_storeu_ps(&dst[4], src->columns[1]);
+    _mm_storeu_ps(&dst[8], src->columns[2]);
+    _mm_storeu_ps(&dst[12], src->columns[3]);
+#else
+    memcpy(dst, src->m, sizeof(src->m));
+#endif
+}
+
@@ -0,0 +1,1171 @@
+#include "common.h"
+
+enum
+{
+    VERTEX_BENCHMARK_LEGACY_VARIANT,            // translate, rotate and ortho matrices rebuilt per vertex
+    VERTEX_BENCHMARK_MVP_VARIANT,               // model-view-projection matrix built on the CPU
+    VERTEX_BENCHMARK_VARIANT_COUNT,
+
+    VERTEX_BENCHMARK_RUN_COUNT = 5,
+
+    INDEX_ORDER_GENERATED_VARIANT = 0,          // row after row, as the sphere is generated
+    INDEX_ORDER_SHUFFLED_VARIANT,               // the triangles in random order, like a mesh from a tool that does not care
+    INDEX_ORDER_OPTIMIZED_VARIANT,              // the shuffled triangles reordered for the vertex cache, and the vertices for the fetch
+    INDEX_ORDER_VARIANT_COUNT,
+
+    // The sphere of the index order benchmark, large enough that its rows do not fit in the vertex cache
+    INDEX_BENCHMARK_SPHERE_SLICE_COUNT = 256,
+    INDEX_BENCHMARK_SPHERE_STACK_COUNT = 128,
+    // The copies of the sphere are laid out in a square grid of this many columns
+    INDEX_BENCHMARK_GRID_SIZE = 16,
+
+    VERTEX_FETCH_ALL_ATTRIBUTES_PASS = 0,       // position, color and texture coordinates, like a shading pass
+    VERTEX_FETCH_POSITION_PASS,                 // the position only, like a depth only or shadow pass
+    VERTEX_FETCH_PASS_COUNT
+};
+
+// Must be coherent with `transform_block` in vertbench_legacy.vert.glsl
+typedef struct LegacyTransformConstants
+{
+    float u_factor[2];
+    float u_angle;
+} LegacyTransformConstants;
+
+// The vertex streams, and the indices of an indexed draw, of a benchmark draw in one buffer
+typedef struct BenchmarkGeometry
+{
+    VkBuffer buffer;
+    uint32_t streamCount;
+    VkDeviceSize streamOffsets[MAX_VERTEX_STREAM_COUNT];
+    bool isIndexed;
+    VkDeviceSize indexOffset;
+    uint32_t instanceCount;
+} BenchmarkGeometry;
+
+static VkPipeline CreateVertexBenchmarkPipeline(VkDevice specDevice, const char* vertSPVFilePath, const char* fragSPVFilePath,
+                                                const VkPipelineVertexInputStateCreateInfo* vertexInputState, VkPipelineLayout pipelineLayout,
+                                                const RenderTarget* renderTarget, VkPipelineCache pipelineCache)
+{
+    VkShaderModule vertexShaderModule = VK_NULL_HANDLE;
+    VkShaderModule fragmentShaderModule = VK_NULL_HANDLE;
+    VkPipeline dstPipeline = VK_NULL_HANDLE;
+    VkResult res = VK_ERROR_INITIALIZATION_FAILED;
+
+    do
+    {
+        if (!CreateShaderModule(vertSPVFilePath, &vertexShaderModule)) break;
+        if (!CreateShaderModule(fragSPVFilePath, &fragmentShaderModule)) break;
+
+        // two shader stages
+        const VkPipelineShaderStageCreateInfo shaderStages[] = {
+            // vertex shader
+            {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .pNext = NULL,
+                .flags = 0,
+                .stage = VK_SHADER_STAGE_VERTEX_BIT,
+                .module = vertexShaderModule,
+                .pName = "main",
+                .pSpecializationInfo = NULL
+            },
+            // fragment shader
+            {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .pNext = NULL,
+                .flags = 0,
+                .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+                .module = fragmentShaderModule,
+                .pName = "main",
+                .pSpecializationInfo = NULL
+            }
+        };
+
+        const VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+            .primitiveRestartEnable = VK_FALSE
+        };
+
+        const VkPipelineViewportStateCreateInfo viewportStateCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .viewportCount = 1,
+            .pViewports = NULL,     // As the viewport state is dynamic, this member is ignored.
+            .scissorCount = 1,
+            .pScissors = NULL       // As the scissor state is dynamic, this member is ignored.
+        };
+
+        const VkPipelineRasterizationStateCreateInfo rasterizationStateCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .depthClampEnable = VK_FALSE,
+            .rasterizerDiscardEnable = VK_FALSE,
+            .polygonMode = VK_POLYGON_MODE_FILL,
+            .cullMode = VK_CULL_MODE_BACK_BIT,
+            .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+            .depthBiasEnable = VK_FALSE,
+            .depthBiasConstantFactor = 0.0f,
+            .depthBiasClamp = 1.0f,
+            .depthBiasSlopeFactor = 0.0f,
+            .lineWidth = 1.0f,
+        };
+
+        const VkPipelineMultisampleStateCreateInfo multisampleStateCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .rasterizationSamples = renderTarget->sampleCount,
+            .sampleShadingEnable = VK_FALSE,
+            .minSampleShading = 0.0f,
+            .pSampleMask = NULL,
+            .alphaToCoverageEnable = VK_FALSE,
+            .alphaToOneEnable = VK_FALSE
+        };
+
+        const VkStencilOpState stencilOpState = {
+            .failOp = VK_STENCIL_OP_KEEP,
+            .passOp = VK_STENCIL_OP_KEEP,
+            .depthFailOp = VK_STENCIL_OP_KEEP,
+            .compareOp = VK_COMPARE_OP_ALWAYS,
+            .compareMask = 0,
+            .writeMask = 0,
+            .reference = 0
+        };
+
+        const VkPipelineDepthStencilStateCreateInfo depthStencilStateCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .depthTestEnable = VK_FALSE,
+            .depthWriteEnable = VK_FALSE,
+            .depthCompareOp = VK_COMPARE_OP_ALWAYS,
+            .depthBoundsTestEnable = VK_FALSE,
+            .stencilTestEnable = VK_FALSE,
+            .front = stencilOpState,
+            .back = stencilOpState,
+            .minDepthBounds = 0.0f,
+            .maxDepthBounds = 0.0f
+        };
+
+        const VkPipelineColorBlendAttachmentState attatchmentStates[1] = {
+            {
+                .blendEnable = VK_FALSE,
+                .srcColorBlendFactor = VK_BLEND_FACTOR_ZERO,
+                .dstColorBlendFactor = VK_BLEND_FACTOR_ZERO,
+                .colorBlendOp = VK_BLEND_OP_ADD,
+                .srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+                .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+                .alphaBlendOp = VK_BLEND_OP_ADD,
+                .colorWriteMask = 0x0fU
+            }
+        };
+
+        const VkPipelineColorBlendStateCreateInfo colorBlendStateCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .logicOpEnable = VK_FALSE,
+            .logicOp = VK_LOGIC_OP_CLEAR,
+            .attachmentCount = (uint32_t)(sizeof(attatchmentStates) / sizeof(attatchmentStates[0])),
+            .pAttachments = attatchmentStates,
+            .blendConstants = { 0.0f }
+        };
+
+        const VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .dynamicStateCount = 2U,
+            .pDynamicStates = (VkDynamicState[]) { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR }
+        };
+
+        VkPipelineRenderingCreateInfoKHR renderingCreateInfo;
+        const VkGraphicsPipelineCreateInfo pipelineCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+            .pNext = PrepareRenderTargetPipelineInfo(renderTarget, &renderingCreateInfo, NULL),
+            .stageCount = (uint32_t)(sizeof(shaderStages) / sizeof(shaderStages[0])),
+            .pStages = shaderStages,
+            .pVertexInputState = vertexInputState,
+            .pInputAssemblyState = &inputAssemblyStateCreateInfo,
+            .pTessellationState = NULL,
+            .pViewportState = &viewportStateCreateInfo,
+            .pRasterizationState = &rasterizationStateCreateInfo,
+            .pMultisampleState = &multisampleStateCreateInfo,
+            .pDepthStencilState = &depthStencilStateCreateInfo,
+            .pColorBlendState = &colorBlendStateCreateInfo,
+            .pDynamicState = &dynamicStateCreateInfo,
+            .layout = pipelineLayout,
+            .renderPass = renderTarget->renderPass,
+            .subpass = 0,
+            .basePipelineHandle = VK_NULL_HANDLE,
+            .basePipelineIndex = 0
+        };
+
+        res = vkCreateGraphicsPipelines(specDevice, pipelineCache, 1, &pipelineCreateInfo, NULL, &dstPipeline);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreateGraphicsPipelines for %s failed: %d\n", vertSPVFilePath, res);
+            break;
+        }
+    }
+    while (false);
+
+    if (vertexShaderModule != VK_NULL_HANDLE) {
+        vkDestroyShaderModule(specDevice, vertexShaderModule, NULL);
+    }
+    if (fragmentShaderModule != VK_NULL_HANDLE) {
+        vkDestroyShaderModule(specDevice, fragmentShaderModule, NULL);
+    }
+
+    if (res == VK_SUCCESS) {
+        return dstPipeline;
+    }
+
+    if (dstPipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(specDevice, dstPipeline, NULL);
+    }
+
+    return VK_NULL_HANDLE;
+}
+
+// Records and submits one draw of `vertexCount` vertices between two timestamps, and returns its GPU time in milliseconds, or -1 on failure.
+// With `geometry`, the vertices are fetched from its buffer, and for an indexed one `vertexCount` is the index count.
+// Otherwise the vertex shader generates the vertices.
+static double MeasureVertexBenchmarkDraw(VkDevice specDevice, VkQueue queue, VkCommandBuffer cmdBuf, VkFence fence, VkQueryPool queryPool,
+                                        const RenderTarget* renderTarget, VkPipelineLayout pipelineLayout,
+                                        VkPipeline pipeline, const void* pushConstants, uint32_t pushConstantsSize, uint32_t vertexCount,
+                                        const BenchmarkGeometry* geometry, float timestampPeriod)
+{
+    const VkCommandBufferBeginInfo beginInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = NULL,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = NULL
+    };
+    VkResult res = vkBeginCommandBuffer(cmdBuf, &beginInfo);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkBeginCommandBuffer for the vertex benchmark failed: %d\n", res);
+        return -1.0;
+    }
+
+    vkCmdResetQueryPool(cmdBuf, queryPool, 0, 2);
+    vkCmdWriteTimestamp(cmdBuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0);
+
+    // This `clearValues` MUST BE coherent with the attachments in renderpass creation.
+    const VkClearValue clearValues[] = {
+        { .color.float32 = { 0.4f, 0.5f, 0.4f, 1.0f } },
+        { .depthStencil = { .depth = 1.0f, .stencil = 0 } }
+    };
+    BeginRenderTarget(cmdBuf, renderTarget, clearValues);
+
+    const VkExtent2D extent = renderTarget->extent;
+    const VkViewport viewport = {
+        .x = 0.0f,
+        .y = 0.0f,
+        .width = (float)extent.width,
+        .height = (float)extent.height,
+        .minDepth = 0.0f,
+        .maxDepth = 1.0f
+    };
+    vkCmdSetViewport(cmdBuf, 0, 1, &viewport);
+
+    const VkRect2D scissor = {
+        .offset = { .x = 0, .y = 0 },
+        .extent = extent
+    };
+    vkCmdSetScissor(cmdBuf, 0, 1, &scissor);
+
+    vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    vkCmdPushConstants(cmdBuf, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, pushConstantsSize, pushConstants);
+    if (geometry != NULL)
+    {
+        const VkBuffer vertexBuffers[MAX_VERTEX_STREAM_COUNT] = { geometry->buffer, geometry->buffer, geometry->buffer };
+        vkCmdBindVertexBuffers(cmdBuf, 0, geometry->streamCount, vertexBuffers, geometry->streamOffsets);
+    }
+    if (geometry != NULL && geometry->isIndexed)
+    {
+        vkCmdBindIndexBuffer(cmdBuf, geometry->buffer, geometry->indexOffset, VK_INDEX_TYPE_UINT32);
+        vkCmdDrawIndexed(cmdBuf, vertexCount, geometry->instanceCount, 0, 0, 0);
+    }
+    else {
+        vkCmdDraw(cmdBuf, vertexCount, geometry != NULL ? geometry->instanceCount : 1U, 0, 0);
+    }
+
+    EndRenderTarget(cmdBuf, renderTarget);
+
+    vkCmdWriteTimestamp(cmdBuf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1);
+
+    res = vkEndCommandBuffer(cmdBuf);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkEndCommandBuffer for the vertex benchmark failed: %d\n", res);
+        return -1.0;
+    }
+
+    const VkSubmitInfo submitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = NULL,
+        .waitSemaphoreCount = 0,
+        .pWaitSemaphores = NULL,
+        .pWaitDstStageMask = NULL,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &cmdBuf,
+        .signalSemaphoreCount = 0,
+        .pSignalSemaphores = NULL
+    };
+    res = vkQueueSubmit(queue, 1, &submitInfo, fence);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkQueueSubmit for the vertex benchmark failed: %d\n", res);
+        return -1.0;
+    }
+
+    vkWaitForFences(specDevice, 1, &fence, VK_TRUE, UINT64_MAX);
+    vkResetFences(specDevice, 1, &fence);
+
+    uint64_t timestamps[2] = { 0 };
+    res = vkGetQueryPoolResults(specDevice, queryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(timestamps[0]), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkGetQueryPoolResults for the vertex benchmark failed: %d\n", res);
+        return -1.0;
+    }
+
+    return (double)(timestamps[1] - timestamps[0]) * (double)timestampPeriod / 1000000.0;
+}
+
+bool RunVertexThroughputBenchmark(VkDevice specDevice, VkQueue queue, VkCommandPool commandPool, const RenderTarget* renderTarget,
+                                VkPipelineCache pipelineCache, float timestampPeriod, uint32_t vertexCount)
+{
+    // Whole triangles only
+    vertexCount = max(vertexCount / 3U, 1U) * 3U;
+
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline pipelines[VERTEX_BENCHMARK_VARIANT_COUNT] = { VK_NULL_HANDLE };
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    VkCommandBuffer cmdBuf = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE;
+    bool succeeded = false;
+
+    do
+    {
+        // Large enough for both the legacy transform constants and a mat4
+        const VkPushConstantRange pushConstantRange = {
+            .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+            .offset = 0,
+            .size = sizeof(float[16])
+        };
+        const VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+            .pNext = NULL,
+            .setLayoutCount = 0,
+            .pSetLayouts = NULL,
+            .pushConstantRangeCount = 1,
+            .pPushConstantRanges = &pushConstantRange
+        };
+        VkResult res = vkCreatePipelineLayout(specDevice, &pipelineLayoutCreateInfo, NULL, &pipelineLayout);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreatePipelineLayout for the vertex benchmark failed: %d\n", res);
+            break;
+        }
+
+        // The vertex positions are generated from gl_VertexIndex, so that only the transform is measured.
+        const VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .vertexBindingDescriptionCount = 0,
+            .pVertexBindingDescriptions = NULL,
+            .vertexAttributeDescriptionCount = 0,
+            .pVertexAttributeDescriptions = NULL
+        };
+
+        pipelines[VERTEX_BENCHMARK_LEGACY_VARIANT] = CreateVertexBenchmarkPipeline(specDevice, "shaders/vertbench_legacy.vert.spv", "shaders/flatten.frag.spv",
+                                                                                &vertexInputStateCreateInfo, pipelineLayout, renderTarget, pipelineCache);
+        if (pipelines[VERTEX_BENCHMARK_LEGACY_VARIANT] == VK_NULL_HANDLE) break;
+
+        pipelines[VERTEX_BENCHMARK_MVP_VARIANT] = CreateVertexBenchmarkPipeline(specDevice, "shaders/vertbench_mvp.vert.spv", "shaders/flatten.frag.spv",
+                                                                            &vertexInputStateCreateInfo, pipelineLayout, renderTarget, pipelineCache);
+        if (pipelines[VERTEX_BENCHMARK_MVP_VARIANT] == VK_NULL_HANDLE) break;
+
+        const VkQueryPoolCreateInfo queryPoolCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .queryType = VK_QUERY_TYPE_TIMESTAMP,
+            .queryCount = 2,
+            .pipelineStatistics = 0
+        };
+        res = vkCreateQueryPool(specDevice, &queryPoolCreateInfo, NULL, &queryPool);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreateQueryPool for the vertex benchmark failed: %d\n", res);
+            break;
+        }
+
+        const VkCommandBufferAllocateInfo cmdBufAllocInfo = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .pNext = NULL,
+            .commandPool = commandPool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1
+        };
+        res = vkAllocateCommandBuffers(specDevice, &cmdBufAllocInfo, &cmdBuf);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkAllocateCommandBuffers for the vertex benchmark failed: %d\n", res);
+            break;
+        }
+
+        const VkFenceCreateInfo fenceCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0
+        };
+        res = vkCreateFence(specDevice, &fenceCreateInfo, NULL, &fence);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreateFence for the vertex benchmark failed: %d\n", res);
+            break;
+        }
+
+        // Both variants produce the same positions as the flatten draw at 30 degrees
+        const float angle = 30.0f;
+        const LegacyTransformConstants legacyConstants = {
+            .u_factor = { 1.0f, 1.0f },
+            .u_angle = angle
+        };
+
+        const Mat4 projection = Mat4Ortho(-1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 3.0f);
+        const Mat4 translation = Mat4Translate(-0.6f, -0.6f, -2.3f);
+        const Mat4 rotation = Mat4RotateY(DegreesToRadians(angle));
+        const Mat4 mvp = Mat4ModelViewProjection(&projection, &translation, &rotation);
+        float mvpConstants[16];
+        Mat4Store(mvpConstants, &mvp);
+
+        const void* const pushConstants[VERTEX_BENCHMARK_VARIANT_COUNT] = { &legacyConstants, mvpConstants };
+        const uint32_t pushConstantsSizes[VERTEX_BENCHMARK_VARIANT_COUNT] = { (uint32_t)sizeof(legacyConstants), (uint32_t)sizeof(mvpConstants) };
+
+        // Alternate the variants and keep the best time of each, which filters out clock ramp-up and other noise.
+        double bestTimes[VERTEX_BENCHMARK_VARIANT_COUNT] = { -1.0, -1.0 };
+        bool measured = true;
+        for (uint32_t run = 0; run < VERTEX_BENCHMARK_RUN_COUNT && measured; ++run)
+        {
+            for (uint32_t variant = 0; variant < VERTEX_BENCHMARK_VARIANT_COUNT; ++variant)
+            {
+                const double gpuTime = MeasureVertexBenchmarkDraw(specDevice, queue, cmdBuf, fence, queryPool, renderTarget, pipelineLayout,
+                                                                pipelines[variant], pushConstants[variant], pushConstantsSizes[variant], vertexCount, NULL, timestampPeriod);
+                if (gpuTime < 0.0)
+                {
+                    measured = false;
+                    break;
+                }
+                if (bestTimes[variant] < 0.0 || gpuTime < bestTimes[variant]) {
+                    bestTimes[variant] = gpuTime;
+                }
+            }
+        }
+        if (!measured) break;
+
+        const double legacyTime = bestTimes[VERTEX_BENCHMARK_LEGACY_VARIANT];
+        const double mvpTime = bestTimes[VERTEX_BENCHMARK_MVP_VARIANT];
+        printf("Vertex throughput benchmark: %u vertices per draw, best of %d runs\n", vertexCount, VERTEX_BENCHMARK_RUN_COUNT);
+        printf("  per-vertex transform matrices: %.3f ms, %.1f Mvertices/s\n", legacyTime, legacyTime > 0.0 ? vertexCount / (legacyTime * 1000.0) : 0.0);
+        printf("  CPU-built MVP matrix:          %.3f ms, %.1f Mvertices/s (%.2fx)\n", mvpTime, mvpTime > 0.0 ? vertexCount / (mvpTime * 1000.0) : 0.0,
+            mvpTime > 0.0 ? legacyTime / mvpTime : 0.0);
+
+        succeeded = true;
+    }
+    while (false);
+
+    if (fence != VK_NULL_HANDLE) {
+        vkDestroyFence(specDevice, fence, NULL);
+    }
+    if (cmdBuf != VK_NULL_HANDLE) {
+        vkFreeCommandBuffers(specDevice, commandPool, 1, &cmdBuf);
+    }
+    if (queryPool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(specDevice, queryPool, NULL);
+    }
+    for (int i = 0; i < VERTEX_BENCHMARK_VARIANT_COUNT; ++i)
+    {
+        if (pipelines[i] != VK_NULL_HANDLE) {
+            vkDestroyPipeline(specDevice, pipelines[i], NULL);
+        }
+    }
+    if (pipelineLayout != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(specDevice, pipelineLayout, NULL);
+    }
+
+    return succeeded;
+}
+
+static bool CreateBenchmarkBuffer(VkDevice specDevice, VkDeviceSize size, VkBufferUsageFlags usage, DeviceMemoryUsage memoryUsage,
+                                VkBuffer* outBuffer, DeviceMemoryAllocation* outMemory)
+{
+    const VkBufferCreateInfo bufferCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .size = size,
+        .usage = usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 0,
+        .pQueueFamilyIndices = NULL
+    };
+    const VkResult res = vkCreateBuffer(specDevice, &bufferCreateInfo, NULL, outBuffer);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkCreateBuffer for a benchmark buffer failed: %d\n", res);
+        return false;
+    }
+
+    if (!AllocateAndBindBufferMemory(*outBuffer, memoryUsage, outMemory))
+    {
+        fprintf(stderr, "Allocating the memory for a benchmark buffer failed!\n");
+        return false;
+    }
+
+    return true;
+}
+
+// Copies the first `size` bytes of `stagingBuffer` into `dstBuffer` and waits until they can be fetched as vertices and indices.
+// `fence` is left unsignaled.
+static bool UploadBenchmarkBuffer(VkDevice specDevice, VkQueue queue, VkCommandBuffer cmdBuf, VkFence fence, VkBuffer stagingBuffer, VkBuffer dstBuffer,
+                                VkDeviceSize size)
+{
+    const VkCommandBufferBeginInfo beginInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = NULL,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = NULL
+    };
+    VkResult res = vkBeginCommandBuffer(cmdBuf, &beginInfo);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkBeginCommandBuffer for a benchmark upload failed: %d\n", res);
+        return false;
+    }
+
+    const VkBufferCopy copyRegion = {
+        .srcOffset = 0,
+        .dstOffset = 0,
+        .size = size
+    };
+    vkCmdCopyBuffer(cmdBuf, stagingBuffer, dstBuffer, 1, &copyRegion);
+
+    const VkBufferMemoryBarrier bufferBarrier = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .pNext = NULL,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer = dstBuffer,
+        .offset = 0,
+        .size = VK_WHOLE_SIZE
+    };
+    vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 0, NULL, 1, &bufferBarrier, 0, NULL);
+
+    res = vkEndCommandBuffer(cmdBuf);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkEndCommandBuffer for a benchmark upload failed: %d\n", res);
+        return false;
+    }
+
+    const VkSubmitInfo submitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = NULL,
+        .waitSemaphoreCount = 0,
+        .pWaitSemaphores = NULL,
+        .pWaitDstStageMask = NULL,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &cmdBuf,
+        .signalSemaphoreCount = 0,
+        .pSignalSemaphores = NULL
+    };
+    res = vkQueueSubmit(queue, 1, &submitInfo, fence);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkQueueSubmit for a benchmark upload failed: %d\n", res);
+        return false;
+    }
+    vkWaitForFences(specDevice, 1, &fence, VK_TRUE, UINT64_MAX);
+    vkResetFences(specDevice, 1, &fence);
+
+    return true;
+}
+
+// Fisher-Yates over whole triangles with a fixed seed, so that every run measures the same order
+static void ShuffleTriangles(uint32_t* indices, uint32_t triangleCount)
+{
+    uint32_t state = 0x9e3779b9U;
+    for (uint32_t i = triangleCount; i > 1; --i)
+    {
+        // xorshift32
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+
+        const uint32_t j = state % i;
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            const uint32_t index = indices[(i - 1) * 3U + k];
+            indices[(i - 1) * 3U + k] = indices[j * 3U + k];
+            indices[j * 3U + k] = index;
+        }
+    }
+}
+
+bool RunIndexOrderBenchmark(VkDevice specDevice, VkQueue queue, VkCommandPool commandPool, const RenderTarget* renderTarget,
+                            VkPipelineCache pipelineCache, float timestampPeriod, uint32_t instanceCount)
+{
+    instanceCount = max(instanceCount, 1U);
+
+    IndexedMesh meshes[INDEX_ORDER_VARIANT_COUNT] = { 0 };
+    VertexCacheStatistics cacheStats[INDEX_ORDER_VARIANT_COUNT] = { 0 };
+    VkDeviceSize vertexOffsets[INDEX_ORDER_VARIANT_COUNT] = { 0 };
+    VkDeviceSize indexOffsets[INDEX_ORDER_VARIANT_COUNT] = { 0 };
+    VkBuffer geometryBuffer = VK_NULL_HANDLE;
+    DeviceMemoryAllocation geometryMemory = { 0 };
+    VkBuffer stagingBuffer = VK_NULL_HANDLE;
+    DeviceMemoryAllocation stagingMemory = { 0 };
+    uint32_t* optimizedIndices = NULL;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    VkCommandBuffer cmdBuf = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE;
+    bool succeeded = false;
+
+    do
+    {
+        // The copies are spread over a grid of cells 2 / INDEX_BENCHMARK_GRID_SIZE wide
+        const float radius = 0.8f / (float)INDEX_BENCHMARK_GRID_SIZE;
+        bool meshesCreated = true;
+        for (int i = 0; i < INDEX_ORDER_VARIANT_COUNT && meshesCreated; ++i) {
+            meshesCreated = CreateSphereMesh(INDEX_BENCHMARK_SPHERE_SLICE_COUNT, INDEX_BENCHMARK_SPHERE_STACK_COUNT, radius, &meshes[i]);
+        }
+        if (!meshesCreated) break;
+
+        const uint32_t indexCount = meshes[INDEX_ORDER_GENERATED_VARIANT].indexCount;
+        ShuffleTriangles(meshes[INDEX_ORDER_SHUFFLED_VARIANT].indices, indexCount / 3U);
+        ShuffleTriangles(meshes[INDEX_ORDER_OPTIMIZED_VARIANT].indices, indexCount / 3U);
+
+        IndexedMesh* optimizedMesh = &meshes[INDEX_ORDER_OPTIMIZED_VARIANT];
+        optimizedIndices = malloc(indexCount * sizeof(*optimizedIndices));
+        if (optimizedIndices == NULL)
+        {
+            fprintf(stderr, "Failed to allocate the optimized indices of the index order benchmark!\n");
+            break;
+        }
+        const double startTime = GetCurrentTimeInMilliseconds();
+        if (!OptimizeVertexCache(optimizedIndices, optimizedMesh->indices, indexCount, optimizedMesh->vertexCount)) break;
+        free(optimizedMesh->indices);
+        optimizedMesh->indices = optimizedIndices;
+        optimizedIndices = NULL;
+        if (!OptimizeVertexFetch(optimizedMesh)) break;
+        const double optimizeTime = GetCurrentTimeInMilliseconds() - startTime;
+
+        // The vertices and the indices of all the variants live in one buffer, every array 4 byte aligned.
+        VkDeviceSize geometrySize = 0;
+        for (int i = 0; i < INDEX_ORDER_VARIANT_COUNT; ++i)
+        {
+            cacheStats[i] = AnalyzeVertexCache(meshes[i].indices, meshes[i].indexCount, meshes[i].vertexCount, VERTEX_CACHE_ANALYSIS_SIZE);
+
+            vertexOffsets[i] = geometrySize;
+            geometrySize += (VkDeviceSize)meshes[i].vertexCount * sizeof(*meshes[i].vertices);
+            indexOffsets[i] = geometrySize;
+            geometrySize += (VkDeviceSize)meshes[i].indexCount * sizeof(*meshes[i].indices);
+        }
+
+        // The geometry lives in device local memory, so that the draws measure the vertex cache rather than the bus.
+        if (!CreateBenchmarkBuffer(specDevice, geometrySize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                DEVICE_MEMORY_USAGE_GPU_ONLY, &geometryBuffer, &geometryMemory)) {
+            break;
+        }
+        if (!CreateBenchmarkBuffer(specDevice, geometrySize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, DEVICE_MEMORY_USAGE_STAGING_UPLOAD,
+                                &stagingBuffer, &stagingMemory)) {
+            break;
+        }
+        uint8_t* stagingData = stagingMemory.mappedData;
+        for (int i = 0; i < INDEX_ORDER_VARIANT_COUNT; ++i)
+        {
+            memcpy(&stagingData[vertexOffsets[i]], meshes[i].vertices, meshes[i].vertexCount * sizeof(*meshes[i].vertices));
+            memcpy(&stagingData[indexOffsets[i]], meshes[i].indices, meshes[i].indexCount * sizeof(*meshes[i].indices));
+        }
+
+        const VkPushConstantRange pushConstantRange = {
+            .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+            .offset = 0,
+            .size = sizeof(float[16])
+        };
+        const VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+            .pNext = NULL,
+            .setLayoutCount = 0,
+            .pSetLayouts = NULL,
+            .pushConstantRangeCount = 1,
+            .pPushConstantRanges = &pushConstantRange
+        };
+        VkResult res = vkCreatePipelineLayout(specDevice, &pipelineLayoutCreateInfo, NULL, &pipelineLayout);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreatePipelineLayout for the index order benchmark failed: %d\n", res);
+            break;
+        }
+
+        // Only the positions are fetched
+        const VkVertexInputBindingDescription vertexInputBinding = {
+            .binding = 0,
+            .stride = sizeof(MeshVertex),
+            .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
+        };
+        const VkVertexInputAttributeDescription vertexInputAttribute = {
+            .location = 0,
+            .binding = 0,
+            .format = VK_FORMAT_R32G32B32_SFLOAT,
+            .offset = (uint32_t)offsetof(MeshVertex, position)
+        };
+        const VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .vertexBindingDescriptionCount = 1,
+            .pVertexBindingDescriptions = &vertexInputBinding,
+            .vertexAttributeDescriptionCount = 1,
+            .pVertexAttributeDescriptions = &vertexInputAttribute
+        };
+
+        pipeline = CreateVertexBenchmarkPipeline(specDevice, "shaders/vertbench_indexed.vert.spv", "shaders/flatten.frag.spv",
+                                                &vertexInputStateCreateInfo, pipelineLayout, renderTarget, pipelineCache);
+        if (pipeline == VK_NULL_HANDLE) break;
+
+        const VkQueryPoolCreateInfo queryPoolCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .queryType = VK_QUERY_TYPE_TIMESTAMP,
+            .queryCount = 2,
+            .pipelineStatistics = 0
+        };
+        res = vkCreateQueryPool(specDevice, &queryPoolCreateInfo, NULL, &queryPool);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreateQueryPool for the index order benchmark failed: %d\n", res);
+            break;
+        }
+
+        const VkCommandBufferAllocateInfo cmdBufAllocInfo = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .pNext = NULL,
+            .commandPool = commandPool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1
+        };
+        res = vkAllocateCommandBuffers(specDevice, &cmdBufAllocInfo, &cmdBuf);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkAllocateCommandBuffers for the index order benchmark failed: %d\n", res);
+            break;
+        }
+
+        const VkFenceCreateInfo fenceCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0
+        };
+        res = vkCreateFence(specDevice, &fenceCreateInfo, NULL, &fence);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreateFence for the index order benchmark failed: %d\n", res);
+            break;
+        }
+
+        // Upload the geometry of all the variants once
+        if (!UploadBenchmarkBuffer(specDevice, queue, cmdBuf, fence, stagingBuffer, geometryBuffer, geometrySize)) break;
+
+        const Mat4 projection = Mat4Ortho(-1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 3.0f);
+        const Mat4 translation = Mat4Translate(0.0f, 0.0f, -2.0f);
+        const Mat4 mvp = Mat4Multiply(&projection, &translation);
+        float mvpConstants[16];
+        Mat4Store(mvpConstants, &mvp);
+
+        // Alternate the variants and keep the best time of each, which filters out clock ramp-up and other noise.
+        double bestTimes[INDEX_ORDER_VARIANT_COUNT] = { -1.0, -1.0, -1.0 };
+        bool measured = true;
+        for (uint32_t run = 0; run < VERTEX_BENCHMARK_RUN_COUNT && measured; ++run)
+        {
+            for (int variant = 0; variant < INDEX_ORDER_VARIANT_COUNT; ++variant)
+            {
+                const BenchmarkGeometry geometry = {
+                    .buffer = geometryBuffer,
+                    .streamCount = 1,
+                    .streamOffsets = { vertexOffsets[variant] },
+                    .isIndexed = true,
+                    .indexOffset = indexOffsets[variant],
+                    .instanceCount = instanceCount
+                };
+                const double gpuTime = MeasureVertexBenchmarkDraw(specDevice, queue, cmdBuf, fence, queryPool, renderTarget, pipelineLayout,
+                                                                pipeline, mvpConstants, (uint32_t)sizeof(mvpConstants), indexCount, &geometry, timestampPeriod);
+                if (gpuTime < 0.0)
+                {
+                    measured = false;
+                    break;
+                }
+                if (bestTimes[variant] < 0.0 || gpuTime < bestTimes[variant]) {
+                    bestTimes[variant] = gpuTime;
+                }
+            }
+        }
+        if (!measured) break;
+
+        static const char* const variantNames[INDEX_ORDER_VARIANT_COUNT] = { "generated order:", "shuffled order: ", "optimized order:" };
+        const double triangleCount = (double)(indexCount / 3U) * (double)instanceCount;
+        printf("Index order benchmark: %u copies of a sphere of %u triangles, best of %d runs, %u entry FIFO simulated, optimized in %.3f ms\n",
+            instanceCount, indexCount / 3U, VERTEX_BENCHMARK_RUN_COUNT, (uint32_t)VERTEX_CACHE_ANALYSIS_SIZE, optimizeTime);
+        for (int variant = 0; variant < INDEX_ORDER_VARIANT_COUNT; ++variant)
+        {
+            const double gpuTime = bestTimes[variant];
+            printf("  %s ACMR %.3f, ATVR %.3f, %.3f ms, %.1f Mtriangles/s\n", variantNames[variant], cacheStats[variant].acmr, cacheStats[variant].atvr,
+                gpuTime, gpuTime > 0.0 ? triangleCount / (gpuTime * 1000.0) : 0.0);
+        }
+        const double optimizedTime = bestTimes[INDEX_ORDER_OPTIMIZED_VARIANT];
+        printf("  optimized speed-up: %.2fx over the shuffled order, %.2fx over the generated order\n",
+            optimizedTime > 0.0 ? bestTimes[INDEX_ORDER_SHUFFLED_VARIANT] / optimizedTime : 0.0,
+            optimizedTime > 0.0 ? bestTimes[INDEX_ORDER_GENERATED_VARIANT] / optimizedTime : 0.0);
+
+        succeeded = true;
+    }
+    while (false);
+
+    if (fence != VK_NULL_HANDLE) {
+        vkDestroyFence(specDevice, fence, NULL);
+    }
+    if (cmdBuf != VK_NULL_HANDLE) {
+        vkFreeCommandBuffers(specDevice, commandPool, 1, &cmdBuf);
+    }
+    if (queryPool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(specDevice, queryPool, NULL);
+    }
+    if (pipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(specDevice, pipeline, NULL);
+    }
+    if (pipelineLayout != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(specDevice, pipelineLayout, NULL);
+    }
+    if (stagingBuffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(specDevice, stagingBuffer, NULL);
+    }
+    FreeDeviceMemory(&stagingMemory);
+    if (geometryBuffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(specDevice, geometryBuffer, NULL);
+    }
+    FreeDeviceMemory(&geometryMemory);
+    free(optimizedIndices);
+    for (int i = 0; i < INDEX_ORDER_VARIANT_COUNT; ++i) {
+        FreeIndexedMesh(&meshes[i]);
+    }
+
+    return succeeded;
+}
+
+bool RunVertexLayoutBenchmark(VkDevice specDevice, VkQueue queue, VkCommandPool commandPool, const RenderTarget* renderTarget,
+                            VkPipelineCache pipelineCache, float timestampPeriod, uint32_t vertexCount, VertexCompression compression)
+{
+    // Whole triangles only
+    vertexCount = max(vertexCount / 3U, 1U) * 3U;
+
+    float* positions = malloc(vertexCount * sizeof(float[4]));
+    float* colors = malloc(vertexCount * sizeof(float[4]));
+    float* texCoords = malloc(vertexCount * sizeof(float[2]));
+    QuantizedVertexAttributes quantizedAttributes = { 0 };
+    VertexLayout layouts[VERTEX_STREAM_LAYOUT_COUNT] = { 0 };
+    VkDeviceSize layoutOffsets[VERTEX_STREAM_LAYOUT_COUNT] = { 0 };
+    uint32_t fetchedBytesPerVertex[VERTEX_STREAM_LAYOUT_COUNT][VERTEX_FETCH_PASS_COUNT] = { 0 };
+    VkBuffer geometryBuffer = VK_NULL_HANDLE;
+    DeviceMemoryAllocation geometryMemory = { 0 };
+    VkBuffer stagingBuffer = VK_NULL_HANDLE;
+    DeviceMemoryAllocation stagingMemory = { 0 };
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline pipelines[VERTEX_STREAM_LAYOUT_COUNT][VERTEX_FETCH_PASS_COUNT] = { VK_NULL_HANDLE };
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    VkCommandBuffer cmdBuf = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE;
+    bool succeeded = false;
+
+    do
+    {
+        if (positions == NULL || colors == NULL || texCoords == NULL)
+        {
+            fprintf(stderr, "Failed to allocate the vertices of the vertex layout benchmark!\n");
+            break;
+        }
+
+        // The three vertices of a triangle share their position, so every triangle is degenerate and culled right after the vertex shader.
+        // What is left to measure is the vertex fetch.
+        const uint32_t triangleCount = vertexCount / 3U;
+        const uint32_t columnCount = (uint32_t)ceilf(sqrtf((float)triangleCount));
+        for (uint32_t v = 0; v < vertexCount; ++v)
+        {
+            const uint32_t triangle = v / 3U;
+            const float x = ((float)(triangle % columnCount) + 0.5f) / (float)columnCount * 2.0f - 1.0f;
+            const float y = ((float)(triangle / columnCount) + 0.5f) / (float)columnCount * 2.0f - 1.0f;
+            const float s = (float)(v % 256U) / 255.0f;
+            memcpy(&positions[v * 4U], (const float[4]) { x, y, 0.0f, 1.0f }, sizeof(float[4]));
+            memcpy(&colors[v * 4U], (const float[4]) { s, 1.0f - s, 0.5f, 1.0f }, sizeof(float[4]));
+            memcpy(&texCoords[v * 2U], (const float[2]) { s, 1.0f - s }, sizeof(float[2]));
+        }
+
+        // The same attributes as the quad, the position first
+        const VertexAttributeSource attributes[] = {
+            {
+                .location = VERTEX_BUFFER_LOCATION_INDEX,
+                .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+                .size = sizeof(float[4]),
+                .data = positions
+            },
+            {
+                .location = COLOR_BUFFER_LOCATION_INDEX,
+                .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+                .size = sizeof(float[4]),
+                .data = colors
+            },
+            {
+                .location = TEXCOORDS_BUFFER_LOCATION_INDEX,
+                .format = VK_FORMAT_R32G32_SFLOAT,
+                .size = sizeof(float[2]),
+                .data = texCoords
+            }
+        };
+        const uint32_t attributeCount = (uint32_t)(sizeof(attributes) / sizeof(attributes[0]));
+        // The fetch shaders skip the decode of the positions, which makes no difference to degenerate triangles.
+        if (!QuantizeVertexAttributes(attributes, attributeCount, vertexCount, compression, "the vertex layout benchmark", &quantizedAttributes)) break;
+
+        // The vertices of every layout live in one buffer
+        VkDeviceSize geometrySize = 0;
+        bool layoutsBuilt = true;
+        for (int i = 0; i < VERTEX_STREAM_LAYOUT_COUNT && layoutsBuilt; ++i)
+        {
+            layoutsBuilt = BuildVertexLayout((VertexStreamLayout)i, quantizedAttributes.attributes, attributeCount, vertexCount, &layouts[i]);
+            layoutOffsets[i] = (geometrySize + VERTEX_STREAM_ALIGNMENT - 1) / VERTEX_STREAM_ALIGNMENT * VERTEX_STREAM_ALIGNMENT;
+            geometrySize = layoutOffsets[i] + layouts[i].totalSize;
+        }
+        if (!layoutsBuilt) break;
+
+        // The vertices live in device local memory, so that the draws measure the vertex fetch rather than the bus.
+        if (!CreateBenchmarkBuffer(specDevice, geometrySize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                DEVICE_MEMORY_USAGE_GPU_ONLY, &geometryBuffer, &geometryMemory)) {
+            break;
+        }
+        if (!CreateBenchmarkBuffer(specDevice, geometrySize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, DEVICE_MEMORY_USAGE_STAGING_UPLOAD,
+                                &stagingBuffer, &stagingMemory)) {
+            break;
+        }
+        uint8_t* stagingData = stagingMemory.mappedData;
+        for (int i = 0; i < VERTEX_STREAM_LAYOUT_COUNT; ++i) {
+            PackVertexData(&layouts[i], quantizedAttributes.attributes, vertexCount, &stagingData[layoutOffsets[i]]);
+        }
+
+        const VkPushConstantRange pushConstantRange = {
+            .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+            .offset = 0,
+            .size = sizeof(float[16])
+        };
+        const VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+            .pNext = NULL,
+            .setLayoutCount = 0,
+            .pSetLayouts = NULL,
+            .pushConstantRangeCount = 1,
+            .pPushConstantRanges = &pushConstantRange
+        };
+        VkResult res = vkCreatePipelineLayout(specDevice, &pipelineLayoutCreateInfo, NULL, &pipelineLayout);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreatePipelineLayout for the vertex layout benchmark failed: %d\n", res);
+            break;
+        }
+
+        static const char* const passVertSPVFilePaths[VERTEX_FETCH_PASS_COUNT] = { "shaders/vertbench_fetch.vert.spv", "shaders/vertbench_fetch_position.vert.spv" };
+        const uint32_t passLocationMasks[VERTEX_FETCH_PASS_COUNT] = {
+            (1U << VERTEX_BUFFER_LOCATION_INDEX) | (1U << COLOR_BUFFER_LOCATION_INDEX) | (1U << TEXCOORDS_BUFFER_LOCATION_INDEX),
+            1U << VERTEX_BUFFER_LOCATION_INDEX
+        };
+        bool pipelinesCreated = true;
+        for (int i = 0; i < VERTEX_STREAM_LAYOUT_COUNT && pipelinesCreated; ++i)
+        {
+            for (int pass = 0; pass < VERTEX_FETCH_PASS_COUNT && pipelinesCreated; ++pass)
+            {
+                VkVertexInputBindingDescription vertexInputBindings[MAX_VERTEX_STREAM_COUNT];
+                VkVertexInputAttributeDescription vertexInputAttributes[MAX_VERTEX_ATTRIBUTE_COUNT];
+                uint32_t vertexInputAttributeCount = 0;
+                const uint32_t vertexInputBindingCount = FillVertexInputDescriptions(&layouts[i], passLocationMasks[pass], vertexInputBindings,
+                                                                                    vertexInputAttributes, &vertexInputAttributeCount);
+                // Every stream that the pass binds is pulled through the caches, including the attributes that it skips.
+                for (uint32_t b = 0; b < vertexInputBindingCount; ++b) {
+                    fetchedBytesPerVertex[i][pass] += vertexInputBindings[b].stride;
+                }
+
+                const VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo = {
+                    .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+                    .pNext = NULL,
+                    .flags = 0,
+                    .vertexBindingDescriptionCount = vertexInputBindingCount,
+                    .pVertexBindingDescriptions = vertexInputBindings,
+                    .vertexAttributeDescriptionCount = vertexInputAttributeCount,
+                    .pVertexAttributeDescriptions = vertexInputAttributes
+                };
+                pipelines[i][pass] = CreateVertexBenchmarkPipeline(specDevice, passVertSPVFilePaths[pass], "shaders/flatten.frag.spv",
+                                                                &vertexInputStateCreateInfo, pipelineLayout, renderTarget, pipelineCache);
+                pipelinesCreated = pipelines[i][pass] != VK_NULL_HANDLE;
+            }
+        }
+        if (!pipelinesCreated) break;
+
+        const VkQueryPoolCreateInfo queryPoolCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .queryType = VK_QUERY_TYPE_TIMESTAMP,
+            .queryCount = 2,
+            .pipelineStatistics = 0
+        };
+        res = vkCreateQueryPool(specDevice, &queryPoolCreateInfo, NULL, &queryPool);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreateQueryPool for the vertex layout benchmark failed: %d\n", res);
+            break;
+        }
+
+        const VkCommandBufferAllocateInfo cmdBufAllocInfo = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .pNext = NULL,
+            .commandPool = commandPool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1
+        };
+        res = vkAllocateCommandBuffers(specDevice, &cmdBufAllocInfo, &cmdBuf);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkAllocateCommandBuffers for the vertex layout benchmark failed: %d\n", res);
+            break;
+        }
+
+        const VkFenceCreateInfo fenceCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0
+        };
+        res = vkCreateFence(specDevice, &fenceCreateInfo, NULL, &fence);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreateFence for the vertex layout benchmark failed: %d\n", res);
+            break;
+        }
+
+        // Upload the vertices of all the layouts once
+        if (!UploadBenchmarkBuffer(specDevice, queue, cmdBuf, fence, stagingBuffer, geometryBuffer, geometrySize)) break;
+
+        const Mat4 projection = Mat4Ortho(-1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 3.0f);
+        const Mat4 translation = Mat4Translate(0.0f, 0.0f, -2.0f);
+        const Mat4 mvp = Mat4Multiply(&projection, &translation);
+        float mvpConstants[16];
+        Mat4Store(mvpConstants, &mvp);
+
+        // Alternate the layouts and keep the best time of each, which filters out clock ramp-up and other noise.
+        double bestTimes[VERTEX_STREAM_LAYOUT_COUNT][VERTEX_FETCH_PASS_COUNT] = { { -1.0, -1.0 }, { -1.0, -1.0 }, { -1.0, -1.0 } };
+        bool measured = true;
+        for (uint32_t run = 0; run < VERTEX_BENCHMARK_RUN_COUNT && measured; ++run)
+        {
+            for (int i = 0; i < VERTEX_STREAM_LAYOUT_COUNT && measured; ++i)
+            {
+                BenchmarkGeometry geometry = {
+                    .buffer = geometryBuffer,
+                    .streamCount = layouts[i].streamCount,
+                    .streamOffsets = { 0 },
+                    .isIndexed = false,
+                    .indexOffset = 0,
+                    .instanceCount = 1
+                };
+                for (uint32_t stream = 0; stream < layouts[i].streamCount; ++stream) {
+                    geometry.streamOffsets[stream] = layoutOffsets[i] + layouts[i].streamOffsets[stream];
+                }
+
+                for (int pass = 0; pass < VERTEX_FETCH_PASS_COUNT; ++pass)
+                {
+                    const double gpuTime = MeasureVertexBenchmarkDraw(specDevice, queue, cmdBuf, fence, queryPool, renderTarget, pipelineLayout,
+                                                                    pipelines[i][pass], mvpConstants, (uint32_t)sizeof(mvpConstants), vertexCount, &geometry, timestampPeriod);
+                    if (gpuTime < 0.0)
+                    {
+                        measured = false;
+                        break;
+                    }
+                    if (bestTimes[i][pass] < 0.0 || gpuTime < bestTimes[i][pass]) {
+                        bestTimes[i][pass] = gpuTime;
+                    }
+                }
+            }
+        }
+        if (!measured) break;
+
+        printf("Vertex layout benchmark: %u vertices per draw, %s vertex compression, best of %d runs\n", vertexCount, GetVertexCompressionName(compression),
+            VERTEX_BENCHMARK_RUN_COUNT);
+        for (int i = 0; i < VERTEX_STREAM_LAYOUT_COUNT; ++i)
+        {
+            const double allTime = bestTimes[i][VERTEX_FETCH_ALL_ATTRIBUTES_PASS];
+            const double positionTime = bestTimes[i][VERTEX_FETCH_POSITION_PASS];
+            printf("  %-14s %u streams, all attributes: %.3f ms, %.1f Mvertices/s, %u bytes/vertex; position only: %.3f ms, %.1f Mvertices/s, %u bytes/vertex\n",
+                GetVertexStreamLayoutName(layouts[i].streamLayout), layouts[i].streamCount,
+                allTime, allTime > 0.0 ? vertexCount / (allTime * 1000.0) : 0.0, fetchedBytesPerVertex[i][VERTEX_FETCH_ALL_ATTRIBUTES_PASS],
+                positionTime, positionTime > 0.0 ? vertexCount / (positionTime * 1000.0) : 0.0, fetchedBytesPerVertex[i][VERTEX_FETCH_POSITION_PASS]);
+        }
+
+        succeeded = true;
+    }
+    while (false);
+
+    if (fence != VK_NULL_HANDLE) {
+        vkDestroyFence(specDevice, fence, NULL);
+    }
+    if (cmdBuf != VK_NULL_HANDLE) {
+        vkFreeCommandBuffers(specDevice, commandPool, 1, &cmdBuf);
+    }
+    if (queryPool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(specDevice, queryPool, NULL);
+    }
+    for (int i = 0; i < VERTEX_STREAM_LAYOUT_COUNT; ++i)
+    {
+        for (int pass = 0; pass < VERTEX_FETCH_PASS_COUNT; ++pass)
+        {
+            if (pipelines[i][pass] != VK_NULL_HANDLE) {
+                vkDestroyPipeline(specDevice, pipelines[i][pass], NULL);
+            }
+        }
+    }
+    if (pipelineLayout != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(specDevice, pipelineLayout, NULL);
+    }
+    if (stagingBuffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(specDevice, stagingBuffer, NULL);
+    }
+    FreeDeviceMemory(&stagingMemory);
+    if (geometryBuffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(specDevice, geometryBuffer, NULL);
+    }
+    FreeDeviceMemory(&geometryMemory);
+    FreeQuantizedVertexAttributes(&quantizedAttributes);
+    free(texCoords);
+    free(colors);
+    free(positions);
+
+    return succeeded;
+}
+
@@ -0,0 +1,139 @@
+#include "common.h"
+
+static const char* const s_vertexStreamLayoutNames[VERTEX_STREAM_LAYOUT_COUNT] = {
+    "separate",
+    "interleaved",
+    "position-split"
+};
+
+const char* GetVertexStreamLayoutName(VertexStreamLayout streamLayout)
+{
+    return streamLayout < VERTEX_STREAM_LAYOUT_COUNT ? s_vertexStreamLayoutNames[streamLayout] : "unknown";
+}
+
+bool ParseVertexStreamLayout(const char* name, VertexStreamLayout* outStreamLayout)
+{
+    for (int i = 0; i < VERTEX_STREAM_LAYOUT_COUNT; ++i)
+    {
+        if (strcmp(name, s_vertexStreamLayoutNames[i]) == 0)
+        {
+            *outStreamLayout = (VertexStreamLayout)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool BuildVertexLayout(VertexStreamLayout streamLayout, const VertexAttributeSource* attributes, uint32_t attributeCount, uint32_t vertexCount,
+                        VertexLayout* outLayout)
+{
+    memset(outLayout, 0, sizeof(*outLayout));
+    if (attributeCount == 0 || attributeCount > MAX_VERTEX_ATTRIBUTE_COUNT)
+    {
+        fprintf(stderr, "A vertex layout holds 1 to %d attributes, not %u!\n", MAX_VERTEX_ATTRIBUTE_COUNT, attributeCount);
+        return false;
+    }
+
+    outLayout->streamLayout = streamLayout;
+    outLayout->attributeCount = attributeCount;
+    for (uint32_t i = 0; i < attributeCount; ++i)
+    {
+        uint32_t stream = 0;
+        switch (streamLayout)
+        {
+        case VERTEX_STREAM_LAYOUT_SEPARATE:
+            stream = i;
+            break;
+
+        case VERTEX_STREAM_LAYOUT_INTERLEAVED:
+            stream = 0;
+            break;
+
+        case VERTEX_STREAM_LAYOUT_POSITION_SPLIT:
+            stream = i == 0 ? 0 : 1;
+            break;
+
+        default:
+            fprintf(stderr, "Unknown vertex stream layout: %d\n", streamLayout);
+            return false;
+        }
+
+        // Within a stream the attributes follow each other in the order of `attributes`
+        VertexLayoutAttribute* attribute = &outLayout->attributes[i];
+        attribute->location = attributes[i].location;
+        attribute->format = attributes[i].format;
+        attribute->stream = stream;
+        attribute->offset = outLayout->streamStrides[stream];
+        outLayout->streamStrides[stream] += attributes[i].size;
+        outLayout->streamCount = max(outLayout->streamCount, stream + 1);
+    }
+
+    VkDeviceSize totalSize = 0;
+    for (uint32_t stream = 0; stream < outLayout->streamCount; ++stream)
+    {
+        outLayout->streamOffsets[stream] = (totalSize + VERTEX_STREAM_ALIGNMENT - 1) / VERTEX_STREAM_ALIGNMENT * VERTEX_STREAM_ALIGNMENT;
+        totalSize = outLayout->streamOffsets[stream] + (VkDeviceSize)outLayout->streamStrides[stream] * vertexCount;
+    }
+    outLayout->totalSize = totalSize;
+
+    return true;
+}
+
+void PackVertexData(const VertexLayout* layout, const VertexAttributeSource* attributes, uint32_t vertexCount, void* dst)
+{
+    // `dst` may be write-combined memory, so it is written front to back and never read.
+    uint8_t* dstBytes = dst;
+    for (uint32_t stream = 0; stream < layout->streamCount; ++stream)
+    {
+        uint8_t* dstStream = &dstBytes[layout->streamOffsets[stream]];
+        const uint32_t stride = layout->streamStrides[stream];
+        for (uint32_t v = 0; v < vertexCount; ++v)
+        {
+            for (uint32_t i = 0; i < layout->attributeCount; ++i)
+            {
+                const VertexLayoutAttribute* attribute = &layout->attributes[i];
+                if (attribute->stream != stream) continue;
+
+                const uint32_t size = attributes[i].size;
+                memcpy(&dstStream[v * stride + attribute->offset], &((const uint8_t*)attributes[i].data)[v * size], size);
+            }
+        }
+    }
+}
+
+uint32_t FillVertexInputDescriptions(const VertexLayout* layout, uint32_t locationMask, VkVertexInputBindingDescription* outBindings,
+                                    VkVertexInputAttributeDescription* outAttributes, uint32_t* outAttributeCount)
+{
+    bool isStreamUsed[MAX_VERTEX_STREAM_COUNT] = { false };
+    uint32_t attributeCount = 0;
+    for (uint32_t i = 0; i < layout->attributeCount; ++i)
+    {
+        const VertexLayoutAttribute* attribute = &layout->attributes[i];
+        if ((locationMask & (1U << attribute->location)) == 0) continue;
+
+        outAttributes[attributeCount++] = (VkVertexInputAttributeDescription){
+            .location = attribute->location,
+            .binding = attribute->stream,
+            .format = attribute->format,
+            .offset = attribute->offset
+        };
+        isStreamUsed[attribute->stream] = true;
+    }
+
+    // A stream that only holds attributes the pipeline does not consume is left unbound.
+    uint32_t bindingCount = 0;
+    for (uint32_t stream = 0; stream < layout->streamCount; ++stream)
+    {
+        if (!isStreamUsed[stream]) continue;
+
+        outBindings[bindingCount++] = (VkVertexInputBindingDescription){
+            .binding = stream,
+            .stride = layout->streamStrides[stream],
+            .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
+        };
+    }
+
+    *outAttributeCount = attributeCount;
+    return bindingCount;
+}
+
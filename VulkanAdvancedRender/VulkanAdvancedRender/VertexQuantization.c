@@ -0,0 +1,344 @@
+#include "common.h"
+
+typedef enum VertexAttributeEncoding
+{
+    VERTEX_ATTRIBUTE_ENCODING_FLOAT,            // copied as it is
+    VERTEX_ATTRIBUTE_ENCODING_HALF_BOUNDS,      // normalized into the bounds of the mesh, then half floats
+    VERTEX_ATTRIBUTE_ENCODING_SNORM16_BOUNDS,   // normalized into the bounds of the mesh, then 16-bit snorm
+    VERTEX_ATTRIBUTE_ENCODING_UNORM16,          // clamped to [0, 1]
+    VERTEX_ATTRIBUTE_ENCODING_UNORM8,           // clamped to [0, 1]
+    VERTEX_ATTRIBUTE_ENCODING_COUNT
+} VertexAttributeEncoding;
+
+static const char* const s_vertexCompressionNames[VERTEX_COMPRESSION_COUNT] = {
+    "none",
+    "half",
+    "snorm16"
+};
+
+static const char* const s_encodingNames[VERTEX_ATTRIBUTE_ENCODING_COUNT] = {
+    "float",
+    "half in bounds",
+    "snorm16 in bounds",
+    "unorm16",
+    "unorm8"
+};
+
+static const uint32_t s_encodingComponentSizes[VERTEX_ATTRIBUTE_ENCODING_COUNT] = { 4U, 2U, 2U, 2U, 1U };
+
+// Indexed by the component count minus 1. Three 16-bit or 8-bit components are padded to four,
+// as the three component formats of these sizes are not required to be supported for vertex buffers.
+static const VkFormat s_encodingFormats[VERTEX_ATTRIBUTE_ENCODING_COUNT][4] = {
+    { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT },
+    { VK_FORMAT_R16_SFLOAT, VK_FORMAT_R16G16_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT },
+    { VK_FORMAT_R16_SNORM, VK_FORMAT_R16G16_SNORM, VK_FORMAT_R16G16B16A16_SNORM, VK_FORMAT_R16G16B16A16_SNORM },
+    { VK_FORMAT_R16_UNORM, VK_FORMAT_R16G16_UNORM, VK_FORMAT_R16G16B16A16_UNORM, VK_FORMAT_R16G16B16A16_UNORM },
+    { VK_FORMAT_R8_UNORM, VK_FORMAT_R8G8_UNORM, VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R8G8B8A8_UNORM }
+};
+
+const char* GetVertexCompressionName(VertexCompression compression)
+{
+    return compression < VERTEX_COMPRESSION_COUNT ? s_vertexCompressionNames[compression] : "unknown";
+}
+
+bool ParseVertexCompression(const char* name, VertexCompression* outCompression)
+{
+    for (int i = 0; i < VERTEX_COMPRESSION_COUNT; ++i)
+    {
+        if (strcmp(name, s_vertexCompressionNames[i]) == 0)
+        {
+            *outCompression = (VertexCompression)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static VertexAttributeEncoding GetAttributeEncoding(VertexCompression compression, uint32_t location, bool isPosition)
+{
+    if (compression == VERTEX_COMPRESSION_NONE) return VERTEX_ATTRIBUTE_ENCODING_FLOAT;
+
+    if (isPosition) {
+        return compression == VERTEX_COMPRESSION_HALF ? VERTEX_ATTRIBUTE_ENCODING_HALF_BOUNDS : VERTEX_ATTRIBUTE_ENCODING_SNORM16_BOUNDS;
+    }
+
+    switch (location)
+    {
+    case COLOR_BUFFER_LOCATION_INDEX:
+        return VERTEX_ATTRIBUTE_ENCODING_UNORM8;
+
+    case TEXCOORDS_BUFFER_LOCATION_INDEX:
+        return VERTEX_ATTRIBUTE_ENCODING_UNORM16;
+
+    default:
+        return VERTEX_ATTRIBUTE_ENCODING_FLOAT;
+    }
+}
+
+// Round to nearest even, like the conversions of the GPU
+static uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint16_t sign = (uint16_t)((bits >> 16) & 0x8000U);
+    const uint32_t absBits = bits & 0x7fffffffU;
+
+    // infinity and NaN
+    if (absBits >= 0x7f800000U) return sign | 0x7c00U | (absBits > 0x7f800000U ? 0x0200U : 0U);
+    // rounds to more than 65504
+    if (absBits >= 0x477ff000U) return sign | 0x7c00U;
+    // rounds to less than half of the smallest subnormal
+    if (absBits < 0x33000000U) return sign;
+
+    if (absBits < 0x38800000U)
+    {
+        // A subnormal half is the mantissa with its implicit 1 in units of 2^-24
+        const uint32_t mantissa = (absBits & 0x007fffffU) | 0x00800000U;
+        const uint32_t shift = 126U - (absBits >> 23);
+        const uint32_t remainder = mantissa & ((1U << shift) - 1U);
+        const uint32_t halfway = 1U << (shift - 1U);
+        uint32_t result = mantissa >> shift;
+        if (remainder > halfway || (remainder == halfway && (result & 1U) != 0)) {
+            ++result;
+        }
+        return sign | (uint16_t)result;
+    }
+
+    // Rebias the exponent from 127 to 15, then drop 13 bits of the mantissa. A carry out of the mantissa correctly bumps the exponent.
+    const uint32_t rebiased = absBits - 0x38000000U;
+    return sign | (uint16_t)((rebiased + 0x0fffU + ((rebiased >> 13) & 1U)) >> 13);
+}
+
+static float HalfToFloat(uint16_t value)
+{
+    const uint32_t exponent = (value >> 10) & 0x1fU;
+    const uint32_t mantissa = value & 0x03ffU;
+
+    float magnitude;
+    if (exponent == 0) {
+        magnitude = ldexpf((float)mantissa, -24);
+    }
+    else if (exponent == 31) {
+        magnitude = mantissa != 0 ? NAN : INFINITY;
+    }
+    else {
+        magnitude = ldexpf((float)(mantissa | 0x0400U), (int)exponent - 25);
+    }
+    return (value & 0x8000U) != 0 ? -magnitude : magnitude;
+}
+
+static void StoreComponent(VertexAttributeEncoding encoding, float value, uint8_t* dst)
+{
+    switch (encoding)
+    {
+    case VERTEX_ATTRIBUTE_ENCODING_FLOAT:
+        memcpy(dst, &value, sizeof(value));
+        break;
+
+    case VERTEX_ATTRIBUTE_ENCODING_HALF_BOUNDS:
+    {
+        const uint16_t half = FloatToHalf(value);
+        memcpy(dst, &half, sizeof(half));
+        break;
+    }
+
+    case VERTEX_ATTRIBUTE_ENCODING_SNORM16_BOUNDS:
+    {
+        const int16_t snorm = (int16_t)lroundf(max(min(value, 1.0f), -1.0f) * 32767.0f);
+        memcpy(dst, &snorm, sizeof(snorm));
+        break;
+    }
+
+    case VERTEX_ATTRIBUTE_ENCODING_UNORM16:
+    {
+        const uint16_t unorm = (uint16_t)lroundf(max(min(value, 1.0f), 0.0f) * 65535.0f);
+        memcpy(dst, &unorm, sizeof(unorm));
+        break;
+    }
+
+    case VERTEX_ATTRIBUTE_ENCODING_UNORM8:
+        *dst = (uint8_t)lroundf(max(min(value, 1.0f), 0.0f) * 255.0f);
+        break;
+
+    default:
+        break;
+    }
+}
+
+// Returns what the vertex fetch makes of a stored component
+static float LoadComponent(VertexAttributeEncoding encoding, const uint8_t* src)
+{
+    switch (encoding)
+    {
+    case VERTEX_ATTRIBUTE_ENCODING_FLOAT:
+    {
+        float value;
+        memcpy(&value, src, sizeof(value));
+        return value;
+    }
+
+    case VERTEX_ATTRIBUTE_ENCODING_HALF_BOUNDS:
+    {
+        uint16_t half;
+        memcpy(&half, src, sizeof(half));
+        return HalfToFloat(half);
+    }
+
+    case VERTEX_ATTRIBUTE_ENCODING_SNORM16_BOUNDS:
+    {
+        int16_t snorm;
+        memcpy(&snorm, src, sizeof(snorm));
+        return max((float)snorm / 32767.0f, -1.0f);
+    }
+
+    case VERTEX_ATTRIBUTE_ENCODING_UNORM16:
+    {
+        uint16_t unorm;
+        memcpy(&unorm, src, sizeof(unorm));
+        return (float)unorm / 65535.0f;
+    }
+
+    case VERTEX_ATTRIBUTE_ENCODING_UNORM8:
+        return (float)*src / 255.0f;
+
+    default:
+        return 0.0f;
+    }
+}
+
+bool QuantizeVertexAttributes(const VertexAttributeSource* attributes, uint32_t attributeCount, uint32_t vertexCount, VertexCompression compression,
+                            const char* meshName, QuantizedVertexAttributes* outAttributes)
+{
+    memset(outAttributes, 0, sizeof(*outAttributes));
+    if (attributeCount == 0 || attributeCount > MAX_VERTEX_ATTRIBUTE_COUNT)
+    {
+        fprintf(stderr, "A vertex layout holds 1 to %d attributes, not %u!\n", MAX_VERTEX_ATTRIBUTE_COUNT, attributeCount);
+        return false;
+    }
+
+    VertexAttributeEncoding encodings[MAX_VERTEX_ATTRIBUTE_COUNT];
+    uint32_t sourceComponentCounts[MAX_VERTEX_ATTRIBUTE_COUNT];
+    uint32_t componentCounts[MAX_VERTEX_ATTRIBUTE_COUNT];
+    VkDeviceSize dataOffsets[MAX_VERTEX_ATTRIBUTE_COUNT];
+    VkDeviceSize dataSize = 0;
+    for (uint32_t i = 0; i < attributeCount; ++i)
+    {
+        // Only 32-bit float sources are quantized
+        sourceComponentCounts[i] = attributes[i].size / (uint32_t)sizeof(float);
+        if (attributes[i].size % sizeof(float) != 0 || sourceComponentCounts[i] == 0 || sourceComponentCounts[i] > 4 ||
+            attributes[i].format != s_encodingFormats[VERTEX_ATTRIBUTE_ENCODING_FLOAT][sourceComponentCounts[i] - 1])
+        {
+            fprintf(stderr, "The attribute at location %u of %s is not made of 1 to 4 floats!\n", attributes[i].location, meshName);
+            return false;
+        }
+
+        encodings[i] = GetAttributeEncoding(compression, attributes[i].location, i == 0);
+        componentCounts[i] = encodings[i] != VERTEX_ATTRIBUTE_ENCODING_FLOAT && sourceComponentCounts[i] == 3 ? 4U : sourceComponentCounts[i];
+
+        const uint32_t size = componentCounts[i] * s_encodingComponentSizes[encodings[i]];
+        outAttributes->attributes[i] = (VertexAttributeSource){
+            .location = attributes[i].location,
+            .format = s_encodingFormats[encodings[i]][componentCounts[i] - 1],
+            .size = size,
+            .data = NULL
+        };
+
+        // Every array starts at a multiple of 4 bytes
+        dataOffsets[i] = dataSize;
+        dataSize += ((VkDeviceSize)size * vertexCount + 3U) & ~(VkDeviceSize)3U;
+    }
+
+    uint8_t* data = malloc((size_t)max(dataSize, (VkDeviceSize)1U));
+    if (data == NULL)
+    {
+        fprintf(stderr, "Failed to allocate the quantized vertices of %s!\n", meshName);
+        return false;
+    }
+    outAttributes->data = data;
+    outAttributes->attributeCount = attributeCount;
+
+    uint32_t sourceStride = 0;
+    uint32_t quantizedStride = 0;
+    float boundsExtent = 0.0f;
+    for (uint32_t i = 0; i < attributeCount; ++i)
+    {
+        const VertexAttributeEncoding encoding = encodings[i];
+        const uint32_t sourceComponentCount = sourceComponentCounts[i];
+        const float* src = attributes[i].data;
+        uint8_t* dst = &data[dataOffsets[i]];
+        const uint32_t componentSize = s_encodingComponentSizes[encoding];
+        float* decodeScale = outAttributes->decodeScales[i];
+        float* decodeBias = outAttributes->decodeBiases[i];
+        outAttributes->attributes[i].data = dst;
+
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            decodeScale[c] = 1.0f;
+            decodeBias[c] = 0.0f;
+        }
+
+        // The bounds map to [-1, 1]. A component that is the same for all the vertices is all in the bias.
+        const bool isInBounds = encoding == VERTEX_ATTRIBUTE_ENCODING_HALF_BOUNDS || encoding == VERTEX_ATTRIBUTE_ENCODING_SNORM16_BOUNDS;
+        for (uint32_t c = 0; c < sourceComponentCount && isInBounds && vertexCount > 0; ++c)
+        {
+            float minValue = src[c];
+            float maxValue = src[c];
+            for (uint32_t v = 1; v < vertexCount; ++v)
+            {
+                minValue = min(minValue, src[v * sourceComponentCount + c]);
+                maxValue = max(maxValue, src[v * sourceComponentCount + c]);
+            }
+            const float halfExtent = 0.5f * (maxValue - minValue);
+            decodeScale[c] = halfExtent > 0.0f ? halfExtent : 1.0f;
+            decodeBias[c] = 0.5f * (maxValue + minValue);
+            boundsExtent = max(boundsExtent, maxValue - minValue);
+        }
+
+        float maxError = 0.0f;
+        for (uint32_t v = 0; v < vertexCount; ++v)
+        {
+            uint8_t* dstVertex = &dst[v * outAttributes->attributes[i].size];
+            for (uint32_t c = 0; c < componentCounts[i]; ++c)
+            {
+                // The padding component decodes to 1 like the missing components of the vertex fetch
+                if (c >= sourceComponentCount)
+                {
+                    StoreComponent(encoding, 1.0f, &dstVertex[c * componentSize]);
+                    continue;
+                }
+
+                const float value = src[v * sourceComponentCount + c];
+                StoreComponent(encoding, (value - decodeBias[c]) / decodeScale[c], &dstVertex[c * componentSize]);
+                const float decoded = LoadComponent(encoding, &dstVertex[c * componentSize]) * decodeScale[c] + decodeBias[c];
+                maxError = max(maxError, fabsf(decoded - value));
+            }
+        }
+        outAttributes->maxErrors[i] = maxError;
+
+        sourceStride += attributes[i].size;
+        quantizedStride += outAttributes->attributes[i].size;
+    }
+
+    if (compression == VERTEX_COMPRESSION_NONE) return true;
+
+    printf("Vertex compression of %s (%s): %u vertices, %u -> %u bytes per vertex (%.2fx)\n", meshName, GetVertexCompressionName(compression), vertexCount,
+        sourceStride, quantizedStride, quantizedStride > 0 ? (double)sourceStride / (double)quantizedStride : 0.0);
+    for (uint32_t i = 0; i < attributeCount; ++i)
+    {
+        const VertexAttributeEncoding encoding = encodings[i];
+        printf("  location %u: %u x %s, max error %g", attributes[i].location, componentCounts[i], s_encodingNames[encoding], outAttributes->maxErrors[i]);
+        if ((encoding == VERTEX_ATTRIBUTE_ENCODING_HALF_BOUNDS || encoding == VERTEX_ATTRIBUTE_ENCODING_SNORM16_BOUNDS) && boundsExtent > 0.0f) {
+            printf(" (%.5f%% of the bounds)", 100.0 * outAttributes->maxErrors[i] / boundsExtent);
+        }
+        printf("\n");
+    }
+
+    return true;
+}
+
+void FreeQuantizedVertexAttributes(QuantizedVertexAttributes* attributes)
+{
+    free(attributes->data);
+    memset(attributes, 0, sizeof(*attributes));
+}
+
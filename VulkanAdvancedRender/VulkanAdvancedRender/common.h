@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -29,12 +30,41 @@ static inline FILE* GeneralOpenFile(const char* path)
     return fp;
 }
 
+static inline FILE* GeneralOpenFileForWriting(const char* path)
+{
+    FILE* fp = NULL;
+    const errno_t errCode = fopen_s(&fp, path, "wb");
+    if (errCode != 0)
+    {
+        printf("Open file '%s' for writing failed, because: %d\n", path, errCode);
+        return NULL;
+    }
+    return fp;
+}
+
+static inline double GetCurrentTimeInMilliseconds(void)
+{
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1000.0 / (double)frequency.QuadPart;
+}
+
 #define _USE_MATH_DEFINES
 
 #else
 #include <unistd.h>
+#include <time.h>
 #include <sys/types.h>
 
+#ifndef min
+#define min(a, b)       ((a) < (b) ? (a) : (b))
+#endif
+
+#ifndef max
+#define max(a, b)       ((a) > (b) ? (a) : (b))
+#endif
+
 #define sprintf_s(buffer, bufferMaxCount, format, ...)      sprintf((buffer), (format), ## __VA_ARGS__)
 
 static inline int strcpy_s(char* dst, size_t maxSizeInDst, const char* src)
@@ -60,29 +90,876 @@ static inline FILE* GeneralOpenFile(const char* path)
     return fp;
 }
 
+static inline FILE* GeneralOpenFileForWriting(const char* path)
+{
+    FILE* fp = fopen(path, "wb");
+    if (fp == NULL)
+    {
+        printf("File '%s' open for writing failed!\n", path);
+        return NULL;
+    }
+    return fp;
+}
+
+static inline double GetCurrentTimeInMilliseconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
 #endif // _WIN32
 
-#include <math.h>
+// Reports a failed check of a --self-test run, and returns whether the check has passed
+static inline bool CheckSelfTestCondition(bool condition, const char* description)
+{
+    if (!condition) {
+        fprintf(stderr, "Self-test check failed: %s\n", description);
+    }
+    return condition;
+}
 
-#define USE_MSAA_SAMPLE_COUNT       0
+#include <math.h>
+#include "VectorMath.h"
 
 enum
 {
     VERTEX_BUFFER_LOCATION_INDEX,
     COLOR_BUFFER_LOCATION_INDEX,
-    TEXCOORDS_BUFFER_LOCATION_INDEX
+    TEXCOORDS_BUFFER_LOCATION_INDEX,
+    INSTANCE_BUFFER_LOCATION_INDEX,                 // the binding of the per-instance attributes, and the location of the instance transform
+    INSTANCE_COLOR_LOCATION_INDEX,
+    INSTANCE_TEXTURE_INDEX_LOCATION_INDEX
+};
+
+enum { MAX_INSTANCE_COUNT = 100000 };
+
+// How the per-vertex attributes are distributed over vertex buffer bindings, the streams.
+// Depth-only passes fetch less with the positions alone in a stream, full shading fetches fewer cache lines with everything interleaved.
+typedef enum VertexStreamLayout
+{
+    VERTEX_STREAM_LAYOUT_SEPARATE,              // one stream per attribute
+    VERTEX_STREAM_LAYOUT_INTERLEAVED,           // all the attributes in one stream
+    VERTEX_STREAM_LAYOUT_POSITION_SPLIT,        // the positions in one stream, all the other attributes interleaved in a second one
+    VERTEX_STREAM_LAYOUT_COUNT
+} VertexStreamLayout;
+
+enum
+{
+    MAX_VERTEX_ATTRIBUTE_COUNT = 4,
+    // The streams use the bindings from 0, below the per-instance attributes
+    MAX_VERTEX_STREAM_COUNT = INSTANCE_BUFFER_LOCATION_INDEX,
+    // The offset of every stream in the packed vertex data is a multiple of this, enough for any attribute format
+    VERTEX_STREAM_ALIGNMENT = 16
+};
+
+// The tightly packed data of one vertex attribute
+typedef struct VertexAttributeSource
+{
+    uint32_t location;
+    VkFormat format;
+    uint32_t size;                  // of one element, which has to match `format`
+    const void* data;               // one element per vertex
+} VertexAttributeSource;
+
+typedef struct VertexLayoutAttribute
+{
+    uint32_t location;
+    VkFormat format;
+    uint32_t stream;                // which is also the vertex buffer binding
+    uint32_t offset;                // within a vertex of the stream
+} VertexLayoutAttribute;
+
+typedef struct VertexLayout
+{
+    VertexStreamLayout streamLayout;
+    VertexLayoutAttribute attributes[MAX_VERTEX_ATTRIBUTE_COUNT];
+    uint32_t attributeCount;
+    uint32_t streamCount;
+    uint32_t streamStrides[MAX_VERTEX_STREAM_COUNT];
+    VkDeviceSize streamOffsets[MAX_VERTEX_STREAM_COUNT];    // of each stream in the packed vertex data
+    VkDeviceSize totalSize;
+} VertexLayout;
+
+// Which formats the float vertex attributes are quantized to. Colors become 8-bit unorm and texture coordinates 16-bit unorm
+// with any compression, while positions are normalized into the bounds of their mesh and stored as half floats or 16-bit snorm.
+typedef enum VertexCompression
+{
+    VERTEX_COMPRESSION_NONE,
+    VERTEX_COMPRESSION_HALF,
+    VERTEX_COMPRESSION_SNORM16,
+    VERTEX_COMPRESSION_COUNT
+} VertexCompression;
+
+// The quantized attributes of a mesh. A shader decodes an attribute as `encoded * decodeScale + decodeBias`,
+// which the formats of all the attributes but the positions already do in the vertex fetch.
+typedef struct QuantizedVertexAttributes
+{
+    VertexAttributeSource attributes[MAX_VERTEX_ATTRIBUTE_COUNT];   // pointing into `data`
+    float decodeScales[MAX_VERTEX_ATTRIBUTE_COUNT][4];
+    float decodeBiases[MAX_VERTEX_ATTRIBUTE_COUNT][4];
+    float maxErrors[MAX_VERTEX_ATTRIBUTE_COUNT];                    // the largest difference of a decoded component from its source
+    uint32_t attributeCount;
+    void* data;
+} QuantizedVertexAttributes;
+
+enum
+{
+    MAX_TEXTURE_FILE_COUNT = 8,
+    MAX_IMAGE_FILE_LEVEL_COUNT = 16,
+    TEXTURE_BLOCK_TEXEL_COUNT = 16      // of the 4 x 4 blocks of the compressed formats
+};
+
+// Decodes a compressed block into RGBA texels, row by row. Returns false for a block that is only decodable by the device.
+typedef bool (*DecodeTextureBlockProc)(const uint8_t* block, uint8_t dstRGBA[TEXTURE_BLOCK_TEXEL_COUNT * 4]);
+
+// How the texels of a texture format are stored, in blocks of `blockWidth` x `blockHeight` texels taking `blockSize` bytes each
+typedef struct TextureFormatInfo
+{
+    VkFormat format;
+    const char* name;
+    uint32_t blockWidth;
+    uint32_t blockHeight;
+    uint32_t blockSize;
+    VkFormat decodedFormat;                 // what `decodeBlock` writes
+    DecodeTextureBlockProc decodeBlock;     // NULL for the uncompressed formats, used when the device cannot sample the blocks
+} TextureFormatInfo;
+
+typedef enum ImageFileType
+{
+    IMAGE_FILE_TYPE_BMP,
+    IMAGE_FILE_TYPE_TGA,
+    IMAGE_FILE_TYPE_PPM,
+    IMAGE_FILE_TYPE_KTX2,
+    IMAGE_FILE_TYPE_COUNT
+} ImageFileType;
+
+// An image file mapped into memory with its header parsed. The pixels are only read when the file is decoded,
+// into tightly packed levels of `format` ready for vkCmdCopyBufferToImage.
+typedef struct ImageFile
+{
+    const uint8_t* fileData;
+    size_t fileSize;
+    ImageFileType type;
+    VkFormat format;                // of the decoded data
+    VkFormat fileFormat;            // of the texels in the file, which only differs from `format` while blocks are decompressed
+    bool isOpaque;                  // the alpha channel holds no alpha, so it is to be read as 1
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+    VkDeviceSize levelOffsets[MAX_IMAGE_FILE_LEVEL_COUNT];      // in the decoded data
+    VkDeviceSize levelSizes[MAX_IMAGE_FILE_LEVEL_COUNT];
+    VkDeviceSize decodedSize;
+
+    // where and how the pixels are stored in the file
+    size_t srcLevelOffsets[MAX_IMAGE_FILE_LEVEL_COUNT];
+    size_t srcRowPitch;
+    uint32_t srcBytesPerPixel;
+    bool isBottomUp;
+    bool isRunLengthEncoded;
+} ImageFile;
+
+// How a texture loaded with a single level gets the rest of its mip chain
+typedef enum MipmapGeneration
+{
+    MIPMAP_GENERATION_AUTO,         // blits when the format supports them, otherwise a compute downsample
+    MIPMAP_GENERATION_BLIT,
+    MIPMAP_GENERATION_COMPUTE,
+    MIPMAP_GENERATION_NONE,
+    MIPMAP_GENERATION_COUNT
+} MipmapGeneration;
+
+// What the commands of a compute mip chain generation use, which has to live until they have completed
+typedef struct MipmapComputeResources
+{
+    VkDescriptorSetLayout descriptorSetLayout;
+    VkPipelineLayout pipelineLayout;
+    VkPipeline pipeline;
+    VkDescriptorPool descriptorPool;
+    VkSampler sampler;
+    VkImageView levelViews[2 * MAX_IMAGE_FILE_LEVEL_COUNT];     // the source and destination view of each generated level
+    uint32_t levelViewCount;
+} MipmapComputeResources;
+
+enum { MAX_HOST_IMAGE_COPY_LAYOUT_COUNT = 16 };
+
+// The VK_EXT_host_image_copy functions, with which the CPU writes optimal tiling images without any staging buffer or command
+typedef struct HostImageCopySupport
+{
+    PFN_vkCopyMemoryToImageEXT copyMemoryToImage;
+    PFN_vkTransitionImageLayoutEXT transitionImageLayout;
+    uint32_t copyDstLayoutCount;
+    VkImageLayout copyDstLayouts[MAX_HOST_IMAGE_COPY_LAYOUT_COUNT];    // the layouts that images can be in while they are written from the host
+} HostImageCopySupport;
+
+// The per-instance attributes of the quad pipelines, fetched from INSTANCE_BUFFER_LOCATION_INDEX at the instance rate.
+// This MUST BE coherent with the instance attributes in flatten.vert.glsl, fsr.vert.glsl, gradient.vert.glsl and texture.vert.glsl.
+typedef struct InstanceData
+{
+    float transform[4];             // x and y offsets in the plane of the quad, uniform scale, unused
+    uint8_t color[4];               // RGBA tint, VK_FORMAT_R8G8B8A8_UNORM
+    uint32_t textureIndex;          // 0 for the whole first texture, otherwise quadrant (textureIndex - 1) % 4 of texture (textureIndex - 1) / 4
+} InstanceData;
+
+static_assert(sizeof(InstanceData) == 24U, "Invalid InstanceData size");
+
+// The bounding sphere of an instance in the model space of its draw, which the GPU culling tests against the view frustum.
+// This MUST BE coherent with `bounds_block` in cull_objects.comp.glsl.
+typedef struct ObjectBounds
+{
+    float center[3];
+    float radius;
+} ObjectBounds;
+
+enum { CULLING_WORK_GROUP_SIZE = 64 };
+
+// A vertex of the procedural meshes drawn by the mesh shader pipeline.
+// This MUST BE coherent with `MeshVertex` in basic_ms.mesh.glsl and meshlet_ref.vert.glsl.
+typedef struct MeshVertex
+{
+    float position[3];
+    float normal[3];
+} MeshVertex;
+
+// Triangles are wound clockwise when seen from their front side, like all the other geometry of this sample.
+typedef struct IndexedMesh
+{
+    MeshVertex* vertices;
+    uint32_t* indices;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+} IndexedMesh;
+
+// The post-transform vertex cache behaviour of an index order, simulated with a FIFO cache
+typedef struct VertexCacheStatistics
+{
+    uint32_t transformedVertexCount;
+    float acmr;                     // average cache miss ratio, transformed vertices per triangle: 3 at worst and about 0.5 at best for a regular mesh
+    float atvr;                     // average transformed vertex ratio, transformed vertices per referenced vertex: 1 at best
+} VertexCacheStatistics;
+
+enum { VERTEX_CACHE_ANALYSIS_SIZE = 16 };
+
+enum
+{
+    // The meshlet limits that basic_ms.mesh.glsl is compiled for, the device limits may lower them further.
+    MESHLET_MAX_VERTEX_COUNT = 64,
+    MESHLET_MAX_TRIANGLE_COUNT = 124
+};
+
+// This MUST BE coherent with `Meshlet` in basic_ms.mesh.glsl.
+typedef struct Meshlet
+{
+    uint32_t vertexOffset;          // into MeshletData::vertexIndices
+    uint32_t triangleOffset;        // into MeshletData::triangles
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+} Meshlet;
+
+// The whole meshlet faces away from a view direction `v` when dot(v, coneAxis) >= coneCutoff,
+// where coneCutoff is the sine of the largest angle between the axis and the normal of a triangle, or 1 if there is no such cone.
+typedef struct MeshletBounds
+{
+    float center[3];
+    float radius;
+    float coneAxis[3];
+    float coneCutoff;
+} MeshletBounds;
+
+typedef struct MeshletData
+{
+    Meshlet* meshlets;
+    MeshletBounds* bounds;
+    uint32_t* vertexIndices;        // the mesh vertices of each meshlet
+    uint32_t* triangles;            // 3 local vertex indices of 8 bits per triangle, the first in the lowest byte
+    uint32_t meshletCount;
+    uint32_t vertexIndexCount;
+    uint32_t triangleCount;
+} MeshletData;
+
+enum { MAX_PIPELINE_SHADER_STAGE_COUNT = 4 };
+
+typedef struct PipelineCreationFeedbackRecord
+{
+    VkPipelineCreationFeedback pipelineFeedback;
+    VkPipelineCreationFeedback stageFeedbacks[MAX_PIPELINE_SHADER_STAGE_COUNT];
+    VkPipelineCreationFeedbackCreateInfo createInfo;
+} PipelineCreationFeedbackRecord;
+
+// The attachments that a graphics pass renders into, either through a render pass and framebuffer,
+// or through dynamic rendering when `renderPass` is VK_NULL_HANDLE and `cmdBeginRendering` is set.
+typedef struct RenderTarget
+{
+    VkRenderPass renderPass;
+    VkFramebuffer framebuffer;
+    PFN_vkCmdBeginRenderingKHR cmdBeginRendering;
+    PFN_vkCmdEndRenderingKHR cmdEndRendering;
+    PFN_vkCmdBeginRenderPass2KHR cmdBeginRenderPass2;  // the core or VK_KHR_create_renderpass2 entry points for a multisampled render pass
+    PFN_vkCmdEndRenderPass2KHR cmdEndRenderPass2;
+    VkExtent2D extent;
+    VkSampleCountFlagBits sampleCount;
+    VkFormat colorFormat;
+    VkFormat depthFormat;
+    VkImage colorImage;             // the multisampled color image with MSAA
+    VkImageView colorView;
+    VkImage resolveImage;           // the single sampled image that the color image is resolved into, VK_NULL_HANDLE without MSAA
+    VkImageView resolveView;
+    VkImage depthImage;             // as many samples as the color image
+    VkImageView depthView;
+    VkImageLayout finalColorLayout; // of the single sampled color image after the pass
+} RenderTarget;
+
+// Scales the render size of every frame so that its GPU time stays within `gpuTimeBudget` milliseconds.
+// The scale applies to both axes, so the pixel count follows its square.
+typedef struct DynamicResolution
+{
+    double gpuTimeBudget;
+    float minScale;
+    float scale;                    // of the next frame to be recorded
+    float lowestScale;
+    float highestScale;
+    double scaleSum;
+    uint32_t sampleCount;           // the frames whose GPU time has been fed in
+    uint32_t overBudgetCount;
+} DynamicResolution;
+
+typedef struct DeviceMemoryBlock DeviceMemoryBlock;
+
+typedef struct DeviceMemoryAllocation
+{
+    VkDeviceMemory memory;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    void* mappedData;               // non-NULL for host visible memory, which stays mapped as long as the allocation lives
+    uint32_t memoryTypeIndex;
+    uint32_t level;                 // buddy level of the sub-allocation
+    uint32_t tiling;
+    DeviceMemoryBlock* block;       // NULL for a dedicated allocation
+} DeviceMemoryAllocation;
+
+typedef struct DeviceMemoryStatistics
+{
+    uint32_t blockCount;
+    uint32_t dedicatedAllocationCount;
+    uint32_t subAllocationCount;
+    uint32_t deviceMemoryAllocationCount;       // accumulated vkAllocateMemory calls
+    VkDeviceSize blockBytes;
+    VkDeviceSize dedicatedBytes;
+    VkDeviceSize usedBytes;                     // bytes of the buddy nodes in use
+    VkDeviceSize requestedBytes;
+} DeviceMemoryStatistics;
+
+// The intended usage of an allocation, which decides the memory type it lives in
+typedef enum DeviceMemoryUsage
+{
+    DEVICE_MEMORY_USAGE_GPU_ONLY,               // written and read by the GPU only
+    DEVICE_MEMORY_USAGE_STAGING_UPLOAD,         // written once by the CPU and copied by the GPU
+    DEVICE_MEMORY_USAGE_READBACK,               // written by the GPU and read by the CPU
+    DEVICE_MEMORY_USAGE_DYNAMIC,                // rewritten by the CPU every frame and read by the GPU directly
+    DEVICE_MEMORY_USAGE_TRANSIENT,              // attachments that only live inside a render pass
+    DEVICE_MEMORY_USAGE_COUNT
+} DeviceMemoryUsage;
+
+enum
+{
+    UPLOAD_BATCH_COUNT = 4,                     // batches that can be in flight on the upload queue at the same time
+    MAX_UPLOAD_OWNERSHIP_TRANSFER_COUNT = 32,
+    MAX_UPLOAD_COPY_COUNT = 128,                // copies queued before they are recorded, enough for every level of every texture layer
+    UPLOAD_STAGING_RING_SIZE = 32 * 1024 * 1024
+};
+
+// A copy out of the staging ring, waiting to be recorded together with the other copies into the same destination
+typedef struct UploadCopy
+{
+    VkBuffer dstBuffer;
+    VkImage dstImage;
+    VkBufferCopy bufferRegion;
+    VkBufferImageCopy imageRegion;
+} UploadCopy;
+
+typedef struct UploadStatistics
+{
+    uint32_t allocationCount;
+    uint32_t failedAllocationCount;             // requests larger than the ring, or made when it could not wait for space
+    uint32_t stallCount;                        // times an allocation waited for an upload batch to free its space
+    uint32_t copyRegionCount;
+    uint32_t copyCommandCount;
+    VkDeviceSize allocatedSize;
+    VkDeviceSize peakUsedSize;
+    VkDeviceSize completedSize;                 // the staging bytes of the batches known to have completed
+    double completedTime;                       // milliseconds from the first staging write to the observed completion, summed over those batches
+} UploadStatistics;
+
+// The acquire half of a queue family ownership transfer, kept until it is recorded on the graphics queue
+typedef struct UploadOwnershipTransfer
+{
+    uint64_t batchValue;
+    VkPipelineStageFlags dstStageMask;
+    bool isImage;
+    VkBufferMemoryBarrier bufferBarrier;
+    VkImageMemoryBarrier imageBarrier;
+} UploadOwnershipTransfer;
+
+// Copies recorded in batches for the dedicated transfer queue when the device has one, otherwise for the graphics queue.
+// Each submitted batch signals the next value of a timeline semaphore, so its completion can be polled without blocking.
+// Without timeline semaphores, the copies are recorded into `inlineCommandBuffer`, which is submitted by its owner.
+// The source data lives in one persistently mapped staging ring. The space used by a batch is reclaimed once its timeline value has been reached.
+typedef struct UploadManager
+{
+    VkDevice device;
+    VkQueue queue;
+    uint32_t queueFamilyIndex;
+    uint32_t graphicsQueueFamilyIndex;
+    VkCommandBuffer inlineCommandBuffer;
+    VkCommandPool commandPool;
+    VkCommandBuffer commandBuffers[UPLOAD_BATCH_COUNT];
+    uint64_t batchValues[UPLOAD_BATCH_COUNT];           // the timeline value signaled by the last submission of each command buffer
+    uint32_t currentBatchIndex;
+    bool isRecording;
+    VkSemaphore timelineSemaphore;
+    uint64_t lastSubmittedValue;
+    PFN_vkGetSemaphoreCounterValue getSemaphoreCounterValue;
+    PFN_vkWaitSemaphores waitSemaphores;
+    UploadOwnershipTransfer pendingTransfers[MAX_UPLOAD_OWNERSHIP_TRANSFER_COUNT];
+    uint32_t pendingTransferCount;
+    uint32_t submittedBatchCount;
+    uint32_t ownershipTransferCount;
+    VkBuffer stagingBuffer;
+    DeviceMemoryAllocation stagingMemory;
+    VkDeviceSize stagingHead;                           // where the next allocation starts
+    VkDeviceSize stagingUsedSize;                       // from the oldest unreclaimed allocation up to the head, wrap padding included
+    VkDeviceSize recordingStagingSize;                  // the part of `stagingUsedSize` owned by the batch being recorded
+    VkDeviceSize recordingQueuedSize;                   // the start of `recordingStagingSize` read by queued copies, which a submission hands to its batch
+    VkDeviceSize recordingLastAllocationPosition;       // where the newest allocation starts within `recordingStagingSize`
+    VkDeviceSize batchStagingSizes[UPLOAD_BATCH_COUNT]; // the part owned by each submitted batch, 0 once reclaimed
+    VkDeviceSize recordingUploadSize;                   // the bytes allocated for the batch being recorded, without the padding
+    VkDeviceSize batchUploadSizes[UPLOAD_BATCH_COUNT];
+    double recordingStartTime;
+    double batchStartTimes[UPLOAD_BATCH_COUNT];
+    UploadCopy pendingCopies[MAX_UPLOAD_COPY_COUNT];
+    uint32_t pendingCopyCount;
+    UploadStatistics statistics;
+} UploadManager;
+
+enum
+{
+    MAX_RENDER_GRAPH_RESOURCE_COUNT = 32,
+    MAX_RENDER_GRAPH_PASS_COUNT = 32,
+    MAX_RENDER_GRAPH_PASS_USE_COUNT = 8
 };
 
+// How a pass accesses a resource, which decides the pipeline stages, the access types and, for an image, the layout
+typedef enum RenderGraphUsage
+{
+    RENDER_GRAPH_USAGE_TRANSFER_READ,
+    RENDER_GRAPH_USAGE_TRANSFER_WRITE,
+    RENDER_GRAPH_USAGE_COMPUTE_READ,                // storage buffers and images accessed by compute shaders
+    RENDER_GRAPH_USAGE_COMPUTE_WRITE,
+    RENDER_GRAPH_USAGE_COMPUTE_READ_WRITE,
+    RENDER_GRAPH_USAGE_TASK_READ_WRITE,             // storage buffers accessed by task shaders, e.g. an atomic counter
+    RENDER_GRAPH_USAGE_VERTEX_ATTRIBUTE_READ,
+    RENDER_GRAPH_USAGE_INDEX_READ,
+    RENDER_GRAPH_USAGE_INDIRECT_READ,
+    RENDER_GRAPH_USAGE_FRAGMENT_SAMPLED_READ,
+    RENDER_GRAPH_USAGE_COLOR_ATTACHMENT_WRITE,
+    RENDER_GRAPH_USAGE_DEPTH_ATTACHMENT_WRITE,
+    RENDER_GRAPH_USAGE_HOST_READ,                   // read by the host after the fence of the submission
+    RENDER_GRAPH_USAGE_COUNT
+} RenderGraphUsage;
+
+// What the passes executed so far have done to a resource, from which the barrier in front of the next access is derived
+typedef struct RenderGraphResourceState
+{
+    VkPipelineStageFlags writeStages;               // of the last write, or the layout transition after it
+    VkAccessFlags writeAccess;
+    bool isWriteAvailable;                          // a barrier has already made the last write available
+    VkPipelineStageFlags readStages;                // the reads since the last write, which the next write has to wait for
+    VkPipelineStageFlags visibleStages;             // the last write is visible to these stages and access types
+    VkAccessFlags visibleAccess;
+    VkImageLayout layout;
+} RenderGraphResourceState;
+
+// A buffer range or an image accessed by the passes, either imported from its owner or a transient image created by the graph.
+// Transient images whose passes do not overlap share the same memory.
+typedef struct RenderGraphResource
+{
+    const char* name;
+    VkBuffer buffer;                                // VK_NULL_HANDLE for an image
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    VkImage image;
+    VkImageView view;                               // only created for the transient images
+    VkImageSubresourceRange subresourceRange;
+    bool isTransient;
+    VkImageCreateInfo transientCreateInfo;
+    uint32_t aliasedResource;                       // the transient image that occupies the same memory before this one, UINT32_MAX if none
+    VkDeviceSize memoryOffset;
+    uint32_t firstPass;                             // the passes using the resource, UINT32_MAX if none does
+    uint32_t lastPass;
+    bool isUsedInExecution;
+    RenderGraphResourceState state;
+} RenderGraphResource;
+
+typedef struct RenderGraphPassUse
+{
+    uint32_t resource;
+    RenderGraphUsage usage;
+} RenderGraphPassUse;
+
+// Records the commands of a pass. `frameData` is the one given to ExecuteRenderGraph.
+typedef void (*RenderGraphRecordProc)(VkCommandBuffer commandBuffer, const void* frameData);
+
+typedef struct RenderGraphPass
+{
+    const char* name;
+    RenderGraphRecordProc recordProc;               // may be NULL for a pass that only makes its resources available to their uses
+    bool isEnabled;
+    uint32_t useCount;
+    RenderGraphPassUse uses[MAX_RENDER_GRAPH_PASS_USE_COUNT];
+} RenderGraphPass;
+
+typedef struct RenderGraphStatistics
+{
+    uint32_t executedPassCount;
+    uint32_t barrierBatchCount;                     // vkCmdPipelineBarrier calls
+    uint32_t bufferBarrierCount;
+    uint32_t imageBarrierCount;
+    uint32_t executionBarrierCount;                 // dependencies that need no memory barrier, e.g. a write after reads
+} RenderGraphStatistics;
+
+// Passes in the order of execution, each declaring the resources it reads and writes. The barriers in front of a pass are derived
+// from the state that the former passes, including those of the former executions, have left the resources in, and are issued in one batch.
+// The passes and resources are fixed once the graph is compiled, but a pass can be disabled for an execution.
+typedef struct RenderGraph
+{
+    VkDevice device;
+    uint32_t resourceCount;
+    RenderGraphResource resources[MAX_RENDER_GRAPH_RESOURCE_COUNT];
+    uint32_t passCount;
+    RenderGraphPass passes[MAX_RENDER_GRAPH_PASS_COUNT];
+    bool isCompiled;
+    DeviceMemoryAllocation transientMemory;
+    VkDeviceSize unaliasedTransientSize;            // the memory that the transient images would take without aliasing
+    RenderGraphStatistics lastExecution;
+} RenderGraph;
+
 extern bool CreateShaderModule(const char* fileName, VkShaderModule* pShaderModule);
 
-extern bool CreateTexturePipelineAssets(VkPhysicalDevice currPhysicalDevice, VkDevice specDevice, uint32_t graphicsQueueFamilyIndex, VkCommandBuffer commandBuffer,
-                                        const char* vertSPVFilePath, const char* fragSPVFilePath, VkPipelineLayout pipelineLayout, VkRenderPass renderPass,
-                                        VkImage* outImage, VkImageView* outImageView, VkSampler* outSampler, VkBuffer* pHostUploadBuffer, VkDeviceMemory* pHostUploadMemory, VkDeviceMemory* pTextureImageMemory,
-                                        VkPipelineCache* outPipelineCache, VkPipeline* outPipeline);
+extern VkPipelineCache CreatePersistentPipelineCache(VkPhysicalDevice physicalDevice, VkDevice device, const char* filePath, bool enableCreationFeedback);
+
+extern bool SavePersistentPipelineCache(VkPhysicalDevice physicalDevice, VkDevice device, VkPipelineCache pipelineCache, const char* filePath);
+
+// Returns the pNext for VkGraphicsPipelineCreateInfo, with the creation feedback of `record` chained in front of `pNext` when it is enabled.
+extern const void* PreparePipelineCreationFeedback(PipelineCreationFeedbackRecord* record, const void* pNext, uint32_t stageCount);
+
+extern void RecordPipelineCreation(const char* pipelineName, const PipelineCreationFeedbackRecord* record, double creationTime);
+
+extern void PrintPipelineCacheStatistics(void);
+
+// Returns the pNext for VkGraphicsPipelineCreateInfo of a pipeline drawn into `target`, with the attachment formats
+// in `outCreateInfo` chained in front of `pNext` for dynamic rendering.
+extern const void* PrepareRenderTargetPipelineInfo(const RenderTarget* target, VkPipelineRenderingCreateInfoKHR* outCreateInfo, const void* pNext);
+
+// Begins the pass into `target` with the color and depth attachments cleared to `clearValues`.
+// With dynamic rendering, the attachments are transitioned from VK_IMAGE_LAYOUT_UNDEFINED first.
+extern void BeginRenderTarget(VkCommandBuffer commandBuffer, const RenderTarget* target, const VkClearValue clearValues[2]);
+
+// Ends the pass into `target`, leaving the single sampled color image in `target->finalColorLayout`
+extern void EndRenderTarget(VkCommandBuffer commandBuffer, const RenderTarget* target);
+
+extern void InitializeDynamicResolution(DynamicResolution* controller, double gpuTimeBudget, float minScale);
+
+// Adjusts the scale from the GPU time `gpuDuration` of a frame rendered at `renderedScale`, and returns the scale of the next frame.
+// A negative `gpuDuration`, i.e. one that is not available, keeps the scale.
+extern float UpdateDynamicResolution(DynamicResolution* controller, double gpuDuration, float renderedScale);
+
+// The part of `fullExtent` rendered at `scale`, at least one pixel on each axis
+extern VkExtent2D GetScaledRenderExtent(VkExtent2D fullExtent, float scale);
+
+// Upscales the top left `srcExtent` of `srcImage` in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, whose writes must have been made visible to transfers,
+// into the whole `dstExtent` of `dstImage` with a linear filter. The former contents of `dstImage` are discarded, and it is left in `dstFinalLayout`.
+extern void RecordUpscaleBlit(VkCommandBuffer commandBuffer, VkImage srcImage, VkExtent2D srcExtent, VkImage dstImage, VkExtent2D dstExtent, VkImageLayout dstFinalLayout);
+
+extern void PrintDynamicResolutionStatistics(const DynamicResolution* controller);
+
+extern void InitializeRenderGraph(RenderGraph* graph, VkDevice device);
+
+// All the resources must be added before CompileRenderGraph. Each returns the index of the resource, or UINT32_MAX when the graph is full.
+extern uint32_t ImportRenderGraphBuffer(RenderGraph* graph, const char* name, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size);
+
+// `currentLayout` is the layout that `image` is in before the first execution
+extern uint32_t ImportRenderGraphImage(RenderGraph* graph, const char* name, VkImage image, const VkImageSubresourceRange* subresourceRange, VkImageLayout currentLayout);
+
+// An image that is created by CompileRenderGraph and whose contents do not outlive an execution, so its memory can be shared with the other transient images
+extern uint32_t AddRenderGraphTransientImage(RenderGraph* graph, const char* name, const VkImageCreateInfo* createInfo, VkImageAspectFlags aspectMask);
+
+// Returns the index of the pass, or UINT32_MAX when the graph is full. The passes are executed in the order they are added.
+extern uint32_t AddRenderGraphPass(RenderGraph* graph, const char* name, RenderGraphRecordProc recordProc);
+
+extern bool UseRenderGraphResource(RenderGraph* graph, uint32_t pass, uint32_t resource, RenderGraphUsage usage);
+
+// Creates the transient images, placing those whose passes do not overlap at the same memory offset
+extern bool CompileRenderGraph(RenderGraph* graph);
+
+// A disabled pass is skipped together with its barriers until it is enabled again. Every pass is enabled when added.
+extern void SetRenderGraphPassEnabled(RenderGraph* graph, uint32_t pass, bool isEnabled);
+
+extern VkImage GetRenderGraphImage(const RenderGraph* graph, uint32_t resource);
+
+extern VkImageView GetRenderGraphImageView(const RenderGraph* graph, uint32_t resource);
+
+// Records the enabled passes into `commandBuffer`, each preceded by one batch of the barriers that its accesses need
+extern void ExecuteRenderGraph(RenderGraph* graph, VkCommandBuffer commandBuffer, const void* frameData);
+
+extern void PrintRenderGraphStatistics(const RenderGraph* graph);
+
+// None of the executions may still be in use
+extern void DestroyRenderGraph(RenderGraph* graph);
+
+// Compiles a graph of three transient images on `device`, and checks that only the two whose passes do not overlap share their memory
+extern bool RunRenderGraphSelfTest(VkDevice device);
+
+typedef void (*ParallelJobProc)(void* jobData);
+
+extern uint32_t GetLogicalProcessorCount(void);
+
+// Runs `jobCount` jobs, each `jobSize` bytes long in `jobs`, on up to `threadCount` threads including the calling one. 0 means one thread per logical processor.
+// Returns after all the jobs have finished.
+extern void RunJobsInParallel(ParallelJobProc jobProc, void* jobs, size_t jobSize, uint32_t jobCount, uint32_t threadCount);
+
+extern bool InitializeDeviceMemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device);
+
+// All the allocations must have been freed before this is called
+extern void DestroyDeviceMemoryAllocator(void);
+
+// Returns the memory type in `memoryTypeBits` that scores best for `usage`, or UINT32_MAX if no type has the flags the usage requires.
+extern uint32_t FindMemoryTypeIndex(uint32_t memoryTypeBits, DeviceMemoryUsage usage);
+
+extern VkMemoryPropertyFlags GetMemoryTypePropertyFlags(uint32_t memoryTypeIndex);
+
+extern bool AllocateDeviceMemory(const VkMemoryRequirements* requirements, DeviceMemoryUsage usage, bool isOptimalTilingImage, DeviceMemoryAllocation* outAllocation);
+
+extern bool AllocateAndBindBufferMemory(VkBuffer buffer, DeviceMemoryUsage usage, DeviceMemoryAllocation* outAllocation);
+
+extern bool AllocateAndBindImageMemory(VkImage image, DeviceMemoryUsage usage, DeviceMemoryAllocation* outAllocation);
+
+extern void FreeDeviceMemory(DeviceMemoryAllocation* allocation);
+
+extern void GetDeviceMemoryStatistics(DeviceMemoryStatistics* outStats);
+
+// `transferQueueFamilyIndex` is UINT32_MAX when the device has no dedicated transfer queue family, and the batches then go to the graphics queue.
+// A non-null `inlineCommandBuffer` is used instead of any batch when timeline semaphores are not supported.
+extern bool CreateUploadManager(VkDevice device, uint32_t graphicsQueueFamilyIndex, uint32_t transferQueueFamilyIndex, VkCommandBuffer inlineCommandBuffer,
+                                UploadManager* outManager);
+
+extern void DestroyUploadManager(UploadManager* manager);
+
+// Returns the command buffer of the batch being recorded, beginning a new batch if there is none.
+// When the oldest batch is still executing, this waits for it with `waitsForBatch`, otherwise it returns VK_NULL_HANDLE so that a render loop can retry later.
+extern VkCommandBuffer BeginUploadBatch(UploadManager* manager, bool waitsForBatch);
+
+// Records the queued copies and submits the batch being recorded, if any. `outBatchValue` receives the timeline value that signals the completion of every batch submitted so far,
+// 0 when there has been none.
+extern bool SubmitUploadBatch(UploadManager* manager, uint64_t* outBatchValue);
+
+// The timeline value of the last completed batch, without blocking
+extern uint64_t GetCompletedUploadValue(const UploadManager* manager);
+
+// Returns the mapped address of `size` bytes of the staging ring, aligned to `alignment`, and their offset in `manager->stagingBuffer` in `outOffset`.
+// When the ring is full, the batch being recorded is submitted and this waits for the oldest batch with `waitsForSpace`.
+// Returns NULL if the request is larger than the ring, or if there is no space and it cannot wait, so that the caller can use a buffer of its own.
+// A submission only takes the space up to the last queued copy, the allocations after it stay with the next batch. The copies out of an allocation
+// must still be queued before the next allocation, which may submit the current batch.
+extern void* AllocateUploadStagingMemory(UploadManager* manager, VkDeviceSize size, VkDeviceSize alignment, bool waitsForSpace, VkDeviceSize* outOffset);
+
+// Queues a copy from `srcOffset` of the staging ring. The copies into the same destination are recorded as the regions of a single command
+// before the next release barrier or submission, so they must not overlap each other.
+extern bool QueueBufferUpload(UploadManager* manager, VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize srcOffset, VkDeviceSize size);
+
+// The same as QueueBufferUpload for an image in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, `region->bufferOffset` being the offset in the staging ring
+extern bool QueueImageUpload(UploadManager* manager, VkImage dstImage, const VkBufferImageCopy* region);
+
+// Without timeline semaphores, tells the manager that the inline command buffer has completed, so that the whole staging ring can be reused
+extern void CompleteInlineUploads(UploadManager* manager);
+
+extern void PrintUploadStatistics(UploadManager* manager);
+
+// Records the queued copies, then makes the copies into `buffer` recorded in the current batch visible to `dstStageMask` and `dstAccessMask` on the graphics queue,
+// releasing the buffer from the transfer queue family when the batch goes to the dedicated transfer queue.
+extern bool ReleaseUploadedBuffer(UploadManager* manager, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, VkPipelineStageFlags dstStageMask,
+                                VkAccessFlags dstAccessMask);
+
+// The same as ReleaseUploadedBuffer for an image, along with its transition from `oldLayout` to `newLayout`
+extern bool ReleaseUploadedImage(UploadManager* manager, VkImage image, const VkImageSubresourceRange* subresourceRange, VkImageLayout oldLayout,
+                                VkImageLayout newLayout, VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask);
+
+// Records into `commandBuffer` of the graphics queue the acquire barriers of the resources released by the batches up to `batchValue`,
+// UINT64_MAX including the batch being recorded. The submission of `commandBuffer` has to wait for the timeline semaphore to reach the value
+// of those batches, unless GetCompletedUploadValue has already reached it.
+extern void RecordUploadAcquireBarriers(UploadManager* manager, VkCommandBuffer commandBuffer, uint64_t batchValue);
+
+extern void PrintDeviceMemoryStatistics(void);
+
+extern bool RunDeviceMemoryChurnBenchmark(uint32_t iterationCount);
+
+// Checks the buddy split and merge, the alignment rounding, the separation of linear and optimal resources, the dedicated fallback and the statistics
+// with requests whose results do not depend on the device. Must run before anything has been allocated.
+extern bool RunDeviceMemoryAllocatorSelfTest(void);
+
+// Compares the GPU time of drawing `vertexCount` vertices with the translate, rotate and ortho matrices rebuilt per vertex
+// against the same draw with a CPU-built model-view-projection matrix. `renderTarget` must not be in use.
+extern bool RunVertexThroughputBenchmark(VkDevice specDevice, VkQueue queue, VkCommandPool commandPool, const RenderTarget* renderTarget,
+                                        VkPipelineCache pipelineCache, float timestampPeriod, uint32_t vertexCount);
+
+// Compares the GPU time of drawing `instanceCount` copies of a large sphere with its triangles in the generated order, in random order,
+// and in random order reordered by OptimizeVertexCache and OptimizeVertexFetch, along with the simulated cache behaviour of each order.
+extern bool RunIndexOrderBenchmark(VkDevice specDevice, VkQueue queue, VkCommandPool commandPool, const RenderTarget* renderTarget,
+                                    VkPipelineCache pipelineCache, float timestampPeriod, uint32_t instanceCount);
+
+// Draws `vertexCount` vertices quantized with `compression` from each vertex stream layout, once fetching all of their attributes and once only their positions.
+extern bool RunVertexLayoutBenchmark(VkDevice specDevice, VkQueue queue, VkCommandPool commandPool, const RenderTarget* renderTarget,
+                                    VkPipelineCache pipelineCache, float timestampPeriod, uint32_t vertexCount, VertexCompression compression);
+
+// Loads the image files at `texturePaths` as the layers of one 2D array texture, which requires them to have the same size and format,
+// and records their upload into the current batch of `uploadManager`. Without any path, images/geom.bmp is loaded, or a checkerboard generated if it cannot be.
+// With a non-null `hostImageCopy`, the CPU writes the image directly whenever the device supports it for the texture format.
+// Files without precomputed levels get a mip chain generated into `commandBuffer` of the graphics queue with `mipmapGeneration`,
+// which may leave resources in `pMipmapComputeResources`.
+extern bool CreateTextureAssets(VkPhysicalDevice currPhysicalDevice, VkDevice specDevice, uint32_t graphicsQueueFamilyIndex, VkCommandBuffer commandBuffer, UploadManager* uploadManager,
+                                const HostImageCopySupport* hostImageCopy,
+                                const char* const* texturePaths, uint32_t textureCount, MipmapGeneration mipmapGeneration, VkPipelineCache pipelineCache,
+                                MipmapComputeResources* pMipmapComputeResources, VkImage* outImage, VkImageView* outImageView, VkSampler* outSampler, VkBuffer* pHostUploadBuffer, DeviceMemoryAllocation* pHostUploadMemory, DeviceMemoryAllocation* pTextureImageMemory);
+
+// Whether the device can write an image of `format` with `usage` and `flags` from the host, and leave it in `dstLayout`. Always false for a NULL `hostImageCopy`.
+// `outIsOptimal` tells whether the device accesses such an image as fast as one without VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT.
+extern bool CanCopyImageFromHost(VkPhysicalDevice physicalDevice, const HostImageCopySupport* hostImageCopy, VkFormat format, VkImageUsageFlags usage,
+                                VkImageCreateFlags flags, VkImageLayout dstLayout, bool* outIsOptimal);
+
+// Writes the first `layerInfo->levelCount` levels of the `layerCount` layers in `hostData`, `layerStride` bytes apart, into `image` created with
+// VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT. All the `levelCount` levels are transitioned from VK_IMAGE_LAYOUT_UNDEFINED to `dstLayout` on the host beforehand.
+extern bool CopyImageDataFromHost(VkDevice specDevice, const HostImageCopySupport* hostImageCopy, VkImage image, const ImageFile* layerInfo, const uint8_t* hostData,
+                                uint32_t levelCount, uint32_t layerCount, VkDeviceSize layerStride, VkImageLayout dstLayout);
+
+// Uploads a generated RGBA8 texture with a full mip chain `iterationCount` times through a staging buffer and a copy on `queue`,
+// and as many times through host image copies when `hostImageCopy` is not NULL, reporting the latency and the peak device memory of both.
+extern bool RunTextureUploadBenchmark(VkPhysicalDevice physicalDevice, VkDevice specDevice, VkQueue queue, VkCommandPool commandPool,
+                                    const HostImageCopySupport* hostImageCopy, uint32_t iterationCount);
+
+extern VkPipeline CreateTextureGraphicsPipeline(VkDevice specDevice, const char* vertSPVFilePath, const char* fragSPVFilePath, const VertexLayout* vertexLayout,
+                                                VkPipelineLayout pipelineLayout, const RenderTarget* renderTarget, VkPipelineCache pipelineCache);
 
 extern VkPipeline CreateGeometryShaderGraphicsPipeline(VkDevice specDevice, const char* vertSPVFilePath, const char* fragSPVFilePath, const char* geomSPVFilePath,
-                                        VkPipelineLayout pipelineLayout, VkRenderPass renderPass, VkPipelineCache* outPipelineCache);
+                                        const VertexLayout* vertexLayout, VkPipelineLayout pipelineLayout, const RenderTarget* renderTarget, VkPipelineCache pipelineCache);
+
+// A UV sphere around the origin. The poles only have one triangle per slice.
+extern bool CreateSphereMesh(uint32_t sliceCount, uint32_t stackCount, float radius, IndexedMesh* outMesh);
+
+extern void FreeIndexedMesh(IndexedMesh* mesh);
+
+// Splits `mesh` into meshlets of at most `maxVertexCount` vertices and `maxTriangleCount` triangles.
+// Each meshlet grows from a seed triangle over the neighbouring triangles that add the fewest new vertices, so the meshlets stay compact.
+extern bool BuildMeshlets(const IndexedMesh* mesh, uint32_t maxVertexCount, uint32_t maxTriangleCount, MeshletData* outData);
+
+extern void FreeMeshlets(MeshletData* data);
+
+extern const char* GetVertexStreamLayoutName(VertexStreamLayout streamLayout);
+
+extern bool ParseVertexStreamLayout(const char* name, VertexStreamLayout* outStreamLayout);
+
+// Lays out `attributes` in streams for `vertexCount` vertices. With VERTEX_STREAM_LAYOUT_POSITION_SPLIT, `attributes[0]` is the position.
+extern bool BuildVertexLayout(VertexStreamLayout streamLayout, const VertexAttributeSource* attributes, uint32_t attributeCount, uint32_t vertexCount,
+                                VertexLayout* outLayout);
 
+// Writes `attributes` in the layout of `layout` into `dst`, which must hold `layout->totalSize` bytes
+extern void PackVertexData(const VertexLayout* layout, const VertexAttributeSource* attributes, uint32_t vertexCount, void* dst);
+
+// Describes the attributes at the locations in `locationMask`, one bit per location, and the streams that hold them.
+// Returns the binding count and stores the attribute count in `outAttributeCount`.
+extern uint32_t FillVertexInputDescriptions(const VertexLayout* layout, uint32_t locationMask, VkVertexInputBindingDescription* outBindings,
+                                            VkVertexInputAttributeDescription* outAttributes, uint32_t* outAttributeCount);
+
+extern const char* GetVertexCompressionName(VertexCompression compression);
+
+extern bool ParseVertexCompression(const char* name, VertexCompression* outCompression);
+
+// Quantizes the float attributes of the `meshName` mesh, telling them apart by their locations, and reports the size and the error of each.
+// `attributes[0]` is the position. With VERTEX_COMPRESSION_NONE, the attributes are copied as they are.
+extern bool QuantizeVertexAttributes(const VertexAttributeSource* attributes, uint32_t attributeCount, uint32_t vertexCount, VertexCompression compression,
+                                    const char* meshName, QuantizedVertexAttributes* outAttributes);
+
+extern void FreeQuantizedVertexAttributes(QuantizedVertexAttributes* attributes);
+
+extern const char* GetImageFileTypeName(ImageFileType type);
+
+// Maps the BMP, TGA, PPM or KTX2 file at `path` into memory and parses its header
+extern bool OpenImageFile(const char* path, ImageFile* outImage);
+
+// Makes DecodeImageFile decompress the blocks of `image` into RGBA texels, for a device that cannot sample its format
+extern bool RequestImageFileDecompression(ImageFile* image);
+
+// Writes the levels of `image` into `dst`, which must hold `image->decodedSize` bytes, e.g. mapped staging memory
+extern bool DecodeImageFile(const ImageFile* image, void* dst);
+
+extern void CloseImageFile(ImageFile* image);
+
+// The block layout of the uncompressed formats the image loader produces and the compressed formats it accepts. NULL for any other format.
+extern const TextureFormatInfo* GetTextureFormatInfo(VkFormat format);
+
+extern VkDeviceSize GetTextureLevelSize(const TextureFormatInfo* formatInfo, uint32_t width, uint32_t height, uint32_t level);
+
+// Encodes 4 x 4 RGBA texels into a BC1 block without alpha
+extern void EncodeBC1Block(const uint8_t srcRGBA[TEXTURE_BLOCK_TEXEL_COUNT * 4], uint8_t dst[8]);
+
+// Encodes 4 x 4 RGBA texels into a BC7 block in mode 6
+extern void EncodeBC7Block(const uint8_t srcRGBA[TEXTURE_BLOCK_TEXEL_COUNT * 4], uint8_t dst[16]);
+
+// "bc1", "bc1-srgb", "bc7" or "bc7-srgb"
+extern bool ParseTextureEncodingFormat(const char* name, VkFormat* outFormat);
+
+// Encodes the image file at `srcPath` with a full mip chain into a KTX2 file of `format` on up to `threadCount` threads, 0 meaning one per logical processor,
+// and reports the quality and the size of the result
+extern bool EncodeTextureFile(const char* srcPath, const char* dstPath, VkFormat format, uint32_t threadCount);
+
+extern const char* GetMipmapGenerationName(MipmapGeneration generation);
+
+extern bool ParseMipmapGeneration(const char* name, MipmapGeneration* outGeneration);
+
+// The level count of a full mip chain down to 1 x 1
+extern uint32_t GetFullMipLevelCount(uint32_t width, uint32_t height);
+
+// Picks how the levels of a texture in `format` are generated, falling back from what is requested to what the device supports
+extern MipmapGeneration ResolveMipmapGeneration(VkPhysicalDevice physicalDevice, VkFormat format, MipmapGeneration requested);
+
+// Fills the levels below the first with a cascade of linear blits. All the levels must be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+// and are left in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+extern void RecordMipmapBlits(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height, uint32_t levelCount, uint32_t layerCount);
+
+// Fills the levels below the first with a compute shader averaging 2 x 2 texels of the level above, with the same layouts as RecordMipmapBlits.
+// The image must have been created with VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT and VK_IMAGE_USAGE_STORAGE_BIT.
+extern bool RecordMipmapCompute(VkDevice specDevice, VkCommandBuffer commandBuffer, VkImage image, VkFormat format, uint32_t width, uint32_t height,
+                                uint32_t levelCount, uint32_t layerCount, VkPipelineCache pipelineCache, MipmapComputeResources* outResources);
+
+extern void DestroyMipmapComputeResources(VkDevice specDevice, MipmapComputeResources* resources);
+
+// Reorders the triangles of `indices` into `dstIndices` for post-transform vertex cache locality, with Tom Forsyth's linear-speed algorithm.
+// `dstIndices` must not overlap `indices`.
+extern bool OptimizeVertexCache(uint32_t* dstIndices, const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount);
+
+// Reorders the vertices of `mesh` in the order in which its indices first reference them, so that the vertex fetches walk through memory.
+// Vertices that are never referenced are dropped.
+extern bool OptimizeVertexFetch(IndexedMesh* mesh);
+
+extern VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize);
+
+// The compute pipeline that frustum culls the instances and writes the indirect draw commands of the visible ones
+extern VkPipeline CreateCullingComputePipeline(VkDevice specDevice, const char* compSPVFilePath, VkPipelineLayout pipelineLayout, VkPipelineCache pipelineCache);
+
+// Each task work group culls `taskWorkGroupSize` meshlets, one per invocation, and launches a mesh work group of `meshWorkGroupSize` invocations per survivor.
 extern VkPipeline CreateMeshShaderGraphicsPipeline(VkDevice specDevice, const char* taskSPVFilePath, const char* meshSPVFilePath, const char* fragmentSPVFilePath,
-                                                    VkPipelineLayout pipelineLayout, VkRenderPass renderPass, VkPipelineCache* outPipelineCache);
+                                                    uint32_t taskWorkGroupSize, uint32_t meshWorkGroupSize, VkPipelineLayout pipelineLayout,
+                                                    const RenderTarget* renderTarget, VkPipelineCache pipelineCache);
+
+// Draws the same meshes as the mesh shader pipeline through the vertex pipeline, pulling the vertices from the meshlet storage buffers by index
+extern VkPipeline CreateMeshletReferenceGraphicsPipeline(VkDevice specDevice, const char* vertSPVFilePath, const char* fragmentSPVFilePath,
+                                                        VkPipelineLayout pipelineLayout, const RenderTarget* renderTarget, VkPipelineCache pipelineCache);
 
@@ -26,6 +26,44 @@ enum MY_CONSTANTS
     MESH_SHADER_PIPELINE_INDEX,
     TOTAL_PIPELINE_INDEX_COUNT,
 
+    FLATTEN_DRAW_TRANSFORM_INDEX = 0,
+    GRADIENT_DRAW_TRANSFORM_INDEX,
+    TEXTURE_DRAW_TRANSFORM_INDEX,
+    GEOMETRY_SHADER_DRAW_TRANSFORM_INDEX,
+    MESH_SHADER_DRAW_TRANSFORM_INDEX,           // the first of MESH_SHADER_WORK_GROUP_COUNT transforms, one per row of task work groups
+    MESH_SHADER_WORK_GROUP_COUNT = 4,           // the copies of the meshlet mesh, one per quadrant
+    TOTAL_DRAW_TRANSFORM_COUNT = MESH_SHADER_DRAW_TRANSFORM_INDEX + MESH_SHADER_WORK_GROUP_COUNT,
+
+    // The flatten, gradient and texture draws, whose transforms start at FLATTEN_DRAW_TRANSFORM_INDEX, can be culled on the GPU.
+    CULLED_DRAW_COUNT = 3,
+    // With GPU culling, the instances are spread over this many times the extent of the quad, so that some of them leave the view.
+    GPU_CULLING_FIELD_SCALE = 4,
+
+    DRAW_PUSH_CONSTANT_STAGES = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT,
+
+    // The sphere that the mesh shader pipeline draws from meshlets
+    MESHLET_SPHERE_SLICE_COUNT = 96,
+    MESHLET_SPHERE_STACK_COUNT = 48,
+
+    // The storage buffers of the meshlet descriptor set, in binding order, and the index buffer of the vertex pipeline reference draw
+    MESHLET_VERTEX_REGION = 0,
+    MESHLET_MESHLET_REGION,
+    MESHLET_VERTEX_INDEX_REGION,
+    MESHLET_TRIANGLE_REGION,
+    MESHLET_BOUNDS_REGION,
+    MESHLET_STORAGE_REGION_COUNT,
+    MESHLET_INDEX_REGION = MESHLET_STORAGE_REGION_COUNT,
+    MESHLET_REGION_COUNT,
+    // The culled meshlet counter of the task shader follows the storage buffer regions in the meshlet descriptor set
+    MESHLET_CULLING_COUNTER_BINDING = MESHLET_STORAGE_REGION_COUNT,
+    MESHLET_BINDING_COUNT,
+
+    MESHLET_BENCHMARK_RUN_COUNT = 5,
+
+    // The two triangles of the quad drawn by the flatten, gradient and texture pipelines
+    QUAD_VERTEX_COUNT = 4,
+    QUAD_INDEX_COUNT = 6,
+
     COLOR_DESCRIPTOR_SET_INDEX = 0,
     TEXTURE_DESCRIPTOR_SET_INDEX,
     DESCRIPTOR_SET_INDEX_COUNT
@@ -37,18 +75,57 @@ typedef struct SwapchainImageResources
     VkImageView view;
     VkImage msaaImage;          // MSAA image for render target (framebuffer)
     VkImageView msaaView;       // MSAA image view for render target (framebuffer)
-    VkCommandBuffer cmd_buf;
+    VkImage sceneImage;         // with dynamic resolution, the full size image that the frame is rendered into a scaled part of and then upscaled from
+    VkImageView sceneView;
     VkCommandBuffer graphics_to_present_cmd_buf;
     VkFramebuffer framebuffer;
 } SwapchainImageResources;
 
-typedef struct FlattenVertexUniform
+// The model-view-projection matrices of all the draws in a frame, built on the CPU.
+// This MUST BE coherent with `transform_block` in the vertex and mesh shaders.
+typedef struct DrawTransformUniform
+{
+    float mvp[TOTAL_DRAW_TRANSFORM_COUNT][16];
+    // The quad positions are decoded as `position * positionScale + positionBias`
+    float positionScale[4];
+    float positionBias[4];
+} DrawTransformUniform;
+
+static_assert(sizeof(DrawTransformUniform) == TOTAL_DRAW_TRANSFORM_COUNT * 64U + 32U, "Invalid DrawTransformUniform size");
+
+// Selects the matrix in DrawTransformUniform for the current draw
+typedef struct DrawPushConstants
 {
-    float u_factor[2];
-    float u_angle;
-} FlattenVertexUniform;
+    uint32_t drawIndex;
+    uint32_t meshletCount;          // only read by the task shader
+} DrawPushConstants;
+
+// This MUST BE coherent with `culling_block` in cull_objects.comp.glsl.
+typedef struct CullingPushConstants
+{
+    uint32_t objectCount;
+    uint32_t firstDrawIndex;
+    uint32_t maxDrawCount;          // the number of command slots of each culled draw in the indirect draw buffer
+    uint32_t indexCount;
+} CullingPushConstants;
+
+// The draw counts that the culling compute shader accumulates, followed by the number of instances it has tested for each draw.
+// This MUST BE coherent with `counter_block` in cull_objects.comp.glsl.
+typedef struct CullingCounters
+{
+    uint32_t drawCounts[CULLED_DRAW_COUNT];
+    uint32_t objectCount;
+} CullingCounters;
+
+static_assert(GRADIENT_DRAW_TRANSFORM_INDEX == FLATTEN_DRAW_TRANSFORM_INDEX + 1 && TEXTURE_DRAW_TRANSFORM_INDEX == FLATTEN_DRAW_TRANSFORM_INDEX + 2,
+            "The transforms of the culled draws must be consecutive");
 
-static_assert(sizeof(FlattenVertexUniform) == 12U, "Invalid FlattenVertexUniform size");
+// What the passes of the frame graph are recorded with
+typedef struct FrameRecordData
+{
+    uint32_t swapchainIndex;
+    uint32_t frameIndex;
+} FrameRecordData;
 
 static VkLayerProperties s_layerProperties[MAX_VULKAN_LAYER_COUNT];
 static const char* s_layerNames[MAX_VULKAN_LAYER_COUNT];
@@ -60,8 +137,16 @@ static VkPhysicalDevice s_currPhysicalDevice = VK_NULL_HANDLE;
 static VkInstance s_instance = VK_NULL_HANDLE;
 static VkDevice s_specDevice = VK_NULL_HANDLE;
 static bool s_supportIncrementalPresent = false;
+static uint32_t s_instanceApiVersion = VK_API_VERSION_1_0;
 static uint32_t s_queueFamilyPropertyCount = 0;
 static uint32_t s_specQueueFamilyIndex = 0;
+static uint32_t s_transferQueueFamilyIndex = UINT32_MAX;    // a queue family for transfers only, UINT32_MAX when the device has none
+static bool s_supportTimelineSemaphore = false;
+static bool s_useTransferQueue = true;              // upload through the dedicated transfer queue family when there is one
+static bool s_useHostImageCopy = true;              // write the textures from the host with VK_EXT_host_image_copy when the device allows it
+static HostImageCopySupport s_hostImageCopy;        // the entry points are NULL unless the hostImageCopy feature is enabled
+static bool s_useDynamicRendering = false;          // render without any render pass or framebuffer through VK_KHR_dynamic_rendering when the device allows it
+static UploadManager s_uploadManager = { 0 };
 static VkSurfaceKHR s_surface = VK_NULL_HANDLE;
 static VkSwapchainKHR s_swapchain = VK_NULL_HANDLE;
 static VkSurfaceFormatKHR s_surfaceFormat = { 0 };
@@ -79,32 +164,78 @@ static VkSemaphore s_imageOwnershipSemaphores[FRAME_LAG] = { VK_NULL_HANDLE };
 static VkCommandPool s_commandPool = VK_NULL_HANDLE;
 static VkCommandPool s_presentCommandPool = VK_NULL_HANDLE;
 static VkCommandBuffer s_commandBuffers[1] = { VK_NULL_HANDLE };
+static VkCommandBuffer s_frameCommandBuffers[FRAME_LAG] = { VK_NULL_HANDLE };     // re-recorded every frame
 static VkQueryPool s_timestampQueryPool = VK_NULL_HANDLE;
 static VkQueryPool s_occlusionQueryPool = VK_NULL_HANDLE;
-static VkBuffer s_hostVertexAndUniformBuffer = VK_NULL_HANDLE;
-static VkDeviceMemory s_hostVertexUniformMemory = VK_NULL_HANDLE;
-static VkDeviceMemory s_msaaColorImageMemory = VK_NULL_HANDLE;
+static DeviceMemoryAllocation s_msaaColorImageMemory = { 0 };
+static uint32_t s_requestedMSAASampleCount = 1;     // lowered to the highest count that both the color and depth attachments support
+static VkSampleCountFlagBits s_msaaSampleCount = VK_SAMPLE_COUNT_1_BIT;     // of the render pass, its attachments and every graphics pipeline
+static VkSampleCountFlags s_supportedMSAASampleCounts = VK_SAMPLE_COUNT_1_BIT;
 static VkDescriptorSetLayout s_descSetLayout = VK_NULL_HANDLE;
 static VkPipelineLayout s_pipelineLayout = VK_NULL_HANDLE;
 static VkRenderPass s_render_pass = VK_NULL_HANDLE;
-static VkPipelineCache s_pipelineCaches[TOTAL_PIPELINE_INDEX_COUNT] = { VK_NULL_HANDLE };
+static VkPipelineCache s_pipelineCache = VK_NULL_HANDLE;      // shared by all the pipelines and persisted across launches
 static VkPipeline s_pipelines[TOTAL_PIPELINE_INDEX_COUNT] = { VK_NULL_HANDLE };
 static VkDescriptorPool s_descPool = VK_NULL_HANDLE;
 static VkDescriptorSet s_descriptorSet = VK_NULL_HANDLE;
-static VkBuffer s_vertexCoordsBuffer = VK_NULL_HANDLE;
-static VkBuffer s_textureCoordsBuffer = VK_NULL_HANDLE;
-static VkBuffer s_colorBuffer = VK_NULL_HANDLE;
+static VkBuffer s_vertexBuffer = VK_NULL_HANDLE;            // all the streams of s_vertexLayout
+static VkBuffer s_indexBuffer = VK_NULL_HANDLE;
+static VertexLayout s_vertexLayout = { 0 };
+static QuantizedVertexAttributes s_quadVertexAttributes = { 0 };     // s_quad_vertex_attributes quantized with s_vertexCompression
 static VkBuffer s_uniformBuffer = VK_NULL_HANDLE;
 static VkBuffer s_hostUploadTextureBuffer = VK_NULL_HANDLE;
 static VkImage s_textureImage = VK_NULL_HANDLE;
 static VkImageView s_textureImageView = VK_NULL_HANDLE;
 static VkSampler s_textureSampler = VK_NULL_HANDLE;
-static VkDeviceMemory s_vertexMemory = VK_NULL_HANDLE;
-static VkDeviceMemory s_uniformMemory = VK_NULL_HANDLE;
-static VkDeviceMemory s_hostUploadTextureMemory = VK_NULL_HANDLE;
-static VkDeviceMemory s_textureMemory = VK_NULL_HANDLE;
+static DeviceMemoryAllocation s_vertexMemory = { 0 };
+static bool s_writeVertexDataDirectly = false;      // the vertex buffers live in device local host visible memory and need no staging copy
+static DeviceMemoryAllocation s_uniformMemory = { 0 };
+static uint8_t* s_uniformRingData = NULL;           // persistently mapped, FRAME_LAG slots of s_uniformSlotSize bytes
+static VkDeviceSize s_uniformSlotSize = 0;
+static VkDeviceSize s_minUniformBufferOffsetAlignment = 1;
+static DeviceMemoryAllocation s_hostUploadTextureMemory = { 0 };
+static DeviceMemoryAllocation s_textureMemory = { 0 };
+static MipmapComputeResources s_mipmapComputeResources = { 0 };     // only needed until the init commands have completed
+static VkBuffer s_instanceBuffer = VK_NULL_HANDLE;
+static DeviceMemoryAllocation s_instanceMemory = { 0 };
+static VkBuffer s_hostInstanceBuffer = VK_NULL_HANDLE;      // only exists when the instance buffer is not host visible
+static DeviceMemoryAllocation s_hostInstanceMemory = { 0 };     // persistently mapped, FRAME_LAG slots of s_hostInstanceSlotSize bytes
+static VkDeviceSize s_hostInstanceSlotSize = 0;
+static uint32_t s_instanceCapacity = 0;
+static uint32_t s_instanceUploadCount = 0;          // instances in the staging buffer that the next frame has to copy into the instance buffer
+static VkDeviceSize s_objectBoundsOffset = 0;       // the ObjectBounds array follows the InstanceData array in the instance buffer when GPU culling is used
+static VkDeviceSize s_minStorageBufferOffsetAlignment = 1;
+static VkDescriptorSetLayout s_cullingDescSetLayout = VK_NULL_HANDLE;
+static VkPipelineLayout s_cullingPipelineLayout = VK_NULL_HANDLE;
+static VkPipeline s_cullingPipeline = VK_NULL_HANDLE;
+static VkDescriptorSet s_cullingDescriptorSet = VK_NULL_HANDLE;
+static VkBuffer s_indirectDrawBuffer = VK_NULL_HANDLE;      // CULLED_DRAW_COUNT runs of s_instanceCapacity VkDrawIndexedIndirectCommand
+static DeviceMemoryAllocation s_indirectDrawMemory = { 0 };
+static VkBuffer s_cullingCounterBuffer = VK_NULL_HANDLE;
+static DeviceMemoryAllocation s_cullingCounterMemory = { 0 };
+static VkBuffer s_cullingReadbackBuffer = VK_NULL_HANDLE;   // the CullingCounters of each frame slot, read by the host after the fence of the slot
+static DeviceMemoryAllocation s_cullingReadbackMemory = { 0 };
+static VkDescriptorSetLayout s_meshletDescSetLayout = VK_NULL_HANDLE;
+static VkDescriptorSet s_meshletDescriptorSet = VK_NULL_HANDLE;
+static VkBuffer s_meshletBuffer = VK_NULL_HANDLE;          // MESHLET_REGION_COUNT regions, see CreateMeshletResources
+static DeviceMemoryAllocation s_meshletMemory = { 0 };
+static VkDeviceSize s_meshletIndexOffset = 0;
+static uint32_t s_meshletIndexCount = 0;            // the triangles of the meshlet mesh drawn through the vertex pipeline
+static uint32_t s_meshletCount = 0;
+static uint32_t s_taskWorkGroupSize = 0;            // the meshlets culled by each task work group, one per invocation
+static uint32_t s_meshWorkGroupSize = 0;
+static VkBuffer s_meshletCullingCounterBuffer = VK_NULL_HANDLE;
+static DeviceMemoryAllocation s_meshletCullingCounterMemory = { 0 };
+static VkBuffer s_meshletCullingReadbackBuffer = VK_NULL_HANDLE;   // the culled meshlet count of each frame slot, read by the host after the fence of the slot
+static DeviceMemoryAllocation s_meshletCullingReadbackMemory = { 0 };
 
 static PFN_vkCmdDrawMeshTasksEXT dyn_vkCmdDrawMeshTasksEXT = NULL;
+static PFN_vkCmdDrawIndexedIndirectCountKHR dyn_vkCmdDrawIndexedIndirectCountKHR = NULL;
+static PFN_vkCmdBeginRenderingKHR dyn_vkCmdBeginRenderingKHR = NULL;
+static PFN_vkCmdEndRenderingKHR dyn_vkCmdEndRenderingKHR = NULL;
+static PFN_vkCreateRenderPass2KHR dyn_vkCreateRenderPass2KHR = NULL;
+static PFN_vkCmdBeginRenderPass2KHR dyn_vkCmdBeginRenderPass2KHR = NULL;
+static PFN_vkCmdEndRenderPass2KHR dyn_vkCmdEndRenderPass2KHR = NULL;
 
 static uint32_t s_maxTaskWorkGroupTotalCount = 0U;
 static uint32_t s_maxTaskWorkGroupInvocations = 0U;
@@ -125,12 +256,55 @@ static uint32_t s_maxPreferredTaskWorkGroupInvocations = 0U;
 static uint32_t s_maxPreferredMeshWorkGroupInvocations = 0U;
 static bool s_supportFragmentShadingRate = false;
 
+static bool s_isHeadless = false;                   // render into offscreen images without any window or swapchain
+static int s_userDeviceIndex = -1;                  // the physical device index given on the command line, or -1 to ask
+static uint32_t s_headlessFrameCount = 1000U;       // how many frames to render in headless mode
+static VkImageLayout s_colorAttachmentFinalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+static DeviceMemoryAllocation s_offscreenColorImageMemory = { 0 };
+static DeviceMemoryAllocation s_sceneColorImageMemory = { 0 };
+static const char* s_pipelineCacheFilePath = "pipeline_cache.bin";
+static bool s_discardPipelineCacheFile = false;    // ignore the existing cache file to measure a cold start
+static bool s_supportPipelineCreationFeedback = false;
+static uint32_t s_pipelineThreadCount = 0;          // 0 means one thread per logical processor
+static uint32_t s_allocChurnIterationCount = 0;     // run the device memory churn benchmark at startup when non-zero
+static bool s_runSelfTest = false;                  // run the deterministic checks of the device memory allocator and the render graph, and exit
+static uint32_t s_vertexBenchmarkVertexCount = 0;   // run the vertex throughput benchmark before the render loop when non-zero
+static VertexStreamLayout s_vertexStreamLayout = VERTEX_STREAM_LAYOUT_SEPARATE;
+static VertexCompression s_vertexCompression = VERTEX_COMPRESSION_NONE;
+static uint32_t s_vertexLayoutBenchmarkVertexCount = 0;     // run the vertex layout benchmark with this many vertices per draw when non-zero
+static const char* s_texturePaths[MAX_TEXTURE_FILE_COUNT];  // the layers of the texture, images/geom.bmp when there is none
+static uint32_t s_textureFileCount = 0;
+static MipmapGeneration s_mipmapGeneration = MIPMAP_GENERATION_AUTO;
+static const char* s_encodeTextureSrcPath = NULL;   // encode this image into a KTX2 file instead of rendering when non-NULL
+static const char* s_encodeTextureDstPath = NULL;
+static VkFormat s_encodeTextureFormat = VK_FORMAT_BC7_UNORM_BLOCK;
+static uint32_t s_instanceCount = 1U;               // instances drawn by each of the flatten, gradient and texture pipelines
+static bool s_runInstanceScalingBenchmark = false;  // replace the headless render loop with the instance scaling benchmark
+static bool s_useGPUCulling = false;                // frustum cull the instances in a compute pass and draw the visible ones indirectly
+static uint32_t s_textureUploadBenchmarkIterationCount = 0;     // run the texture upload benchmark this many times per upload path when non-zero
+static uint32_t s_resizeBenchmarkCount = 0;         // resize the offscreen images this many times before the headless render loop when non-zero
+static uint32_t s_meshletBenchmarkCopyCount = 0;    // run the meshlet throughput benchmark with this many copies of the meshlet mesh per draw when non-zero
+static uint32_t s_indexBenchmarkCopyCount = 0;      // run the index order benchmark with this many copies of its sphere per draw when non-zero
+static double s_gpuTimeBudget = 0.0;                // the GPU time per frame in milliseconds that dynamic resolution scales the render size for, 0 to always render at the full size
+static uint32_t s_minRenderScalePercent = 50U;      // the lowest render size that dynamic resolution may scale down to
+static bool s_useDynamicResolution = false;         // render into the scene images and upscale them, cleared when the color format cannot be blitted
+static DynamicResolution s_dynamicResolution = { 0 };
+static float s_frameRenderScales[FRAME_LAG] = { 0.0f };     // the scale that the last rendering in each frame slot has used
+static RenderGraph s_frameGraph = { 0 };            // the passes recorded for each frame, see CreateFrameGraph
+static uint32_t s_instanceUploadPass = UINT32_MAX;
+static uint32_t s_meshletCounterResetPass = UINT32_MAX;
+static uint32_t s_readbackPasses[FRAME_LAG];        // one for each frame slot, enabled for the slot being recorded
+static uint32_t s_hostReadbackPasses[FRAME_LAG];
+
 static bool s_isRenderPrepared = false;
 static bool s_isRotating = true;
 static float s_currRorationDegree = 0.0f;
 static float s_gpuTimestampPeriod = 0.0f;
 static double s_currGPUDuration = 0.0;
 static uint64_t s_currOcclusionCount = 0;
+static uint32_t s_currVisibleObjectCount = 0;
+static uint32_t s_currCulledObjectCount = 0;
+static uint32_t s_currCulledMeshletCount = 0;
 
 static struct
 {
@@ -138,8 +312,8 @@ static struct
     VkImageView image_view;
     VkImage msaaImage;
     VkImageView msaaView;
-    VkDeviceMemory device_memory;
-    VkDeviceMemory msaaDeviceMemory;
+    DeviceMemoryAllocation device_memory;
+    DeviceMemoryAllocation msaaDeviceMemory;
 } s_depthResource;
 
 static const char* const s_deviceTypes[] = {
@@ -150,7 +324,7 @@ static const char* const s_deviceTypes[] = {
     "CPU"
 };
 
-static const float s_vertex_coords_data[4 * 4] = {
+static const float s_vertex_coords_data[QUAD_VERTEX_COUNT * 4] = {
     // bottom left
     -0.2f, 0.2f, 0.0f, 1.0f,
     // bottom right
@@ -161,7 +335,7 @@ static const float s_vertex_coords_data[4 * 4] = {
     0.2f, -0.2f, 0.0f, 1.0f
 };
 
-static const float s_texture_coords_data[4 * 2] = {
+static const float s_texture_coords_data[QUAD_VERTEX_COUNT * 2] = {
     // bottom left
     0.0f, 0.0f,
     // bottom right
@@ -172,7 +346,7 @@ static const float s_texture_coords_data[4 * 2] = {
     1.0f, 1.0f
 };
 
-static const float s_vertex_color_data[4 * 4] = {
+static const float s_vertex_color_data[QUAD_VERTEX_COUNT * 4] = {
     // bottom left
     0.9f, 0.1f, 0.1f, 1.0f,
     // bottom right
@@ -183,6 +357,35 @@ static const float s_vertex_color_data[4 * 4] = {
     0.9f, 0.1f, 0.9f, 1.0f
 };
 
+// The per-vertex attributes of the quad, which are quantized into s_quadVertexAttributes and distributed over the vertex streams by s_vertexLayout.
+// The position comes first.
+static const VertexAttributeSource s_quad_vertex_attributes[] = {
+    {
+        .location = VERTEX_BUFFER_LOCATION_INDEX,
+        .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+        .size = sizeof(float[4]),
+        .data = s_vertex_coords_data
+    },
+    {
+        .location = COLOR_BUFFER_LOCATION_INDEX,
+        .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+        .size = sizeof(float[4]),
+        .data = s_vertex_color_data
+    },
+    {
+        .location = TEXCOORDS_BUFFER_LOCATION_INDEX,
+        .format = VK_FORMAT_R32G32_SFLOAT,
+        .size = sizeof(float[2]),
+        .data = s_texture_coords_data
+    }
+};
+
+// The same winding as the triangle strip that the quad used to be drawn as
+static const uint16_t s_quad_index_data[QUAD_INDEX_COUNT] = {
+    0, 1, 2,
+    2, 1, 3
+};
+
 static inline bool IsSeperatePresentQueue(void)
 {
     return s_graphicsQueueFamilyIndex != s_presentQueueFamilyIndex;
@@ -287,6 +490,7 @@ static bool InitializeVulkanInstance(const char *appName, const char *engineName
         return false;
     }
     printf("Current API version: %u.%u.%u\n", VK_VERSION_MAJOR(apiVersion), VK_VERSION_MINOR(apiVersion), VK_VERSION_PATCH(apiVersion));
+    s_instanceApiVersion = apiVersion;
 
     // initialize the VkApplicationInfo structure
     const VkApplicationInfo app_info = {
@@ -334,12 +538,14 @@ static bool InitializeVulkanInstance(const char *appName, const char *engineName
             availExtensionNames[availExtensionCount++] = currExtName;
             continue;
         }
+#ifdef _WIN32
         if (strcmp(currExtName, VK_KHR_WIN32_SURFACE_EXTENSION_NAME) == 0)
         {
             supportFurfaceWin32 = true;
             availExtensionNames[availExtensionCount++] = currExtName;
             continue;
         }
+#endif
         if (strcmp(currExtName, VK_EXT_SWAPCHAIN_COLOR_SPACE_EXTENSION_NAME) == 0)
         {
             supportColorSpaceExt = true;
@@ -356,11 +562,13 @@ static bool InitializeVulkanInstance(const char *appName, const char *engineName
     printf("%s %s supported!\n", VK_KHR_SURFACE_EXTENSION_NAME, notStr);
     notStr = "is";
 
+#ifdef _WIN32
     if (!supportFurfaceWin32) {
         notStr = "not";
     }
     printf("%s %s supported!\n", VK_KHR_WIN32_SURFACE_EXTENSION_NAME, notStr);
     notStr = "is";
+#endif
 
     if (!supportColorSpaceExt) {
         notStr = "not";
@@ -427,6 +635,19 @@ static void ParseDepthStencilResolveModes(char dstBuffer[], size_t bufferSize, V
     }
 }
 
+static bool IsQueueFamilyPresentable(uint32_t queueFamilyIndex)
+{
+#ifdef _WIN32
+    if (!s_isHeadless) {
+        return vkGetPhysicalDeviceWin32PresentationSupportKHR(s_currPhysicalDevice, queueFamilyIndex) == VK_TRUE;
+    }
+#else
+    (void)queueFamilyIndex;
+#endif
+    // Nothing will be presented in headless mode, so every queue family is fine.
+    return true;
+}
+
 // Return the queue family count
 static bool InitializeVulkanDevice(VkQueueFlagBits queueFlag)
 {
@@ -464,28 +685,47 @@ static bool InitializeVulkanDevice(VkQueueFlagBits queueFlag)
         printf("Vulkan API version: %u.%u.%u\n", VK_VERSION_MAJOR(props.apiVersion), VK_VERSION_MINOR(props.apiVersion), VK_VERSION_PATCH(props.apiVersion));
         printf("Driver version: %08X\n", props.driverVersion);
     }
-    puts("Please choose which device to use...");
-
-#ifdef _WIN32
-    char inputBuffer[8] = { '\0' };
-    const char* input = gets_s(inputBuffer, sizeof(inputBuffer));
-    if (input == NULL) {
-        input = "0";
+    uint32_t deviceIndex = 0U;
+    if (s_userDeviceIndex >= 0) {
+        deviceIndex = (uint32_t)s_userDeviceIndex;
     }
-    const uint32_t deviceIndex = atoi(input);
-#else
-    char* input = NULL;
-    ssize_t initLen = 0;
-    const ssize_t len = getline(&input, &initLen, stdin);
-    input[len - 1] = '\0';
-    errno = 0;
-    const uint32_t deviceIndex = (uint32_t)strtoul(input, NULL, 10);
-    if (errno != 0)
+    else if (s_isHeadless)
     {
-        fprintf(stderr, "Input error: %d! Invalid integer input!!\n", errno);
-        return false;
+        // Nobody is there to answer the prompt on a render node, so just take the first device.
+        puts("No device specified with --device, so device[0] is used...");
     }
+    else
+    {
+        puts("Please choose which device to use...");
+
+#ifdef _WIN32
+        char inputBuffer[8] = { '\0' };
+        const char* input = gets_s(inputBuffer, sizeof(inputBuffer));
+        if (input == NULL) {
+            input = "0";
+        }
+        deviceIndex = atoi(input);
+#else
+        char* input = NULL;
+        size_t initLen = 0;
+        const ssize_t len = getline(&input, &initLen, stdin);
+        if (len <= 0)
+        {
+            free(input);
+            fprintf(stderr, "No device index has been input!\n");
+            return false;
+        }
+        input[len - 1] = '\0';
+        errno = 0;
+        deviceIndex = (uint32_t)strtoul(input, NULL, 10);
+        free(input);
+        if (errno != 0)
+        {
+            fprintf(stderr, "Input error: %d! Invalid integer input!!\n", errno);
+            return false;
+        }
 #endif // WIN32
+    }
 
     if (deviceIndex >= gpu_count)
     {
@@ -516,7 +756,7 @@ static bool InitializeVulkanDevice(VkQueueFlagBits queueFlag)
     }
 
     uint32_t availExtensionCount = 0;
-    const char* availExtensionNames[16];
+    const char* availExtensionNames[24];
 
     bool supportSwapchain = false;
     bool supportScalarBlock = false;
@@ -525,6 +765,13 @@ static bool InitializeVulkanDevice(VkQueueFlagBits queueFlag)
     bool supportMeshShader = false;
     bool supportDepthStencilResolve = false;
     bool supportCreateRenderPass2 = false;
+    bool supportPipelineCreationFeedback = false;
+    bool supportDrawIndirectCount = false;
+    bool supportTimelineSemaphore = false;
+    bool supportCopyCommands2 = false;
+    bool supportFormatFeatureFlags2 = false;
+    bool supportHostImageCopy = false;
+    bool supportDynamicRendering = false;
 
     for (uint32_t i = 0; i < extPropCount; ++i)
     {
@@ -584,6 +831,47 @@ static bool InitializeVulkanDevice(VkQueueFlagBits queueFlag)
             availExtensionNames[availExtensionCount++] = currExtName;
             continue;
         }
+        if (strcmp(currExtName, VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME) == 0)
+        {
+            supportPipelineCreationFeedback = true;
+            availExtensionNames[availExtensionCount++] = currExtName;
+            continue;
+        }
+        if (strcmp(currExtName, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME) == 0)
+        {
+            supportDrawIndirectCount = true;
+            availExtensionNames[availExtensionCount++] = currExtName;
+            continue;
+        }
+        if (strcmp(currExtName, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) == 0)
+        {
+            supportTimelineSemaphore = true;
+            availExtensionNames[availExtensionCount++] = currExtName;
+            continue;
+        }
+        if (strcmp(currExtName, VK_KHR_COPY_COMMANDS_2_EXTENSION_NAME) == 0)
+        {
+            supportCopyCommands2 = true;
+            availExtensionNames[availExtensionCount++] = currExtName;
+            continue;
+        }
+        if (strcmp(currExtName, VK_KHR_FORMAT_FEATURE_FLAGS_2_EXTENSION_NAME) == 0)
+        {
+            supportFormatFeatureFlags2 = true;
+            availExtensionNames[availExtensionCount++] = currExtName;
+            continue;
+        }
+        // Only enabled once its dependencies are known to be met
+        if (strcmp(currExtName, VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME) == 0)
+        {
+            supportHostImageCopy = true;
+            continue;
+        }
+        if (strcmp(currExtName, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) == 0)
+        {
+            supportDynamicRendering = true;
+            continue;
+        }
     }
 
     const char* notStr = "is";
@@ -641,6 +929,36 @@ static bool InitializeVulkanDevice(VkQueueFlagBits queueFlag)
     printf("%s feature %s supported!\n", VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME, notStr);
     notStr = "is";
 
+    if (!supportPipelineCreationFeedback) {
+        notStr = "not";
+    }
+    printf("%s feature %s supported!\n", VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME, notStr);
+    notStr = "is";
+
+    if (!supportDrawIndirectCount) {
+        notStr = "not";
+    }
+    printf("%s feature %s supported!\n", VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME, notStr);
+    notStr = "is";
+
+    if (!supportTimelineSemaphore) {
+        notStr = "not";
+    }
+    printf("%s feature %s supported!\n", VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME, notStr);
+    notStr = "is";
+
+    if (!supportHostImageCopy) {
+        notStr = "not";
+    }
+    printf("%s feature %s supported!\n", VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME, notStr);
+    notStr = "is";
+
+    if (!supportDynamicRendering) {
+        notStr = "not";
+    }
+    printf("%s feature %s supported!\n", VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME, notStr);
+    notStr = "is";
+
     printf("Available required device extension count: %u\n\n", availExtensionCount);
 
     char strBuffer[256] = { '\0' };
@@ -714,6 +1032,15 @@ static bool InitializeVulkanDevice(VkQueueFlagBits queueFlag)
         printf("In mesh shader, max output primitive count: %u\n", s_maxMeshOutputPrimitives);
         s_maxMeshOutputLayers = meshShaderProps.maxMeshOutputLayers;
         printf("In mesh shader, max output layer count: %u\n", s_maxMeshOutputLayers);
+
+        // The task payload holds the transform index followed by the index of every meshlet that survives the culling of the work group.
+        const uint32_t payloadMeshletCapacity = (s_maxTaskPayloadSize - (uint32_t)sizeof(uint32_t)) / (uint32_t)sizeof(uint32_t);
+        s_taskWorkGroupSize = max(min(min(s_maxPreferredTaskWorkGroupInvocations, s_maxTaskWorkGroupInvocations), payloadMeshletCapacity), 1U);
+        // More invocations than the vertices and the triangles of a meshlet would stay idle.
+        s_meshWorkGroupSize = max(min(min(s_maxPreferredMeshWorkGroupInvocations, s_maxMeshWorkGroupInvocations),
+                                    (uint32_t)max(MESHLET_MAX_VERTEX_COUNT, MESHLET_MAX_TRIANGLE_COUNT)), 1U);
+        printf("Mesh shader pipeline: %u meshlets culled per task work group with a payload of %u bytes, %u invocations per mesh work group\n",
+            s_taskWorkGroupSize, (s_taskWorkGroupSize + 1U) * (uint32_t)sizeof(uint32_t), s_meshWorkGroupSize);
     }
     if (s_supportFragmentShadingRate)
     {
@@ -747,19 +1074,103 @@ static bool InitializeVulkanDevice(VkQueueFlagBits queueFlag)
         printf("Support independent resolve: %s\n", depthStencilResolveProperties.independentResolve != VK_FALSE ? "YES" : "NO");
     }
 
-#if USE_MSAA_SAMPLE_COUNT > 0
-    if (!supportDepthStencilResolve) {
-        fprintf(stderr, "WARNING: Current device does not support either VK_KHR_depth_stencil_resolve or VK_KHR_create_renderpass2!");
+    // The highest power of two not above the requested count that the framebuffers support for both color and depth
+    const VkSampleCountFlags framebufferSampleCounts = properties2.properties.limits.framebufferColorSampleCounts &
+                                                        properties2.properties.limits.framebufferDepthSampleCounts;
+    // The multisampled render pass resolves its depth as well, and is created and recorded through the render pass 2 entry points.
+    // Both VK_KHR_depth_stencil_resolve and VK_KHR_create_renderpass2 have been promoted to Vulkan 1.2 core.
+    const bool isRenderPass2Core = s_instanceApiVersion >= VK_API_VERSION_1_2 && properties2.properties.apiVersion >= VK_API_VERSION_1_2;
+    const bool supportDepthResolveRenderPass = (supportDepthStencilResolve && supportCreateRenderPass2) || isRenderPass2Core;
+    s_supportedMSAASampleCounts = supportDepthResolveRenderPass ? framebufferSampleCounts : VK_SAMPLE_COUNT_1_BIT;
+    s_msaaSampleCount = VK_SAMPLE_COUNT_1_BIT;
+    for (uint32_t count = VK_SAMPLE_COUNT_64_BIT; count > VK_SAMPLE_COUNT_1_BIT; count >>= 1)
+    {
+        if (count <= s_requestedMSAASampleCount && (framebufferSampleCounts & count) != 0)
+        {
+            s_msaaSampleCount = (VkSampleCountFlagBits)count;
+            break;
+        }
     }
-#endif
+    if (s_msaaSampleCount > VK_SAMPLE_COUNT_1_BIT && !supportDepthResolveRenderPass)
+    {
+        fprintf(stderr, "WARNING: Current device does not support either VK_KHR_depth_stencil_resolve or VK_KHR_create_renderpass2, so MSAA is disabled!\n");
+        s_msaaSampleCount = VK_SAMPLE_COUNT_1_BIT;
+    }
+    printf("MSAA: %ux requested, %ux selected, the framebuffers support sample counts 0x%02X\n", s_requestedMSAASampleCount, (uint32_t)s_msaaSampleCount,
+        framebufferSampleCounts);
 
     s_gpuTimestampPeriod = properties2.properties.limits.timestampPeriod;
+    s_minUniformBufferOffsetAlignment = max(properties2.properties.limits.minUniformBufferOffsetAlignment, (VkDeviceSize)1);
+    s_minStorageBufferOffsetAlignment = max(properties2.properties.limits.minStorageBufferOffsetAlignment, (VkDeviceSize)1);
+
+    // Pipeline creation feedback has been promoted to Vulkan 1.3 core
+    s_supportPipelineCreationFeedback = supportPipelineCreationFeedback ||
+        (s_instanceApiVersion >= VK_API_VERSION_1_3 && properties2.properties.apiVersion >= VK_API_VERSION_1_3);
+
+    // Timeline semaphores have been promoted to Vulkan 1.2 core
+    supportTimelineSemaphore = supportTimelineSemaphore ||
+        (s_instanceApiVersion >= VK_API_VERSION_1_2 && properties2.properties.apiVersion >= VK_API_VERSION_1_2);
+
+    // Host image copies depend on VK_KHR_copy_commands2 and VK_KHR_format_feature_flags2, both promoted to Vulkan 1.3 core
+    supportHostImageCopy = s_useHostImageCopy && supportHostImageCopy && ((supportCopyCommands2 && supportFormatFeatureFlags2) ||
+        (s_instanceApiVersion >= VK_API_VERSION_1_3 && properties2.properties.apiVersion >= VK_API_VERSION_1_3));
+    if (supportHostImageCopy)
+    {
+        // The layouts an image may be in when it is written from the host, which decide whether a texture can skip the staging buffer
+        VkPhysicalDeviceHostImageCopyPropertiesEXT hostImageCopyProps = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_PROPERTIES_EXT,
+            .pNext = NULL,
+            .copySrcLayoutCount = 0,
+            .pCopySrcLayouts = NULL,
+            .copyDstLayoutCount = MAX_HOST_IMAGE_COPY_LAYOUT_COUNT,
+            .pCopyDstLayouts = s_hostImageCopy.copyDstLayouts
+        };
+        VkPhysicalDeviceProperties2 hostImageCopyProperties2 = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+            .pNext = &hostImageCopyProps
+        };
+        vkGetPhysicalDeviceProperties2(s_currPhysicalDevice, &hostImageCopyProperties2);
+        s_hostImageCopy.copyDstLayoutCount = min(hostImageCopyProps.copyDstLayoutCount, (uint32_t)MAX_HOST_IMAGE_COPY_LAYOUT_COUNT);
+        printf("Host image copies can write %u image layouts, with identical memory type requirements? %s\n", s_hostImageCopy.copyDstLayoutCount,
+            hostImageCopyProps.identicalMemoryTypeRequirements != VK_FALSE ? "YES" : "NO");
+
+        availExtensionNames[availExtensionCount++] = VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME;
+    }
+
+    // Dynamic rendering depends on VK_KHR_depth_stencil_resolve, and has been promoted to Vulkan 1.3 core
+    const bool isDynamicRenderingCore = s_instanceApiVersion >= VK_API_VERSION_1_3 && properties2.properties.apiVersion >= VK_API_VERSION_1_3;
+    supportDynamicRendering = s_useDynamicRendering && ((supportDynamicRendering && supportDepthStencilResolve) || isDynamicRenderingCore);
+    if (supportDynamicRendering && !isDynamicRenderingCore) {
+        availExtensionNames[availExtensionCount++] = VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME;
+    }
 
     // ==== The following is query the specific extension features in the feature chaining form ====
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeature = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES,
+        .pNext = NULL
+    };
+
+    VkPhysicalDeviceHostImageCopyFeaturesEXT hostImageCopyFeature = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT,
+        .pNext = supportTimelineSemaphore ? &timelineSemaphoreFeature : NULL
+    };
+
     VkPhysicalDeviceScalarBlockLayoutFeatures scalarBlockLayoutFeature = {
         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SCALAR_BLOCK_LAYOUT_FEATURES,
-        .pNext = NULL
+        .pNext = supportTimelineSemaphore ? &timelineSemaphoreFeature : NULL
+    };
+    // Only chained when the extension is enabled, since the feature would otherwise be enabled without it
+    if (supportHostImageCopy) {
+        scalarBlockLayoutFeature.pNext = &hostImageCopyFeature;
+    }
+
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeature = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR,
+        .pNext = scalarBlockLayoutFeature.pNext
     };
+    if (supportDynamicRendering) {
+        scalarBlockLayoutFeature.pNext = &dynamicRenderingFeature;
+    }
 
     VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeature = {
         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT,
@@ -796,6 +1207,17 @@ static bool InitializeVulkanDevice(VkQueueFlagBits queueFlag)
         dyn_vkCmdDrawMeshTasksEXT = (PFN_vkCmdDrawMeshTasksEXT)vkGetInstanceProcAddr(s_instance, "vkCmdDrawMeshTasksEXT");
     }
 
+    // Every visible instance is an indirect draw of its own, selected by `firstInstance`
+    if (supportDrawIndirectCount && features2.features.multiDrawIndirect != VK_FALSE && features2.features.drawIndirectFirstInstance != VK_FALSE) {
+        dyn_vkCmdDrawIndexedIndirectCountKHR = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetInstanceProcAddr(s_instance, "vkCmdDrawIndexedIndirectCountKHR");
+    }
+    if (s_useGPUCulling && dyn_vkCmdDrawIndexedIndirectCountKHR == NULL)
+    {
+        fprintf(stderr, "GPU culling needs %s with the multiDrawIndirect and drawIndirectFirstInstance features, so all the instances are drawn directly!\n",
+            VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+        s_useGPUCulling = false;
+    }
+
     if (s_supportFragmentShadingRate)
     {
         printf("Current device support pipeline fragment shading rate? %s\n", fragmentShadingRateFeature.pipelineFragmentShadingRate != VK_FALSE ? "YES" : "NO");
@@ -803,13 +1225,62 @@ static bool InitializeVulkanDevice(VkQueueFlagBits queueFlag)
         printf("Current device support attachment fragment shading rate? %s\n", fragmentShadingRateFeature.attachmentFragmentShadingRate != VK_FALSE ? "YES" : "NO");
     }
 
+    // The upload manager needs timeline semaphores to track its batches, and records into the init command buffer without them
+    s_supportTimelineSemaphore = supportTimelineSemaphore && timelineSemaphoreFeature.timelineSemaphore != VK_FALSE;
+    if (!s_supportTimelineSemaphore) {
+        puts("Timeline semaphores are not supported, so the uploads are recorded into the init command buffer.");
+    }
+
+    // Textures written from the host need neither a staging buffer nor a command, see CreateTextureAssets
+    if (supportHostImageCopy && hostImageCopyFeature.hostImageCopy != VK_FALSE)
+    {
+        s_hostImageCopy.copyMemoryToImage = (PFN_vkCopyMemoryToImageEXT)vkGetInstanceProcAddr(s_instance, "vkCopyMemoryToImageEXT");
+        s_hostImageCopy.transitionImageLayout = (PFN_vkTransitionImageLayoutEXT)vkGetInstanceProcAddr(s_instance, "vkTransitionImageLayoutEXT");
+    }
+    if (s_hostImageCopy.copyMemoryToImage == NULL || s_hostImageCopy.transitionImageLayout == NULL)
+    {
+        s_hostImageCopy.copyMemoryToImage = NULL;
+        s_hostImageCopy.transitionImageLayout = NULL;
+        if (s_useHostImageCopy) {
+            puts("Host image copies are not supported, so the textures are uploaded through the staging ring.");
+        }
+    }
+
+    // The passes render straight into the image views, so neither the render pass nor the framebuffers are created
+    if (supportDynamicRendering && dynamicRenderingFeature.dynamicRendering != VK_FALSE)
+    {
+        dyn_vkCmdBeginRenderingKHR = (PFN_vkCmdBeginRenderingKHR)vkGetInstanceProcAddr(s_instance, isDynamicRenderingCore ? "vkCmdBeginRendering" : "vkCmdBeginRenderingKHR");
+        dyn_vkCmdEndRenderingKHR = (PFN_vkCmdEndRenderingKHR)vkGetInstanceProcAddr(s_instance, isDynamicRenderingCore ? "vkCmdEndRendering" : "vkCmdEndRenderingKHR");
+    }
+    if (dyn_vkCmdBeginRenderingKHR == NULL || dyn_vkCmdEndRenderingKHR == NULL)
+    {
+        dyn_vkCmdBeginRenderingKHR = NULL;
+        dyn_vkCmdEndRenderingKHR = NULL;
+        if (s_useDynamicRendering)
+        {
+            puts("Dynamic rendering is not supported, so the passes are rendered through a render pass and framebuffers.");
+            s_useDynamicRendering = false;
+        }
+    }
+
     const float queue_priorities[1] = { 0.0f };
-    VkDeviceQueueCreateInfo queue_info = {
-        .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-        .pNext = NULL,
-        .queueCount = 1,
-        .pQueuePriorities = queue_priorities
+    VkDeviceQueueCreateInfo queue_infos[2] = {
+        {
+            .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .queueCount = 1,
+            .pQueuePriorities = queue_priorities
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .queueCount = 1,
+            .pQueuePriorities = queue_priorities
+        }
     };
+    VkDeviceQueueCreateInfo* const queue_info = &queue_infos[0];
 
     VkQueueFamilyProperties queueFamilyProperties[MAX_QUEUE_FAMILY_PROPERTY_COUNT];
 
@@ -823,15 +1294,37 @@ static bool InitializeVulkanDevice(VkQueueFlagBits queueFlag)
     {
         if ((queueFamilyProperties[i].queueFlags & queueFlag) != 0 &&
             // Query whether the current queue supports presentation operations
-            vkGetPhysicalDeviceWin32PresentationSupportKHR(s_currPhysicalDevice, i) == VK_TRUE)
+            IsQueueFamilyPresentable(i))
         {
-            queue_info.queueFamilyIndex = i;
+            queue_info->queueFamilyIndex = i;
             found = true;
             break;
         }
     }
+    if (!found)
+    {
+        fprintf(stderr, "Could not find a queue family that supports all the required operations!\n");
+        return false;
+    }
 
-    s_specQueueFamilyIndex = queue_info.queueFamilyIndex;
+    s_specQueueFamilyIndex = queue_info->queueFamilyIndex;
+
+    // A family with transfers only is usually backed by the copy engines, which run the uploads next to the rendering
+    uint32_t queueInfoCount = 1;
+    s_transferQueueFamilyIndex = UINT32_MAX;
+    for (uint32_t i = 0; i < s_queueFamilyPropertyCount && s_useTransferQueue && s_supportTimelineSemaphore; i++)
+    {
+        const VkQueueFlags flags = queueFamilyProperties[i].queueFlags;
+        if ((flags & VK_QUEUE_TRANSFER_BIT) != 0 && (flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) == 0)
+        {
+            s_transferQueueFamilyIndex = i;
+            queue_infos[queueInfoCount++].queueFamilyIndex = i;
+            printf("Dedicated transfer queue family: %u, min image transfer granularity: %u x %u x %u\n", i,
+                queueFamilyProperties[i].minImageTransferGranularity.width, queueFamilyProperties[i].minImageTransferGranularity.height,
+                queueFamilyProperties[i].minImageTransferGranularity.depth);
+            break;
+        }
+    }
 
     // There are two ways to enable features:
     // (1) Set pNext to a VkPhysicalDeviceFeatures2 structure and set pEnabledFeatures to NULL;
@@ -840,8 +1333,8 @@ static bool InitializeVulkanDevice(VkQueueFlagBits queueFlag)
     const VkDeviceCreateInfo device_info = {
         .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
         .pNext = &features2,
-        .queueCreateInfoCount = 1,
-        .pQueueCreateInfos = &queue_info,
+        .queueCreateInfoCount = queueInfoCount,
+        .pQueueCreateInfos = queue_infos,
         .enabledLayerCount = 0,
         .ppEnabledLayerNames = NULL,
         .enabledExtensionCount = availExtensionCount,
@@ -856,9 +1349,23 @@ static bool InitializeVulkanDevice(VkQueueFlagBits queueFlag)
         return false;
     }
 
+    // Under Vulkan 1.2 the render pass 2 commands only exist as the entry points of the enabled VK_KHR_create_renderpass2
+    if (s_msaaSampleCount > VK_SAMPLE_COUNT_1_BIT)
+    {
+        dyn_vkCreateRenderPass2KHR = (PFN_vkCreateRenderPass2KHR)vkGetDeviceProcAddr(s_specDevice, isRenderPass2Core ? "vkCreateRenderPass2" : "vkCreateRenderPass2KHR");
+        dyn_vkCmdBeginRenderPass2KHR = (PFN_vkCmdBeginRenderPass2KHR)vkGetDeviceProcAddr(s_specDevice, isRenderPass2Core ? "vkCmdBeginRenderPass2" : "vkCmdBeginRenderPass2KHR");
+        dyn_vkCmdEndRenderPass2KHR = (PFN_vkCmdEndRenderPass2KHR)vkGetDeviceProcAddr(s_specDevice, isRenderPass2Core ? "vkCmdEndRenderPass2" : "vkCmdEndRenderPass2KHR");
+        if (dyn_vkCreateRenderPass2KHR == NULL || dyn_vkCmdBeginRenderPass2KHR == NULL || dyn_vkCmdEndRenderPass2KHR == NULL)
+        {
+            fprintf(stderr, "WARNING: The render pass 2 entry points cannot be loaded, so MSAA is disabled!\n");
+            s_msaaSampleCount = VK_SAMPLE_COUNT_1_BIT;
+        }
+    }
+
     return true;
 }
 
+#ifdef _WIN32
 static bool CreateVulkanSurface(HINSTANCE hInstane, HWND hWnd)
 {
     // Destroy the surface object if it has already existed.
@@ -884,69 +1391,303 @@ static bool CreateVulkanSurface(HINSTANCE hInstane, HWND hWnd)
 
     return true;
 }
+#endif // _WIN32
 
-static bool CreateVulkanSwapchain(void)
+static bool CreateColorImageViews(void)
 {
-    // Iterate over each queue to learn whether it supports presenting:
-    VkBool32 supportsPresents[MAX_QUEUE_FAMILY_PROPERTY_COUNT] = { VK_FALSE };
-    VkResult res;
-    for (uint32_t i = 0; i < s_queueFamilyPropertyCount; ++i)
+    for (uint32_t i = 0; i < s_swapchainImageCount; i++)
     {
-        res = vkGetPhysicalDeviceSurfaceSupportKHR(s_currPhysicalDevice, i, s_surface, &supportsPresents[i]);
+        const VkImageViewCreateInfo colorImageView = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .image = s_swapchainImageResources[i].image,
+            .viewType = VK_IMAGE_VIEW_TYPE_2D,
+            .format = s_surfaceFormat.format,
+            .components =
+                {
+                    .r = VK_COMPONENT_SWIZZLE_IDENTITY,
+                    .g = VK_COMPONENT_SWIZZLE_IDENTITY,
+                    .b = VK_COMPONENT_SWIZZLE_IDENTITY,
+                    .a = VK_COMPONENT_SWIZZLE_IDENTITY,
+                },
+            .subresourceRange =
+                {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0, .levelCount = 1, 
+                .baseArrayLayer = 0, .layerCount = 1}
+        };
+        VkResult res = vkCreateImageView(s_specDevice, &colorImageView, NULL, &s_swapchainImageResources[i].view);
         if (res != VK_SUCCESS)
         {
-            fprintf(stderr, "vkGetPhysicalDeviceSurfaceSupportKHR failed @%u: %d\n", i, res);
+            fprintf(stderr, "vkCreateImageView for swapchain failed: %d\n", res);
             return false;
         }
     }
 
-    VkQueueFamilyProperties queue_props[MAX_QUEUE_FAMILY_PROPERTY_COUNT] = { 0 };
-    vkGetPhysicalDeviceQueueFamilyProperties(s_currPhysicalDevice, &s_queueFamilyPropertyCount, queue_props);
+    return true;
+}
 
-    // Search for a graphics and a present queue in the array of queue families,
-    // try to find one that supports both
-    uint32_t graphicsQueueFamilyIndex = UINT32_MAX;
-    uint32_t presentQueueFamilyIndex = UINT32_MAX;
-    for (uint32_t i = 0; i < s_queueFamilyPropertyCount; ++i)
-    {
-        if ((queue_props[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0)
-        {
-            if (graphicsQueueFamilyIndex == UINT32_MAX) {
-                graphicsQueueFamilyIndex = i;
-            }
-            if (supportsPresents[i] == VK_TRUE)
-            {
-                graphicsQueueFamilyIndex = i;
-                presentQueueFamilyIndex = i;
-                break;
-            }
-        }
-    }
+// The multisampled color attachment of every swapchain image, which only lives inside the render pass and is resolved into the swapchain image
+static bool CreateMSAAColorResources(VkExtent2D imageExtent)
+{
+    const VkImageCreateInfo msaaImageCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = s_surfaceFormat.format,
+        .extent = { imageExtent.width, imageExtent.height, 1U },
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = s_msaaSampleCount,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = (VkImageUsageFlagBits)(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT),
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 1,
+        .pQueueFamilyIndices = &s_graphicsQueueFamilyIndex,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+    };
 
-    if (presentQueueFamilyIndex == UINT32_MAX)
+    VkResult res = vkCreateImage(s_specDevice, &msaaImageCreateInfo, NULL, &s_swapchainImageResources[0].msaaImage);
+    if (res != VK_SUCCESS)
     {
-        // If didn't find a queue that supports both graphics and present, then
-        // find a separate present queue.
-        for (uint32_t i = 0; i < s_queueFamilyPropertyCount; ++i)
-        {
-            if (supportsPresents[i] == VK_TRUE)
-            {
-                presentQueueFamilyIndex = i;
-                break;
-            }
-        }
+        fprintf(stderr, "vkCreateImage for texture faild: %d\n", res);
+        return false;
     }
 
-    // Generate error if could not find both a graphics and a present queue
-    if (graphicsQueueFamilyIndex == UINT32_MAX || presentQueueFamilyIndex == UINT32_MAX)
+    VkMemoryRequirements memoryRequirements = { 0 };
+    vkGetImageMemoryRequirements(s_specDevice, s_swapchainImageResources[0].msaaImage, &memoryRequirements);
+    const VkDeviceSize alignmentMask = memoryRequirements.alignment - 1U;
+    const VkDeviceSize msaaImageBufferSize = (memoryRequirements.size + alignmentMask) & ~alignmentMask;
+    memoryRequirements.size = msaaImageBufferSize * s_swapchainImageCount;
+
+    // We prefer using the lazily allocated memory to back an image with VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT usage.
+    if (!AllocateDeviceMemory(&memoryRequirements, DEVICE_MEMORY_USAGE_TRANSIENT, true, &s_msaaColorImageMemory))
     {
-        fprintf(stderr, "Could not find both graphics and present queues!\n");
+        fprintf(stderr, "Allocating the device memory for MSAA color images failed!\n");
         return false;
     }
 
-    s_graphicsQueueFamilyIndex = graphicsQueueFamilyIndex;
-    s_presentQueueFamilyIndex = presentQueueFamilyIndex;
-    const bool isSeparatePresentQueue = graphicsQueueFamilyIndex != presentQueueFamilyIndex;
+    VkImageViewCreateInfo msaaImageViewCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .image = VK_NULL_HANDLE,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = s_surfaceFormat.format,
+        .components = {
+            .r = VK_COMPONENT_SWIZZLE_IDENTITY,
+            .g = VK_COMPONENT_SWIZZLE_IDENTITY,
+            .b = VK_COMPONENT_SWIZZLE_IDENTITY,
+            .a = VK_COMPONENT_SWIZZLE_IDENTITY
+        },
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0U,
+            .levelCount = 1U,
+            .baseArrayLayer = 0U,
+            .layerCount = 1U
+        }
+    };
+
+    for (uint32_t i = 0; i < s_swapchainImageCount; i++)
+    {
+        if (i > 0U)
+        {
+            res = vkCreateImage(s_specDevice, &msaaImageCreateInfo, NULL, &s_swapchainImageResources[i].msaaImage);
+            if (res != VK_SUCCESS)
+            {
+                fprintf(stderr, "vkCreateImage for MSAA image faild: %d\n", res);
+                return false;
+            }
+        }
+
+        res = vkBindImageMemory(s_specDevice, s_swapchainImageResources[i].msaaImage, s_msaaColorImageMemory.memory,
+                                s_msaaColorImageMemory.offset + i * msaaImageBufferSize);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkBindImageMemory for MSAA image failed: %d\n", res);
+            return false;
+        }
+
+        msaaImageViewCreateInfo.image = s_swapchainImageResources[i].msaaImage;
+        res = vkCreateImageView(s_specDevice, &msaaImageViewCreateInfo, NULL, &s_swapchainImageResources[i].msaaView);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreateImageView for MSAA image view failed: %d\n", res);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Dynamic resolution upscales the scene images into the presented images with a linear blit, which the color format and the swapchain usages must allow.
+// Clears s_useDynamicResolution otherwise.
+static void CheckDynamicResolutionSupport(VkImageUsageFlags supportedUsageFlags)
+{
+    if (!s_useDynamicResolution) return;
+
+    VkFormatProperties formatProperties = { 0 };
+    vkGetPhysicalDeviceFormatProperties(s_currPhysicalDevice, s_surfaceFormat.format, &formatProperties);
+    const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    if ((formatProperties.optimalTilingFeatures & blitFeatures) != blitFeatures || (supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) == 0)
+    {
+        puts("The color images cannot be upscaled with a linear blit, so dynamic resolution is disabled.");
+        s_useDynamicResolution = false;
+    }
+}
+
+// The full size color image of every swapchain image that dynamic resolution renders a scaled part of, or resolves it into with MSAA, before upscaling it
+static bool CreateSceneColorResources(VkExtent2D imageExtent)
+{
+    const VkImageCreateInfo sceneImageCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = s_surfaceFormat.format,
+        .extent = { imageExtent.width, imageExtent.height, 1U },
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 1,
+        .pQueueFamilyIndices = &s_graphicsQueueFamilyIndex,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+    };
+
+    for (uint32_t i = 0; i < s_swapchainImageCount; ++i)
+    {
+        const VkResult res = vkCreateImage(s_specDevice, &sceneImageCreateInfo, NULL, &s_swapchainImageResources[i].sceneImage);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreateImage for scene image @%u failed: %d\n", i, res);
+            return false;
+        }
+    }
+
+    VkMemoryRequirements memoryRequirements = { 0 };
+    vkGetImageMemoryRequirements(s_specDevice, s_swapchainImageResources[0].sceneImage, &memoryRequirements);
+    const VkDeviceSize alignmentMask = memoryRequirements.alignment - 1U;
+    const VkDeviceSize sceneImageBufferSize = (memoryRequirements.size + alignmentMask) & ~alignmentMask;
+    memoryRequirements.size = sceneImageBufferSize * s_swapchainImageCount;
+
+    if (!AllocateDeviceMemory(&memoryRequirements, DEVICE_MEMORY_USAGE_GPU_ONLY, true, &s_sceneColorImageMemory))
+    {
+        fprintf(stderr, "Allocating the device memory for scene images failed!\n");
+        return false;
+    }
+
+    VkImageViewCreateInfo sceneImageViewCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .image = VK_NULL_HANDLE,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = s_surfaceFormat.format,
+        .components = {
+            .r = VK_COMPONENT_SWIZZLE_IDENTITY,
+            .g = VK_COMPONENT_SWIZZLE_IDENTITY,
+            .b = VK_COMPONENT_SWIZZLE_IDENTITY,
+            .a = VK_COMPONENT_SWIZZLE_IDENTITY
+        },
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0U,
+            .levelCount = 1U,
+            .baseArrayLayer = 0U,
+            .layerCount = 1U
+        }
+    };
+
+    for (uint32_t i = 0; i < s_swapchainImageCount; ++i)
+    {
+        VkResult res = vkBindImageMemory(s_specDevice, s_swapchainImageResources[i].sceneImage, s_sceneColorImageMemory.memory,
+                                        s_sceneColorImageMemory.offset + i * sceneImageBufferSize);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkBindImageMemory for scene image @%u failed: %d\n", i, res);
+            return false;
+        }
+
+        sceneImageViewCreateInfo.image = s_swapchainImageResources[i].sceneImage;
+        res = vkCreateImageView(s_specDevice, &sceneImageViewCreateInfo, NULL, &s_swapchainImageResources[i].sceneView);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreateImageView for scene image @%u failed: %d\n", i, res);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Selects the graphics and present queues and the color format of the swapchain images, which only depend on the device and the surface.
+// It runs once, so a resize only recreates the swapchain and keeps the format every pipeline and render pass was created with.
+static bool SelectSwapchainQueuesAndFormat(void)
+{
+    // Iterate over each queue to learn whether it supports presenting:
+    VkBool32 supportsPresents[MAX_QUEUE_FAMILY_PROPERTY_COUNT] = { VK_FALSE };
+    VkResult res;
+    for (uint32_t i = 0; i < s_queueFamilyPropertyCount; ++i)
+    {
+        res = vkGetPhysicalDeviceSurfaceSupportKHR(s_currPhysicalDevice, i, s_surface, &supportsPresents[i]);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkGetPhysicalDeviceSurfaceSupportKHR failed @%u: %d\n", i, res);
+            return false;
+        }
+    }
+
+    VkQueueFamilyProperties queue_props[MAX_QUEUE_FAMILY_PROPERTY_COUNT] = { 0 };
+    vkGetPhysicalDeviceQueueFamilyProperties(s_currPhysicalDevice, &s_queueFamilyPropertyCount, queue_props);
+
+    // Search for a graphics and a present queue in the array of queue families,
+    // try to find one that supports both
+    uint32_t graphicsQueueFamilyIndex = UINT32_MAX;
+    uint32_t presentQueueFamilyIndex = UINT32_MAX;
+    for (uint32_t i = 0; i < s_queueFamilyPropertyCount; ++i)
+    {
+        if ((queue_props[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0)
+        {
+            if (graphicsQueueFamilyIndex == UINT32_MAX) {
+                graphicsQueueFamilyIndex = i;
+            }
+            if (supportsPresents[i] == VK_TRUE)
+            {
+                graphicsQueueFamilyIndex = i;
+                presentQueueFamilyIndex = i;
+                break;
+            }
+        }
+    }
+
+    if (presentQueueFamilyIndex == UINT32_MAX)
+    {
+        // If didn't find a queue that supports both graphics and present, then
+        // find a separate present queue.
+        for (uint32_t i = 0; i < s_queueFamilyPropertyCount; ++i)
+        {
+            if (supportsPresents[i] == VK_TRUE)
+            {
+                presentQueueFamilyIndex = i;
+                break;
+            }
+        }
+    }
+
+    // Generate error if could not find both a graphics and a present queue
+    if (graphicsQueueFamilyIndex == UINT32_MAX || presentQueueFamilyIndex == UINT32_MAX)
+    {
+        fprintf(stderr, "Could not find both graphics and present queues!\n");
+        return false;
+    }
+
+    s_graphicsQueueFamilyIndex = graphicsQueueFamilyIndex;
+    s_presentQueueFamilyIndex = presentQueueFamilyIndex;
+    const bool isSeparatePresentQueue = graphicsQueueFamilyIndex != presentQueueFamilyIndex;
 
     vkGetDeviceQueue(s_specDevice, graphicsQueueFamilyIndex, 0, &s_graphicsQueue);
 
@@ -966,17 +1707,6 @@ static bool CreateVulkanSwapchain(void)
         return false;
     }
 
-    // Determine the number of VkImages to use in the swap chain.
-    // Application desires to acquire 3 images at a time for triple buffering
-    uint32_t desiredNumOfSwapchainImages = 3;
-    desiredNumOfSwapchainImages = max(desiredNumOfSwapchainImages, surfCapabilities.minImageCount);
-    // If maxImageCount is 0, we can ask for as many images as we want;
-    // otherwise we're limited to maxImageCount
-    if (surfCapabilities.maxImageCount > 0) {
-        // Application must settle for fewer images than desired:
-        desiredNumOfSwapchainImages = min(desiredNumOfSwapchainImages, surfCapabilities.maxImageCount);
-    }
-
     // Get the list of VkFormat's that are supported:
     uint32_t formatCount = 0;
     res = vkGetPhysicalDeviceSurfaceFormatsKHR(s_currPhysicalDevice, s_surface, &formatCount, NULL);
@@ -1079,6 +1809,33 @@ static bool CreateVulkanSwapchain(void)
         imageFormatProperties.maxExtent.width, imageFormatProperties.maxExtent.height, imageFormatProperties.maxExtent.depth, imageFormatProperties.maxMipLevels,
         imageFormatProperties.maxArrayLayers, imageFormatProperties.sampleCounts, imageFormatProperties.maxResourceSize);
 
+    CheckDynamicResolutionSupport(surfCapabilities.supportedUsageFlags);
+
+    return true;
+}
+
+static bool CreateVulkanSwapchain(void)
+{
+    // The current extent and the image count limits follow the size of the window
+    VkSurfaceCapabilitiesKHR surfCapabilities = { 0 };
+    VkResult res = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(s_currPhysicalDevice, s_surface, &surfCapabilities);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkGetPhysicalDeviceSurfaceCapabilitiesKHR failed: %d\n", res);
+        return false;
+    }
+
+    // Determine the number of VkImages to use in the swap chain.
+    // Application desires to acquire 3 images at a time for triple buffering
+    uint32_t desiredNumOfSwapchainImages = 3;
+    desiredNumOfSwapchainImages = max(desiredNumOfSwapchainImages, surfCapabilities.minImageCount);
+    // If maxImageCount is 0, we can ask for as many images as we want;
+    // otherwise we're limited to maxImageCount
+    if (surfCapabilities.maxImageCount > 0) {
+        // Application must settle for fewer images than desired:
+        desiredNumOfSwapchainImages = min(desiredNumOfSwapchainImages, surfCapabilities.maxImageCount);
+    }
+
     VkExtent2D swapchainExtent;
     // width and height are either both 0xFFFFFFFF, or both not 0xFFFFFFFF.
     if (surfCapabilities.currentExtent.width == 0xffffffffU || surfCapabilities.currentExtent.height == 0xffffffffU)
@@ -1220,7 +1977,8 @@ static bool CreateVulkanSwapchain(void)
         .imageColorSpace = s_surfaceFormat.colorSpace,
         .imageExtent = swapchainExtent,
         .imageArrayLayers = 1,
-        .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+        // With dynamic resolution, the swapchain images are written by the upscaling blit
+        .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | (s_useDynamicResolution ? VK_IMAGE_USAGE_TRANSFER_DST_BIT : 0),
         .imageSharingMode = VK_SHARING_MODE_EXCLUSIVE,
         .queueFamilyIndexCount = 1,
         .pQueueFamilyIndices = &s_specQueueFamilyIndex,
@@ -1260,168 +2018,96 @@ static bool CreateVulkanSwapchain(void)
         return false;
     }
 
-#if USE_MSAA_SAMPLE_COUNT > 0
-    const VkImageCreateInfo msaaImageCreateInfo = {
+    for (uint32_t i = 0; i < s_swapchainImageCount; i++) {
+        s_swapchainImageResources[i].image = swapchainImages[i];
+    }
+
+    if (!CreateColorImageViews()) return false;
+
+    if (s_msaaSampleCount > VK_SAMPLE_COUNT_1_BIT && !CreateMSAAColorResources(swapchainExtent)) return false;
+    if (s_useDynamicResolution && !CreateSceneColorResources(swapchainExtent)) return false;
+
+    return true;
+}
+
+// The headless counterpart of SelectSwapchainQueuesAndFormat, which also runs only once.
+static void SelectOffscreenQueueAndFormat(void)
+{
+    s_graphicsQueueFamilyIndex = s_specQueueFamilyIndex;
+    s_presentQueueFamilyIndex = s_specQueueFamilyIndex;
+    vkGetDeviceQueue(s_specDevice, s_graphicsQueueFamilyIndex, 0, &s_graphicsQueue);
+    s_presentQueue = s_graphicsQueue;
+
+    // UNORM RGBA8 is mandatory as a color attachment format, so it's supported by every implementation.
+    s_surfaceFormat.format = VK_FORMAT_R8G8B8A8_UNORM;
+    s_surfaceFormat.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+    // The rendered image is kept for a possible read back instead of being presented.
+    s_colorAttachmentFinalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    CheckDynamicResolutionSupport(VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+}
+
+// Create one offscreen color image per frame in flight to stand in for the swapchain images in headless mode.
+static bool CreateOffscreenRenderTargets(void)
+{
+    s_swapchainImageCount = FRAME_LAG;
+
+    const VkImageCreateInfo imageCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
         .pNext = NULL,
         .flags = 0,
         .imageType = VK_IMAGE_TYPE_2D,
         .format = s_surfaceFormat.format,
-        .extent = { swapchainExtent.width, swapchainExtent.height, 1U },
+        .extent = { s_render_width, s_render_height, 1U },
         .mipLevels = 1,
         .arrayLayers = 1,
-        .samples = (VkSampleCountFlagBits)USE_MSAA_SAMPLE_COUNT,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
         .tiling = VK_IMAGE_TILING_OPTIMAL,
-        .usage = (VkImageUsageFlagBits)(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT),
+        .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | (s_useDynamicResolution ? VK_IMAGE_USAGE_TRANSFER_DST_BIT : 0),
         .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
         .queueFamilyIndexCount = 1,
-        .pQueueFamilyIndices = (uint32_t[]){ graphicsQueueFamilyIndex },
+        .pQueueFamilyIndices = &s_graphicsQueueFamilyIndex,
         .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
     };
 
-    res = vkCreateImage(s_specDevice, &msaaImageCreateInfo, NULL, &s_swapchainImageResources[0].msaaImage);
-    if (res != VK_SUCCESS)
+    for (uint32_t i = 0; i < s_swapchainImageCount; ++i)
     {
-        fprintf(stderr, "vkCreateImage for texture faild: %d\n", res);
-        return false;
+        VkResult res = vkCreateImage(s_specDevice, &imageCreateInfo, NULL, &s_swapchainImageResources[i].image);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreateImage for offscreen color image @%u failed: %d\n", i, res);
+            return false;
+        }
     }
 
-    VkPhysicalDeviceMemoryProperties memoryProperties = { 0 };
-    vkGetPhysicalDeviceMemoryProperties(s_currPhysicalDevice, &memoryProperties);
-
     VkMemoryRequirements memoryRequirements = { 0 };
-    vkGetImageMemoryRequirements(s_specDevice, s_swapchainImageResources[0].msaaImage, &memoryRequirements);
+    vkGetImageMemoryRequirements(s_specDevice, s_swapchainImageResources[0].image, &memoryRequirements);
     const VkDeviceSize alignmentMask = memoryRequirements.alignment - 1U;
-    const VkDeviceSize msaaImageBufferSize = (memoryRequirements.size + alignmentMask) & ~alignmentMask;
-    memoryRequirements.size = msaaImageBufferSize * s_swapchainImageCount;
+    const VkDeviceSize colorImageBufferSize = (memoryRequirements.size + alignmentMask) & ~alignmentMask;
+    memoryRequirements.size = colorImageBufferSize * s_swapchainImageCount;
 
-    // Find host visible property memory type index
-    uint32_t memoryTypeIndex;
-    for (memoryTypeIndex = 0; memoryTypeIndex < memoryProperties.memoryTypeCount; ++memoryTypeIndex)
+    if (!AllocateDeviceMemory(&memoryRequirements, DEVICE_MEMORY_USAGE_GPU_ONLY, true, &s_offscreenColorImageMemory))
     {
-        if ((memoryRequirements.memoryTypeBits & (1U << memoryTypeIndex)) == 0U) {
-            continue;
-        }
-        const VkMemoryType memoryType = memoryProperties.memoryTypes[memoryTypeIndex];
-        if ((memoryType.propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0 &&
-            // We prefer using this bit to back an image with VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT usage.
-            (memoryType.propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0 &&
-            memoryProperties.memoryHeaps[memoryType.heapIndex].size >= memoryRequirements.size) {
-            // found our memory type!
-            break;
-        }
-    }
-    if (memoryTypeIndex == memoryProperties.memoryTypeCount)
-    {
-        // Not found preferred memory type!
-        // Try the secondary memory type...
-        for (memoryTypeIndex = 0; memoryTypeIndex < memoryProperties.memoryTypeCount; ++memoryTypeIndex)
-        {
-            if ((memoryRequirements.memoryTypeBits & (1U << memoryTypeIndex)) == 0U) {
-                continue;
-            }
-            const VkMemoryType memoryType = memoryProperties.memoryTypes[memoryTypeIndex];
-            if ((memoryType.propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0 &&
-                memoryProperties.memoryHeaps[memoryType.heapIndex].size >= memoryRequirements.size) {
-                // found our memory type!
-                break;
-            }
-        }
-    }
-
-    const VkMemoryAllocateInfo memAllocInfo = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .pNext = NULL,
-        .allocationSize = memoryRequirements.size,
-        .memoryTypeIndex = memoryTypeIndex
-    };
-
-    res = vkAllocateMemory(s_specDevice, &memAllocInfo, NULL, &s_msaaColorImageMemory);
-    if (res != VK_SUCCESS)
-    {
-        fprintf(stderr, "vkAllocateMemory for texture failed: %d\n", res);
+        fprintf(stderr, "Allocating the device memory for offscreen color images failed!\n");
         return false;
     }
 
-    VkImageViewCreateInfo msaaImageViewCreateInfo = {
-        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-        .pNext = NULL,
-        .flags = 0,
-        .image = VK_NULL_HANDLE,
-        .viewType = VK_IMAGE_VIEW_TYPE_2D,
-        .format = s_surfaceFormat.format,
-        .components = {
-            .r = VK_COMPONENT_SWIZZLE_IDENTITY,
-            .g = VK_COMPONENT_SWIZZLE_IDENTITY,
-            .b = VK_COMPONENT_SWIZZLE_IDENTITY,
-            .a = VK_COMPONENT_SWIZZLE_IDENTITY
-        },
-        .subresourceRange = {
-            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-            .baseMipLevel = 0U,
-            .levelCount = 1U,
-            .baseArrayLayer = 0U,
-            .layerCount = 1U
-        }
-    };
-#endif // USE_MSAA
-
-    for (uint32_t i = 0; i < s_swapchainImageCount; i++)
+    for (uint32_t i = 0; i < s_swapchainImageCount; ++i)
     {
-        const VkImageViewCreateInfo swapchainImageView = {
-            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-            .pNext = NULL,
-            .flags = 0,
-            .image = swapchainImages[i],
-            .viewType = VK_IMAGE_VIEW_TYPE_2D,
-            .format = s_surfaceFormat.format,
-            .components =
-                {
-                    .r = VK_COMPONENT_SWIZZLE_IDENTITY,
-                    .g = VK_COMPONENT_SWIZZLE_IDENTITY,
-                    .b = VK_COMPONENT_SWIZZLE_IDENTITY,
-                    .a = VK_COMPONENT_SWIZZLE_IDENTITY,
-                },
-            .subresourceRange =
-                {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0, .levelCount = 1, 
-                .baseArrayLayer = 0, .layerCount = 1}
-        };
-        res = vkCreateImageView(s_specDevice, &swapchainImageView, NULL, &s_swapchainImageResources[i].view);
+        const VkResult res = vkBindImageMemory(s_specDevice, s_swapchainImageResources[i].image, s_offscreenColorImageMemory.memory,
+                                            s_offscreenColorImageMemory.offset + i * colorImageBufferSize);
         if (res != VK_SUCCESS)
         {
-            fprintf(stderr, "vkCreateImageView for swapchain failed: %d\n", res);
+            fprintf(stderr, "vkBindImageMemory for offscreen color image @%u failed: %d\n", i, res);
             return false;
         }
+    }
 
-        s_swapchainImageResources[i].image = swapchainImages[i];
-
-#if USE_MSAA_SAMPLE_COUNT > 0
-        if (i > 0U)
-        {
-            res = vkCreateImage(s_specDevice, &msaaImageCreateInfo, NULL, &s_swapchainImageResources[i].msaaImage);
-            if (res != VK_SUCCESS)
-            {
-                fprintf(stderr, "vkCreateImage for MSAA image faild: %d\n", res);
-                return false;
-            }
-        }
+    if (!CreateColorImageViews()) return false;
 
-        res = vkBindImageMemory(s_specDevice, s_swapchainImageResources[i].msaaImage, s_msaaColorImageMemory, i * msaaImageBufferSize);
-        if (res != VK_SUCCESS)
-        {
-            fprintf(stderr, "vkBindImageMemory for MSAA image failed: %d\n", res);
-            break;
-        }
+    if (s_msaaSampleCount > VK_SAMPLE_COUNT_1_BIT && !CreateMSAAColorResources((VkExtent2D){ s_render_width, s_render_height })) return false;
+    if (s_useDynamicResolution && !CreateSceneColorResources((VkExtent2D){ s_render_width, s_render_height })) return false;
 
-        msaaImageViewCreateInfo.image = s_swapchainImageResources[i].msaaImage;
-        res = vkCreateImageView(s_specDevice, &msaaImageViewCreateInfo, NULL, &s_swapchainImageResources[i].msaaView);
-        if (res != VK_SUCCESS)
-        {
-            fprintf(stderr, "vkCreateImageView for MSAA image view failed: %d\n", res);
-            break;
-        }
-#endif
-    }
+    printf("Headless mode renders into %u offscreen %ux%u color images.\n", s_swapchainImageCount, s_render_width, s_render_height);
 
     return true;
 }
@@ -1520,6 +2206,33 @@ static bool BuildPresentImageOwnershipTransition(uint32_t imageIndex)
     return true;
 }
 
+// The pre-recorded ownership transfer of every swapchain image, which has to be recorded again whenever the swapchain is recreated
+static bool CreatePresentImageOwnershipTransitions(void)
+{
+    const VkCommandBufferAllocateInfo present_cmd_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .pNext = NULL,
+        .commandPool = s_presentCommandPool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+    for (uint32_t i = 0; i < s_swapchainImageCount; i++)
+    {
+        VkResult res = vkAllocateCommandBuffers(s_specDevice, &present_cmd_info, &s_swapchainImageResources[i].graphics_to_present_cmd_buf);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkAllocateCommandBuffers for graphics to present failed: %d\n", res);
+            return false;
+        }
+
+        if (!BuildPresentImageOwnershipTransition(i)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 static bool CreateCommandBufferAndBeginCommand(void)
 {
     const VkCommandPoolCreateInfo cmdPoolInfo = {
@@ -1552,15 +2265,20 @@ static bool CreateCommandBufferAndBeginCommand(void)
         return false;
     }
 
-    // Create command buffers for swapchain images
-    for (uint32_t i = 0; i < s_swapchainImageCount; i++)
+    // Create one draw command buffer per frame in flight. They are re-recorded each frame
+    // so that the dynamic uniform offset can point at the ring slot of that frame.
+    const VkCommandBufferAllocateInfo frameCmdBufAllocInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .pNext = NULL,
+        .commandPool = s_commandPool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = FRAME_LAG
+    };
+    res = vkAllocateCommandBuffers(s_specDevice, &frameCmdBufAllocInfo, s_frameCommandBuffers);
+    if (res != VK_SUCCESS)
     {
-        res = vkAllocateCommandBuffers(s_specDevice, &cmdBufAllocInfo, &s_swapchainImageResources[i].cmd_buf);
-        if (res != VK_SUCCESS)
-        {
-            fprintf(stderr, "vkAllocateCommandBuffers for swapchain @%u failed: %d\n", i, res);
-            return false;
-        }
+        fprintf(stderr, "vkAllocateCommandBuffers for frame command buffers failed: %d\n", res);
+        return false;
     }
 
     if (IsSeperatePresentQueue())
@@ -1577,26 +2295,7 @@ static bool CreateCommandBufferAndBeginCommand(void)
             fprintf(stderr, "vkCreateCommandPool failed: %d\n", res);
             return false;
         }
-        const VkCommandBufferAllocateInfo present_cmd_info = {
-            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-            .pNext = NULL,
-            .commandPool = s_presentCommandPool,
-            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-            .commandBufferCount = 1,
-        };
-        for (uint32_t i = 0; i < s_swapchainImageCount; i++)
-        {
-            res = vkAllocateCommandBuffers(s_specDevice, &present_cmd_info, &s_swapchainImageResources[i].graphics_to_present_cmd_buf);
-            if (res != VK_SUCCESS)
-            {
-                fprintf(stderr, "vkAllocateCommandBuffers for graphics to present failed: %d\n", res);
-                return false;
-            }
-
-            if (!BuildPresentImageOwnershipTransition(i)) {
-                return false;
-            }
-        }
+        if (!CreatePresentImageOwnershipTransitions()) return false;
     }
 
     const VkCommandBufferBeginInfo cmdBufBeginInfo = {
@@ -1623,7 +2322,7 @@ static bool CreateQueryPools(void)
         .pNext = NULL,
         .flags = 0,
         .queryType = VK_QUERY_TYPE_TIMESTAMP,
-        .queryCount = 2 * s_swapchainImageCount,
+        .queryCount = 2 * FRAME_LAG,
         .pipelineStatistics = 0
     };
 
@@ -1639,7 +2338,7 @@ static bool CreateQueryPools(void)
         .pNext = NULL,
         .flags = 0,
         .queryType = VK_QUERY_TYPE_OCCLUSION,
-        .queryCount = s_swapchainImageCount,
+        .queryCount = FRAME_LAG,
         .pipelineStatistics = 0
     };
     
@@ -1654,320 +2353,356 @@ static bool CreateQueryPools(void)
 }
 
 static bool CreateVertexAndUniformBuffersAndMemories(void)
-{    
-    VkPhysicalDeviceMemoryProperties memoryProperties = { 0 };
-    vkGetPhysicalDeviceMemoryProperties(s_currPhysicalDevice, &memoryProperties);
-
-    const VkBufferCreateInfo hostVertexBufferCreateInfo = {
-        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-        .pNext = NULL,
-        .flags = 0,
-        .size = sizeof(s_vertex_coords_data) + sizeof(s_texture_coords_data) + sizeof(s_vertex_color_data) + sizeof(FlattenVertexUniform),
-        .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-        .queueFamilyIndexCount = 1,
-        .pQueueFamilyIndices = &s_graphicsQueueFamilyIndex
-    };
-    VkResult res = vkCreateBuffer(s_specDevice, &hostVertexBufferCreateInfo, NULL, &s_hostVertexAndUniformBuffer);
-    if (res != VK_SUCCESS)
-    {
-        fprintf(stderr, "vkCreateBuffer for host vertex and uniform buffer failed: %d\n", res);
+{
+    const uint32_t quadAttributeCount = (uint32_t)(sizeof(s_quad_vertex_attributes) / sizeof(s_quad_vertex_attributes[0]));
+    if (!QuantizeVertexAttributes(s_quad_vertex_attributes, quadAttributeCount, QUAD_VERTEX_COUNT, s_vertexCompression, "the quad", &s_quadVertexAttributes)) {
         return false;
     }
-
-    VkMemoryRequirements hostVertexMemoryRequirements = { 0 };
-    vkGetBufferMemoryRequirements(s_specDevice, s_hostVertexAndUniformBuffer, &hostVertexMemoryRequirements);
-
-    uint32_t memoryTypeIndex;
-    // Find host visible property memory type index
-    for (memoryTypeIndex = 0; memoryTypeIndex < memoryProperties.memoryTypeCount; ++memoryTypeIndex)
-    {
-        if ((hostVertexMemoryRequirements.memoryTypeBits & (1U << memoryTypeIndex)) == 0U) {
-            continue;
-        }
-        const VkMemoryType memoryType = memoryProperties.memoryTypes[memoryTypeIndex];
-        if ((memoryType.propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0 &&
-            (memoryType.propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0 &&
-            memoryProperties.memoryHeaps[memoryType.heapIndex].size >= hostVertexMemoryRequirements.size)
-        {
-            // found our memory type!
-            printf("Host visible memory size: %zuMB\n", memoryProperties.memoryHeaps[memoryType.heapIndex].size / (1024 * 1024));
-            break;
-        }
-    }
-
-    const VkMemoryAllocateInfo hostMemAllocInfo = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .pNext = NULL,
-        .allocationSize = hostVertexMemoryRequirements.size,
-        .memoryTypeIndex = memoryTypeIndex
-    };
-
-    res = vkAllocateMemory(s_specDevice, &hostMemAllocInfo, NULL, &s_hostVertexUniformMemory);
-    if (res != VK_SUCCESS)
-    {
-        fprintf(stderr, "vkAllocateMemory for host vertex and uniform memory failed: %d\n", res);
-        return res;
-    }
-
-    res = vkBindBufferMemory(s_specDevice, s_hostVertexAndUniformBuffer, s_hostVertexUniformMemory, 0);
-    if (res != VK_SUCCESS)
-    {
-        fprintf(stderr, "vkBindBufferMemory failed: %d\n", res);
-        return res;
+    if (!BuildVertexLayout(s_vertexStreamLayout, s_quadVertexAttributes.attributes, quadAttributeCount, QUAD_VERTEX_COUNT, &s_vertexLayout)) {
+        return false;
     }
 
-    const VkBufferCreateInfo deviceCoordsBufferCreateInfo = {
+    const VkBufferCreateInfo vertexBufferCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
         .pNext = NULL,
         .flags = 0,
-        .size = sizeof(s_vertex_coords_data),
+        .size = s_vertexLayout.totalSize,
         .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
         .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
         .queueFamilyIndexCount = 1,
         .pQueueFamilyIndices = &s_graphicsQueueFamilyIndex
     };
 
-    const VkBufferCreateInfo deviceTexCoordsBufferCreateInfo = {
+    const VkBufferCreateInfo indexBufferCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
         .pNext = NULL,
         .flags = 0,
-        .size = sizeof(s_texture_coords_data),
-        .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        .size = sizeof(s_quad_index_data),
+        .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
         .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
         .queueFamilyIndexCount = 1,
         .pQueueFamilyIndices = &s_graphicsQueueFamilyIndex
     };
 
-    const VkBufferCreateInfo deviceColorBufferCreateInfo = {
-        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-        .pNext = NULL,
-        .flags = 0,
-        .size = sizeof(s_vertex_color_data),
-        .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-        .queueFamilyIndexCount = 1,
-        .pQueueFamilyIndices = &s_graphicsQueueFamilyIndex
-    };
+    // The uniform buffer is a ring of FRAME_LAG slots, each aligned to minUniformBufferOffsetAlignment,
+    // so that the CPU writes the slot of the current frame while the GPU may still read the other ones.
+    const VkDeviceSize uniformAlignMask = s_minUniformBufferOffsetAlignment - 1U;
+    s_uniformSlotSize = (sizeof(DrawTransformUniform) + uniformAlignMask) & ~uniformAlignMask;
 
     const VkBufferCreateInfo uniformBufferCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
         .pNext = NULL,
         .flags = 0,
-        .size = sizeof(FlattenVertexUniform),
-        .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        .size = s_uniformSlotSize * FRAME_LAG,
+        .usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
         .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
         .queueFamilyIndexCount = 1,
         .pQueueFamilyIndices = &s_graphicsQueueFamilyIndex
     };
 
-    res = vkCreateBuffer(s_specDevice, &deviceCoordsBufferCreateInfo, NULL, &s_vertexCoordsBuffer);
-    if (res != VK_SUCCESS)
-    {
-        fprintf(stderr, "vkCreateBuffer for vertex coords buffer failed: %d\n", res);
-        return false;
-    }
-
-    res = vkCreateBuffer(s_specDevice, &deviceTexCoordsBufferCreateInfo, NULL, &s_textureCoordsBuffer);
+    VkResult res = vkCreateBuffer(s_specDevice, &vertexBufferCreateInfo, NULL, &s_vertexBuffer);
     if (res != VK_SUCCESS)
     {
-        fprintf(stderr, "vkCreateBuffer for texture coords buffer failed: %d\n", res);
+        fprintf(stderr, "vkCreateBuffer for vertex buffer failed: %d\n", res);
         return false;
     }
 
-    res = vkCreateBuffer(s_specDevice, &deviceColorBufferCreateInfo, NULL, &s_colorBuffer);
+    res = vkCreateBuffer(s_specDevice, &indexBufferCreateInfo, NULL, &s_indexBuffer);
     if (res != VK_SUCCESS)
     {
-        fprintf(stderr, "vkCreateBuffer for color buffer failed: %d\n", res);
+        fprintf(stderr, "vkCreateBuffer for index buffer failed: %d\n", res);
         return false;
     }
 
     VkMemoryRequirements deviceVertexMemoryRequirements = { 0 };
-    vkGetBufferMemoryRequirements(s_specDevice, s_vertexCoordsBuffer, &deviceVertexMemoryRequirements);
+    VkMemoryRequirements indexMemoryRequirements = { 0 };
+    vkGetBufferMemoryRequirements(s_specDevice, s_vertexBuffer, &deviceVertexMemoryRequirements);
+    vkGetBufferMemoryRequirements(s_specDevice, s_indexBuffer, &indexMemoryRequirements);
+    deviceVertexMemoryRequirements.alignment = max(deviceVertexMemoryRequirements.alignment, indexMemoryRequirements.alignment);
+    deviceVertexMemoryRequirements.memoryTypeBits &= indexMemoryRequirements.memoryTypeBits;
     const VkDeviceSize alignedSizeMask = deviceVertexMemoryRequirements.alignment - 1U;
     const VkDeviceSize vertexBufferMemorySize = (deviceVertexMemoryRequirements.size + alignedSizeMask) & ~alignedSizeMask;
-    const VkDeviceSize totalDeviceVertexBufferSize = vertexBufferMemorySize * 3;
+    // The vertex buffer is followed by the index buffer
+    const VkDeviceSize totalDeviceVertexBufferSize = vertexBufferMemorySize + indexMemoryRequirements.size;
 
-    // Find host visible property memory type index
-    for (memoryTypeIndex = 0; memoryTypeIndex < memoryProperties.memoryTypeCount; ++memoryTypeIndex)
+    // When a memory type is both device local and host visible (the BAR window, or all of VRAM with resizable BAR),
+    // the vertex data is written into it in place. Otherwise it goes through a host staging buffer and a GPU copy.
+    const uint32_t directMemoryTypeIndex = FindMemoryTypeIndex(deviceVertexMemoryRequirements.memoryTypeBits, DEVICE_MEMORY_USAGE_DYNAMIC);
+    s_writeVertexDataDirectly = directMemoryTypeIndex != UINT32_MAX &&
+                                (GetMemoryTypePropertyFlags(directMemoryTypeIndex) & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0;
+
+    // The vertex and the index buffers share one allocation
+    deviceVertexMemoryRequirements.size = totalDeviceVertexBufferSize;
+    if (s_writeVertexDataDirectly && !AllocateDeviceMemory(&deviceVertexMemoryRequirements, DEVICE_MEMORY_USAGE_DYNAMIC, false, &s_vertexMemory))
     {
-        if ((deviceVertexMemoryRequirements.memoryTypeBits & (1U << memoryTypeIndex)) == 0U) {
-            continue;
-        }
-        const VkMemoryType memoryType = memoryProperties.memoryTypes[memoryTypeIndex];
-        if ((memoryType.propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0 &&
-            memoryProperties.memoryHeaps[memoryType.heapIndex].size >= totalDeviceVertexBufferSize) {
-            // found our memory type!
-            break;
-        }
+        // The BAR heap may be too small or used up, so fall back to the staging path.
+        s_writeVertexDataDirectly = false;
     }
-
-    const VkMemoryAllocateInfo deviceVertexMemAllocInfo = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .pNext = NULL,
-        .allocationSize = totalDeviceVertexBufferSize,
-        .memoryTypeIndex = memoryTypeIndex
-    };
-
-    res = vkAllocateMemory(s_specDevice, &deviceVertexMemAllocInfo, NULL, &s_vertexMemory);
-    if (res != VK_SUCCESS)
+    if (!s_writeVertexDataDirectly && !AllocateDeviceMemory(&deviceVertexMemoryRequirements, DEVICE_MEMORY_USAGE_GPU_ONLY, false, &s_vertexMemory))
     {
-        fprintf(stderr, "vkAllocateMemory for vertex buffer failed: %d\n", res);
+        fprintf(stderr, "Allocating the device memory for vertex buffers failed!\n");
         return false;
     }
 
-    res = vkBindBufferMemory(s_specDevice, s_vertexCoordsBuffer, s_vertexMemory, 0U);
+    res = vkBindBufferMemory(s_specDevice, s_vertexBuffer, s_vertexMemory.memory, s_vertexMemory.offset);
     if (res != VK_SUCCESS)
     {
-        fprintf(stderr, "vkBindBufferMemory for vertex coords buffer failed: %d\n", res);
+        fprintf(stderr, "vkBindBufferMemory for vertex buffer failed: %d\n", res);
         return false;
     }
 
-    res = vkBindBufferMemory(s_specDevice, s_textureCoordsBuffer, s_vertexMemory, vertexBufferMemorySize);
+    res = vkBindBufferMemory(s_specDevice, s_indexBuffer, s_vertexMemory.memory, s_vertexMemory.offset + vertexBufferMemorySize);
     if (res != VK_SUCCESS)
     {
-        fprintf(stderr, "vkBindBufferMemory for texture coords buffer failed: %d\n", res);
+        fprintf(stderr, "vkBindBufferMemory for index buffer failed: %d\n", res);
         return false;
     }
 
-    res = vkBindBufferMemory(s_specDevice, s_colorBuffer, s_vertexMemory, vertexBufferMemorySize * 2U);
+    res = vkCreateBuffer(s_specDevice, &uniformBufferCreateInfo, NULL, &s_uniformBuffer);
     if (res != VK_SUCCESS)
     {
-        fprintf(stderr, "vkBindBufferMemory for color buffer failed: %d\n", res);
+        fprintf(stderr, "vkCreateBuffer for uniform buffer failed: %d\n", res);
         return false;
     }
 
-    res = vkCreateBuffer(s_specDevice, &uniformBufferCreateInfo, NULL, &s_uniformBuffer);
-    if (res != VK_SUCCESS)
+    // The uniform ring prefers the device local memory that is also host visible, otherwise it uses any host coherent memory.
+    // It stays mapped for the whole lifetime of the application.
+    if (!AllocateAndBindBufferMemory(s_uniformBuffer, DEVICE_MEMORY_USAGE_DYNAMIC, &s_uniformMemory))
     {
-        fprintf(stderr, "vkCreateBuffer for uniform buffer failed: %d\n", res);
+        fprintf(stderr, "Allocating the uniform ring buffer memory failed!\n");
         return false;
     }
+    s_uniformRingData = s_uniformMemory.mappedData;
+
+    if (s_writeVertexDataDirectly)
+    {
+        // Host coherent writes become visible to the GPU on the next queue submission, so no barrier is needed either.
+        uint8_t* vertexData = s_vertexMemory.mappedData;
+        PackVertexData(&s_vertexLayout, s_quadVertexAttributes.attributes, QUAD_VERTEX_COUNT, vertexData);
+        memcpy(&vertexData[vertexBufferMemorySize], s_quad_index_data, sizeof(s_quad_index_data));
+    }
+
+    // The quad is too small for any reordering to help, but it is reported like every other indexed mesh.
+    uint32_t quadIndices[QUAD_INDEX_COUNT];
+    for (uint32_t i = 0; i < QUAD_INDEX_COUNT; ++i) {
+        quadIndices[i] = s_quad_index_data[i];
+    }
+    const VertexCacheStatistics quadStats = AnalyzeVertexCache(quadIndices, QUAD_INDEX_COUNT, QUAD_VERTEX_COUNT, VERTEX_CACHE_ANALYSIS_SIZE);
+    printf("Vertex cache of the quad (%u triangles, %u vertices, %u entry FIFO): ACMR %.3f, ATVR %.3f\n", QUAD_INDEX_COUNT / 3U, QUAD_VERTEX_COUNT,
+        (uint32_t)VERTEX_CACHE_ANALYSIS_SIZE, quadStats.acmr, quadStats.atvr);
 
-    vkGetBufferMemoryRequirements(s_specDevice, s_uniformBuffer, &deviceVertexMemoryRequirements);
+    const bool isUniformRingDeviceLocal = (GetMemoryTypePropertyFlags(s_uniformMemory.memoryTypeIndex) & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0;
+    printf("Vertex data: %s layout in %u streams, %s (memory type %u)\n", GetVertexStreamLayoutName(s_vertexLayout.streamLayout), s_vertexLayout.streamCount,
+        s_writeVertexDataDirectly ? "written directly into device local host visible memory" : "uploaded through the staging ring", s_vertexMemory.memoryTypeIndex);
+    printf("Uniform ring: %s memory (memory type %u)\n", isUniformRingDeviceLocal ? "device local host visible" : "host", s_uniformMemory.memoryTypeIndex);
 
-    for (memoryTypeIndex = 0; memoryTypeIndex < memoryProperties.memoryTypeCount; ++memoryTypeIndex)
+    return true;
+}
+
+static bool CopyFromHostToDeviceBuffersAndSync(void)
+{
+    // The vertex buffers already hold their data
+    if (s_writeVertexDataDirectly) return true;
+
+    // The packed vertex data is followed by the indices in the staging ring
+    VkDeviceSize stagingOffset;
+    uint8_t* stagingData = AllocateUploadStagingMemory(&s_uploadManager, s_vertexLayout.totalSize + sizeof(s_quad_index_data), 16U, true, &stagingOffset);
+    if (stagingData == NULL)
     {
-        if ((deviceVertexMemoryRequirements.memoryTypeBits & (1U << memoryTypeIndex)) == 0U) {
-            continue;
-        }
-        const VkMemoryType memoryType = memoryProperties.memoryTypes[memoryTypeIndex];
-        if ((memoryType.propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0 &&
-            memoryProperties.memoryHeaps[memoryType.heapIndex].size >= deviceVertexMemoryRequirements.size) {
-            // found our memory type!
-            break;
+        fprintf(stderr, "Allocating the staging memory for the vertex data failed!\n");
+        return false;
+    }
+    PackVertexData(&s_vertexLayout, s_quadVertexAttributes.attributes, QUAD_VERTEX_COUNT, stagingData);
+    memcpy(&stagingData[s_vertexLayout.totalSize], s_quad_index_data, sizeof(s_quad_index_data));
+
+    if (!QueueBufferUpload(&s_uploadManager, s_vertexBuffer, 0, stagingOffset, s_vertexLayout.totalSize) ||
+        !QueueBufferUpload(&s_uploadManager, s_indexBuffer, 0, stagingOffset + s_vertexLayout.totalSize, sizeof(s_quad_index_data))) {
+        return false;
+    }
+
+    return ReleaseUploadedBuffer(&s_uploadManager, s_vertexBuffer, 0, s_vertexLayout.totalSize, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                                VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT) &&
+        ReleaseUploadedBuffer(&s_uploadManager, s_indexBuffer, 0, sizeof(s_quad_index_data), VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
+}
+
+// Lays out `instanceCount` instances in a square grid covering the footprint of the original quad, so that the scene keeps its layout at any instance count.
+// A single instance is the original quad itself.
+// `dstBounds` may be NULL when no GPU culling is done
+static void FillInstanceData(InstanceData* dst, ObjectBounds* dstBounds, uint32_t instanceCount)
+{
+    const uint32_t gridSize = (uint32_t)ceil(sqrt((double)instanceCount));
+    const float quadExtent = s_vertex_coords_data[4] - s_vertex_coords_data[0];
+    const float fieldExtent = s_useGPUCulling ? quadExtent * (float)GPU_CULLING_FIELD_SCALE : quadExtent;
+    const float cellSize = fieldExtent / (float)gridSize;
+    // Leave some gap between neighbouring instances
+    const float scale = gridSize > 1 ? 0.8f * cellSize / quadExtent : 1.0f;
+    // The radius of the bounding sphere of the quad, which is centered at the origin
+    const float quadRadius = sqrtf(s_vertex_coords_data[0] * s_vertex_coords_data[0] + s_vertex_coords_data[1] * s_vertex_coords_data[1]);
+
+    const bool isSingle = instanceCount == 1;
+
+    for (uint32_t i = 0; i < instanceCount; ++i)
+    {
+        const uint32_t column = i % gridSize;
+        const uint32_t row = i / gridSize;
+
+        // `dst` may be write-combined memory, so every member is written exactly once.
+        InstanceData* instance = &dst[i];
+        instance->transform[0] = ((float)column + 0.5f) * cellSize - 0.5f * fieldExtent;
+        instance->transform[1] = ((float)row + 0.5f) * cellSize - 0.5f * fieldExtent;
+        instance->transform[2] = scale;
+        instance->transform[3] = 0.0f;
+        instance->color[0] = isSingle ? 255U : (uint8_t)(128U + column * 127U / gridSize);
+        instance->color[1] = isSingle ? 255U : (uint8_t)(128U + row * 127U / gridSize);
+        instance->color[2] = isSingle ? 255U : (uint8_t)(255U - (column + row) * 127U / (2U * gridSize));
+        instance->color[3] = 255U;
+        // The instances walk through the quadrants of one texture after another
+        instance->textureIndex = isSingle ? 0U : 1U + i;
+
+        if (dstBounds != NULL)
+        {
+            ObjectBounds* bounds = &dstBounds[i];
+            bounds->center[0] = instance->transform[0];
+            bounds->center[1] = instance->transform[1];
+            bounds->center[2] = 0.0f;
+            bounds->radius = scale * quadRadius;
         }
     }
+}
+
+// Draws `instanceCount` instances from now on. The instance data is written at once when the instance buffer is host visible,
+// and the GPU must not be using it then. On the staging path, the next frame writes it into its staging slot and copies it into the instance buffer.
+static void SetInstanceCount(uint32_t instanceCount)
+{
+    s_instanceCount = min(instanceCount, s_instanceCapacity);
+
+    if (s_hostInstanceBuffer == VK_NULL_HANDLE)
+    {
+        uint8_t* dstData = s_instanceMemory.mappedData;
+        FillInstanceData((InstanceData*)dstData, s_useGPUCulling ? (ObjectBounds*)(dstData + s_objectBoundsOffset) : NULL, s_instanceCount);
+    }
+    else {
+        s_instanceUploadCount = s_instanceCount;
+    }
+}
+
+static bool CreateInstanceBuffer(void)
+{
+    s_instanceCapacity = s_runInstanceScalingBenchmark ? (uint32_t)MAX_INSTANCE_COUNT : s_instanceCount;
+    VkDeviceSize bufferSize = (VkDeviceSize)s_instanceCapacity * sizeof(InstanceData);
+    if (s_useGPUCulling)
+    {
+        // The bounds are read by the culling compute shader through a storage buffer descriptor
+        s_objectBoundsOffset = (bufferSize + s_minStorageBufferOffsetAlignment - 1) / s_minStorageBufferOffsetAlignment * s_minStorageBufferOffsetAlignment;
+        bufferSize = s_objectBoundsOffset + (VkDeviceSize)s_instanceCapacity * sizeof(ObjectBounds);
+    }
 
-    const VkMemoryAllocateInfo deviceUniformMemAllocInfo = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+    const VkBufferCreateInfo instanceBufferCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
         .pNext = NULL,
-        .allocationSize = deviceVertexMemoryRequirements.size,
-        .memoryTypeIndex = memoryTypeIndex
+        .flags = 0,
+        .size = bufferSize,
+        .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | (s_useGPUCulling ? VK_BUFFER_USAGE_STORAGE_BUFFER_BIT : 0),
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 1,
+        .pQueueFamilyIndices = &s_graphicsQueueFamilyIndex
     };
-
-    res = vkAllocateMemory(s_specDevice, &deviceUniformMemAllocInfo, NULL, &s_uniformMemory);
+    VkResult res = vkCreateBuffer(s_specDevice, &instanceBufferCreateInfo, NULL, &s_instanceBuffer);
     if (res != VK_SUCCESS)
     {
-        fprintf(stderr, "vkAllocateMemory for uniform buffer failed: %d\n", res);
+        fprintf(stderr, "vkCreateBuffer for instance buffer failed: %d\n", res);
         return false;
     }
 
-    res = vkBindBufferMemory(s_specDevice, s_uniformBuffer, s_uniformMemory, 0);
-    if (res != VK_SUCCESS)
+    // As the vertex data, the instance data is written in place when it can live in device local host visible memory.
+    VkMemoryRequirements memoryRequirements = { 0 };
+    vkGetBufferMemoryRequirements(s_specDevice, s_instanceBuffer, &memoryRequirements);
+    const uint32_t directMemoryTypeIndex = FindMemoryTypeIndex(memoryRequirements.memoryTypeBits, DEVICE_MEMORY_USAGE_DYNAMIC);
+    bool writeDirectly = directMemoryTypeIndex != UINT32_MAX &&
+                        (GetMemoryTypePropertyFlags(directMemoryTypeIndex) & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0;
+    if (writeDirectly && !AllocateDeviceMemory(&memoryRequirements, DEVICE_MEMORY_USAGE_DYNAMIC, false, &s_instanceMemory)) {
+        writeDirectly = false;
+    }
+    if (!writeDirectly && !AllocateDeviceMemory(&memoryRequirements, DEVICE_MEMORY_USAGE_GPU_ONLY, false, &s_instanceMemory))
     {
-        fprintf(stderr, "vkBindBufferMemory for coords buffer failed: %d\n", res);
+        fprintf(stderr, "Allocating the device memory for instance buffer failed!\n");
         return false;
     }
 
-    // Fill the vertex coordinate data into the host memory object
-    uint8_t *hostData = NULL;
-    res = vkMapMemory(s_specDevice, s_hostVertexUniformMemory, 0, hostVertexMemoryRequirements.size, 0, &hostData);
+    res = vkBindBufferMemory(s_specDevice, s_instanceBuffer, s_instanceMemory.memory, s_instanceMemory.offset);
     if (res != VK_SUCCESS)
     {
-        fprintf(stderr, "vkMapMemory in CreateVertexAndUniformBuffersAndMemories failed: %d\n", res);
+        fprintf(stderr, "vkBindBufferMemory for instance buffer failed: %d\n", res);
         return false;
     }
 
-    memcpy(hostData, s_vertex_coords_data, sizeof(s_vertex_coords_data));
-    memcpy(&hostData[sizeof(s_vertex_coords_data)], s_texture_coords_data, sizeof(s_texture_coords_data));
-    memcpy(&hostData[sizeof(s_vertex_coords_data) + sizeof(s_texture_coords_data)], s_vertex_color_data, sizeof(s_vertex_color_data));
+    if (!writeDirectly)
+    {
+        // The staging buffer is kept, since the instance data is uploaded again whenever the instance count changes.
+        // Every frame in flight has a slot with the layout of the instance buffer, so that the copy of a former frame never reads the data being written.
+        s_hostInstanceSlotSize = bufferSize;
+        const VkBufferCreateInfo hostInstanceBufferCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .size = s_hostInstanceSlotSize * FRAME_LAG,
+            .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = 1,
+            .pQueueFamilyIndices = &s_graphicsQueueFamilyIndex
+        };
+        res = vkCreateBuffer(s_specDevice, &hostInstanceBufferCreateInfo, NULL, &s_hostInstanceBuffer);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreateBuffer for host instance buffer failed: %d\n", res);
+            return false;
+        }
+
+        if (!AllocateAndBindBufferMemory(s_hostInstanceBuffer, DEVICE_MEMORY_USAGE_STAGING_UPLOAD, &s_hostInstanceMemory))
+        {
+            fprintf(stderr, "Allocating the host instance memory failed!\n");
+            return false;
+        }
+    }
+
+    printf("Instance data: up to %u instances %s (memory type %u)\n", s_instanceCapacity,
+        writeDirectly ? "written directly into device local host visible memory" : "uploaded through a staging buffer", s_instanceMemory.memoryTypeIndex);
 
-    vkUnmapMemory(s_specDevice, s_hostVertexUniformMemory);
+    SetInstanceCount(s_instanceCount);
 
     return true;
 }
 
-static void CopyFromHostToDeviceBuffersAndSync(void)
+// Writes the instance data of the count that SetInstanceCount has set into the staging slot of the frame, and copies it into the instance buffer.
+// The pass only runs when there is any.
+static void RecordInstanceDataUpload(VkCommandBuffer inputCmdBuf, const void* frameData)
 {
-    const VkBufferCopy copyVertexCoordsRegion = {
-        .srcOffset = 0,
-        .dstOffset = 0,
-        .size = sizeof(s_vertex_coords_data)
-    };
-    const VkBufferCopy copyTextureCoordsRegion = {
-        .srcOffset = sizeof(s_vertex_coords_data),
-        .dstOffset = 0,
-        .size = sizeof(s_texture_coords_data)
-    };
-    const VkBufferCopy copyColorRegion = {
-        .srcOffset = sizeof(s_vertex_coords_data) + sizeof(s_texture_coords_data),
-        .dstOffset = 0,
-        .size = sizeof(s_vertex_color_data)
-    };
-
-    vkCmdCopyBuffer(s_commandBuffers[0], s_hostVertexAndUniformBuffer, s_vertexCoordsBuffer, 1, &copyVertexCoordsRegion);
-    vkCmdCopyBuffer(s_commandBuffers[0], s_hostVertexAndUniformBuffer, s_textureCoordsBuffer, 1, &copyTextureCoordsRegion);
-    vkCmdCopyBuffer(s_commandBuffers[0], s_hostVertexAndUniformBuffer, s_colorBuffer, 1, &copyColorRegion);
+    // The slot of this frame is not read by the GPU any more since its fence has been waited for
+    const uint32_t frameIndex = ((const FrameRecordData*)frameData)->frameIndex;
+    const VkDeviceSize slotOffset = frameIndex * s_hostInstanceSlotSize;
+    uint8_t* slotData = (uint8_t*)s_hostInstanceMemory.mappedData + slotOffset;
+    FillInstanceData((InstanceData*)slotData, s_useGPUCulling ? (ObjectBounds*)(slotData + s_objectBoundsOffset) : NULL, s_instanceUploadCount);
 
-    VkBufferMemoryBarrier bufferBarriers[] = {
-        // vertex coords buffer barrier
+    const VkBufferCopy copyRegions[] = {
         {
-            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
-            .pNext = NULL,
-            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
-            .srcQueueFamilyIndex = s_graphicsQueueFamilyIndex,
-            .dstQueueFamilyIndex = s_graphicsQueueFamilyIndex,
-            .buffer = s_vertexCoordsBuffer,
-            .offset = 0,
-            .size = sizeof(s_vertex_coords_data)
+            .srcOffset = slotOffset,
+            .dstOffset = 0,
+            .size = (VkDeviceSize)s_instanceUploadCount * sizeof(InstanceData)
         },
-        // texture coords buffer barrier
+        // The bounds for the GPU culling
         {
-            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
-            .pNext = NULL,
-            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
-            .srcQueueFamilyIndex = s_graphicsQueueFamilyIndex,
-            .dstQueueFamilyIndex = s_graphicsQueueFamilyIndex,
-            .buffer = s_textureCoordsBuffer,
-            .offset = 0,
-            .size = sizeof(s_texture_coords_data)
-        },
-        // color buffer barrier
-        {
-            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
-            .pNext = NULL,
-            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
-            .srcQueueFamilyIndex = s_graphicsQueueFamilyIndex,
-            .dstQueueFamilyIndex = s_graphicsQueueFamilyIndex,
-            .buffer = s_colorBuffer,
-            .offset = 0,
-            .size = sizeof(s_vertex_color_data)
+            .srcOffset = slotOffset + s_objectBoundsOffset,
+            .dstOffset = s_objectBoundsOffset,
+            .size = (VkDeviceSize)s_instanceUploadCount * sizeof(ObjectBounds)
         }
     };
+    vkCmdCopyBuffer(inputCmdBuf, s_hostInstanceBuffer, s_instanceBuffer, s_useGPUCulling ? 2U : 1U, copyRegions);
 
-    vkCmdPipelineBarrier(s_commandBuffers[0], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0,
-                        0, NULL, (uint32_t)(sizeof(bufferBarriers) / sizeof(bufferBarriers[0])), bufferBarriers, 0, NULL);
+    s_instanceUploadCount = 0;
 }
 
 static bool CreateDepthReource(void)
 {
-    VkPhysicalDeviceMemoryProperties memoryProperties = { 0 };
-    vkGetPhysicalDeviceMemoryProperties(s_currPhysicalDevice, &memoryProperties);
-
     const VkImageCreateInfo imageCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
         .pNext = NULL,
@@ -1993,43 +2728,9 @@ static bool CreateDepthReource(void)
         return false;
     }
 
-    VkMemoryRequirements memoryRequirements = { 0 };
-    vkGetImageMemoryRequirements(s_specDevice, s_depthResource.image, &memoryRequirements);
-
-    uint32_t memoryTypeIndex;
-    // Find host visible property memory type index
-    for (memoryTypeIndex = 0; memoryTypeIndex < memoryProperties.memoryTypeCount; ++memoryTypeIndex)
-    {
-        if ((memoryRequirements.memoryTypeBits & (1U << memoryTypeIndex)) == 0U) {
-            continue;
-        }
-        const VkMemoryType memoryType = memoryProperties.memoryTypes[memoryTypeIndex];
-        if ((memoryType.propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0 &&
-            memoryProperties.memoryHeaps[memoryType.heapIndex].size >= memoryRequirements.size)
-        {
-            // found our memory type!
-            break;
-        }
-    }
-
-    const VkMemoryAllocateInfo memAllocInfo = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .pNext = NULL,
-        .allocationSize = memoryRequirements.size,
-        .memoryTypeIndex = memoryTypeIndex
-    };
-
-    res = vkAllocateMemory(s_specDevice, &memAllocInfo, NULL, &s_depthResource.device_memory);
-    if (res != VK_SUCCESS)
-    {
-        fprintf(stderr, "vkAllocateMemory for depth failed: %d\n", res);
-        return false;
-    }
-
-    res = vkBindImageMemory(s_specDevice, s_depthResource.image, s_depthResource.device_memory, 0);
-    if (res != VK_SUCCESS)
+    if (!AllocateAndBindImageMemory(s_depthResource.image, DEVICE_MEMORY_USAGE_GPU_ONLY, &s_depthResource.device_memory))
     {
-        fprintf(stderr, "vkBindImageMemory for depth failed: %d\n", res);
+        fprintf(stderr, "Allocating the device memory for depth failed!\n");
         return false;
     }
 
@@ -2062,7 +2763,9 @@ static bool CreateDepthReource(void)
         return false;
     }
 
-#if USE_MSAA_SAMPLE_COUNT > 0
+    // The single sampled depth image above is the resolve target of the multisampled one
+    if (s_msaaSampleCount == VK_SAMPLE_COUNT_1_BIT) return true;
+
     const VkImageCreateInfo msaaImageCreateInfo = {
             .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
             .pNext = NULL,
@@ -2072,7 +2775,7 @@ static bool CreateDepthReource(void)
             .extent = { s_render_width, s_render_height, 1 },
             .mipLevels = 1,
             .arrayLayers = 1,
-            .samples = (VkSampleCountFlagBits)USE_MSAA_SAMPLE_COUNT,
+            .samples = s_msaaSampleCount,
             .tiling = VK_IMAGE_TILING_OPTIMAL,
             .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
             .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
@@ -2088,60 +2791,10 @@ static bool CreateDepthReource(void)
         return false;
     }
 
-    vkGetImageMemoryRequirements(s_specDevice, s_depthResource.msaaImage, &memoryRequirements);
-
-    for (memoryTypeIndex = 0; memoryTypeIndex < memoryProperties.memoryTypeCount; ++memoryTypeIndex)
-    {
-        if ((memoryRequirements.memoryTypeBits & (1U << memoryTypeIndex)) == 0U) {
-            continue;
-        }
-        const VkMemoryType memoryType = memoryProperties.memoryTypes[memoryTypeIndex];
-        if ((memoryType.propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0 &&
-            // We prefer using this bit to back an image with VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT usage.
-            (memoryType.propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0 &&
-            memoryProperties.memoryHeaps[memoryType.heapIndex].size >= memoryRequirements.size)
-        {
-            // found our memory type!
-            break;
-        }
-    }
-    if (memoryTypeIndex == memoryProperties.memoryTypeCount)
-    {
-        // Not found preferred memory type!
-        // Try the secondary memory type...
-        for (memoryTypeIndex = 0; memoryTypeIndex < memoryProperties.memoryTypeCount; ++memoryTypeIndex)
-        {
-            if ((memoryRequirements.memoryTypeBits & (1U << memoryTypeIndex)) == 0U) {
-                continue;
-            }
-            const VkMemoryType memoryType = memoryProperties.memoryTypes[memoryTypeIndex];
-            if ((memoryType.propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0 &&
-                memoryProperties.memoryHeaps[memoryType.heapIndex].size >= memoryRequirements.size)
-            {
-                // found our memory type!
-                break;
-            }
-        }
-    }
-
-    const VkMemoryAllocateInfo msaaMemAllocInfo = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .pNext = NULL,
-        .allocationSize = memoryRequirements.size,
-        .memoryTypeIndex = memoryTypeIndex
-    };
-
-    res = vkAllocateMemory(s_specDevice, &msaaMemAllocInfo, NULL, &s_depthResource.msaaDeviceMemory);
-    if (res != VK_SUCCESS)
-    {
-        fprintf(stderr, "vkAllocateMemory for MSAA depth failed: %d\n", res);
-        return false;
-    }
-
-    res = vkBindImageMemory(s_specDevice, s_depthResource.msaaImage, s_depthResource.msaaDeviceMemory, 0U);
-    if (res != VK_SUCCESS)
+    // We prefer using the lazily allocated memory to back an image with VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT usage.
+    if (!AllocateAndBindImageMemory(s_depthResource.msaaImage, DEVICE_MEMORY_USAGE_TRANSIENT, &s_depthResource.msaaDeviceMemory))
     {
-        fprintf(stderr, "vkBindImageMemory for depth failed: %d\n", res);
+        fprintf(stderr, "Allocating the device memory for MSAA depth failed!\n");
         return false;
     }
 
@@ -2173,20 +2826,111 @@ static bool CreateDepthReource(void)
         fprintf(stderr, "vkCreateImageView for MSAA depth failed: %d\n", res);
         return false;
     }
-#endif
 
     return true;
 }
 
+// The memory requirements of an attachment of the render size, queried from an image that is never bound
+static bool GetAttachmentMemoryRequirements(VkFormat format, VkImageUsageFlags usage, VkSampleCountFlagBits sampleCount, VkMemoryRequirements* outRequirements)
+{
+    const VkImageCreateInfo imageCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = format,
+        .extent = { s_render_width, s_render_height, 1 },
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = sampleCount,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 1,
+        .pQueueFamilyIndices = &s_graphicsQueueFamilyIndex,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+    };
+    VkImage image = VK_NULL_HANDLE;
+    const VkResult res = vkCreateImage(s_specDevice, &imageCreateInfo, NULL, &image);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkCreateImage for the MSAA memory report failed: %d\n", res);
+        return false;
+    }
+    vkGetImageMemoryRequirements(s_specDevice, image, outRequirements);
+    vkDestroyImage(s_specDevice, image, NULL);
+    return true;
+}
+
+// Compares the attachment memory of the render pass at 1x, 2x, 4x and 8x MSAA.
+// The multisampled color and depth attachments are transient, so lazily allocated memory only gets committed for what the tiles actually need.
+static void PrintMSAAMemoryReport(void)
+{
+    const uint32_t colorUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    const uint32_t depthUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+
+    VkMemoryRequirements resolvedDepthRequirements;
+    if (!GetAttachmentMemoryRequirements(s_depth_format, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_SAMPLE_COUNT_1_BIT, &resolvedDepthRequirements)) return;
+
+    printf("MSAA attachment memory at %ux%u with %u color images, besides the color images themselves:\n", s_render_width, s_render_height, s_swapchainImageCount);
+    for (uint32_t count = VK_SAMPLE_COUNT_1_BIT; count <= VK_SAMPLE_COUNT_8_BIT; count <<= 1)
+    {
+        const char* const selectedStr = count == (uint32_t)s_msaaSampleCount ? " <- selected" : "";
+        if (count == VK_SAMPLE_COUNT_1_BIT)
+        {
+            printf("  1x: %8.2f MB of depth%s\n", (double)resolvedDepthRequirements.size / (1024.0 * 1024.0), selectedStr);
+            continue;
+        }
+        if ((s_supportedMSAASampleCounts & count) == 0)
+        {
+            printf("  %ux: not supported\n", count);
+            continue;
+        }
+
+        VkMemoryRequirements colorRequirements, depthRequirements;
+        if (!GetAttachmentMemoryRequirements(s_surfaceFormat.format, colorUsage, (VkSampleCountFlagBits)count, &colorRequirements)) return;
+        if (!GetAttachmentMemoryRequirements(s_depth_format, depthUsage, (VkSampleCountFlagBits)count, &depthRequirements)) return;
+
+        // The same memory types as CreateMSAAColorResources and CreateDepthReource pick
+        const uint32_t colorTypeIndex = FindMemoryTypeIndex(colorRequirements.memoryTypeBits, DEVICE_MEMORY_USAGE_TRANSIENT);
+        const uint32_t depthTypeIndex = FindMemoryTypeIndex(depthRequirements.memoryTypeBits, DEVICE_MEMORY_USAGE_TRANSIENT);
+        const bool isLazilyAllocated = colorTypeIndex != UINT32_MAX && depthTypeIndex != UINT32_MAX &&
+                                        (GetMemoryTypePropertyFlags(colorTypeIndex) & GetMemoryTypePropertyFlags(depthTypeIndex) & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0;
+
+        const VkDeviceSize transientSize = colorRequirements.size * s_swapchainImageCount + depthRequirements.size;
+        printf("  %ux: %8.2f MB, of which %.2f MB of transient attachments %s%s\n", count,
+            (double)(transientSize + resolvedDepthRequirements.size) / (1024.0 * 1024.0), (double)transientSize / (1024.0 * 1024.0),
+            isLazilyAllocated ? "committed lazily" : "committed up front", selectedStr);
+    }
+}
+
+// How much of the lazily allocated memory behind the transient MSAA attachments the rendering has actually committed
+static void PrintMSAAMemoryCommitment(void)
+{
+    const DeviceMemoryAllocation* const allocations[] = { &s_msaaColorImageMemory, &s_depthResource.msaaDeviceMemory };
+    for (size_t i = 0; i < sizeof(allocations) / sizeof(allocations[0]); ++i)
+    {
+        const DeviceMemoryAllocation* allocation = allocations[i];
+        if (allocation->memory == VK_NULL_HANDLE || (GetMemoryTypePropertyFlags(allocation->memoryTypeIndex) & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) == 0) continue;
+
+        // The commitment covers the whole device memory object, which may hold other transient attachments as well
+        VkDeviceSize committedSize = 0;
+        vkGetDeviceMemoryCommitment(s_specDevice, allocation->memory, &committedSize);
+        printf("MSAA %s attachments: %.2f MB committed of the lazily allocated memory holding their %.2f MB\n", i == 0 ? "color" : "depth",
+            (double)committedSize / (1024.0 * 1024.0), (double)allocation->size / (1024.0 * 1024.0));
+    }
+}
+
 static bool CreateDescriptorSetAndPipelineLayout(void)
 {
     const VkDescriptorSetLayoutBinding layoutBindings[] = {
         // uniform transfer buffer
         {
             .binding = 0,
-            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
             .descriptorCount = 1,
-            .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_MESH_BIT_EXT,    // The `bind = 0` uniform buffer will be used both in vertex shader and mesh shader. 
+            // The `bind = 0` uniform buffer will be used in vertex shader and mesh shader, and in the culling compute shader as well.
+            .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_MESH_BIT_EXT | VK_SHADER_STAGE_COMPUTE_BIT,
             .pImmutableSamplers = NULL,
         },
         // sampler
@@ -2214,11 +2958,50 @@ static bool CreateDescriptorSetAndPipelineLayout(void)
         return false;
     }
 
+    // The meshlet buffers at set 1, read by the mesh shader pipeline and by the vertex pipeline reference draw of the meshlet benchmark
+    VkDescriptorSetLayoutBinding meshletLayoutBindings[MESHLET_BINDING_COUNT];
+    for (uint32_t i = 0; i < MESHLET_BINDING_COUNT; ++i)
+    {
+        meshletLayoutBindings[i] = (VkDescriptorSetLayoutBinding){
+            .binding = i,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = i == MESHLET_CULLING_COUNTER_BINDING ? VK_SHADER_STAGE_TASK_BIT_EXT :
+                            VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT,
+            .pImmutableSamplers = NULL
+        };
+    }
+
+    const VkDescriptorSetLayoutCreateInfo meshletDescriptorLayout = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .bindingCount = (uint32_t)(sizeof(meshletLayoutBindings) / sizeof(meshletLayoutBindings[0])),
+        .pBindings = meshletLayoutBindings,
+    };
+
+    res = vkCreateDescriptorSetLayout(s_specDevice, &meshletDescriptorLayout, NULL, &s_meshletDescSetLayout);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkCreateDescriptorSetLayout for meshlets failed: %d\n", res);
+        return false;
+    }
+
+    // The draw index selecting the model-view-projection matrix in the uniform buffer
+    const VkPushConstantRange pushConstantRange = {
+        .stageFlags = DRAW_PUSH_CONSTANT_STAGES,
+        .offset = 0,
+        .size = sizeof(DrawPushConstants)
+    };
+
+    const VkDescriptorSetLayout setLayouts[] = { s_descSetLayout, s_meshletDescSetLayout };
     const VkPipelineLayoutCreateInfo pPipelineLayoutCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
         .pNext = NULL,
-        .setLayoutCount = 1,
-        .pSetLayouts = &s_descSetLayout,
+        .setLayoutCount = (uint32_t)(sizeof(setLayouts) / sizeof(setLayouts[0])),
+        .pSetLayouts = setLayouts,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstantRange
     };
 
     res = vkCreatePipelineLayout(s_specDevice, &pPipelineLayoutCreateInfo, NULL, &s_pipelineLayout);
@@ -2231,17 +3014,15 @@ static bool CreateDescriptorSetAndPipelineLayout(void)
     return true;
 }
 
-static bool CreateRenderPass(void)
+// The multisampled color and depth attachments are resolved into the swapchain image and the single sampled depth image
+// The layout that a pass leaves its single sampled color image in, which is the source of the upscaling blit with dynamic resolution
+static inline VkImageLayout GetRenderedColorLayout(void)
+{
+    return s_useDynamicResolution ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : s_colorAttachmentFinalLayout;
+}
+
+static bool CreateMultisampleRenderPass(void)
 {
-    // The initial layout for the color and depth attachments will be LAYOUT_UNDEFINED
-    // because at the start of the renderpass, we don't care about their contents.
-    // At the start of the subpass, the color attachment's layout will be transitioned
-    // to LAYOUT_COLOR_ATTACHMENT_OPTIMAL and the depth stencil attachment's layout
-    // will be transitioned to LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL.  At the end of
-    // the renderpass, the color attachment's layout will be transitioned to
-    // LAYOUT_PRESENT_SRC_KHR to be ready to present.  This is all done as part of
-    // the renderpass, no barriers are necessary.
-#if USE_MSAA_SAMPLE_COUNT > 0
     const VkAttachmentDescription2KHR attachments[] = {
         // MSAA color attachment
         {
@@ -2249,7 +3030,7 @@ static bool CreateRenderPass(void)
             .pNext = NULL,
             .flags = 0,
             .format = s_surfaceFormat.format,
-            .samples = (VkSampleCountFlagBits)USE_MSAA_SAMPLE_COUNT,
+            .samples = s_msaaSampleCount,
             .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
             .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
             .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
@@ -2263,8 +3044,7 @@ static bool CreateRenderPass(void)
             .pNext = NULL,
             .flags = 0,
             .format = s_depth_format,
-            .flags = 0,
-            .samples = (VkSampleCountFlagBits)USE_MSAA_SAMPLE_COUNT,
+            .samples = s_msaaSampleCount,
             .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
             .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
             .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
@@ -2277,7 +3057,6 @@ static bool CreateRenderPass(void)
             .sType = VK_STRUCTURE_TYPE_ATTACHMENT_DESCRIPTION_2_KHR,
             .pNext = NULL,
             .flags = 0,
-            .flags = 0,
             .format = s_surfaceFormat.format,
             .samples = VK_SAMPLE_COUNT_1_BIT,
             .loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
@@ -2285,16 +3064,14 @@ static bool CreateRenderPass(void)
             .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
             .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
             .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-            .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+            .finalLayout = GetRenderedColorLayout()
         },
         // depth resolved attachment
         {
             .sType = VK_STRUCTURE_TYPE_ATTACHMENT_DESCRIPTION_2_KHR,
             .pNext = NULL,
             .flags = 0,
-            .flags = 0,
             .format = s_depth_format,
-            .flags = 0,
             .samples = VK_SAMPLE_COUNT_1_BIT,
             .loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
             .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
@@ -2333,7 +3110,8 @@ static bool CreateRenderPass(void)
     const VkSubpassDescriptionDepthStencilResolveKHR depthStencilResolve = {
         .sType = VK_STRUCTURE_TYPE_SUBPASS_DESCRIPTION_DEPTH_STENCIL_RESOLVE_KHR,
         .pNext = NULL,
-        .depthResolveMode = VK_RESOLVE_MODE_AVERAGE_BIT_KHR,
+        // The only depth resolve mode that every implementation of VK_KHR_depth_stencil_resolve supports
+        .depthResolveMode = VK_RESOLVE_MODE_SAMPLE_ZERO_BIT_KHR,
         .stencilResolveMode = VK_RESOLVE_MODE_NONE,
         .pDepthStencilResolveAttachment = &depth_resolved_reference
     };
@@ -2381,8 +3159,22 @@ static bool CreateRenderPass(void)
             .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT,
             .dependencyFlags = 0,
             .viewOffset = 0
+        },
+        // The resolved image is copied or blitted out after the pass, only used when it ends up in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+        {
+            .sType = VK_STRUCTURE_TYPE_SUBPASS_DEPENDENCY_2_KHR,
+            .pNext = NULL,
+            .srcSubpass = 0,
+            .dstSubpass = VK_SUBPASS_EXTERNAL,
+            .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT,
+            .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+            .dependencyFlags = 0,
+            .viewOffset = 0
         }
     };
+    const bool isCopiedOut = GetRenderedColorLayout() == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
 
     const VkRenderPassCreateInfo2KHR renderPassCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO_2_KHR,
@@ -2392,20 +3184,24 @@ static bool CreateRenderPass(void)
         .pAttachments = attachments,
         .subpassCount = (uint32_t)(sizeof(subpasses) / sizeof(subpasses[0])),
         .pSubpasses = subpasses,
-        .dependencyCount = (uint32_t)(sizeof(attachmentDependencies) / sizeof(attachmentDependencies[0])),
+        .dependencyCount = isCopiedOut ? 3U : 2U,
         .pDependencies = attachmentDependencies,
         .correlatedViewMaskCount = 0U,
         .pCorrelatedViewMasks = NULL
     };
 
-    VkResult res = vkCreateRenderPass2(s_specDevice, &renderPassCreateInfo, NULL, &s_render_pass);
+    VkResult res = dyn_vkCreateRenderPass2KHR(s_specDevice, &renderPassCreateInfo, NULL, &s_render_pass);
     if (res != VK_SUCCESS)
     {
         fprintf(stderr, "vkCreateRenderPass failed: %d\n", res);
         return false;
     }
 
-#else
+    return true;
+}
+
+static bool CreateSingleSampleRenderPass(void)
+{
     const VkAttachmentDescription attachments[] = {
         // color attachment
         {
@@ -2417,7 +3213,7 @@ static bool CreateRenderPass(void)
             .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
             .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
             .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-            .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+            .finalLayout = GetRenderedColorLayout()
         },
         // depth attachment
         {
@@ -2478,7 +3274,18 @@ static bool CreateRenderPass(void)
             .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT,
             .dependencyFlags = 0
         },
+        // The color image is copied or blitted out after the pass, only used when it ends up in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+        {
+            .srcSubpass = 0,
+            .dstSubpass = VK_SUBPASS_EXTERNAL,
+            .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT,
+            .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+            .dependencyFlags = 0
+        }
     };
+    const bool isCopiedOut = GetRenderedColorLayout() == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
 
     const VkRenderPassCreateInfo renderPassCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
@@ -2488,7 +3295,7 @@ static bool CreateRenderPass(void)
         .pAttachments = attachments,
         .subpassCount = (uint32_t)(sizeof(subpasses) / sizeof(subpasses[0])),
         .pSubpasses = subpasses,
-        .dependencyCount = (uint32_t)(sizeof(attachmentDependencies) / sizeof(attachmentDependencies[0])),
+        .dependencyCount = isCopiedOut ? 3U : 2U,
         .pDependencies = attachmentDependencies
     };
 
@@ -2498,11 +3305,56 @@ static bool CreateRenderPass(void)
         fprintf(stderr, "vkCreateRenderPass failed: %d\n", res);
         return false;
     }
-#endif
 
     return true;
 }
 
+static bool CreateRenderPass(void)
+{
+    // The initial layout for the color and depth attachments will be LAYOUT_UNDEFINED
+    // because at the start of the renderpass, we don't care about their contents.
+    // At the start of the subpass, the color attachment's layout will be transitioned
+    // to LAYOUT_COLOR_ATTACHMENT_OPTIMAL and the depth stencil attachment's layout
+    // will be transitioned to LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL.  At the end of
+    // the renderpass, the color attachment's layout will be transitioned to
+    // LAYOUT_PRESENT_SRC_KHR to be ready to present.  This is all done as part of
+    // the renderpass, no barriers are necessary.
+    if (s_msaaSampleCount > VK_SAMPLE_COUNT_1_BIT) {
+        return CreateMultisampleRenderPass();
+    }
+    return CreateSingleSampleRenderPass();
+}
+
+// The attachments of the swapchain or offscreen image at `imageIndex`. With dynamic rendering, `renderPass` and `framebuffer` stay VK_NULL_HANDLE.
+// With dynamic resolution, the single sampled color image is the scene image instead of the swapchain or offscreen image.
+static RenderTarget GetImageRenderTarget(uint32_t imageIndex)
+{
+    const bool isMultisampled = s_msaaSampleCount > VK_SAMPLE_COUNT_1_BIT;
+    const SwapchainImageResources* imageResources = &s_swapchainImageResources[imageIndex];
+    const VkImage renderedImage = s_useDynamicResolution ? imageResources->sceneImage : imageResources->image;
+    const VkImageView renderedView = s_useDynamicResolution ? imageResources->sceneView : imageResources->view;
+
+    return (RenderTarget) {
+        .renderPass = s_render_pass,
+        .framebuffer = imageResources->framebuffer,
+        .cmdBeginRendering = dyn_vkCmdBeginRenderingKHR,
+        .cmdEndRendering = dyn_vkCmdEndRenderingKHR,
+        .cmdBeginRenderPass2 = dyn_vkCmdBeginRenderPass2KHR,
+        .cmdEndRenderPass2 = dyn_vkCmdEndRenderPass2KHR,
+        .extent = { .width = s_render_width, .height = s_render_height },
+        .sampleCount = s_msaaSampleCount,
+        .colorFormat = s_surfaceFormat.format,
+        .depthFormat = s_depth_format,
+        .colorImage = isMultisampled ? imageResources->msaaImage : renderedImage,
+        .colorView = isMultisampled ? imageResources->msaaView : renderedView,
+        .resolveImage = isMultisampled ? renderedImage : VK_NULL_HANDLE,
+        .resolveView = isMultisampled ? renderedView : VK_NULL_HANDLE,
+        .depthImage = isMultisampled ? s_depthResource.msaaImage : s_depthResource.image,
+        .depthView = isMultisampled ? s_depthResource.msaaView : s_depthResource.image_view,
+        .finalColorLayout = GetRenderedColorLayout()
+    };
+}
+
 bool CreateShaderModule(const char* fileName, VkShaderModule* pShaderModule)
 {
     FILE* fp = GeneralOpenFile(fileName);
@@ -2572,45 +3424,42 @@ static bool CreateGraphicsPipeline(const char* vertSPVFilePath, const char* frag
             }
         };
 
-        const VkVertexInputBindingDescription vertexInputBindings[] = {
-            // vertex coords buffer
-            {
-                .binding = VERTEX_BUFFER_LOCATION_INDEX,
-                .stride = sizeof(float[4]),
-                .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
-            },
-            // color buffer
-            {
-                .binding = COLOR_BUFFER_LOCATION_INDEX,
-                .stride = sizeof(float[4]),
-                .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
-            }
+        // inPos and inColor attributes, from the streams of s_vertexLayout that hold them
+        VkVertexInputBindingDescription vertexInputBindings[MAX_VERTEX_STREAM_COUNT + 1];
+        VkVertexInputAttributeDescription vertexInputAttributes[MAX_VERTEX_ATTRIBUTE_COUNT + 2];
+        uint32_t vertexInputAttributeCount = 0;
+        uint32_t vertexInputBindingCount = FillVertexInputDescriptions(&s_vertexLayout, (1U << VERTEX_BUFFER_LOCATION_INDEX) | (1U << COLOR_BUFFER_LOCATION_INDEX),
+                                                                        vertexInputBindings, vertexInputAttributes, &vertexInputAttributeCount);
+
+        // per-instance attributes buffer
+        vertexInputBindings[vertexInputBindingCount++] = (VkVertexInputBindingDescription){
+            .binding = INSTANCE_BUFFER_LOCATION_INDEX,
+            .stride = sizeof(InstanceData),
+            .inputRate = VK_VERTEX_INPUT_RATE_INSTANCE
         };
 
-        const VkVertexInputAttributeDescription vertexInputAttributes[] = {
-            // inPos attribute
-            {
-                .location = VERTEX_BUFFER_LOCATION_INDEX,
-                .binding = VERTEX_BUFFER_LOCATION_INDEX,
-                .format = VK_FORMAT_R32G32B32A32_SFLOAT,
-                .offset = 0
-            },
-            // inColor attribute
-            {
-                .location = COLOR_BUFFER_LOCATION_INDEX,
-                .binding = COLOR_BUFFER_LOCATION_INDEX,
-                .format = VK_FORMAT_R32G32B32A32_SFLOAT,
-                .offset = 0
-            }
+        // inInstanceTransform attribute
+        vertexInputAttributes[vertexInputAttributeCount++] = (VkVertexInputAttributeDescription){
+            .location = INSTANCE_BUFFER_LOCATION_INDEX,
+            .binding = INSTANCE_BUFFER_LOCATION_INDEX,
+            .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+            .offset = (uint32_t)offsetof(InstanceData, transform)
+        };
+        // inInstanceColor attribute
+        vertexInputAttributes[vertexInputAttributeCount++] = (VkVertexInputAttributeDescription){
+            .location = INSTANCE_COLOR_LOCATION_INDEX,
+            .binding = INSTANCE_BUFFER_LOCATION_INDEX,
+            .format = VK_FORMAT_R8G8B8A8_UNORM,
+            .offset = (uint32_t)offsetof(InstanceData, color)
         };
 
         const VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo = {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
             .pNext = NULL,
             .flags = 0,
-            .vertexBindingDescriptionCount = (uint32_t)(sizeof(vertexInputBindings) / sizeof(vertexInputBindings[0])),
+            .vertexBindingDescriptionCount = vertexInputBindingCount,
             .pVertexBindingDescriptions = vertexInputBindings,
-            .vertexAttributeDescriptionCount = (uint32_t)(sizeof(vertexInputAttributes) / sizeof(vertexInputAttributes[0])),
+            .vertexAttributeDescriptionCount = vertexInputAttributeCount,
             .pVertexAttributeDescriptions = vertexInputAttributes
         };
 
@@ -2618,7 +3467,7 @@ static bool CreateGraphicsPipeline(const char* vertSPVFilePath, const char* frag
             .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
             .pNext = NULL,
             .flags = 0,
-            .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
+            .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
             .primitiveRestartEnable = VK_FALSE
         };
 
@@ -2653,7 +3502,7 @@ static bool CreateGraphicsPipeline(const char* vertSPVFilePath, const char* frag
             .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
             .pNext = NULL,
             .flags = 0,
-            .rasterizationSamples = USE_MSAA_SAMPLE_COUNT > 0 ? (VkSampleCountFlagBits)(USE_MSAA_SAMPLE_COUNT) : VK_SAMPLE_COUNT_1_BIT,
+            .rasterizationSamples = s_msaaSampleCount,
             .sampleShadingEnable = VK_FALSE,
             .minSampleShading = 0.0f,
             .pSampleMask = NULL,
@@ -2722,16 +3571,22 @@ static bool CreateGraphicsPipeline(const char* vertSPVFilePath, const char* frag
             .sType = VK_STRUCTURE_TYPE_PIPELINE_FRAGMENT_SHADING_RATE_STATE_CREATE_INFO_KHR,
             .pNext = NULL,
             .fragmentSize = {
-                .width = USE_MSAA_SAMPLE_COUNT > 0 ? 2U : 1U,
-                .height = USE_MSAA_SAMPLE_COUNT > 0 ? 2U : 4U
+                .width = s_msaaSampleCount > VK_SAMPLE_COUNT_1_BIT ? 2U : 1U,
+                .height = s_msaaSampleCount > VK_SAMPLE_COUNT_1_BIT ? 2U : 4U
             },
             .combinerOps = { [0] = VK_FRAGMENT_SHADING_RATE_COMBINER_OP_REPLACE_KHR, [1] = VK_FRAGMENT_SHADING_RATE_COMBINER_OP_KEEP_KHR }
         };
 
+        PipelineCreationFeedbackRecord feedbackRecord;
+        VkPipelineRenderingCreateInfoKHR renderingCreateInfo;
+        const RenderTarget renderTarget = GetImageRenderTarget(0);
+        const uint32_t stageCount = (uint32_t)(sizeof(shaderStages) / sizeof(shaderStages[0]));
+
         const VkGraphicsPipelineCreateInfo pipelineCreateInfo = {
             .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-            .pNext = (index == 0 && s_supportFragmentShadingRate) ? &fragmentShadingRateStateCreateInfo : NULL,
-            .stageCount = (uint32_t)(sizeof(shaderStages) / sizeof(shaderStages[0])),
+            .pNext = PreparePipelineCreationFeedback(&feedbackRecord, PrepareRenderTargetPipelineInfo(&renderTarget, &renderingCreateInfo,
+                                                    (index == 0 && s_supportFragmentShadingRate) ? &fragmentShadingRateStateCreateInfo : NULL), stageCount),
+            .stageCount = stageCount,
             .pStages = shaderStages,
             .pVertexInputState = &vertexInputStateCreateInfo,
             .pInputAssemblyState = &inputAssemblyStateCreateInfo,
@@ -2743,33 +3598,21 @@ static bool CreateGraphicsPipeline(const char* vertSPVFilePath, const char* frag
             .pColorBlendState = &colorBlendStateCreateInfo,
             .pDynamicState = &dynamicStateCreateInfo,
             .layout = s_pipelineLayout,
-            .renderPass = s_render_pass,
+            .renderPass = renderTarget.renderPass,
             .subpass = 0,
             .basePipelineHandle = VK_NULL_HANDLE,
             .basePipelineIndex = 0
         };
 
-        const VkPipelineCacheCreateInfo pipelineCacheInfo = {
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
-            .pNext = NULL,
-            .flags = 0,
-            .initialDataSize = 0,
-            .pInitialData = NULL
-        };
-
-        res = vkCreatePipelineCache(s_specDevice, &pipelineCacheInfo, NULL, &s_pipelineCaches[index]);
-        if (res != VK_SUCCESS)
-        {
-            fprintf(stderr, "vkCreatePipelineCache failed: %d\n", res);
-            break;
-        }
-
-        res = vkCreateGraphicsPipelines(s_specDevice, s_pipelineCaches[index], 1, &pipelineCreateInfo, NULL, &s_pipelines[index]);
+        const double startTime = GetCurrentTimeInMilliseconds();
+        res = vkCreateGraphicsPipelines(s_specDevice, s_pipelineCache, 1, &pipelineCreateInfo, NULL, &s_pipelines[index]);
         if (res != VK_SUCCESS)
         {
             fprintf(stderr, "vkCreateGraphicsPipelines failed: %d\n", res);
             break;
         }
+
+        RecordPipelineCreation(index == FLATTEN_PIPELINE_INDEX ? "flatten" : "gradient", &feedbackRecord, GetCurrentTimeInMilliseconds() - startTime);
     }
     while (false);
 
@@ -2783,24 +3626,117 @@ static bool CreateGraphicsPipeline(const char* vertSPVFilePath, const char* frag
     return res == VK_SUCCESS;
 }
 
+typedef struct PipelineCreationJob
+{
+    int pipelineIndex;
+    double jobTime;         // including the time of reading the SPIR-V files
+    bool succeeded;
+} PipelineCreationJob;
+
+static void CreatePipelineJobProc(void* jobData)
+{
+    PipelineCreationJob* job = jobData;
+    const double startTime = GetCurrentTimeInMilliseconds();
+    const RenderTarget renderTarget = GetImageRenderTarget(0);
+
+    // Every job only writes its own slot of s_pipelines while the pipeline cache is synchronized internally by the implementation.
+    switch (job->pipelineIndex)
+    {
+    case FLATTEN_PIPELINE_INDEX:
+    {
+        const char* vsSPV = s_supportFragmentShadingRate ? "shaders/fsr.vert.spv" : "shaders/flatten.vert.spv";
+        const char* fsSPV = s_supportFragmentShadingRate ? "shaders/fsr.frag.spv" : "shaders/flatten.frag.spv";
+        job->succeeded = CreateGraphicsPipeline(vsSPV, fsSPV, FLATTEN_PIPELINE_INDEX);
+        break;
+    }
+
+    case GRAIENT_PIPELINE_INDEX:
+        job->succeeded = CreateGraphicsPipeline("shaders/gradient.vert.spv", "shaders/gradient.frag.spv", GRAIENT_PIPELINE_INDEX);
+        break;
+
+    case GEOMETRY_SHADER_PIPELINE_INDEX:
+        s_pipelines[GEOMETRY_SHADER_PIPELINE_INDEX] = CreateGeometryShaderGraphicsPipeline(s_specDevice, "shaders/geomtest.vert.spv", "shaders/geomtest.frag.spv", "shaders/geomtest.geom.spv",
+                                                                                        &s_vertexLayout, s_pipelineLayout, &renderTarget, s_pipelineCache);
+        job->succeeded = s_pipelines[GEOMETRY_SHADER_PIPELINE_INDEX] != VK_NULL_HANDLE;
+        break;
+
+    case TEXTURE_PIPELINE_INDEX:
+        s_pipelines[TEXTURE_PIPELINE_INDEX] = CreateTextureGraphicsPipeline(s_specDevice, "shaders/texture.vert.spv", "shaders/texture.frag.spv",
+                                                                        &s_vertexLayout, s_pipelineLayout, &renderTarget, s_pipelineCache);
+        job->succeeded = s_pipelines[TEXTURE_PIPELINE_INDEX] != VK_NULL_HANDLE;
+        break;
+
+    case MESH_SHADER_PIPELINE_INDEX:
+        s_pipelines[MESH_SHADER_PIPELINE_INDEX] = CreateMeshShaderGraphicsPipeline(s_specDevice, "shaders/basic_ms.task.spv", "shaders/basic_ms.mesh.spv", "shaders/basic_ms.frag.spv",
+                                                                                s_taskWorkGroupSize, s_meshWorkGroupSize, s_pipelineLayout, &renderTarget, s_pipelineCache);
+        job->succeeded = s_pipelines[MESH_SHADER_PIPELINE_INDEX] != VK_NULL_HANDLE;
+        break;
+
+    default:
+        break;
+    }
+
+    job->jobTime = GetCurrentTimeInMilliseconds() - startTime;
+}
+
+static bool CreateAllGraphicsPipelines(void)
+{
+    PipelineCreationJob jobs[TOTAL_PIPELINE_INDEX_COUNT];
+    uint32_t jobCount = 0;
+    for (int i = 0; i < TOTAL_PIPELINE_INDEX_COUNT; ++i)
+    {
+        // The mesh shader pipeline is only needed when the device supports task and mesh shaders
+        if (i == MESH_SHADER_PIPELINE_INDEX && dyn_vkCmdDrawMeshTasksEXT == NULL) continue;
+
+        jobs[jobCount++] = (PipelineCreationJob){ .pipelineIndex = i, .jobTime = 0.0, .succeeded = false };
+    }
+
+    uint32_t threadCount = s_pipelineThreadCount > 0 ? s_pipelineThreadCount : GetLogicalProcessorCount();
+    threadCount = min(threadCount, jobCount);
+
+    const double startTime = GetCurrentTimeInMilliseconds();
+    RunJobsInParallel(CreatePipelineJobProc, jobs, sizeof(jobs[0]), jobCount, threadCount);
+    const double elapsedTime = GetCurrentTimeInMilliseconds() - startTime;
+
+    bool succeeded = true;
+    double jobTimeSum = 0.0;
+    for (uint32_t i = 0; i < jobCount; ++i)
+    {
+        printf("Pipeline job #%d %s in %.3f ms\n", jobs[i].pipelineIndex, jobs[i].succeeded ? "finished" : "failed", jobs[i].jobTime);
+        jobTimeSum += jobs[i].jobTime;
+        succeeded = succeeded && jobs[i].succeeded;
+    }
+    printf("Created %u pipelines on %u thread%s in %.3f ms (%.3f ms when created one after another)\n",
+        jobCount, threadCount, threadCount > 1 ? "s" : "", elapsedTime, jobTimeSum);
+
+    PrintPipelineCacheStatistics();
+
+    return succeeded;
+}
+
 static bool CreateDescriptorPoolAndSet(void)
 {
     const VkDescriptorPoolSize poolSizes[] = {
         // uniform translate buffer
         {
-            .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
             .descriptorCount = 1U,
         },
         // sampler combined with image
         {
             .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
             .descriptorCount = 1U
+        },
+        // bounds, indirect draw commands and counters of the GPU culling, and the meshlet buffers
+        {
+            .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 3U + MESHLET_BINDING_COUNT
         }
     };
     const VkDescriptorPoolCreateInfo descriptor_pool = {
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
         .pNext = NULL,
-        .maxSets = 2U,
+        .maxSets = 4U,
         .poolSizeCount = (uint32_t)(sizeof(poolSizes) / sizeof(poolSizes[0])),
         .pPoolSizes = poolSizes,
     };
@@ -2823,7 +3759,7 @@ static bool CreateDescriptorPoolAndSet(void)
     const VkDescriptorBufferInfo buffer_info = {
         .buffer = s_uniformBuffer,
         .offset = 0,
-        .range = sizeof(FlattenVertexUniform)
+        .range = sizeof(DrawTransformUniform)
     };
 
     const VkDescriptorImageInfo image_info = {
@@ -2850,7 +3786,7 @@ static bool CreateDescriptorPoolAndSet(void)
             .dstBinding = 0,
             .dstArrayElement = 0,
             .descriptorCount = 1,
-            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
             .pImageInfo = NULL,
             .pBufferInfo = &buffer_info,
             .pTexelBufferView = NULL
@@ -2875,122 +3811,549 @@ static bool CreateDescriptorPoolAndSet(void)
     return true;
 }
 
-static bool CreateFramebuffers(void)
+static bool CreateBufferWithMemory(VkDeviceSize size, VkBufferUsageFlags usage, DeviceMemoryUsage memoryUsage, const char* bufferName,
+                                VkBuffer* outBuffer, DeviceMemoryAllocation* outMemory)
 {
-#if USE_MSAA_SAMPLE_COUNT > 0
-    // This `attachments` MUST BE coherent with the one in renderpass creation.
-    VkImageView attachments[] = { VK_NULL_HANDLE, s_depthResource.msaaView, VK_NULL_HANDLE, s_depthResource.image_view };
-#else
-    // This `attachments` MUST BE coherent with the one in renderpass creation.
-    VkImageView attachments[] = { VK_NULL_HANDLE, s_depthResource.image_view };
-#endif
-
-    const VkFramebufferCreateInfo framebufferCreateInfo = {
-        .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+    const VkBufferCreateInfo bufferCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
         .pNext = NULL,
-        .renderPass = s_render_pass,
-        .attachmentCount = (uint32_t)(sizeof(attachments) / sizeof(attachments[0])),
-        .pAttachments = attachments,
-        .width = s_render_width,
-        .height = s_render_height,
-        .layers = 1
+        .flags = 0,
+        .size = size,
+        .usage = usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 1,
+        .pQueueFamilyIndices = &s_graphicsQueueFamilyIndex
     };
+    const VkResult res = vkCreateBuffer(s_specDevice, &bufferCreateInfo, NULL, outBuffer);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkCreateBuffer for %s failed: %d\n", bufferName, res);
+        return false;
+    }
 
-    for (uint32_t i = 0; i < s_swapchainImageCount; ++i)
+    if (!AllocateAndBindBufferMemory(*outBuffer, memoryUsage, outMemory))
     {
-#if USE_MSAA_SAMPLE_COUNT > 0
-        attachments[0] = s_swapchainImageResources[i].msaaView;
-        attachments[2] = s_swapchainImageResources[i].view;
-#else
-        attachments[0] = s_swapchainImageResources[i].view;
-#endif
-        VkResult res = vkCreateFramebuffer(s_specDevice, &framebufferCreateInfo, NULL, &s_swapchainImageResources[i].framebuffer);
-        if (res != VK_SUCCESS)
-        {
-            fprintf(stderr, "vkCreateFramebuffer @%u failed: %d\n", i, res);
-            return false;
-        }
+        fprintf(stderr, "Allocating the device memory for %s failed!\n", bufferName);
+        return false;
     }
 
     return true;
 }
 
-static bool RecordCommandsForDraw(VkCommandBuffer inputCmdBuf, uint32_t swapchainIndex)
+// The culling compute pipeline shares the uniform descriptor set of the draws at set 0, so it reads the same model-view-projection matrices.
+static bool CreateGPUCullingResources(void)
 {
-    const VkCommandBufferBeginInfo cmd_buf_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+    if (!s_useGPUCulling) return true;
+
+    const VkDescriptorSetLayoutBinding layoutBindings[] = {
+        // object bounds
+        {
+            .binding = 0,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = NULL
+        },
+        // indirect draw commands
+        {
+            .binding = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = NULL
+        },
+        // counters
+        {
+            .binding = 2,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = NULL
+        }
+    };
+
+    const VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
         .pNext = NULL,
-        .flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT,
-        .pInheritanceInfo = NULL,
+        .flags = 0,
+        .bindingCount = (uint32_t)(sizeof(layoutBindings) / sizeof(layoutBindings[0])),
+        .pBindings = layoutBindings
     };
-    VkResult res = vkBeginCommandBuffer(inputCmdBuf, &cmd_buf_info);
+    VkResult res = vkCreateDescriptorSetLayout(s_specDevice, &descriptorSetLayoutCreateInfo, NULL, &s_cullingDescSetLayout);
     if (res != VK_SUCCESS)
     {
-        fprintf(stderr, "vkBeginCommandBuffer in RecordCommandsForDraw @%u failed: %d\n", swapchainIndex, res);
+        fprintf(stderr, "vkCreateDescriptorSetLayout for GPU culling failed: %d\n", res);
         return false;
     }
 
-    // Reset the query pools
-    vkCmdResetQueryPool(inputCmdBuf, s_occlusionQueryPool, swapchainIndex, 1);
-    vkCmdResetQueryPool(inputCmdBuf, s_timestampQueryPool, swapchainIndex * 2, 1);
+    const VkDescriptorSetLayout setLayouts[] = { s_descSetLayout, s_cullingDescSetLayout };
+    const VkPushConstantRange pushConstantRange = {
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset = 0,
+        .size = sizeof(CullingPushConstants)
+    };
+    const VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .pNext = NULL,
+        .setLayoutCount = (uint32_t)(sizeof(setLayouts) / sizeof(setLayouts[0])),
+        .pSetLayouts = setLayouts,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstantRange
+    };
+    res = vkCreatePipelineLayout(s_specDevice, &pipelineLayoutCreateInfo, NULL, &s_cullingPipelineLayout);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkCreatePipelineLayout for GPU culling failed: %d\n", res);
+        return false;
+    }
 
-    // Begin the timestamp query
-    vkCmdWriteTimestamp(inputCmdBuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, s_timestampQueryPool, swapchainIndex * 2);
+    s_cullingPipeline = CreateCullingComputePipeline(s_specDevice, "shaders/cull_objects.comp.spv", s_cullingPipelineLayout, s_pipelineCache);
+    if (s_cullingPipeline == VK_NULL_HANDLE) return false;
 
-    // This `clearValues` MUST BE coherent with the attachments in renderpass creation.
-    const VkClearValue clearValues[] = {
-        { .color.float32 = { 0.4f, 0.5f, 0.4f, 1.0f } },
-        { .depthStencil = { .depth = 1.0f, .stencil = 0 } }
-#if USE_MSAA_SAMPLE_COUNT > 0
-        //,
-        // attachment[2], i.e. color resolve is VK_ATTACHMENT_LOAD_OP_DONT_CARE
-        //{.color.float32 = { 0.4f, 0.5f, 0.4f, 1.0f } },
-        // attachment[3], i.e. depth resolve is VK_ATTACHMENT_LOAD_OP_DONT_CARE
-        //{.depthStencil = {.depth = 1.0f, .stencil = 0 } }
-#endif
-    };
-    const VkRenderPassBeginInfo renderPassBeginInfo = {
-        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+    const VkDeviceSize commandsSize = (VkDeviceSize)CULLED_DRAW_COUNT * s_instanceCapacity * sizeof(VkDrawIndexedIndirectCommand);
+    if (!CreateBufferWithMemory(commandsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, DEVICE_MEMORY_USAGE_GPU_ONLY,
+                                "indirect draw buffer", &s_indirectDrawBuffer, &s_indirectDrawMemory)) {
+        return false;
+    }
+    if (!CreateBufferWithMemory(sizeof(CullingCounters), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, DEVICE_MEMORY_USAGE_GPU_ONLY,
+                                "culling counter buffer", &s_cullingCounterBuffer, &s_cullingCounterMemory)) {
+        return false;
+    }
+    if (!CreateBufferWithMemory(FRAME_LAG * sizeof(CullingCounters), VK_BUFFER_USAGE_TRANSFER_DST_BIT, DEVICE_MEMORY_USAGE_READBACK,
+                                "culling readback buffer", &s_cullingReadbackBuffer, &s_cullingReadbackMemory)) {
+        return false;
+    }
+    memset(s_cullingReadbackMemory.mappedData, 0, FRAME_LAG * sizeof(CullingCounters));
+
+    const VkDescriptorSetAllocateInfo allocInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
         .pNext = NULL,
-        .renderPass = s_render_pass,
-        .framebuffer = s_swapchainImageResources[swapchainIndex].framebuffer,
-        .renderArea = {
-            .offset = { .x = 0, .y = 0 },
-            .extent = {.width = s_render_width, .height = s_render_height }
+        .descriptorPool = s_descPool,
+        .descriptorSetCount = 1U,
+        .pSetLayouts = &s_cullingDescSetLayout
+    };
+    res = vkAllocateDescriptorSets(s_specDevice, &allocInfo, &s_cullingDescriptorSet);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkAllocateDescriptorSets for GPU culling failed: %d\n", res);
+        return false;
+    }
+
+    const VkDescriptorBufferInfo bufferInfos[] = {
+        {
+            .buffer = s_instanceBuffer,
+            .offset = s_objectBoundsOffset,
+            .range = (VkDeviceSize)s_instanceCapacity * sizeof(ObjectBounds)
+        },
+        {
+            .buffer = s_indirectDrawBuffer,
+            .offset = 0,
+            .range = commandsSize
         },
-        .clearValueCount = (uint32_t)(sizeof(clearValues) / sizeof(clearValues[0])),
-        .pClearValues = clearValues,
+        {
+            .buffer = s_cullingCounterBuffer,
+            .offset = 0,
+            .range = sizeof(CullingCounters)
+        }
     };
 
-    // ==== The following code block is in the render pass instance. ====
-#if USE_MSAA_SAMPLE_COUNT > 0
-    const VkSubpassBeginInfoKHR subpassBeginInfo = {
-        .sType = VK_STRUCTURE_TYPE_SUBPASS_BEGIN_INFO_KHR,
+    VkWriteDescriptorSet writes[sizeof(bufferInfos) / sizeof(bufferInfos[0])];
+    for (uint32_t i = 0; i < sizeof(bufferInfos) / sizeof(bufferInfos[0]); ++i)
+    {
+        writes[i] = (VkWriteDescriptorSet){
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .pNext = NULL,
+            .dstSet = s_cullingDescriptorSet,
+            .dstBinding = i,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .pImageInfo = NULL,
+            .pBufferInfo = &bufferInfos[i],
+            .pTexelBufferView = NULL
+        };
+    }
+    vkUpdateDescriptorSets(s_specDevice, (uint32_t)(sizeof(writes) / sizeof(writes[0])), writes, 0, NULL);
+
+    printf("GPU culling: up to %u instances for each of %u draws\n", s_instanceCapacity, (uint32_t)CULLED_DRAW_COUNT);
+
+    return true;
+}
+
+// Reorders the triangles of `mesh` for the post-transform vertex cache and then its vertices for the vertex fetch,
+// and reports the simulated cache behaviour of the generated and the optimized index order.
+static bool OptimizeIndexedMesh(IndexedMesh* mesh, const char* meshName)
+{
+    uint32_t* optimizedIndices = malloc(mesh->indexCount * sizeof(*optimizedIndices));
+    if (optimizedIndices == NULL)
+    {
+        fprintf(stderr, "Failed to allocate the optimized indices of the %s!\n", meshName);
+        return false;
+    }
+
+    const VertexCacheStatistics generatedStats = AnalyzeVertexCache(mesh->indices, mesh->indexCount, mesh->vertexCount, VERTEX_CACHE_ANALYSIS_SIZE);
+    const double startTime = GetCurrentTimeInMilliseconds();
+    if (!OptimizeVertexCache(optimizedIndices, mesh->indices, mesh->indexCount, mesh->vertexCount))
+    {
+        free(optimizedIndices);
+        return false;
+    }
+    free(mesh->indices);
+    mesh->indices = optimizedIndices;
+    if (!OptimizeVertexFetch(mesh)) return false;
+    const double optimizeTime = GetCurrentTimeInMilliseconds() - startTime;
+
+    const VertexCacheStatistics optimizedStats = AnalyzeVertexCache(mesh->indices, mesh->indexCount, mesh->vertexCount, VERTEX_CACHE_ANALYSIS_SIZE);
+    printf("Vertex cache of the %s (%u triangles, %u vertices, %u entry FIFO): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, optimized in %.3f ms\n",
+        meshName, mesh->indexCount / 3U, mesh->vertexCount, (uint32_t)VERTEX_CACHE_ANALYSIS_SIZE, generatedStats.acmr, optimizedStats.acmr,
+        generatedStats.atvr, optimizedStats.atvr, optimizeTime);
+
+    return true;
+}
+
+// Builds the meshlets of the sphere drawn by the mesh shader pipeline, and uploads them together with the sphere itself into one buffer.
+// The index buffer region is only used by the vertex pipeline reference draw of the meshlet benchmark.
+static bool CreateMeshletResources(void)
+{
+    // Without mesh shader support there is nothing to draw the meshlets with
+    if (dyn_vkCmdDrawMeshTasksEXT == NULL) return true;
+
+    IndexedMesh mesh;
+    if (!CreateSphereMesh(MESHLET_SPHERE_SLICE_COUNT, MESHLET_SPHERE_STACK_COUNT, 0.2f, &mesh)) return false;
+
+    // The vertex pipeline reference draw uses the optimized indices directly. The meshlets are built from them too, so they pick up the vertex locality.
+    if (!OptimizeIndexedMesh(&mesh, "meshlet sphere"))
+    {
+        FreeIndexedMesh(&mesh);
+        return false;
+    }
+
+    // The mesh shader is compiled for MESHLET_MAX_VERTEX_COUNT and MESHLET_MAX_TRIANGLE_COUNT, which may still exceed the device limits.
+    const uint32_t maxVertexCount = min((uint32_t)MESHLET_MAX_VERTEX_COUNT, s_maxMeshOutputVertices);
+    const uint32_t maxTriangleCount = min((uint32_t)MESHLET_MAX_TRIANGLE_COUNT, s_maxMeshOutputPrimitives);
+
+    MeshletData meshletData;
+    const double startTime = GetCurrentTimeInMilliseconds();
+    if (!BuildMeshlets(&mesh, maxVertexCount, maxTriangleCount, &meshletData))
+    {
+        FreeIndexedMesh(&mesh);
+        return false;
+    }
+    const double buildTime = GetCurrentTimeInMilliseconds() - startTime;
+
+    const void* const regionData[MESHLET_REGION_COUNT] = {
+        mesh.vertices, meshletData.meshlets, meshletData.vertexIndices, meshletData.triangles, meshletData.bounds, mesh.indices
+    };
+    const VkDeviceSize regionSizes[MESHLET_REGION_COUNT] = {
+        (VkDeviceSize)mesh.vertexCount * sizeof(*mesh.vertices),
+        (VkDeviceSize)meshletData.meshletCount * sizeof(*meshletData.meshlets),
+        (VkDeviceSize)meshletData.vertexIndexCount * sizeof(*meshletData.vertexIndices),
+        (VkDeviceSize)meshletData.triangleCount * sizeof(*meshletData.triangles),
+        (VkDeviceSize)meshletData.meshletCount * sizeof(*meshletData.bounds),
+        (VkDeviceSize)mesh.indexCount * sizeof(*mesh.indices)
+    };
+
+    // Each region is bound as a storage buffer of its own, and the index buffer offset has to be a multiple of 4 for 32 bit indices.
+    const VkDeviceSize regionAlignment = max(s_minStorageBufferOffsetAlignment, (VkDeviceSize)4);
+    VkDeviceSize regionOffsets[MESHLET_REGION_COUNT];
+    VkDeviceSize bufferSize = 0;
+    for (uint32_t i = 0; i < MESHLET_REGION_COUNT; ++i)
+    {
+        regionOffsets[i] = (bufferSize + regionAlignment - 1) / regionAlignment * regionAlignment;
+        bufferSize = regionOffsets[i] + regionSizes[i];
+    }
+
+    bool succeeded = false;
+    do
+    {
+        const VkBufferCreateInfo meshletBufferCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .size = bufferSize,
+            .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = 1,
+            .pQueueFamilyIndices = &s_graphicsQueueFamilyIndex
+        };
+        VkResult res = vkCreateBuffer(s_specDevice, &meshletBufferCreateInfo, NULL, &s_meshletBuffer);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreateBuffer for meshlet buffer failed: %d\n", res);
+            break;
+        }
+
+        // As the vertex data, the meshlets are written in place when they can live in device local host visible memory.
+        VkMemoryRequirements memoryRequirements = { 0 };
+        vkGetBufferMemoryRequirements(s_specDevice, s_meshletBuffer, &memoryRequirements);
+        const uint32_t directMemoryTypeIndex = FindMemoryTypeIndex(memoryRequirements.memoryTypeBits, DEVICE_MEMORY_USAGE_DYNAMIC);
+        bool writeDirectly = directMemoryTypeIndex != UINT32_MAX &&
+                            (GetMemoryTypePropertyFlags(directMemoryTypeIndex) & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0;
+        if (writeDirectly && !AllocateDeviceMemory(&memoryRequirements, DEVICE_MEMORY_USAGE_DYNAMIC, false, &s_meshletMemory)) {
+            writeDirectly = false;
+        }
+        if (!writeDirectly && !AllocateDeviceMemory(&memoryRequirements, DEVICE_MEMORY_USAGE_GPU_ONLY, false, &s_meshletMemory))
+        {
+            fprintf(stderr, "Allocating the device memory for meshlet buffer failed!\n");
+            break;
+        }
+
+        res = vkBindBufferMemory(s_specDevice, s_meshletBuffer, s_meshletMemory.memory, s_meshletMemory.offset);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkBindBufferMemory for meshlet buffer failed: %d\n", res);
+            break;
+        }
+
+        if (!CreateBufferWithMemory(sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                    DEVICE_MEMORY_USAGE_GPU_ONLY, "meshlet culling counter buffer", &s_meshletCullingCounterBuffer, &s_meshletCullingCounterMemory)) {
+            break;
+        }
+        if (!CreateBufferWithMemory(FRAME_LAG * sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_DST_BIT, DEVICE_MEMORY_USAGE_READBACK,
+                                    "meshlet culling readback buffer", &s_meshletCullingReadbackBuffer, &s_meshletCullingReadbackMemory)) {
+            break;
+        }
+        memset(s_meshletCullingReadbackMemory.mappedData, 0, FRAME_LAG * sizeof(uint32_t));
+
+        // Otherwise the regions go through the staging ring, and their copies are recorded as a single command
+        VkDeviceSize stagingOffset = 0;
+        uint8_t* dstData = writeDirectly ? s_meshletMemory.mappedData : AllocateUploadStagingMemory(&s_uploadManager, bufferSize, 16U, true, &stagingOffset);
+        if (dstData == NULL)
+        {
+            fprintf(stderr, "Allocating the staging memory for the meshlet data failed!\n");
+            break;
+        }
+        bool areRegionsQueued = true;
+        for (uint32_t i = 0; i < MESHLET_REGION_COUNT && areRegionsQueued; ++i)
+        {
+            memcpy(dstData + regionOffsets[i], regionData[i], (size_t)regionSizes[i]);
+            if (!writeDirectly) {
+                areRegionsQueued = QueueBufferUpload(&s_uploadManager, s_meshletBuffer, regionOffsets[i], stagingOffset + regionOffsets[i], regionSizes[i]);
+            }
+        }
+        if (!areRegionsQueued) break;
+
+        if (!writeDirectly && !ReleaseUploadedBuffer(&s_uploadManager, s_meshletBuffer, 0, bufferSize,
+                                                    VK_PIPELINE_STAGE_TASK_SHADER_BIT_EXT | VK_PIPELINE_STAGE_MESH_SHADER_BIT_EXT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                                                    VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INDEX_READ_BIT)) {
+            break;
+        }
+
+        const VkDescriptorSetAllocateInfo allocInfo = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .pNext = NULL,
+            .descriptorPool = s_descPool,
+            .descriptorSetCount = 1U,
+            .pSetLayouts = &s_meshletDescSetLayout
+        };
+        res = vkAllocateDescriptorSets(s_specDevice, &allocInfo, &s_meshletDescriptorSet);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkAllocateDescriptorSets for meshlets failed: %d\n", res);
+            break;
+        }
+
+        VkDescriptorBufferInfo bufferInfos[MESHLET_BINDING_COUNT];
+        VkWriteDescriptorSet writes[MESHLET_BINDING_COUNT];
+        for (uint32_t i = 0; i < MESHLET_BINDING_COUNT; ++i)
+        {
+            bufferInfos[i] = i == MESHLET_CULLING_COUNTER_BINDING ?
+                (VkDescriptorBufferInfo){
+                    .buffer = s_meshletCullingCounterBuffer,
+                    .offset = 0,
+                    .range = sizeof(uint32_t)
+                } :
+                (VkDescriptorBufferInfo){
+                    .buffer = s_meshletBuffer,
+                    .offset = regionOffsets[i],
+                    .range = regionSizes[i]
+                };
+            writes[i] = (VkWriteDescriptorSet){
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .pNext = NULL,
+                .dstSet = s_meshletDescriptorSet,
+                .dstBinding = i,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pImageInfo = NULL,
+                .pBufferInfo = &bufferInfos[i],
+                .pTexelBufferView = NULL
+            };
+        }
+        vkUpdateDescriptorSets(s_specDevice, MESHLET_BINDING_COUNT, writes, 0, NULL);
+
+        s_meshletCount = meshletData.meshletCount;
+        s_meshletIndexCount = mesh.indexCount;
+        s_meshletIndexOffset = regionOffsets[MESHLET_INDEX_REGION];
+
+        printf("Meshlets: %u triangles split into %u meshlets of up to %u vertices and %u triangles in %.3f ms\n", meshletData.triangleCount,
+            meshletData.meshletCount, maxVertexCount, maxTriangleCount, buildTime);
+        printf("Meshlets: %.1f vertices and %.1f triangles per meshlet on average, %.2f vertex transforms per unique vertex, %s (memory type %u)\n",
+            (double)meshletData.vertexIndexCount / (double)meshletData.meshletCount, (double)meshletData.triangleCount / (double)meshletData.meshletCount,
+            (double)meshletData.vertexIndexCount / (double)mesh.vertexCount,
+            writeDirectly ? "written directly into device local host visible memory" : "uploaded through a staging buffer", s_meshletMemory.memoryTypeIndex);
+
+        succeeded = true;
+    }
+    while (false);
+
+    FreeMeshlets(&meshletData);
+    FreeIndexedMesh(&mesh);
+
+    return succeeded;
+}
+
+static bool CreateFramebuffers(void)
+{
+    const bool isMultisampled = s_msaaSampleCount > VK_SAMPLE_COUNT_1_BIT;
+    // This `attachments` MUST BE coherent with the one in renderpass creation.
+    // The single sampled render pass only has the color and depth attachments.
+    VkImageView attachments[] = { VK_NULL_HANDLE, isMultisampled ? s_depthResource.msaaView : s_depthResource.image_view, VK_NULL_HANDLE, s_depthResource.image_view };
+
+    const VkFramebufferCreateInfo framebufferCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
         .pNext = NULL,
-        .contents = VK_SUBPASS_CONTENTS_INLINE
+        .renderPass = s_render_pass,
+        .attachmentCount = isMultisampled ? 4U : 2U,
+        .pAttachments = attachments,
+        .width = s_render_width,
+        .height = s_render_height,
+        .layers = 1
     };
-    vkCmdBeginRenderPass2(inputCmdBuf, &renderPassBeginInfo, &subpassBeginInfo);
-#else
-    vkCmdBeginRenderPass(inputCmdBuf, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-#endif
 
-    const VkBuffer vertexBuffers[] = {
-        s_vertexCoordsBuffer,       // VERTEX_BUFFER_LOCATION_INDEX
-        s_colorBuffer,              // COLOR_BUFFER_LOCATION_INDEX
-        s_textureCoordsBuffer       // TEXCOORDS_BUFFER_LOCATION_INDEX
+    for (uint32_t i = 0; i < s_swapchainImageCount; ++i)
+    {
+        const VkImageView renderedView = s_useDynamicResolution ? s_swapchainImageResources[i].sceneView : s_swapchainImageResources[i].view;
+        if (isMultisampled)
+        {
+            attachments[0] = s_swapchainImageResources[i].msaaView;
+            attachments[2] = renderedView;
+        }
+        else {
+            attachments[0] = renderedView;
+        }
+        VkResult res = vkCreateFramebuffer(s_specDevice, &framebufferCreateInfo, NULL, &s_swapchainImageResources[i].framebuffer);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreateFramebuffer @%u failed: %d\n", i, res);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void PushDrawTransformIndex(VkCommandBuffer inputCmdBuf, uint32_t drawIndex)
+{
+    const DrawPushConstants pushConstants = { .drawIndex = drawIndex, .meshletCount = s_meshletCount };
+    vkCmdPushConstants(inputCmdBuf, s_pipelineLayout, DRAW_PUSH_CONSTANT_STAGES, 0, sizeof(pushConstants), &pushConstants);
+}
+
+// Takes over the streamed resources and opens the timed section of the frame
+static void RecordFrameBegin(VkCommandBuffer inputCmdBuf, const void* frameData)
+{
+    const uint32_t frameIndex = ((const FrameRecordData*)frameData)->frameIndex;
+
+    // Resources streamed through the upload queue are taken over once their batch has completed, so the frame never waits for it
+    if (s_uploadManager.pendingTransferCount > 0) {
+        RecordUploadAcquireBarriers(&s_uploadManager, inputCmdBuf, GetCompletedUploadValue(&s_uploadManager));
+    }
+
+    // Reset the query pools
+    vkCmdResetQueryPool(inputCmdBuf, s_occlusionQueryPool, frameIndex, 1);
+    vkCmdResetQueryPool(inputCmdBuf, s_timestampQueryPool, frameIndex * 2, 1);
+
+    // Begin the timestamp query
+    vkCmdWriteTimestamp(inputCmdBuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, s_timestampQueryPool, frameIndex * 2);
+}
+
+static void RecordCullingCounterReset(VkCommandBuffer inputCmdBuf, const void* frameData)
+{
+    const CullingCounters initialCounters = { .drawCounts = { 0U }, .objectCount = s_instanceCount };
+    vkCmdUpdateBuffer(inputCmdBuf, s_cullingCounterBuffer, 0, sizeof(initialCounters), &initialCounters);
+}
+
+// Frustum culls the instances of the culled draws with the transforms of this frame, and compacts the visible ones into the indirect draw buffer.
+static void RecordGPUCulling(VkCommandBuffer inputCmdBuf, const void* frameData)
+{
+    const uint32_t frameIndex = ((const FrameRecordData*)frameData)->frameIndex;
+
+    vkCmdBindPipeline(inputCmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, s_cullingPipeline);
+
+    // The same uniform ring slot as the draws of this frame
+    const VkDescriptorSet descriptorSets[] = { s_descriptorSet, s_cullingDescriptorSet };
+    const uint32_t uniformDynamicOffset = (uint32_t)(frameIndex * s_uniformSlotSize);
+    vkCmdBindDescriptorSets(inputCmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, s_cullingPipelineLayout, 0, (uint32_t)(sizeof(descriptorSets) / sizeof(descriptorSets[0])),
+                            descriptorSets, 1U, &uniformDynamicOffset);
+
+    const CullingPushConstants pushConstants = {
+        .objectCount = s_instanceCount,
+        .firstDrawIndex = FLATTEN_DRAW_TRANSFORM_INDEX,
+        .maxDrawCount = s_instanceCapacity,
+        .indexCount = QUAD_INDEX_COUNT
+    };
+    vkCmdPushConstants(inputCmdBuf, s_cullingPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), &pushConstants);
+
+    vkCmdDispatch(inputCmdBuf, (s_instanceCount + CULLING_WORK_GROUP_SIZE - 1) / CULLING_WORK_GROUP_SIZE, CULLED_DRAW_COUNT, 1U);
+}
+
+static inline bool IsMeshletDrawReady(void)
+{
+    return s_pipelines[MESH_SHADER_PIPELINE_INDEX] != VK_NULL_HANDLE && s_meshletDescriptorSet != VK_NULL_HANDLE;
+}
+
+// Clears the culled meshlet counter before the task shaders of this frame accumulate into it
+static void RecordMeshletCullingCounterReset(VkCommandBuffer inputCmdBuf, const void* frameData)
+{
+    vkCmdFillBuffer(inputCmdBuf, s_meshletCullingCounterBuffer, 0, sizeof(uint32_t), 0U);
+}
+
+static void RecordSceneDraw(VkCommandBuffer inputCmdBuf, const void* frameData)
+{
+    const uint32_t swapchainIndex = ((const FrameRecordData*)frameData)->swapchainIndex;
+    const uint32_t frameIndex = ((const FrameRecordData*)frameData)->frameIndex;
+    const bool drawMeshlets = IsMeshletDrawReady();
+
+    // This `clearValues` MUST BE coherent with the attachments in renderpass creation.
+    const VkClearValue clearValues[] = {
+        { .color.float32 = { 0.4f, 0.5f, 0.4f, 1.0f } },
+        { .depthStencil = { .depth = 1.0f, .stencil = 0 } }
     };
-    const VkDeviceSize vertexoffsets[] = { 0U, 0U, 0U };
-    vkCmdBindVertexBuffers(inputCmdBuf, 0, sizeof(vertexBuffers) / sizeof(vertexBuffers[0]), vertexBuffers, vertexoffsets);
 
+    // With dynamic resolution, only the top left part of the scene image at the current scale is rendered, and later upscaled into the whole image
+    const VkExtent2D fullExtent = { .width = s_render_width, .height = s_render_height };
+    const float renderScale = s_useDynamicResolution ? s_dynamicResolution.scale : 1.0f;
+    const VkExtent2D renderExtent = s_useDynamicResolution ? GetScaledRenderExtent(fullExtent, renderScale) : fullExtent;
+    s_frameRenderScales[frameIndex] = renderScale;
+
+    // ==== The following code block is in the render pass instance, or the dynamic rendering instance. ====
+    RenderTarget renderTarget = GetImageRenderTarget(swapchainIndex);
+    renderTarget.extent = renderExtent;
+    BeginRenderTarget(inputCmdBuf, &renderTarget, clearValues);
+
+    // Every stream of the vertex layout lives in s_vertexBuffer, and the binding of a stream is its index
+    VkBuffer vertexBuffers[MAX_VERTEX_STREAM_COUNT];
+    for (uint32_t stream = 0; stream < s_vertexLayout.streamCount; ++stream) {
+        vertexBuffers[stream] = s_vertexBuffer;
+    }
+    vkCmdBindVertexBuffers(inputCmdBuf, 0, s_vertexLayout.streamCount, vertexBuffers, s_vertexLayout.streamOffsets);
+    const VkDeviceSize instanceBufferOffset = 0;
+    vkCmdBindVertexBuffers(inputCmdBuf, INSTANCE_BUFFER_LOCATION_INDEX, 1, &s_instanceBuffer, &instanceBufferOffset);
+    vkCmdBindIndexBuffer(inputCmdBuf, s_indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+
+    // Select the uniform ring slot that the host has just written for this frame
+    const uint32_t uniformDynamicOffset = (uint32_t)(frameIndex * s_uniformSlotSize);
     vkCmdBindDescriptorSets(inputCmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, s_pipelineLayout, 0, 1U,
-                            &s_descriptorSet, 0, NULL);
+                            &s_descriptorSet, 1U, &uniformDynamicOffset);
 
-    const bool isWidthShorterThanHeight = s_render_width < s_render_height;
+    const bool isWidthShorterThanHeight = renderExtent.width < renderExtent.height;
     const VkViewport viewport = {
-        .x = isWidthShorterThanHeight ? 0.0f : (s_render_width - s_render_height) / 2.0f,
-        .y = isWidthShorterThanHeight ? (s_render_height - s_render_width) / 2.0f : 0.0f,
-        .width = isWidthShorterThanHeight ? (float)s_render_width : (float)s_render_height,
-        .height = isWidthShorterThanHeight ? (float)s_render_width : (float)s_render_height,
+        .x = isWidthShorterThanHeight ? 0.0f : (renderExtent.width - renderExtent.height) / 2.0f,
+        .y = isWidthShorterThanHeight ? (renderExtent.height - renderExtent.width) / 2.0f : 0.0f,
+        .width = isWidthShorterThanHeight ? (float)renderExtent.width : (float)renderExtent.height,
+        .height = isWidthShorterThanHeight ? (float)renderExtent.width : (float)renderExtent.height,
         .minDepth = 0.0f,
         .maxDepth = 1.0f
     };
@@ -2998,48 +4361,91 @@ static bool RecordCommandsForDraw(VkCommandBuffer inputCmdBuf, uint32_t swapchai
 
     const VkRect2D scissor = {
         .offset = { .x = 0, .y = 0 },
-        .extent = { .width = s_render_width, .height = s_render_height }
+        .extent = renderExtent
     };
     vkCmdSetScissor(inputCmdBuf, 0, 1, &scissor);
 
     // Begin the occlusion query
-    vkCmdBeginQuery(inputCmdBuf, s_occlusionQueryPool, swapchainIndex, VK_QUERY_CONTROL_PRECISE_BIT);
-
-    // Draw
-    vkCmdBindPipeline(inputCmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, s_pipelines[FLATTEN_PIPELINE_INDEX]);
-    vkCmdDraw(inputCmdBuf, 4, 1, 0, 0);
+    vkCmdBeginQuery(inputCmdBuf, s_occlusionQueryPool, frameIndex, VK_QUERY_CONTROL_PRECISE_BIT);
 
-    vkCmdBindPipeline(inputCmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, s_pipelines[GRAIENT_PIPELINE_INDEX]);
-    vkCmdDraw(inputCmdBuf, 4, 1, 0, 0);
-
-    vkCmdBindPipeline(inputCmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, s_pipelines[TEXTURE_PIPELINE_INDEX]);
-    vkCmdDraw(inputCmdBuf, 4, 1, 0, 0);
+    // Draw the flatten, gradient and texture instances
+    static const int culledDrawPipelineIndices[CULLED_DRAW_COUNT] = { FLATTEN_PIPELINE_INDEX, GRAIENT_PIPELINE_INDEX, TEXTURE_PIPELINE_INDEX };
+    for (uint32_t i = 0; i < CULLED_DRAW_COUNT; ++i)
+    {
+        vkCmdBindPipeline(inputCmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, s_pipelines[culledDrawPipelineIndices[i]]);
+        PushDrawTransformIndex(inputCmdBuf, FLATTEN_DRAW_TRANSFORM_INDEX + i);
+        if (s_cullingPipeline != VK_NULL_HANDLE)
+        {
+            // One command per visible instance, as many as the culling compute shader has counted
+            dyn_vkCmdDrawIndexedIndirectCountKHR(inputCmdBuf, s_indirectDrawBuffer, (VkDeviceSize)i * s_instanceCapacity * sizeof(VkDrawIndexedIndirectCommand),
+                                                s_cullingCounterBuffer, offsetof(CullingCounters, drawCounts) + i * sizeof(uint32_t),
+                                                s_instanceCapacity, sizeof(VkDrawIndexedIndirectCommand));
+        }
+        else {
+            vkCmdDrawIndexed(inputCmdBuf, QUAD_INDEX_COUNT, s_instanceCount, 0, 0, 0);
+        }
+    }
 
     // Draw the geometry shader test primitives
     vkCmdBindPipeline(inputCmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, s_pipelines[GEOMETRY_SHADER_PIPELINE_INDEX]);
+    PushDrawTransformIndex(inputCmdBuf, GEOMETRY_SHADER_DRAW_TRANSFORM_INDEX);
     vkCmdDraw(inputCmdBuf, 1, 1, 0, 0);
 
-    if (s_pipelines[MESH_SHADER_PIPELINE_INDEX] != VK_NULL_HANDLE && dyn_vkCmdDrawMeshTasksEXT != NULL)
+    if (drawMeshlets)
     {
-        // Dispatch task shader
+        // Dispatch task shader, each row of task work groups culls and draws the whole meshlet mesh in a quadrant
         vkCmdBindPipeline(inputCmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, s_pipelines[MESH_SHADER_PIPELINE_INDEX]);
-        dyn_vkCmdDrawMeshTasksEXT(inputCmdBuf, 1U, 1U, 1U);
+        vkCmdBindDescriptorSets(inputCmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, s_pipelineLayout, 1, 1U, &s_meshletDescriptorSet, 0, NULL);
+        PushDrawTransformIndex(inputCmdBuf, MESH_SHADER_DRAW_TRANSFORM_INDEX);
+        dyn_vkCmdDrawMeshTasksEXT(inputCmdBuf, (s_meshletCount + s_taskWorkGroupSize - 1) / s_taskWorkGroupSize, MESH_SHADER_WORK_GROUP_COUNT, 1U);
     }
 
     // End the occlusion query
-    vkCmdEndQuery(inputCmdBuf, s_occlusionQueryPool, swapchainIndex);
+    vkCmdEndQuery(inputCmdBuf, s_occlusionQueryPool, frameIndex);
 
     // Note that ending the renderpass changes the image's layout from
-    // COLOR_ATTACHMENT_OPTIMAL to PRESENT_SRC_KHR
-#if USE_MSAA_SAMPLE_COUNT > 0
-    const VkSubpassEndInfoKHR subpassEndInfo = {
-        .sType = VK_STRUCTURE_TYPE_SUBPASS_END_INFO_KHR,
-        .pNext = NULL
-    };
-    vkCmdEndRenderPass2(inputCmdBuf, &subpassEndInfo);
-#else
-    vkCmdEndRenderPass(inputCmdBuf);
-#endif
+    // COLOR_ATTACHMENT_OPTIMAL to PRESENT_SRC_KHR, as does the barrier after dynamic rendering
+    EndRenderTarget(inputCmdBuf, &renderTarget);
+
+    // With dynamic resolution the scene image is left in TRANSFER_SRC_OPTIMAL instead, and the blit brings the presented image into PRESENT_SRC_KHR
+    if (s_useDynamicResolution)
+    {
+        RecordUpscaleBlit(inputCmdBuf, s_swapchainImageResources[swapchainIndex].sceneImage, renderExtent,
+                        s_swapchainImageResources[swapchainIndex].image, fullExtent, s_colorAttachmentFinalLayout);
+    }
+}
+
+// Keeps the counters of this frame for the host, which reads them after the fence of this frame slot has been signaled
+static void RecordCounterReadback(VkCommandBuffer inputCmdBuf, const void* frameData)
+{
+    const uint32_t frameIndex = ((const FrameRecordData*)frameData)->frameIndex;
+
+    if (s_cullingPipeline != VK_NULL_HANDLE)
+    {
+        const VkBufferCopy copyRegion = {
+            .srcOffset = 0,
+            .dstOffset = frameIndex * sizeof(CullingCounters),
+            .size = sizeof(CullingCounters)
+        };
+        vkCmdCopyBuffer(inputCmdBuf, s_cullingCounterBuffer, s_cullingReadbackBuffer, 1, &copyRegion);
+    }
+
+    if (IsMeshletDrawReady())
+    {
+        const VkBufferCopy copyRegion = {
+            .srcOffset = 0,
+            .dstOffset = frameIndex * sizeof(uint32_t),
+            .size = sizeof(uint32_t)
+        };
+        vkCmdCopyBuffer(inputCmdBuf, s_meshletCullingCounterBuffer, s_meshletCullingReadbackBuffer, 1, &copyRegion);
+    }
+}
+
+// Hands the presented image over to the present queue and closes the timed section of the frame
+static void RecordFrameEnd(VkCommandBuffer inputCmdBuf, const void* frameData)
+{
+    const uint32_t swapchainIndex = ((const FrameRecordData*)frameData)->swapchainIndex;
+    const uint32_t frameIndex = ((const FrameRecordData*)frameData)->frameIndex;
 
     if (IsSeperatePresentQueue())
     {
@@ -3071,33 +4477,143 @@ static bool RecordCommandsForDraw(VkCommandBuffer inputCmdBuf, uint32_t swapchai
             NULL, 1, &image_ownership_barrier);
     }
 
-    // Update uniform buffer data on device side.
-    // ATTENTION: vkCmdCopyBuffer MUST BE only called outside of a render pass instance!
-    const size_t srcOffset = sizeof(s_vertex_coords_data) + sizeof(s_texture_coords_data) + sizeof(s_vertex_color_data);
-    const VkBufferCopy copyUniformRegion = {
-        .srcOffset = srcOffset,
-        .dstOffset = 0,
-        .size = sizeof(FlattenVertexUniform)
-    };
-    vkCmdCopyBuffer(inputCmdBuf, s_hostVertexAndUniformBuffer, s_uniformBuffer, 1, &copyUniformRegion);
+    // End the query timestamp
+    vkCmdResetQueryPool(inputCmdBuf, s_timestampQueryPool, frameIndex * 2 + 1, 1);
+    vkCmdWriteTimestamp(inputCmdBuf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, s_timestampQueryPool, frameIndex * 2 + 1);
+}
+
+// The passes of a frame in their order, and the buffers that they hand over to each other. The graph derives the barriers between them,
+// including those between the passes of consecutive frames, which the submission order alone does not provide.
+// The color and depth attachments stay with the render pass, or the barriers of the dynamic rendering, that they are created for.
+static bool CreateFrameGraph(void)
+{
+    RenderGraph* graph = &s_frameGraph;
+    InitializeRenderGraph(graph, s_specDevice);
+
+    const uint32_t instanceResource = ImportRenderGraphBuffer(graph, "instance buffer", s_instanceBuffer, 0, VK_WHOLE_SIZE);
+    uint32_t indirectDrawResource = UINT32_MAX;
+    uint32_t cullingCounterResource = UINT32_MAX;
+    uint32_t meshletCounterResource = UINT32_MAX;
+    uint32_t cullingReadbackResources[FRAME_LAG];
+    uint32_t meshletReadbackResources[FRAME_LAG];
+    for (uint32_t slot = 0; slot < FRAME_LAG; ++slot)
+    {
+        cullingReadbackResources[slot] = UINT32_MAX;
+        meshletReadbackResources[slot] = UINT32_MAX;
+    }
+
+    if (s_cullingPipeline != VK_NULL_HANDLE)
+    {
+        indirectDrawResource = ImportRenderGraphBuffer(graph, "indirect draw buffer", s_indirectDrawBuffer, 0, VK_WHOLE_SIZE);
+        cullingCounterResource = ImportRenderGraphBuffer(graph, "culling counter buffer", s_cullingCounterBuffer, 0, VK_WHOLE_SIZE);
+        for (uint32_t slot = 0; slot < FRAME_LAG; ++slot)
+        {
+            cullingReadbackResources[slot] = ImportRenderGraphBuffer(graph, "culling readback slot", s_cullingReadbackBuffer,
+                                                                    slot * sizeof(CullingCounters), sizeof(CullingCounters));
+        }
+    }
+    if (s_meshletCullingCounterBuffer != VK_NULL_HANDLE)
+    {
+        meshletCounterResource = ImportRenderGraphBuffer(graph, "meshlet culling counter buffer", s_meshletCullingCounterBuffer, 0, VK_WHOLE_SIZE);
+        for (uint32_t slot = 0; slot < FRAME_LAG; ++slot)
+        {
+            meshletReadbackResources[slot] = ImportRenderGraphBuffer(graph, "meshlet culling readback slot", s_meshletCullingReadbackBuffer,
+                                                                    slot * sizeof(uint32_t), sizeof(uint32_t));
+        }
+    }
+
+    // Out of the timed section, as it only happens when the instance count changes
+    s_instanceUploadPass = AddRenderGraphPass(graph, "instance upload", RecordInstanceDataUpload);
+    bool succeeded = UseRenderGraphResource(graph, s_instanceUploadPass, instanceResource, RENDER_GRAPH_USAGE_TRANSFER_WRITE);
+
+    succeeded &= AddRenderGraphPass(graph, "frame begin", RecordFrameBegin) != UINT32_MAX;
 
-    const VkBufferMemoryBarrier copyBarrier = {
-        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+    // The culling is timed together with the draws that it saves
+    if (s_cullingPipeline != VK_NULL_HANDLE)
+    {
+        const uint32_t resetPass = AddRenderGraphPass(graph, "culling counter reset", RecordCullingCounterReset);
+        succeeded &= UseRenderGraphResource(graph, resetPass, cullingCounterResource, RENDER_GRAPH_USAGE_TRANSFER_WRITE);
+
+        const uint32_t cullingPass = AddRenderGraphPass(graph, "GPU culling", RecordGPUCulling);
+        succeeded &= UseRenderGraphResource(graph, cullingPass, instanceResource, RENDER_GRAPH_USAGE_COMPUTE_READ);
+        succeeded &= UseRenderGraphResource(graph, cullingPass, cullingCounterResource, RENDER_GRAPH_USAGE_COMPUTE_READ_WRITE);
+        succeeded &= UseRenderGraphResource(graph, cullingPass, indirectDrawResource, RENDER_GRAPH_USAGE_COMPUTE_WRITE);
+    }
+    if (meshletCounterResource != UINT32_MAX)
+    {
+        s_meshletCounterResetPass = AddRenderGraphPass(graph, "meshlet counter reset", RecordMeshletCullingCounterReset);
+        succeeded &= UseRenderGraphResource(graph, s_meshletCounterResetPass, meshletCounterResource, RENDER_GRAPH_USAGE_TRANSFER_WRITE);
+    }
+
+    const uint32_t drawPass = AddRenderGraphPass(graph, "scene draw", RecordSceneDraw);
+    succeeded &= UseRenderGraphResource(graph, drawPass, instanceResource, RENDER_GRAPH_USAGE_VERTEX_ATTRIBUTE_READ);
+    if (s_cullingPipeline != VK_NULL_HANDLE)
+    {
+        succeeded &= UseRenderGraphResource(graph, drawPass, indirectDrawResource, RENDER_GRAPH_USAGE_INDIRECT_READ);
+        succeeded &= UseRenderGraphResource(graph, drawPass, cullingCounterResource, RENDER_GRAPH_USAGE_INDIRECT_READ);
+    }
+    if (meshletCounterResource != UINT32_MAX) {
+        succeeded &= UseRenderGraphResource(graph, drawPass, meshletCounterResource, RENDER_GRAPH_USAGE_TASK_READ_WRITE);
+    }
+
+    // One readback pass per frame slot, so that each slot of the readback buffers is a resource of its own
+    for (uint32_t slot = 0; slot < FRAME_LAG; ++slot)
+    {
+        s_readbackPasses[slot] = UINT32_MAX;
+        s_hostReadbackPasses[slot] = UINT32_MAX;
+        if (s_cullingPipeline == VK_NULL_HANDLE && meshletCounterResource == UINT32_MAX) continue;
+
+        s_readbackPasses[slot] = AddRenderGraphPass(graph, "counter readback", RecordCounterReadback);
+        s_hostReadbackPasses[slot] = AddRenderGraphPass(graph, "host counter readback", NULL);
+        if (s_cullingPipeline != VK_NULL_HANDLE)
+        {
+            succeeded &= UseRenderGraphResource(graph, s_readbackPasses[slot], cullingCounterResource, RENDER_GRAPH_USAGE_TRANSFER_READ);
+            succeeded &= UseRenderGraphResource(graph, s_readbackPasses[slot], cullingReadbackResources[slot], RENDER_GRAPH_USAGE_TRANSFER_WRITE);
+            succeeded &= UseRenderGraphResource(graph, s_hostReadbackPasses[slot], cullingReadbackResources[slot], RENDER_GRAPH_USAGE_HOST_READ);
+        }
+        if (meshletCounterResource != UINT32_MAX)
+        {
+            succeeded &= UseRenderGraphResource(graph, s_readbackPasses[slot], meshletCounterResource, RENDER_GRAPH_USAGE_TRANSFER_READ);
+            succeeded &= UseRenderGraphResource(graph, s_readbackPasses[slot], meshletReadbackResources[slot], RENDER_GRAPH_USAGE_TRANSFER_WRITE);
+            succeeded &= UseRenderGraphResource(graph, s_hostReadbackPasses[slot], meshletReadbackResources[slot], RENDER_GRAPH_USAGE_HOST_READ);
+        }
+    }
+
+    succeeded &= AddRenderGraphPass(graph, "frame end", RecordFrameEnd) != UINT32_MAX;
+
+    if (!succeeded || !CompileRenderGraph(graph))
+    {
+        fprintf(stderr, "Creating the frame graph failed!\n");
+        return false;
+    }
+    return true;
+}
+
+static bool RecordCommandsForDraw(VkCommandBuffer inputCmdBuf, uint32_t swapchainIndex, uint32_t frameIndex)
+{
+    const VkCommandBufferBeginInfo cmd_buf_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
         .pNext = NULL,
-        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
-        .srcQueueFamilyIndex = s_graphicsQueueFamilyIndex,
-        .dstQueueFamilyIndex = s_graphicsQueueFamilyIndex,
-        .buffer = s_uniformBuffer,
-        .offset = 0,
-        .size = sizeof(FlattenVertexUniform)
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = NULL,
     };
-    vkCmdPipelineBarrier(inputCmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0,
-                        0, NULL, 1, &copyBarrier, 0, NULL);
+    VkResult res = vkBeginCommandBuffer(inputCmdBuf, &cmd_buf_info);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkBeginCommandBuffer in RecordCommandsForDraw @%u failed: %d\n", swapchainIndex, res);
+        return false;
+    }
 
-    // End the query timestamp
-    vkCmdResetQueryPool(inputCmdBuf, s_timestampQueryPool, swapchainIndex * 2 + 1, 1);
-    vkCmdWriteTimestamp(inputCmdBuf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, s_timestampQueryPool, swapchainIndex * 2 + 1);
+    SetRenderGraphPassEnabled(&s_frameGraph, s_instanceUploadPass, s_instanceUploadCount > 0);
+    SetRenderGraphPassEnabled(&s_frameGraph, s_meshletCounterResetPass, IsMeshletDrawReady());
+    for (uint32_t slot = 0; slot < FRAME_LAG; ++slot)
+    {
+        SetRenderGraphPassEnabled(&s_frameGraph, s_readbackPasses[slot], slot == frameIndex);
+        SetRenderGraphPassEnabled(&s_frameGraph, s_hostReadbackPasses[slot], slot == frameIndex);
+    }
+
+    const FrameRecordData frameData = { .swapchainIndex = swapchainIndex, .frameIndex = frameIndex };
+    ExecuteRenderGraph(&s_frameGraph, inputCmdBuf, &frameData);
 
     res = vkEndCommandBuffer(inputCmdBuf);
     if (res != VK_SUCCESS)
@@ -3115,6 +4631,11 @@ static bool FlushInitCommand(void)
     // In that case the second call should be ignored
     if (s_commandBuffers[0] == VK_NULL_HANDLE) return true;
 
+    // The upload batch goes first, and the init commands acquire what it has released once it has completed on the GPU
+    uint64_t uploadValue = 0;
+    if (!SubmitUploadBatch(&s_uploadManager, &uploadValue)) return false;
+    RecordUploadAcquireBarriers(&s_uploadManager, s_commandBuffers[0], uploadValue);
+
     VkResult res = vkEndCommandBuffer(s_commandBuffers[0]);
     if (res != VK_SUCCESS)
     {
@@ -3122,12 +4643,23 @@ static bool FlushInitCommand(void)
         return false;
     }
 
+    const VkTimelineSemaphoreSubmitInfo timelineSubmitInfo = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .pNext = NULL,
+        .waitSemaphoreValueCount = 1,
+        .pWaitSemaphoreValues = &uploadValue,
+        .signalSemaphoreValueCount = 0,
+        .pSignalSemaphoreValues = NULL
+    };
+    const VkPipelineStageFlags uploadWaitStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    const bool waitsForUploads = uploadValue > 0;
+
     const VkSubmitInfo submit_info = {
         .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .pNext = NULL,
-        .waitSemaphoreCount = 0,
-        .pWaitSemaphores = NULL,
-        .pWaitDstStageMask = NULL,
+        .pNext = waitsForUploads ? &timelineSubmitInfo : NULL,
+        .waitSemaphoreCount = waitsForUploads ? 1U : 0U,
+        .pWaitSemaphores = waitsForUploads ? &s_uploadManager.timelineSemaphore : NULL,
+        .pWaitDstStageMask = waitsForUploads ? &uploadWaitStageMask : NULL,
         .commandBufferCount = (uint32_t)(sizeof(s_commandBuffers) / sizeof(s_commandBuffers[0])),
         .pCommandBuffers = s_commandBuffers,
         .signalSemaphoreCount = 0,
@@ -3159,69 +4691,279 @@ static bool FlushInitCommand(void)
             break;
         }
     }
-    while (false);
+    while (false);
+
+    vkDestroyFence(s_specDevice, submitFence, NULL);
+    
+    // This command buffer is one shot for the init flush submission,
+    // and will NOT be used any more.
+    vkFreeCommandBuffers(s_specDevice, s_commandPool, (uint32_t)(sizeof(s_commandBuffers) / sizeof(s_commandBuffers[0])), s_commandBuffers);
+    s_commandBuffers[0] = VK_NULL_HANDLE;
+    s_uploadManager.inlineCommandBuffer = VK_NULL_HANDLE;
+
+    if (s_uploadManager.timelineSemaphore != VK_NULL_HANDLE) {
+        printf("Init uploads: %u batch(es) on queue family %u, %u queue family ownership transfer(s)\n", s_uploadManager.submittedBatchCount,
+            s_uploadManager.queueFamilyIndex, s_uploadManager.ownershipTransferCount);
+    }
+    // Without timeline semaphores, the staging ring was consumed by the init command buffer that has just completed
+    if (res == VK_SUCCESS) {
+        CompleteInlineUploads(&s_uploadManager);
+    }
+    PrintUploadStatistics(&s_uploadManager);
+
+    if (s_hostUploadTextureBuffer != VK_NULL_HANDLE)
+    {
+        vkDestroyBuffer(s_specDevice, s_hostUploadTextureBuffer, NULL);
+        s_hostUploadTextureBuffer = VK_NULL_HANDLE;
+    }
+    FreeDeviceMemory(&s_hostUploadTextureMemory);
+    DestroyMipmapComputeResources(s_specDevice, &s_mipmapComputeResources);
+
+    return res == VK_SUCCESS;
+}
+
+static void StoreDrawTransform(DrawTransformUniform* transforms, uint32_t drawIndex, const Mat4* projection, Mat4 translation, Mat4 rotation)
+{
+    const Mat4 mvp = Mat4ModelViewProjection(projection, &translation, &rotation);
+    Mat4Store(transforms->mvp[drawIndex], &mvp);
+}
+
+static bool UpdateUniformData(uint32_t frameIndex)
+{
+    // The ring slot of this frame is not read by the GPU any more since its fence has been waited for,
+    // so it can be written directly through the persistent mapping.
+    DrawTransformUniform* transforms = (DrawTransformUniform*)(s_uniformRingData + frameIndex * s_uniformSlotSize);
+
+    // glOrtho(-1.0, 1.0, -1.0, 1.0, 1.0, 3.0), as the viewport is always square
+    const Mat4 projection = Mat4Ortho(-1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 3.0f);
+    const float radian = DegreesToRadians(s_currRorationDegree);
+
+    StoreDrawTransform(transforms, FLATTEN_DRAW_TRANSFORM_INDEX, &projection, Mat4Translate(-0.6f, -0.6f, -2.3f), Mat4RotateY(radian));
+    StoreDrawTransform(transforms, GRADIENT_DRAW_TRANSFORM_INDEX, &projection, Mat4Translate(0.6f, -0.6f, -2.3f), Mat4RotateX(-radian));
+    StoreDrawTransform(transforms, TEXTURE_DRAW_TRANSFORM_INDEX, &projection, Mat4Translate(0.0f, -0.5f, -2.3f), Mat4RotateZ(-radian));
+    StoreDrawTransform(transforms, GEOMETRY_SHADER_DRAW_TRANSFORM_INDEX, &projection, Mat4Translate(-0.55f, 0.55f, -2.3f), Mat4RotateZ(radian));
+    memcpy(transforms->positionScale, s_quadVertexAttributes.decodeScales[0], sizeof(transforms->positionScale));
+    memcpy(transforms->positionBias, s_quadVertexAttributes.decodeBiases[0], sizeof(transforms->positionBias));
+
+    // The mesh work groups are placed in 4 quadrants and the odd ones rotate in the opposite direction
+    const float meshOffsetsX[MESH_SHADER_WORK_GROUP_COUNT] = { 0.15f, 0.15f, 0.65f, 0.65f };
+    const float meshOffsetsY[MESH_SHADER_WORK_GROUP_COUNT] = { 0.15f, 0.65f, 0.15f, 0.65f };
+    for (uint32_t i = 0; i < MESH_SHADER_WORK_GROUP_COUNT; ++i)
+    {
+        StoreDrawTransform(transforms, MESH_SHADER_DRAW_TRANSFORM_INDEX + i, &projection, Mat4Translate(meshOffsetsX[i], meshOffsetsY[i], -2.3f),
+                        Mat4RotateZ((i & 1U) != 0 ? -radian : radian));
+    }
+
+    if (!s_isRotating) return true;
+
+    s_currRorationDegree += 1.0f;
+    if (s_currRorationDegree >= 360.0f) {
+        s_currRorationDegree = 0.0f;
+    }
+
+    return true;
+}
+
+static size_t s_drawCount = 0;
+
+// Fetch the query results of the last rendering in the frame slot `frameIndex`.
+// This must be called after its fence has been waited for. Returns the GPU duration in milliseconds, or -1 if unavailable.
+static double FetchFrameQueryResults(uint32_t frameIndex)
+{
+    if (s_drawCount < FRAME_LAG) return -1.0;
+
+    double gpuDuration = -1.0;
+    uint64_t timestamps[2] = { 0 };
+    VkResult res = vkGetQueryPoolResults(s_specDevice, s_timestampQueryPool, frameIndex * 2, 2,
+                        sizeof(timestamps), timestamps, sizeof(timestamps[0]), VK_QUERY_RESULT_64_BIT);
+    if (res == VK_SUCCESS)
+    {
+        gpuDuration = (double)(timestamps[1] - timestamps[0]) * (double)s_gpuTimestampPeriod / 1000000.0;
+        s_currGPUDuration = gpuDuration;
+
+        // The next frame to be recorded is scaled for the time of this one, which has been rendered FRAME_LAG frames earlier
+        if (s_useDynamicResolution) {
+            UpdateDynamicResolution(&s_dynamicResolution, gpuDuration, s_frameRenderScales[frameIndex]);
+        }
+    }
 
-    vkDestroyFence(s_specDevice, submitFence, NULL);
-    
-    // This command buffer is one shot for the init flush submission,
-    // and will NOT be used any more.
-    vkFreeCommandBuffers(s_specDevice, s_commandPool, (uint32_t)(sizeof(s_commandBuffers) / sizeof(s_commandBuffers[0])), s_commandBuffers);
-    s_commandBuffers[0] = VK_NULL_HANDLE;
+    uint64_t occlusion = 0;
+    res = vkGetQueryPoolResults(s_specDevice, s_occlusionQueryPool, frameIndex, 1,
+                        sizeof(occlusion), &occlusion, sizeof(occlusion), VK_QUERY_RESULT_64_BIT);
+    if (res == VK_SUCCESS) {
+        s_currOcclusionCount = occlusion;
+    }
 
-    if (s_hostUploadTextureBuffer != VK_NULL_HANDLE)
+    if (s_cullingReadbackMemory.mappedData != NULL)
     {
-        vkDestroyBuffer(s_specDevice, s_hostUploadTextureBuffer, NULL);
-        s_hostUploadTextureBuffer = VK_NULL_HANDLE;
+        const CullingCounters* counters = (const CullingCounters*)s_cullingReadbackMemory.mappedData + frameIndex;
+        uint32_t visibleCount = 0;
+        for (uint32_t i = 0; i < CULLED_DRAW_COUNT; ++i) {
+            visibleCount += counters->drawCounts[i];
+        }
+        s_currVisibleObjectCount = visibleCount;
+        s_currCulledObjectCount = counters->objectCount * CULLED_DRAW_COUNT - visibleCount;
     }
-    if (s_hostUploadTextureMemory != VK_NULL_HANDLE)
-    {
-        vkFreeMemory(s_specDevice, s_hostUploadTextureMemory, NULL);
-        s_hostUploadTextureMemory = VK_NULL_HANDLE;
+
+    if (s_meshletCullingReadbackMemory.mappedData != NULL) {
+        s_currCulledMeshletCount = ((const uint32_t*)s_meshletCullingReadbackMemory.mappedData)[frameIndex];
     }
 
-    return res == VK_SUCCESS;
+    return gpuDuration;
 }
 
-static bool UpdateUniformData(int currImageIndex)
+// Destroys everything whose size follows the swapchain, that is the image views of the swapchain images, the offscreen images,
+// the MSAA color, scene and depth images and the framebuffers. Nothing of them may be in use.
+static void DestroySizeDependentResources(void)
 {
-    if (!s_isRotating) return true;
+    for (uint32_t i = 0; i < s_swapchainImageCount; ++i)
+    {
+        SwapchainImageResources* imageResources = &s_swapchainImageResources[i];
+        if (imageResources->framebuffer != VK_NULL_HANDLE) {
+            vkDestroyFramebuffer(s_specDevice, imageResources->framebuffer, NULL);
+        }
+        if (imageResources->view != VK_NULL_HANDLE) {
+            vkDestroyImageView(s_specDevice, imageResources->view, NULL);
+        }
+        // Swapchain images are owned by the swapchain, only the offscreen ones have to be destroyed here.
+        if (s_isHeadless && imageResources->image != VK_NULL_HANDLE) {
+            vkDestroyImage(s_specDevice, imageResources->image, NULL);
+        }
+        if (imageResources->msaaImage != VK_NULL_HANDLE) {
+            vkDestroyImage(s_specDevice, imageResources->msaaImage, NULL);
+        }
+        if (imageResources->msaaView != VK_NULL_HANDLE) {
+            vkDestroyImageView(s_specDevice, imageResources->msaaView, NULL);
+        }
+        if (imageResources->sceneView != VK_NULL_HANDLE) {
+            vkDestroyImageView(s_specDevice, imageResources->sceneView, NULL);
+        }
+        if (imageResources->sceneImage != VK_NULL_HANDLE) {
+            vkDestroyImage(s_specDevice, imageResources->sceneImage, NULL);
+        }
+        imageResources->image = VK_NULL_HANDLE;
+        imageResources->view = VK_NULL_HANDLE;
+        imageResources->msaaImage = VK_NULL_HANDLE;
+        imageResources->msaaView = VK_NULL_HANDLE;
+        imageResources->sceneImage = VK_NULL_HANDLE;
+        imageResources->sceneView = VK_NULL_HANDLE;
+        imageResources->framebuffer = VK_NULL_HANDLE;
+    }
+    FreeDeviceMemory(&s_msaaColorImageMemory);
+    FreeDeviceMemory(&s_offscreenColorImageMemory);
+    FreeDeviceMemory(&s_sceneColorImageMemory);
+
+    if (s_depthResource.image_view != VK_NULL_HANDLE) {
+        vkDestroyImageView(s_specDevice, s_depthResource.image_view, NULL);
+    }
+    if (s_depthResource.image != VK_NULL_HANDLE) {
+        vkDestroyImage(s_specDevice, s_depthResource.image, NULL);
+    }
+    if (s_depthResource.msaaView != VK_NULL_HANDLE) {
+        vkDestroyImageView(s_specDevice, s_depthResource.msaaView, NULL);
+    }
+    if (s_depthResource.msaaImage != VK_NULL_HANDLE) {
+        vkDestroyImage(s_specDevice, s_depthResource.msaaImage, NULL);
+    }
+    FreeDeviceMemory(&s_depthResource.device_memory);
+    FreeDeviceMemory(&s_depthResource.msaaDeviceMemory);
+    s_depthResource.image = VK_NULL_HANDLE;
+    s_depthResource.image_view = VK_NULL_HANDLE;
+    s_depthResource.msaaImage = VK_NULL_HANDLE;
+    s_depthResource.msaaView = VK_NULL_HANDLE;
+}
 
-    const size_t srcOffset = sizeof(s_vertex_coords_data) + sizeof(s_texture_coords_data) + sizeof(s_vertex_color_data);
+// Recreates the swapchain, or the offscreen images in headless mode, at s_render_width x s_render_height together with the resources
+// of the same size. The pipelines, descriptors and buffers are kept, so it only waits for the frames in flight instead of the whole device.
+// `pWaitTime` receives the time spent waiting for them in milliseconds.
+static bool RecreateSizeDependentResources(double* pWaitTime)
+{
+    const double waitStartTime = GetCurrentTimeInMilliseconds();
 
-    FlattenVertexUniform* hostUniformData = NULL;
-    VkResult res = vkMapMemory(s_specDevice, s_hostVertexUniformMemory, srcOffset, sizeof(FlattenVertexUniform), 0, &hostUniformData);
+    // Every frame in flight renders into the shared depth image, so all of them have to retire.
+    // The fence of a frame is only reset once its image has been acquired, so none of them can stay unsignaled.
+    VkResult res = vkWaitForFences(s_specDevice, FRAME_LAG, s_presentFences, VK_TRUE, UINT64_MAX);
     if (res != VK_SUCCESS)
     {
-        fprintf(stderr, "vkMapMemory for update uniform data failed: %d\n", res);
+        fprintf(stderr, "vkWaitForFences for resizing failed: %d\n", res);
         return false;
     }
+    // The ownership transfers are submitted without any fence, and have to be re-recorded for the new images
+    const bool isSeparatePresentQueue = !s_isHeadless && IsSeperatePresentQueue();
+    if (isSeparatePresentQueue) {
+        vkQueueWaitIdle(s_presentQueue);
+    }
+    *pWaitTime = GetCurrentTimeInMilliseconds() - waitStartTime;
 
-    hostUniformData->u_factor[0] = 1.0f;
-    hostUniformData->u_factor[1] = 1.0f;
-    hostUniformData->u_angle = s_currRorationDegree;
+    if (isSeparatePresentQueue)
+    {
+        for (uint32_t i = 0; i < s_swapchainImageCount; ++i)
+        {
+            if (s_swapchainImageResources[i].graphics_to_present_cmd_buf != VK_NULL_HANDLE)
+            {
+                vkFreeCommandBuffers(s_specDevice, s_presentCommandPool, 1, &s_swapchainImageResources[i].graphics_to_present_cmd_buf);
+                s_swapchainImageResources[i].graphics_to_present_cmd_buf = VK_NULL_HANDLE;
+            }
+        }
+    }
+    DestroySizeDependentResources();
 
-    s_currRorationDegree += 1.0f;
-    if (s_currRorationDegree >= 360.0f) {
-        s_currRorationDegree = 0.0f;
+    // The old swapchain is handed over to the new one through `oldSwapchain`, so the presentation engine can reuse its resources.
+    // The queues and the color format were selected once at initialization, so the pipelines and the render pass stay compatible.
+    if (s_isHeadless)
+    {
+        if (!CreateOffscreenRenderTargets()) return false;
+    }
+    else if (!CreateVulkanSwapchain()) {
+        return false;
     }
 
-    vkUnmapMemory(s_specDevice, s_hostVertexUniformMemory);
+    if (!CreateDepthReource()) return false;
+    if (!s_useDynamicRendering && !CreateFramebuffers()) return false;
+    if (isSeparatePresentQueue && !CreatePresentImageOwnershipTransitions()) return false;
 
     return true;
 }
 
-static size_t s_drawCount = 0;
-
-static void DoResize(void)
+// Returns false if nothing can be rendered at the current size, e.g. the window is minimized, or the recreation failed.
+static bool DoResize(void)
 {
+    if (!s_isRenderPrepared) return false;
+
+    if (!s_isHeadless)
+    {
+        // A minimized window has a zero extent, with which no swapchain can be created, so the old one is kept until the window is restored.
+        VkSurfaceCapabilitiesKHR surfCapabilities = { 0 };
+        const VkResult res = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(s_currPhysicalDevice, s_surface, &surfCapabilities);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkGetPhysicalDeviceSurfaceCapabilitiesKHR for resizing failed: %d\n", res);
+            return false;
+        }
+        if (surfCapabilities.currentExtent.width == 0 || surfCapabilities.currentExtent.height == 0) return false;
+    }
+
+    const double startTime = GetCurrentTimeInMilliseconds();
+    double waitTime = 0.0;
+    if (!RecreateSizeDependentResources(&waitTime))
+    {
+        // Nothing can be drawn without the size dependent resources
+        s_isRenderPrepared = false;
+        return false;
+    }
+    printf("Resized to %ux%u in %.3f ms, of which %.3f ms waiting for the frames in flight\n", s_render_width, s_render_height,
+        GetCurrentTimeInMilliseconds() - startTime, waitTime);
 
+    return true;
 }
 
+#ifdef _WIN32
 static void DrawObjects(HINSTANCE hInstance, HWND hWnd, int currFrameIndex)
 {
     // Ensure no more than FRAME_LAG renderings are outstanding
     vkWaitForFences(s_specDevice, 1, &s_presentFences[currFrameIndex], VK_TRUE, UINT64_MAX);
-    vkResetFences(s_specDevice, 1, &s_presentFences[currFrameIndex]);
+
+    FetchFrameQueryResults((uint32_t)currFrameIndex);
 
     uint32_t currImageIndex = 0;
     VkResult res;
@@ -3235,8 +4977,8 @@ static void DrawObjects(HINSTANCE hInstance, HWND hWnd, int currFrameIndex)
             break;
 
         case VK_ERROR_OUT_OF_DATE_KHR:
-            // s_swapchain is out of date (e.g. the window was resized) and must be recreated:
-            DoResize();
+            // s_swapchain is out of date (e.g. the window was resized) and must be recreated, or the frame is skipped while it cannot be
+            if (!DoResize()) return;
             break;
 
         case VK_SUBOPTIMAL_KHR:
@@ -3246,7 +4988,7 @@ static void DrawObjects(HINSTANCE hInstance, HWND hWnd, int currFrameIndex)
 
         case VK_ERROR_SURFACE_LOST_KHR:
             if (!CreateVulkanSurface(hInstance, hWnd)) return;
-            DoResize();
+            if (!DoResize()) return;
             break;
 
         default:
@@ -3254,9 +4996,17 @@ static void DrawObjects(HINSTANCE hInstance, HWND hWnd, int currFrameIndex)
             return;
         }
     }
-    while (res != VK_SUCCESS);
+    while (res != VK_SUCCESS && res != VK_SUBOPTIMAL_KHR);
+
+    // Only reset once the frame is certain to be submitted, so that a resize never waits for a fence that is not going to be signaled
+    vkResetFences(s_specDevice, 1, &s_presentFences[currFrameIndex]);
+
+    if (!UpdateUniformData((uint32_t)currFrameIndex)) {
+        return;
+    }
 
-    if (!UpdateUniformData(currImageIndex)) {
+    VkCommandBuffer frameCmdBuf = s_frameCommandBuffers[currFrameIndex];
+    if (!RecordCommandsForDraw(frameCmdBuf, currImageIndex, (uint32_t)currFrameIndex)) {
         return;
     }
 
@@ -3272,7 +5022,7 @@ static void DrawObjects(HINSTANCE hInstance, HWND hWnd, int currFrameIndex)
         .pWaitSemaphores = &s_imageAcquiredSemaphores[currFrameIndex],
         .pWaitDstStageMask = pipelineStageFlags,
         .commandBufferCount = 1,
-        .pCommandBuffers = &s_swapchainImageResources[currImageIndex].cmd_buf,
+        .pCommandBuffers = &frameCmdBuf,
         .signalSemaphoreCount = 1,
         .pSignalSemaphores = &s_drawCompleteSemaphores[currFrameIndex]
     };
@@ -3352,74 +5102,455 @@ static void DrawObjects(HINSTANCE hInstance, HWND hWnd, int currFrameIndex)
         present.pNext = &regions;
     }
 
-    res = vkQueuePresentKHR(s_presentQueue, &present);
-    switch (res)
+    res = vkQueuePresentKHR(s_presentQueue, &present);
+    switch (res)
+    {
+    case VK_SUCCESS:
+        break;
+
+    case VK_ERROR_OUT_OF_DATE_KHR:
+        // s_swapchain is out of date (e.g. the window was resized) and must be recreated:
+        DoResize();
+        break;
+
+    case VK_SUBOPTIMAL_KHR:
+        // s_swapchain is not as optimal as it could be, but the platform's presentation engine will still present the image correctly.
+        break;
+
+    case VK_ERROR_SURFACE_LOST_KHR:
+        if (!CreateVulkanSurface(hInstance, hWnd)) return;
+        DoResize();
+        break;
+
+    default:
+        fprintf(stderr, "vkQueuePresentKHR failed: %d\n", res);
+        break;
+    }
+
+    ++s_drawCount;
+}
+
+static void RunTheRendering(HINSTANCE hInstance, HWND hWnd, int currFrameIndex)
+{
+    if (!s_isRenderPrepared) return;
+
+    DrawObjects(hInstance, hWnd, currFrameIndex);
+}
+#endif // _WIN32
+
+// In headless mode there is exactly one offscreen image per frame in flight,
+// so no image needs to be acquired and nothing needs to be presented.
+static bool DrawObjectsOffscreen(uint32_t currFrameIndex, double* pGPUDuration, double* pRecordTime)
+{
+    // Ensure no more than FRAME_LAG renderings are outstanding
+    VkResult res = vkWaitForFences(s_specDevice, 1, &s_presentFences[currFrameIndex], VK_TRUE, UINT64_MAX);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkWaitForFences for offscreen rendering failed: %d\n", res);
+        return false;
+    }
+    vkResetFences(s_specDevice, 1, &s_presentFences[currFrameIndex]);
+
+    *pGPUDuration = FetchFrameQueryResults(currFrameIndex);
+
+    if (!UpdateUniformData(currFrameIndex)) {
+        return false;
+    }
+
+    VkCommandBuffer frameCmdBuf = s_frameCommandBuffers[currFrameIndex];
+    const double recordStartTime = GetCurrentTimeInMilliseconds();
+    if (!RecordCommandsForDraw(frameCmdBuf, currFrameIndex, currFrameIndex)) {
+        return false;
+    }
+    *pRecordTime = GetCurrentTimeInMilliseconds() - recordStartTime;
+
+    const VkSubmitInfo submit_info = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = NULL,
+        .waitSemaphoreCount = 0,
+        .pWaitSemaphores = NULL,
+        .pWaitDstStageMask = NULL,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &frameCmdBuf,
+        .signalSemaphoreCount = 0,
+        .pSignalSemaphores = NULL
+    };
+    res = vkQueueSubmit(s_graphicsQueue, 1, &submit_info, s_presentFences[currFrameIndex]);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkQueueSubmit for offscreen rendering failed: %d\n", res);
+        return false;
+    }
+
+    ++s_drawCount;
+
+    return true;
+}
+
+// Renders `frameCount` frames offscreen and waits for all of them to finish.
+// Returns the elapsed time in milliseconds, or -1 on failure. `pRecordTimeSum` receives the CPU time of recording the command buffers.
+static double RenderHeadlessFrames(uint32_t frameCount, double* pGPUDurationSum, uint32_t* pGPUSampleCount, double* pRecordTimeSum)
+{
+    *pGPUDurationSum = 0.0;
+    *pGPUSampleCount = 0;
+    *pRecordTimeSum = 0.0;
+
+    const double startTime = GetCurrentTimeInMilliseconds();
+    for (uint32_t frame = 0; frame < frameCount; ++frame)
+    {
+        double gpuDuration;
+        double recordTime;
+        if (!DrawObjectsOffscreen(frame % FRAME_LAG, &gpuDuration, &recordTime)) return -1.0;
+
+        *pRecordTimeSum += recordTime;
+
+        if (gpuDuration >= 0.0)
+        {
+            *pGPUDurationSum += gpuDuration;
+            ++*pGPUSampleCount;
+        }
+    }
+    vkDeviceWaitIdle(s_specDevice);
+
+    return GetCurrentTimeInMilliseconds() - startTime;
+}
+
+static bool RunHeadlessRenderLoop(void)
+{
+    double gpuDurationSum = 0.0;
+    uint32_t gpuSampleCount = 0;
+    double recordTimeSum = 0.0;
+    const double elapsedTime = RenderHeadlessFrames(s_headlessFrameCount, &gpuDurationSum, &gpuSampleCount, &recordTimeSum);
+    if (elapsedTime < 0.0) return false;
+
+    const double cpuFrameTime = s_headlessFrameCount > 0 ? elapsedTime / (double)s_headlessFrameCount : 0.0;
+    printf("Headless rendering finished: %u frames in %.3f ms\n", s_headlessFrameCount, elapsedTime);
+    printf("Average CPU frame time: %.4f ms, FPS: %.2f\n", cpuFrameTime, cpuFrameTime > 0.0 ? 1000.0 / cpuFrameTime : 0.0);
+    printf("Average command recording time through %s: %.4f ms\n", s_useDynamicRendering ? "dynamic rendering" : "a render pass",
+        s_headlessFrameCount > 0 ? recordTimeSum / (double)s_headlessFrameCount : 0.0);
+    if (gpuSampleCount > 0) {
+        printf("Average GPU frame time: %.4f ms (%u samples)\n", gpuDurationSum / (double)gpuSampleCount, gpuSampleCount);
+    }
+    printf("Last occlusion sample count: %llu\n", (unsigned long long)s_currOcclusionCount);
+    if (s_cullingPipeline != VK_NULL_HANDLE) {
+        printf("Last GPU culling result: %u visible, %u culled\n", s_currVisibleObjectCount, s_currCulledObjectCount);
+    }
+    if (s_meshletCullingReadbackMemory.mappedData != NULL) {
+        printf("Last meshlet culling result: %u of %u meshlets culled\n", s_currCulledMeshletCount, s_meshletCount * MESH_SHADER_WORK_GROUP_COUNT);
+    }
+    if (s_useDynamicResolution) {
+        PrintDynamicResolutionStatistics(&s_dynamicResolution);
+    }
+    PrintRenderGraphStatistics(&s_frameGraph);
+
+    return true;
+}
+
+// Renders the headless frames at growing instance counts and reports how the frame time scales
+static bool RunInstanceScalingBenchmark(void)
+{
+    static const uint32_t instanceCounts[] = { 1U, 10U, 100U, 1000U, 10000U, MAX_INSTANCE_COUNT };
+
+    printf("Instance scaling benchmark: %u frames per instance count, each of the flatten, gradient and texture pipelines draws all the instances\n",
+        s_headlessFrameCount);
+    printf("  %10s  %12s  %12s  %16s\n", "instances", "CPU ms/frame", "GPU ms/frame", "GPU Minstances/s");
+
+    for (size_t i = 0; i < sizeof(instanceCounts) / sizeof(instanceCounts[0]); ++i)
+    {
+        // The instance data is rewritten, so no frame may be in flight.
+        vkDeviceWaitIdle(s_specDevice);
+        SetInstanceCount(instanceCounts[i]);
+
+        // Warm up frames, which also upload the instance data and make sure that no GPU time of the former instance count is sampled
+        double gpuDurationSum = 0.0;
+        uint32_t gpuSampleCount = 0;
+        double recordTimeSum = 0.0;
+        if (RenderHeadlessFrames(FRAME_LAG, &gpuDurationSum, &gpuSampleCount, &recordTimeSum) < 0.0) return false;
+
+        const double elapsedTime = RenderHeadlessFrames(s_headlessFrameCount, &gpuDurationSum, &gpuSampleCount, &recordTimeSum);
+        if (elapsedTime < 0.0) return false;
+
+        const double cpuFrameTime = s_headlessFrameCount > 0 ? elapsedTime / (double)s_headlessFrameCount : 0.0;
+        const double gpuFrameTime = gpuSampleCount > 0 ? gpuDurationSum / (double)gpuSampleCount : 0.0;
+        const double instancesPerFrame = 3.0 * (double)s_instanceCount;
+        printf("  %10u  %12.4f  %12.4f  %16.2f\n", s_instanceCount, cpuFrameTime, gpuFrameTime,
+            gpuFrameTime > 0.0 ? instancesPerFrame / (gpuFrameTime * 1000.0) : 0.0);
+    }
+
+    return true;
+}
+
+// Resizes the offscreen images `resizeCount` times with FRAME_LAG frames in flight, alternating between the initial size and three quarters
+// or half of it, and reports the latency of recreating the size dependent resources. The initial size is restored afterwards.
+static bool RunResizeBenchmark(uint32_t resizeCount)
+{
+    static const uint32_t scaleQuarters[] = { 3U, 4U, 2U, 4U };
+
+    const uint32_t initialWidth = s_render_width;
+    const uint32_t initialHeight = s_render_height;
+    double resizeTimeSum = 0.0;
+    double waitTimeSum = 0.0;
+    double minResizeTime = 0.0;
+    double maxResizeTime = 0.0;
+
+    for (uint32_t i = 0; i < resizeCount; ++i)
+    {
+        // Keep the former frames in flight like a window resized during the rendering
+        for (uint32_t frame = 0; frame < FRAME_LAG; ++frame)
+        {
+            double gpuDuration;
+            double recordTime;
+            if (!DrawObjectsOffscreen(frame, &gpuDuration, &recordTime)) return false;
+        }
+
+        const uint32_t quarters = scaleQuarters[i % (sizeof(scaleQuarters) / sizeof(scaleQuarters[0]))];
+        s_render_width = max(initialWidth * quarters / 4U, 1U);
+        s_render_height = max(initialHeight * quarters / 4U, 1U);
+
+        const double startTime = GetCurrentTimeInMilliseconds();
+        double waitTime = 0.0;
+        if (!RecreateSizeDependentResources(&waitTime)) return false;
+        const double resizeTime = GetCurrentTimeInMilliseconds() - startTime;
+
+        resizeTimeSum += resizeTime;
+        waitTimeSum += waitTime;
+        minResizeTime = i == 0 ? resizeTime : min(minResizeTime, resizeTime);
+        maxResizeTime = max(maxResizeTime, resizeTime);
+    }
+
+    if (s_render_width != initialWidth || s_render_height != initialHeight)
+    {
+        double waitTime = 0.0;
+        s_render_width = initialWidth;
+        s_render_height = initialHeight;
+        if (!RecreateSizeDependentResources(&waitTime)) return false;
+    }
+
+    if (resizeCount > 0)
+    {
+        printf("Resize benchmark: %u resizes with %u frames in flight, average %.3f ms (%.3f ms waiting for the frames), min %.3f ms, max %.3f ms\n",
+            resizeCount, (uint32_t)FRAME_LAG, resizeTimeSum / resizeCount, waitTimeSum / resizeCount, minResizeTime, maxResizeTime);
+    }
+
+    return true;
+}
+
+// Records and submits `copyCount` copies of the meshlet mesh between two timestamps, drawn by the mesh shader pipeline,
+// or by `referencePipeline` through the vertex pipeline if it is not VK_NULL_HANDLE. Returns the GPU time in milliseconds, or -1 on failure.
+static double MeasureMeshletBenchmarkDraw(VkCommandBuffer cmdBuf, VkFence fence, VkPipeline referencePipeline, uint32_t copyCount)
+{
+    const VkCommandBufferBeginInfo beginInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = NULL,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = NULL
+    };
+    VkResult res = vkBeginCommandBuffer(cmdBuf, &beginInfo);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkBeginCommandBuffer for the meshlet benchmark failed: %d\n", res);
+        return -1.0;
+    }
+
+    // No frame is in flight, so the timestamp queries of the first frame slot are free.
+    vkCmdResetQueryPool(cmdBuf, s_timestampQueryPool, 0, 2);
+    vkCmdWriteTimestamp(cmdBuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, s_timestampQueryPool, 0);
+
+    // This `clearValues` MUST BE coherent with the attachments in renderpass creation.
+    const VkClearValue clearValues[] = {
+        { .color.float32 = { 0.4f, 0.5f, 0.4f, 1.0f } },
+        { .depthStencil = { .depth = 1.0f, .stencil = 0 } }
+    };
+    const RenderTarget renderTarget = GetImageRenderTarget(0);
+    BeginRenderTarget(cmdBuf, &renderTarget, clearValues);
+
+    const VkViewport viewport = {
+        .x = 0.0f,
+        .y = 0.0f,
+        .width = (float)s_render_width,
+        .height = (float)s_render_height,
+        .minDepth = 0.0f,
+        .maxDepth = 1.0f
+    };
+    vkCmdSetViewport(cmdBuf, 0, 1, &viewport);
+
+    const VkRect2D scissor = {
+        .offset = { .x = 0, .y = 0 },
+        .extent = { .width = s_render_width, .height = s_render_height }
+    };
+    vkCmdSetScissor(cmdBuf, 0, 1, &scissor);
+
+    const VkDescriptorSet descriptorSets[] = { s_descriptorSet, s_meshletDescriptorSet };
+    const uint32_t uniformDynamicOffset = 0;
+    vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, s_pipelineLayout, 0, (uint32_t)(sizeof(descriptorSets) / sizeof(descriptorSets[0])),
+                            descriptorSets, 1U, &uniformDynamicOffset);
+
+    if (referencePipeline != VK_NULL_HANDLE)
+    {
+        vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, referencePipeline);
+        PushDrawTransformIndex(cmdBuf, MESH_SHADER_DRAW_TRANSFORM_INDEX);
+        vkCmdBindIndexBuffer(cmdBuf, s_meshletBuffer, s_meshletIndexOffset, VK_INDEX_TYPE_UINT32);
+        vkCmdDrawIndexed(cmdBuf, s_meshletIndexCount, copyCount, 0, 0, 0);
+    }
+    else
+    {
+        vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, s_pipelines[MESH_SHADER_PIPELINE_INDEX]);
+        PushDrawTransformIndex(cmdBuf, MESH_SHADER_DRAW_TRANSFORM_INDEX);
+        dyn_vkCmdDrawMeshTasksEXT(cmdBuf, (s_meshletCount + s_taskWorkGroupSize - 1) / s_taskWorkGroupSize, copyCount, 1U);
+    }
+
+    EndRenderTarget(cmdBuf, &renderTarget);
+
+    vkCmdWriteTimestamp(cmdBuf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, s_timestampQueryPool, 1);
+
+    res = vkEndCommandBuffer(cmdBuf);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkEndCommandBuffer for the meshlet benchmark failed: %d\n", res);
+        return -1.0;
+    }
+
+    const VkSubmitInfo submitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = NULL,
+        .waitSemaphoreCount = 0,
+        .pWaitSemaphores = NULL,
+        .pWaitDstStageMask = NULL,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &cmdBuf,
+        .signalSemaphoreCount = 0,
+        .pSignalSemaphores = NULL
+    };
+    res = vkQueueSubmit(s_graphicsQueue, 1, &submitInfo, fence);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkQueueSubmit for the meshlet benchmark failed: %d\n", res);
+        return -1.0;
+    }
+
+    vkWaitForFences(s_specDevice, 1, &fence, VK_TRUE, UINT64_MAX);
+    vkResetFences(s_specDevice, 1, &fence);
+
+    uint64_t timestamps[2] = { 0 };
+    res = vkGetQueryPoolResults(s_specDevice, s_timestampQueryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(timestamps[0]), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+    if (res != VK_SUCCESS)
     {
-    case VK_SUCCESS:
-        break;
+        fprintf(stderr, "vkGetQueryPoolResults for the meshlet benchmark failed: %d\n", res);
+        return -1.0;
+    }
 
-    case VK_ERROR_OUT_OF_DATE_KHR:
-        // s_swapchain is out of date (e.g. the window was resized) and must be recreated:
-        DoResize();
-        break;
+    return (double)(timestamps[1] - timestamps[0]) * (double)s_gpuTimestampPeriod / 1000000.0;
+}
 
-    case VK_SUBOPTIMAL_KHR:
-        // s_swapchain is not as optimal as it could be, but the platform's presentation engine will still present the image correctly.
-        break;
+// Draws the same copies of the meshlet mesh through the mesh shader pipeline and through the vertex pipeline with the original index buffer,
+// and reports the primitive throughput of both.
+static bool RunMeshletThroughputBenchmark(uint32_t copyCount)
+{
+    if (s_pipelines[MESH_SHADER_PIPELINE_INDEX] == VK_NULL_HANDLE || s_meshletDescriptorSet == VK_NULL_HANDLE)
+    {
+        fprintf(stderr, "The meshlet benchmark needs task and mesh shader support!\n");
+        return false;
+    }
 
-    case VK_ERROR_SURFACE_LOST_KHR:
-        if (!CreateVulkanSurface(hInstance, hWnd)) return;
-        DoResize();
-        break;
+    // Each copy is a row of task work groups. 65535 is the least maxTaskWorkGroupCount in any dimension that devices support.
+    const uint32_t taskGroupCount = (s_meshletCount + s_taskWorkGroupSize - 1) / s_taskWorkGroupSize;
+    copyCount = min(copyCount, min(65535U, s_maxTaskWorkGroupTotalCount / taskGroupCount));
 
-    default:
-        fprintf(stderr, "vkQueuePresentKHR failed: %d\n", res);
-        break;
-    }
+    VkPipeline referencePipeline = VK_NULL_HANDLE;
+    VkCommandBuffer cmdBuf = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE;
+    bool succeeded = false;
 
-    // Fetch the timestamp query result
-    uint64_t timestamps[MAX_SWAPCHAIN_IMAGE_COUNT * 2] = { 0 };
-    res = vkGetQueryPoolResults(s_specDevice, s_timestampQueryPool, 0, 2 * s_swapchainImageCount, 
-                        sizeof(timestamps), timestamps, sizeof(timestamps[0]), VK_QUERY_RESULT_64_BIT);
-    if (res == VK_SUCCESS)
+    do
     {
-        uint64_t sumDuration = 0;
-        for (uint32_t i = 0; i < s_swapchainImageCount; ++i) {
-            sumDuration += timestamps[i * 2 + 1] - timestamps[i * 2];
+        // The copies are drawn at the mesh shader transforms of the first uniform ring slot.
+        vkDeviceWaitIdle(s_specDevice);
+        UpdateUniformData(0);
+
+        const RenderTarget renderTarget = GetImageRenderTarget(0);
+        referencePipeline = CreateMeshletReferenceGraphicsPipeline(s_specDevice, "shaders/meshlet_ref.vert.spv", "shaders/basic_ms.frag.spv",
+                                                                s_pipelineLayout, &renderTarget, s_pipelineCache);
+        if (referencePipeline == VK_NULL_HANDLE) break;
+
+        const VkCommandBufferAllocateInfo cmdBufAllocInfo = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .pNext = NULL,
+            .commandPool = s_commandPool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1
+        };
+        VkResult res = vkAllocateCommandBuffers(s_specDevice, &cmdBufAllocInfo, &cmdBuf);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkAllocateCommandBuffers for the meshlet benchmark failed: %d\n", res);
+            break;
         }
-        s_currGPUDuration = (double)sumDuration * (double)s_gpuTimestampPeriod / 1000'000.0;
-    }
-    else if(res == VK_NOT_READY){
-        puts("vkGetQueryPoolResults: query not ready...");
-    }
 
-    // Fetch the occlusion query result
-    uint64_t occlusions[MAX_SWAPCHAIN_IMAGE_COUNT] = { 0 };
-    res = vkGetQueryPoolResults(s_specDevice, s_occlusionQueryPool, 0, s_swapchainImageCount,
-        sizeof(occlusions), occlusions, sizeof(occlusions[0]), VK_QUERY_RESULT_64_BIT);
-    if (res == VK_SUCCESS)
-    {
-        uint64_t sum = 0;
-        for (uint32_t i = 0; i < s_swapchainImageCount; ++i) {
-            sum += occlusions[i];
+        const VkFenceCreateInfo fenceCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0
+        };
+        res = vkCreateFence(s_specDevice, &fenceCreateInfo, NULL, &fence);
+        if (res != VK_SUCCESS)
+        {
+            fprintf(stderr, "vkCreateFence for the meshlet benchmark failed: %d\n", res);
+            break;
         }
-        s_currOcclusionCount = sum / s_swapchainImageCount;
-    }
 
-    ++s_drawCount;
-}
+        // Alternate the pipelines and keep the best time of each, which filters out clock ramp-up and other noise.
+        const VkPipeline variantPipelines[2] = { VK_NULL_HANDLE, referencePipeline };
+        double bestTimes[2] = { -1.0, -1.0 };
+        bool measured = true;
+        for (uint32_t run = 0; run < MESHLET_BENCHMARK_RUN_COUNT && measured; ++run)
+        {
+            for (uint32_t variant = 0; variant < 2; ++variant)
+            {
+                const double gpuTime = MeasureMeshletBenchmarkDraw(cmdBuf, fence, variantPipelines[variant], copyCount);
+                if (gpuTime < 0.0)
+                {
+                    measured = false;
+                    break;
+                }
+                if (bestTimes[variant] < 0.0 || gpuTime < bestTimes[variant]) {
+                    bestTimes[variant] = gpuTime;
+                }
+            }
+        }
+        if (!measured) break;
 
-static void RunTheRendering(HINSTANCE hInstance, HWND hWnd, int currFrameIndex)
-{
-    if (!s_isRenderPrepared) return;
+        const double triangleCount = (double)(s_meshletIndexCount / 3U) * (double)copyCount;
+        const double meshShaderTime = bestTimes[0];
+        const double vertexPipelineTime = bestTimes[1];
+        printf("Meshlet throughput benchmark: %u copies of %u triangles in %u meshlets per draw, best of %d runs\n", copyCount, s_meshletIndexCount / 3U,
+            s_meshletCount, MESHLET_BENCHMARK_RUN_COUNT);
+        printf("  mesh shader pipeline: %.3f ms, %.1f Mtriangles/s\n", meshShaderTime, meshShaderTime > 0.0 ? triangleCount / (meshShaderTime * 1000.0) : 0.0);
+        printf("  vertex pipeline:      %.3f ms, %.1f Mtriangles/s (%.2fx)\n", vertexPipelineTime,
+            vertexPipelineTime > 0.0 ? triangleCount / (vertexPipelineTime * 1000.0) : 0.0, meshShaderTime > 0.0 ? vertexPipelineTime / meshShaderTime : 0.0);
 
-    DrawObjects(hInstance, hWnd, currFrameIndex);
+        succeeded = true;
+    }
+    while (false);
+
+    if (fence != VK_NULL_HANDLE) {
+        vkDestroyFence(s_specDevice, fence, NULL);
+    }
+    if (cmdBuf != VK_NULL_HANDLE) {
+        vkFreeCommandBuffers(s_specDevice, s_commandPool, 1, &cmdBuf);
+    }
+    if (referencePipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(s_specDevice, referencePipeline, NULL);
+    }
+
+    return succeeded;
 }
 
 static void DestroyVulkanAssets(void)
 {
     vkDeviceWaitIdle(s_specDevice);
 
+    PrintMSAAMemoryCommitment();
+
     // Wait for fences from present operations
     for (int i = 0; i < FRAME_LAG; i++)
     {
@@ -3439,18 +5570,34 @@ static void DestroyVulkanAssets(void)
         }
     }
 
+    DestroyRenderGraph(&s_frameGraph);
+
     if (s_descPool != VK_NULL_HANDLE) {
         vkDestroyDescriptorPool(s_specDevice, s_descPool, NULL);
     }
+    if (s_cullingPipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(s_specDevice, s_cullingPipeline, NULL);
+    }
+    if (s_cullingPipelineLayout != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(s_specDevice, s_cullingPipelineLayout, NULL);
+    }
+    if (s_cullingDescSetLayout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(s_specDevice, s_cullingDescSetLayout, NULL);
+    }
+    if (s_meshletDescSetLayout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(s_specDevice, s_meshletDescSetLayout, NULL);
+    }
     for (size_t i = 0; i < sizeof(s_pipelines) / sizeof(s_pipelines[0]); ++i)
     {
-        if (s_pipelineCaches[i] != VK_NULL_HANDLE) {
-            vkDestroyPipelineCache(s_specDevice, s_pipelineCaches[i], NULL);
-        }
         if (s_pipelines[i] != VK_NULL_HANDLE) {
             vkDestroyPipeline(s_specDevice, s_pipelines[i], NULL);
         }
     }
+    if (s_pipelineCache != VK_NULL_HANDLE)
+    {
+        SavePersistentPipelineCache(s_currPhysicalDevice, s_specDevice, s_pipelineCache, s_pipelineCacheFilePath);
+        vkDestroyPipelineCache(s_specDevice, s_pipelineCache, NULL);
+    }
     if (s_render_pass != VK_NULL_HANDLE) {
         vkDestroyRenderPass(s_specDevice, s_render_pass, NULL);
     }
@@ -3461,57 +5608,63 @@ static void DestroyVulkanAssets(void)
         vkDestroyDescriptorSetLayout(s_specDevice, s_descSetLayout, NULL);
     }
 
-    for (uint32_t i = 0; i < s_swapchainImageCount; ++i)
+    DestroySizeDependentResources();
+    for (uint32_t i = 0; i < FRAME_LAG; ++i)
     {
-        if (s_swapchainImageResources[i].framebuffer != VK_NULL_HANDLE) {
-            vkDestroyFramebuffer(s_specDevice, s_swapchainImageResources[i].framebuffer, NULL);
-        }
-        if (s_swapchainImageResources[i].view != VK_NULL_HANDLE) {
-            vkDestroyImageView(s_specDevice, s_swapchainImageResources[i].view, NULL);
+        if (s_frameCommandBuffers[i] != VK_NULL_HANDLE) {
+            vkFreeCommandBuffers(s_specDevice, s_commandPool, 1, &s_frameCommandBuffers[i]);
         }
-        if (s_swapchainImageResources[i].msaaImage != VK_NULL_HANDLE) {
-            vkDestroyImage(s_specDevice, s_swapchainImageResources[i].msaaImage, NULL);
-        }
-        if (s_swapchainImageResources[i].msaaView != VK_NULL_HANDLE) {
-            vkDestroyImageView(s_specDevice, s_swapchainImageResources[i].msaaView, NULL);
-        }
-        if (s_swapchainImageResources[i].cmd_buf != VK_NULL_HANDLE) {
-            vkFreeCommandBuffers(s_specDevice, s_commandPool, 1, &s_swapchainImageResources[i].cmd_buf);
-        }
-    }
-    if (s_msaaColorImageMemory != VK_NULL_HANDLE) {
-        vkFreeMemory(s_specDevice, s_msaaColorImageMemory, NULL);
     }
     if (s_uniformBuffer != VK_NULL_HANDLE) {
         vkDestroyBuffer(s_specDevice, s_uniformBuffer, NULL);
     }
-    if (s_uniformMemory != VK_NULL_HANDLE) {
-        vkFreeMemory(s_specDevice, s_uniformMemory, NULL);
+    FreeDeviceMemory(&s_uniformMemory);
+    s_uniformRingData = NULL;
+    if (s_vertexBuffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(s_specDevice, s_vertexBuffer, NULL);
     }
-    if (s_vertexCoordsBuffer != VK_NULL_HANDLE) {
-        vkDestroyBuffer(s_specDevice, s_vertexCoordsBuffer, NULL);
+    if (s_indexBuffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(s_specDevice, s_indexBuffer, NULL);
     }
-    if (s_textureCoordsBuffer != VK_NULL_HANDLE) {
-        vkDestroyBuffer(s_specDevice, s_textureCoordsBuffer, NULL);
+    FreeDeviceMemory(&s_vertexMemory);
+    FreeQuantizedVertexAttributes(&s_quadVertexAttributes);
+    if (s_instanceBuffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(s_specDevice, s_instanceBuffer, NULL);
     }
-    if (s_colorBuffer != VK_NULL_HANDLE) {
-        vkDestroyBuffer(s_specDevice, s_colorBuffer, NULL);
+    FreeDeviceMemory(&s_instanceMemory);
+    if (s_hostInstanceBuffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(s_specDevice, s_hostInstanceBuffer, NULL);
     }
-    if (s_vertexMemory != VK_NULL_HANDLE) {
-        vkFreeMemory(s_specDevice, s_vertexMemory, NULL);
+    FreeDeviceMemory(&s_hostInstanceMemory);
+    if (s_indirectDrawBuffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(s_specDevice, s_indirectDrawBuffer, NULL);
     }
-    if (s_hostVertexAndUniformBuffer != VK_NULL_HANDLE) {
-        vkDestroyBuffer(s_specDevice, s_hostVertexAndUniformBuffer, NULL);
+    FreeDeviceMemory(&s_indirectDrawMemory);
+    if (s_cullingCounterBuffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(s_specDevice, s_cullingCounterBuffer, NULL);
     }
-    if (s_hostVertexUniformMemory != VK_NULL_HANDLE) {
-        vkFreeMemory(s_specDevice, s_hostVertexUniformMemory, NULL);
+    FreeDeviceMemory(&s_cullingCounterMemory);
+    if (s_cullingReadbackBuffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(s_specDevice, s_cullingReadbackBuffer, NULL);
     }
+    FreeDeviceMemory(&s_cullingReadbackMemory);
+    if (s_meshletBuffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(s_specDevice, s_meshletBuffer, NULL);
+    }
+    FreeDeviceMemory(&s_meshletMemory);
+    if (s_meshletCullingCounterBuffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(s_specDevice, s_meshletCullingCounterBuffer, NULL);
+    }
+    FreeDeviceMemory(&s_meshletCullingCounterMemory);
+    if (s_meshletCullingReadbackBuffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(s_specDevice, s_meshletCullingReadbackBuffer, NULL);
+    }
+    FreeDeviceMemory(&s_meshletCullingReadbackMemory);
     if (s_hostUploadTextureBuffer != VK_NULL_HANDLE) {
         vkDestroyBuffer(s_specDevice, s_hostUploadTextureBuffer, NULL);
     }
-    if (s_hostUploadTextureMemory != VK_NULL_HANDLE) {
-        vkFreeMemory(s_specDevice, s_hostUploadTextureMemory, NULL);
-    }
+    FreeDeviceMemory(&s_hostUploadTextureMemory);
+    DestroyMipmapComputeResources(s_specDevice, &s_mipmapComputeResources);
     if (s_textureImageView != VK_NULL_HANDLE) {
         vkDestroyImageView(s_specDevice, s_textureImageView, NULL);
     }
@@ -3521,27 +5674,8 @@ static void DestroyVulkanAssets(void)
     if (s_textureSampler != VK_NULL_HANDLE) {
         vkDestroySampler(s_specDevice, s_textureSampler, NULL);
     }
-    if (s_textureMemory != VK_NULL_HANDLE) {
-        vkFreeMemory(s_specDevice, s_textureMemory, NULL);
-    }
-    if (s_depthResource.image_view != VK_NULL_HANDLE) {
-        vkDestroyImageView(s_specDevice, s_depthResource.image_view, NULL);
-    }
-    if (s_depthResource.image != VK_NULL_HANDLE) {
-        vkDestroyImage(s_specDevice, s_depthResource.image, NULL);
-    }
-    if (s_depthResource.msaaView != VK_NULL_HANDLE) {
-        vkDestroyImageView(s_specDevice, s_depthResource.msaaView, NULL);
-    }
-    if (s_depthResource.msaaImage != VK_NULL_HANDLE) {
-        vkDestroyImage(s_specDevice, s_depthResource.msaaImage, NULL);
-    }
-    if (s_depthResource.device_memory != VK_NULL_HANDLE) {
-        vkFreeMemory(s_specDevice, s_depthResource.device_memory, NULL);
-    }
-    if (s_depthResource.msaaDeviceMemory != VK_NULL_HANDLE) {
-        vkFreeMemory(s_specDevice, s_depthResource.msaaDeviceMemory, NULL);
-    }
+    FreeDeviceMemory(&s_textureMemory);
+    DestroyUploadManager(&s_uploadManager);
     if (s_timestampQueryPool != VK_NULL_HANDLE) {
         vkDestroyQueryPool(s_specDevice, s_timestampQueryPool, NULL);
     }
@@ -3568,7 +5702,9 @@ static void DestroyVulkanAssets(void)
     if (s_swapchain != VK_NULL_HANDLE) {
         vkDestroySwapchainKHR(s_specDevice, s_swapchain, NULL);
     }
-    if (s_specDevice != VK_NULL_HANDLE) {
+    if (s_specDevice != VK_NULL_HANDLE)
+    {
+        DestroyDeviceMemoryAllocator();
         vkDestroyDevice(s_specDevice, NULL);
     }
     if (s_surface != VK_NULL_HANDLE) {
@@ -3579,9 +5715,208 @@ static void DestroyVulkanAssets(void)
     }
 }
 
+static const char s_appName[] = "Vulkan Advanced";
+
+static void PrintUsage(const char* programName)
+{
+    printf("Usage: %s [options]\n", programName);
+    puts("  --headless                    Render into offscreen images without creating any window or swapchain");
+    puts("  --frames <N>                  Number of frames to render in headless mode (default: 1000)");
+    puts("  --device <N>                  Index of the physical device to use");
+    puts("  --pipeline-cache <path>       Pipeline cache file to load at startup and save at exit (default: pipeline_cache.bin)");
+    puts("  --discard-pipeline-cache      Ignore the existing pipeline cache file to measure a cold start");
+    puts("  --pipeline-threads <N>        Number of threads creating the pipelines, 1 creates them one after another (default: 0, one per logical processor)");
+    puts("  --alloc-churn <N>             Run N random allocate/free operations through the device memory sub-allocator and through vkAllocateMemory at startup");
+    puts("  --self-test                   Run the deterministic checks of the device memory allocator and the render graph, then exit with 1 if any of them has failed");
+    puts("  --vertex-benchmark <N>        Compare the GPU time of N vertices transformed by per-vertex matrices and by a CPU-built MVP, implies --headless");
+    puts("  --instances <N>               Number of instances drawn by each of the flatten, gradient and texture pipelines, 1 to 100000 (default: 1)");
+    puts("  --instance-scaling            Report the frame time at instance counts from 1 up to the maximum instead of the render loop, implies --headless");
+    puts("  --msaa <N>                    Render with N samples per pixel, lowered to the highest count the device supports (default: 1, no MSAA)");
+    puts("  --dynamic-rendering           Render with vkCmdBeginRendering instead of a render pass and framebuffers when the device supports it");
+    puts("  --gpu-budget <ms>             Scale the render size every frame to keep the GPU frame time within the budget, and upscale to the output size (default: 0, full size)");
+    puts("  --min-render-scale <percent>  Lowest render size that --gpu-budget may scale down to, 10 to 100 (default: 50)");
+    puts("  --gpu-culling                 Frustum cull the instances in a compute pass and draw the visible ones with vkCmdDrawIndexedIndirectCount");
+    puts("  --no-transfer-queue           Upload through the graphics queue even when the device has a dedicated transfer queue family");
+    puts("  --no-host-image-copy          Upload the textures through the staging ring even when the device supports VK_EXT_host_image_copy");
+    puts("  --texture-upload-benchmark <N>  Compare N texture uploads through a staging buffer and through host image copies, implies --headless");
+    puts("  --resize-benchmark <N>        Resize the offscreen images N times with frames in flight and report the resize latency, implies --headless");
+    puts("  --meshlet-benchmark <N>       Compare the GPU time of N copies of the meshlet mesh drawn by the mesh shader and by the vertex pipeline, implies --headless");
+    puts("  --index-benchmark <N>         Compare the GPU time of N copies of a sphere drawn with generated, shuffled and vertex cache optimized indices, implies --headless");
+    puts("  --vertex-layout <layout>      Vertex stream layout of the quad: separate, interleaved or position-split (default: separate)");
+    puts("  --vertex-layout-benchmark <N> Compare the GPU time of fetching N vertices from each vertex stream layout, implies --headless");
+    puts("  --vertex-compression <mode>   Quantize the vertex attributes: none, half or snorm16 positions with unorm8 colors and unorm16 texture coordinates (default: none)");
+    puts("  --texture <path>              BMP, TGA, PPM or KTX2 image sampled by the texture pipeline, repeat for up to 8 layers of the same size (default: images/geom.bmp)");
+    puts("  --mipmaps <mode>              How a texture without precomputed levels gets its mip chain: auto, blit, compute or none (default: auto)");
+    puts("  --encode-texture <src> <dst> <format>  Encode an image with its mip chain into a KTX2 file of bc1, bc1-srgb, bc7 or bc7-srgb blocks and exit");
+}
+
+static bool ParseCommandLineArguments(int argc, const char* const argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--headless") == 0) {
+            s_isHeadless = true;
+        }
+        else if (strcmp(arg, "--frames") == 0 && i + 1 < argc) {
+            s_headlessFrameCount = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(arg, "--device") == 0 && i + 1 < argc) {
+            s_userDeviceIndex = atoi(argv[++i]);
+        }
+        else if (strcmp(arg, "--pipeline-cache") == 0 && i + 1 < argc) {
+            s_pipelineCacheFilePath = argv[++i];
+        }
+        else if (strcmp(arg, "--discard-pipeline-cache") == 0) {
+            s_discardPipelineCacheFile = true;
+        }
+        else if (strcmp(arg, "--pipeline-threads") == 0 && i + 1 < argc) {
+            s_pipelineThreadCount = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(arg, "--alloc-churn") == 0 && i + 1 < argc) {
+            s_allocChurnIterationCount = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(arg, "--self-test") == 0) {
+            s_runSelfTest = true;
+        }
+        else if (strcmp(arg, "--vertex-benchmark") == 0 && i + 1 < argc)
+        {
+            // The benchmark renders into an offscreen image, which cannot be done with an image of the swapchain that is not acquired.
+            s_vertexBenchmarkVertexCount = (uint32_t)strtoul(argv[++i], NULL, 10);
+            s_isHeadless = true;
+        }
+        else if (strcmp(arg, "--instances") == 0 && i + 1 < argc)
+        {
+            const unsigned long count = strtoul(argv[++i], NULL, 10);
+            s_instanceCount = (uint32_t)max(min(count, (unsigned long)MAX_INSTANCE_COUNT), 1UL);
+        }
+        else if (strcmp(arg, "--instance-scaling") == 0)
+        {
+            s_runInstanceScalingBenchmark = true;
+            s_isHeadless = true;
+        }
+        else if (strcmp(arg, "--msaa") == 0 && i + 1 < argc) {
+            s_requestedMSAASampleCount = max((uint32_t)strtoul(argv[++i], NULL, 10), 1U);
+        }
+        else if (strcmp(arg, "--gpu-culling") == 0) {
+            s_useGPUCulling = true;
+        }
+        else if (strcmp(arg, "--dynamic-rendering") == 0) {
+            s_useDynamicRendering = true;
+        }
+        else if (strcmp(arg, "--gpu-budget") == 0 && i + 1 < argc)
+        {
+            // A budget is usually a fraction of a frame interval, e.g. 8.3 ms for 120 Hz, so it is not an integer
+            s_gpuTimeBudget = max(strtod(argv[++i], NULL), 0.0);
+            s_useDynamicResolution = s_gpuTimeBudget > 0.0;
+        }
+        else if (strcmp(arg, "--min-render-scale") == 0 && i + 1 < argc)
+        {
+            const unsigned long percent = strtoul(argv[++i], NULL, 10);
+            s_minRenderScalePercent = (uint32_t)max(min(percent, 100UL), 10UL);
+        }
+        else if (strcmp(arg, "--no-transfer-queue") == 0) {
+            s_useTransferQueue = false;
+        }
+        else if (strcmp(arg, "--no-host-image-copy") == 0) {
+            s_useHostImageCopy = false;
+        }
+        else if (strcmp(arg, "--texture-upload-benchmark") == 0 && i + 1 < argc)
+        {
+            s_textureUploadBenchmarkIterationCount = (uint32_t)strtoul(argv[++i], NULL, 10);
+            s_isHeadless = true;
+        }
+        else if (strcmp(arg, "--resize-benchmark") == 0 && i + 1 < argc)
+        {
+            s_resizeBenchmarkCount = (uint32_t)strtoul(argv[++i], NULL, 10);
+            s_isHeadless = true;
+        }
+        else if (strcmp(arg, "--meshlet-benchmark") == 0 && i + 1 < argc)
+        {
+            s_meshletBenchmarkCopyCount = (uint32_t)strtoul(argv[++i], NULL, 10);
+            s_isHeadless = true;
+        }
+        else if (strcmp(arg, "--index-benchmark") == 0 && i + 1 < argc)
+        {
+            s_indexBenchmarkCopyCount = (uint32_t)strtoul(argv[++i], NULL, 10);
+            s_isHeadless = true;
+        }
+        else if (strcmp(arg, "--vertex-layout") == 0 && i + 1 < argc)
+        {
+            if (!ParseVertexStreamLayout(argv[++i], &s_vertexStreamLayout))
+            {
+                fprintf(stderr, "Unknown vertex layout: %s\n", argv[i]);
+                PrintUsage(argv[0]);
+                return false;
+            }
+        }
+        else if (strcmp(arg, "--vertex-compression") == 0 && i + 1 < argc)
+        {
+            if (!ParseVertexCompression(argv[++i], &s_vertexCompression))
+            {
+                fprintf(stderr, "Unknown vertex compression: %s\n", argv[i]);
+                PrintUsage(argv[0]);
+                return false;
+            }
+        }
+        else if (strcmp(arg, "--texture") == 0 && i + 1 < argc)
+        {
+            if (s_textureFileCount == MAX_TEXTURE_FILE_COUNT)
+            {
+                fprintf(stderr, "Too many textures, at most %d can be loaded!\n", MAX_TEXTURE_FILE_COUNT);
+                return false;
+            }
+            s_texturePaths[s_textureFileCount++] = argv[++i];
+        }
+        else if (strcmp(arg, "--mipmaps") == 0 && i + 1 < argc)
+        {
+            if (!ParseMipmapGeneration(argv[++i], &s_mipmapGeneration))
+            {
+                fprintf(stderr, "Unknown mipmap generation: %s\n", argv[i]);
+                PrintUsage(argv[0]);
+                return false;
+            }
+        }
+        else if (strcmp(arg, "--encode-texture") == 0 && i + 3 < argc)
+        {
+            s_encodeTextureSrcPath = argv[++i];
+            s_encodeTextureDstPath = argv[++i];
+            if (!ParseTextureEncodingFormat(argv[++i], &s_encodeTextureFormat))
+            {
+                fprintf(stderr, "Unknown texture encoding: %s\n", argv[i]);
+                PrintUsage(argv[0]);
+                return false;
+            }
+        }
+        else if (strcmp(arg, "--vertex-layout-benchmark") == 0 && i + 1 < argc)
+        {
+            s_vertexLayoutBenchmarkVertexCount = (uint32_t)strtoul(argv[++i], NULL, 10);
+            s_isHeadless = true;
+        }
+        else if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0)
+        {
+            PrintUsage(argv[0]);
+            return false;
+        }
+        else
+        {
+            fprintf(stderr, "Unknown or incomplete argument: %s\n", arg);
+            PrintUsage(argv[0]);
+            return false;
+        }
+    }
+
+#ifndef _WIN32
+    // Presentation is only implemented for Win32, so other platforms always render offscreen.
+    s_isHeadless = true;
+#endif
+
+    return true;
+}
+
+#ifdef _WIN32
 static int s_currFrameIndex = 0;
 static POINT s_wndMinsize;                // minimum window size
-static const char s_appName[] = "Vulkan Advanced";
 
 static LRESULT CALLBACK WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
@@ -3593,11 +5928,13 @@ static LRESULT CALLBACK WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lPar
         GetWindowRect(hWnd, &windowRect);
         SetWindowLongA(hWnd, GWL_STYLE, GetWindowLongA(hWnd, GWL_STYLE) & ~WS_MINIMIZEBOX);
         SetWindowLongA(hWnd, GWL_STYLE, GetWindowLongA(hWnd, GWL_STYLE) & ~WS_MAXIMIZEBOX);
-        SetWindowLongA(hWnd, GWL_STYLE, GetWindowLongA(hWnd, GWL_STYLE) & ~WS_SIZEBOX);
         break;
     }
 
     case WM_CLOSE:
+        if (s_useDynamicResolution) {
+            PrintDynamicResolutionStatistics(&s_dynamicResolution);
+        }
         DestroyVulkanAssets();
         PostQuitMessage(0);
         break;
@@ -3609,8 +5946,19 @@ static LRESULT CALLBACK WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lPar
         }
         if (s_drawCount % 60 == 0)
         {
-            char buffer[64];
-            sprintf_s(buffer, sizeof(buffer), "%s -- GPU: %.2f ms | occlusions: %u", s_appName, s_currGPUDuration, (uint32_t)s_currOcclusionCount);
+            char buffer[192];
+            int length = sprintf_s(buffer, sizeof(buffer), "%s -- GPU: %.2f ms | occlusions: %u", s_appName, s_currGPUDuration, (uint32_t)s_currOcclusionCount);
+            if (s_useDynamicResolution) {
+                length += sprintf_s(buffer + length, sizeof(buffer) - length, " | render scale: %.0f%%", 100.0f * s_dynamicResolution.scale);
+            }
+            if (s_cullingPipeline != VK_NULL_HANDLE)
+            {
+                length += sprintf_s(buffer + length, sizeof(buffer) - length, " | visible: %u | culled: %u",
+                                    s_currVisibleObjectCount, s_currCulledObjectCount);
+            }
+            if (s_meshletCullingReadbackMemory.mappedData != NULL) {
+                sprintf_s(buffer + length, sizeof(buffer) - length, " | culled meshlets: %u", s_currCulledMeshletCount);
+            }
             SetWindowTextA(hWnd, buffer);
         }
         break;
@@ -3712,22 +6060,61 @@ static HWND CreateAndInitializeWindow(HINSTANCE hInstance, LPCSTR appName, int w
 
     return hWnd;
 }
+#endif // _WIN32
 
 int main(int argc, const char* const argv[])
 {
-    if (!InitializeVulkanInstance(s_appName, "ZennyEngine")) {
+    if (!ParseCommandLineArguments(argc, argv)) {
         return 0;
     }
+    InitializeDynamicResolution(&s_dynamicResolution, s_gpuTimeBudget, (float)s_minRenderScalePercent / 100.0f);
+
+    // The encoder runs on the CPU only, so it needs neither the instance nor the device
+    if (s_encodeTextureSrcPath != NULL)
+    {
+        return EncodeTextureFile(s_encodeTextureSrcPath, s_encodeTextureDstPath, s_encodeTextureFormat, s_pipelineThreadCount) ? 0 : 1;
+    }
+
+    if (!InitializeVulkanInstance(s_appName, "ZennyEngine")) {
+        return 1;
+    }
 
     if (!InitializeVulkanDevice(VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT)) {
-        return 0;
+        return 1;
+    }
+
+    if (!InitializeDeviceMemoryAllocator(s_currPhysicalDevice, s_specDevice)) {
+        return 1;
+    }
+
+    // The checks expect the allocator to be untouched, so they run before anything is created
+    if (s_runSelfTest)
+    {
+        bool succeeded = RunDeviceMemoryAllocatorSelfTest();
+        succeeded &= RunRenderGraphSelfTest(s_specDevice);
+        DestroyVulkanAssets();
+        return succeeded ? 0 : 1;
+    }
+
+    // A failed benchmark or headless run makes the exit code 1, but the ones after it still run
+    bool succeeded = true;
+    if (s_allocChurnIterationCount > 0) {
+        succeeded &= RunDeviceMemoryChurnBenchmark(s_allocChurnIterationCount);
     }
 
+#ifdef _WIN32
     // Windows Instance
-    HINSTANCE wndInstance = GetModuleHandleA(NULL);
+    HINSTANCE wndInstance = NULL;
 
     // window handle
-    HWND wndHandle = CreateAndInitializeWindow(wndInstance, s_appName, WINDOW_WIDTH, WINDOW_HEIGHT);
+    HWND wndHandle = NULL;
+
+    if (!s_isHeadless)
+    {
+        wndInstance = GetModuleHandleA(NULL);
+        wndHandle = CreateAndInitializeWindow(wndInstance, s_appName, WINDOW_WIDTH, WINDOW_HEIGHT);
+    }
+#endif // _WIN32
 
     s_render_width = WINDOW_WIDTH;
     s_render_height = WINDOW_HEIGHT;
@@ -3737,54 +6124,112 @@ int main(int argc, const char* const argv[])
 
     do
     {
-        if (!CreateVulkanSurface(wndInstance, wndHandle)) break;
-        if (!CreateVulkanSwapchain()) break;
+        if (s_isHeadless)
+        {
+            SelectOffscreenQueueAndFormat();
+            if (!CreateOffscreenRenderTargets()) break;
+        }
+        else
+        {
+#ifdef _WIN32
+            if (!CreateVulkanSurface(wndInstance, wndHandle)) break;
+            if (!SelectSwapchainQueuesAndFormat()) break;
+            if (!CreateVulkanSwapchain()) break;
+#endif // _WIN32
+        }
         if (!CreateFencesAndSemaphores()) break;
         if (!CreateCommandBufferAndBeginCommand()) break;
+        if (!CreateUploadManager(s_specDevice, s_graphicsQueueFamilyIndex, s_transferQueueFamilyIndex,
+                                s_supportTimelineSemaphore ? VK_NULL_HANDLE : s_commandBuffers[0], &s_uploadManager)) {
+            break;
+        }
         if (!CreateQueryPools()) break;
         if (!CreateVertexAndUniformBuffersAndMemories()) break;
-        CopyFromHostToDeviceBuffersAndSync();
+        if (!CopyFromHostToDeviceBuffersAndSync()) break;
+        if (!CreateInstanceBuffer()) break;
         if (!CreateDepthReource()) break;
+        PrintMSAAMemoryReport();
         if (!CreateDescriptorSetAndPipelineLayout()) break;
-        if (!CreateRenderPass()) break;
-        
-        const char* vsSPV = s_supportFragmentShadingRate ? "shaders/fsr.vert.spv" : "shaders/flatten.vert.spv";
-        const char* fsSPV = s_supportFragmentShadingRate ? "shaders/fsr.frag.spv" : "shaders/flatten.frag.spv";
-        if (!CreateGraphicsPipeline(vsSPV, fsSPV, FLATTEN_PIPELINE_INDEX)) break;
-        if (!CreateGraphicsPipeline("shaders/gradient.vert.spv", "shaders/gradient.frag.spv", GRAIENT_PIPELINE_INDEX)) break;
-        s_pipelines[GEOMETRY_SHADER_PIPELINE_INDEX] = CreateGeometryShaderGraphicsPipeline(s_specDevice, "shaders/geomtest.vert.spv", "shaders/geomtest.frag.spv", "shaders/geomtest.geom.spv",
-            s_pipelineLayout, s_render_pass, &s_pipelineCaches[GEOMETRY_SHADER_PIPELINE_INDEX]);
-        if (s_pipelines[GEOMETRY_SHADER_PIPELINE_INDEX] == VK_NULL_HANDLE) break;
-        if (!CreateTexturePipelineAssets(s_currPhysicalDevice, s_specDevice, s_graphicsQueueFamilyIndex, s_commandBuffers[0], "shaders/texture.vert.spv", "shaders/texture.frag.spv",
-            s_pipelineLayout, s_render_pass, &s_textureImage, &s_textureImageView, &s_textureSampler, &s_hostUploadTextureBuffer, &s_hostUploadTextureMemory, &s_textureMemory,
-            &s_pipelineCaches[TEXTURE_PIPELINE_INDEX], &s_pipelines[TEXTURE_PIPELINE_INDEX])) {
+        if (!s_useDynamicRendering && !CreateRenderPass()) break;
+
+        s_pipelineCache = CreatePersistentPipelineCache(s_currPhysicalDevice, s_specDevice, s_discardPipelineCacheFile ? NULL : s_pipelineCacheFilePath,
+                                                        s_supportPipelineCreationFeedback);
+        if (s_pipelineCache == VK_NULL_HANDLE) break;
+
+        if (!CreateTextureAssets(s_currPhysicalDevice, s_specDevice, s_graphicsQueueFamilyIndex, s_commandBuffers[0], &s_uploadManager,
+                                s_hostImageCopy.copyMemoryToImage != NULL ? &s_hostImageCopy : NULL, s_texturePaths, s_textureFileCount,
+            s_mipmapGeneration, s_pipelineCache, &s_mipmapComputeResources, &s_textureImage, &s_textureImageView, &s_textureSampler, &s_hostUploadTextureBuffer, &s_hostUploadTextureMemory, &s_textureMemory)) {
             break;
         }
-        if (dyn_vkCmdDrawMeshTasksEXT != NULL)
-        {
-            s_pipelines[MESH_SHADER_PIPELINE_INDEX] = CreateMeshShaderGraphicsPipeline(s_specDevice, "shaders/basic_ms.task.spv", "shaders/basic_ms.mesh.spv", "shaders/basic_ms.frag.spv",
-                                                                                    s_pipelineLayout, s_render_pass, &s_pipelineCaches[MESH_SHADER_PIPELINE_INDEX]);
-            if (s_pipelines[MESH_SHADER_PIPELINE_INDEX] == VK_NULL_HANDLE) break;
-        }
+        if (!CreateAllGraphicsPipelines()) break;
+
         if (!CreateDescriptorPoolAndSet()) break;
-        if (!CreateFramebuffers()) break;
-        
-        for (uint32_t i = 0; i < s_swapchainImageCount; ++i)
-        {
-            if (!RecordCommandsForDraw(s_swapchainImageResources[i].cmd_buf, i)) {
-                break;
-            }
-        }
+        if (!CreateGPUCullingResources()) break;
+        if (!CreateMeshletResources()) break;
+        if (!CreateFrameGraph()) break;
+        if (!s_useDynamicRendering && !CreateFramebuffers()) break;
+        printf("Rendering through %s: %u render pass and %u framebuffer objects created\n", s_useDynamicRendering ? "dynamic rendering" : "a render pass",
+            s_render_pass != VK_NULL_HANDLE ? 1U : 0U, s_useDynamicRendering ? 0U : s_swapchainImageCount);
 
         s_isRenderPrepared = true;
 
         // Prepare functions above may generate pipeline commands that need to be flushed before beginning the render loop.
         if (!FlushInitCommand()) break;
 
+        PrintDeviceMemoryStatistics();
+
         done = false;
     }
     while (false);
+    succeeded &= !done;
+
+    if (s_isHeadless)
+    {
+        if (!done && s_vertexBenchmarkVertexCount > 0)
+        {
+            const RenderTarget renderTarget = GetImageRenderTarget(0);
+            succeeded &= RunVertexThroughputBenchmark(s_specDevice, s_graphicsQueue, s_commandPool, &renderTarget, s_pipelineCache,
+                                                    s_gpuTimestampPeriod, s_vertexBenchmarkVertexCount);
+        }
+        if (!done && s_indexBenchmarkCopyCount > 0)
+        {
+            const RenderTarget renderTarget = GetImageRenderTarget(0);
+            succeeded &= RunIndexOrderBenchmark(s_specDevice, s_graphicsQueue, s_commandPool, &renderTarget, s_pipelineCache,
+                                                s_gpuTimestampPeriod, s_indexBenchmarkCopyCount);
+        }
+        if (!done && s_vertexLayoutBenchmarkVertexCount > 0)
+        {
+            const RenderTarget renderTarget = GetImageRenderTarget(0);
+            succeeded &= RunVertexLayoutBenchmark(s_specDevice, s_graphicsQueue, s_commandPool, &renderTarget, s_pipelineCache,
+                                                s_gpuTimestampPeriod, s_vertexLayoutBenchmarkVertexCount, s_vertexCompression);
+        }
+        if (!done && s_meshletBenchmarkCopyCount > 0) {
+            succeeded &= RunMeshletThroughputBenchmark(s_meshletBenchmarkCopyCount);
+        }
+        if (!done && s_textureUploadBenchmarkIterationCount > 0)
+        {
+            succeeded &= RunTextureUploadBenchmark(s_currPhysicalDevice, s_specDevice, s_graphicsQueue, s_commandPool,
+                                                s_hostImageCopy.copyMemoryToImage != NULL ? &s_hostImageCopy : NULL, s_textureUploadBenchmarkIterationCount);
+        }
+        if (!done && s_resizeBenchmarkCount > 0 && !RunResizeBenchmark(s_resizeBenchmarkCount))
+        {
+            done = true;
+            succeeded = false;
+        }
+        if (!done)
+        {
+            if (s_runInstanceScalingBenchmark) {
+                succeeded &= RunInstanceScalingBenchmark();
+            }
+            else {
+                succeeded &= RunHeadlessRenderLoop();
+            }
+        }
+        DestroyVulkanAssets();
+        return succeeded ? 0 : 1;
+    }
 
+#ifdef _WIN32
     // main message loop
     MSG msg;
     while (!done)
@@ -3808,6 +6253,9 @@ int main(int argc, const char* const argv[])
         DestroyWindow(wndHandle);
         wndHandle = NULL;
     }
+#endif // _WIN32
+
+    return succeeded ? 0 : 1;
 }
 
 // 运行程序: Ctrl + F5 或调试 >“开始执行(不调试)”菜单
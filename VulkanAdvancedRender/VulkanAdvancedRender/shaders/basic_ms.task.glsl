@@ -1,32 +1,103 @@
-
 #version 450 core
 
-#extension GL_EXT_scalar_block_layout : enable
 #extension GL_EXT_mesh_shader : enable
 
-layout(local_size_x_id = 0) in;
-layout(constant_id = 1) const uint payload_data_count = 1U;
+// One invocation tests one meshlet. The size is derived from the preferred task work group invocations and the payload size limit in main.c.
+layout(local_size_x_id = 1) in;
+
+// The same value as the work group size, which cannot size an array by itself
+layout(constant_id = 2) const uint meshlets_per_task = 32U;
+
+// This MUST BE coherent with `MeshletTaskPayload` in basic_ms.mesh.glsl
+struct MeshletTaskPayload
+{
+    uint transformIndex;
+    uint meshletIndices[meshlets_per_task];     // the meshlets that survive the culling, one mesh work group each
+};
+
+taskPayloadSharedEXT MeshletTaskPayload sharedPayload;
+
+// The model-view-projection matrices of all the draws in a frame are built on the CPU.
+// The array length MUST BE coherent with TOTAL_DRAW_TRANSFORM_COUNT in main.c.
+layout(std140, set = 0, binding = 0) uniform transform_block {
+    mat4 u_mvp[8];
+} trans_consts;
 
-struct MyPayloadType
+// See MeshletBounds in common.h
+struct MeshletBounds
 {
-    int data[payload_data_count];
-    uint meshID;
-    uint meshGroupSize;
+    vec3 center;
+    float radius;
+    vec3 coneAxis;
+    float coneCutoff;
 };
 
-taskPayloadSharedEXT MyPayloadType sharedPayload;
+layout(std430, set = 1, binding = 4) readonly buffer bounds_block {
+    MeshletBounds u_bounds[];
+} meshlet_bounds;
+
+// Cleared at the beginning of every frame and read back by the host
+layout(std430, set = 1, binding = 5) buffer culling_counter_block {
+    uint u_culledMeshletCount;
+} culling_counter;
+
+// The work group rows draw the copies of the mesh, each copy uses the next matrix after u_drawIndex, wrapping every 4 rows.
+// This MUST BE coherent with DrawPushConstants and MESH_SHADER_WORK_GROUP_COUNT in main.c
+layout(push_constant) uniform draw_block {
+    uint u_drawIndex;
+    uint u_meshletCount;
+} draw_consts;
+
+shared uint s_survivorCount;
+
+bool IsMeshletVisible(mat4 mvp, MeshletBounds bounds)
+{
+    // The frustum planes in model space are combinations of the matrix rows,
+    // for the clip volume -w <= x <= w, -w <= y <= w, 0 <= z <= w.
+    const vec4 rowX = vec4(mvp[0][0], mvp[1][0], mvp[2][0], mvp[3][0]);
+    const vec4 rowY = vec4(mvp[0][1], mvp[1][1], mvp[2][1], mvp[3][1]);
+    const vec4 rowZ = vec4(mvp[0][2], mvp[1][2], mvp[2][2], mvp[3][2]);
+    const vec4 rowW = vec4(mvp[0][3], mvp[1][3], mvp[2][3], mvp[3][3]);
+    const vec4 planes[6] = vec4[6](rowW + rowX, rowW - rowX, rowW + rowY, rowW - rowY, rowZ, rowW - rowZ);
+
+    for (int i = 0; i < 6; ++i)
+    {
+        // The planes are not normalized, so the radius is scaled by the length of the plane normal instead.
+        if (dot(planes[i].xyz, bounds.center) + planes[i].w < -bounds.radius * length(planes[i].xyz)) return false;
+    }
+
+    // The projection is orthographic, so the whole meshlet is viewed along one model space direction, the one of growing clip space depth.
+    const vec3 viewDirection = normalize(inverse(mat3(mvp)) * vec3(0.0f, 0.0f, 1.0f));
+    return dot(viewDirection, bounds.coneAxis) < bounds.coneCutoff;
+}
 
 void main()
 {
-    const uint baseData = gl_WorkGroupID.x * gl_WorkGroupID.y * gl_WorkGroupID.z;
+    if (gl_LocalInvocationIndex == 0U) {
+        s_survivorCount = 0U;
+    }
+    barrier();
+
+    const uint meshletIndex = gl_GlobalInvocationID.x;
+    const uint transformIndex = draw_consts.u_drawIndex + gl_WorkGroupID.y % 4U;
 
-    for (uint i = 0; i < payload_data_count; ++i) {
-        sharedPayload.data[i] = int(baseData + i);
+    // Compact the surviving meshlets at the front of the payload
+    if (meshletIndex < draw_consts.u_meshletCount && IsMeshletVisible(trans_consts.u_mvp[transformIndex], meshlet_bounds.u_bounds[meshletIndex])) {
+        sharedPayload.meshletIndices[atomicAdd(s_survivorCount, 1U)] = meshletIndex;
     }
+    barrier();
 
-    sharedPayload.meshID = gl_WorkGroupID.x;
-    sharedPayload.meshGroupSize = 4U;     // launch 4 mesh shader groups
+    if (gl_LocalInvocationIndex == 0U)
+    {
+        sharedPayload.transformIndex = transformIndex;
+
+        // One atomic per work group for all the meshlets it has culled
+        const uint testedCount = min(meshlets_per_task, draw_consts.u_meshletCount - gl_WorkGroupID.x * meshlets_per_task);
+        if (testedCount > s_survivorCount) {
+            atomicAdd(culling_counter.u_culledMeshletCount, testedCount - s_survivorCount);
+        }
+    }
 
-    EmitMeshTasksEXT(sharedPayload.meshGroupSize, 1U, 1U);
+    EmitMeshTasksEXT(s_survivorCount, 1U, 1U);
 }
 
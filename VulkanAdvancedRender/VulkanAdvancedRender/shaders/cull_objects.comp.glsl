@@ -0,0 +1,72 @@
+#version 450 core
+
+// One invocation per instance, and one row of work groups per culled draw
+layout(local_size_x_id = 0) in;
+
+// The model-view-projection matrices of all the draws in a frame are built on the CPU.
+// The array length MUST BE coherent with TOTAL_DRAW_TRANSFORM_COUNT in main.c.
+layout(std140, set = 0, binding = 0) uniform transform_block {
+    mat4 u_mvp[8];
+} trans_consts;
+
+// The bounding sphere of each instance, see ObjectBounds in common.h
+layout(std430, set = 1, binding = 0) readonly buffer bounds_block {
+    vec4 u_bounds[];        // xyz center, w radius
+} object_bounds;
+
+// Same layout as VkDrawIndexedIndirectCommand
+struct DrawIndexedIndirectCommand
+{
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+layout(std430, set = 1, binding = 1) writeonly buffer command_block {
+    DrawIndexedIndirectCommand u_commands[];
+} draw_commands;
+
+// This MUST BE coherent with CullingCounters in main.c
+layout(std430, set = 1, binding = 2) buffer counter_block {
+    uint u_drawCounts[3];
+    uint u_objectCount;
+} counters;
+
+// This MUST BE coherent with CullingPushConstants in main.c
+layout(push_constant) uniform culling_block {
+    uint u_objectCount;
+    uint u_firstDrawIndex;      // the transform of the draw of the first work group row
+    uint u_maxDrawCount;        // the number of command slots of each draw
+    uint u_indexCount;
+} culling_consts;
+
+void main()
+{
+    const uint objectIndex = gl_GlobalInvocationID.x;
+    if (objectIndex >= culling_consts.u_objectCount) return;
+
+    const uint draw = gl_WorkGroupID.y;
+    const mat4 mvp = trans_consts.u_mvp[culling_consts.u_firstDrawIndex + draw];
+    const vec4 bounds = object_bounds.u_bounds[objectIndex];
+
+    // The frustum planes in model space are combinations of the matrix rows,
+    // for the clip volume -w <= x <= w, -w <= y <= w, 0 <= z <= w.
+    const vec4 rowX = vec4(mvp[0][0], mvp[1][0], mvp[2][0], mvp[3][0]);
+    const vec4 rowY = vec4(mvp[0][1], mvp[1][1], mvp[2][1], mvp[3][1]);
+    const vec4 rowZ = vec4(mvp[0][2], mvp[1][2], mvp[2][2], mvp[3][2]);
+    const vec4 rowW = vec4(mvp[0][3], mvp[1][3], mvp[2][3], mvp[3][3]);
+    const vec4 planes[6] = vec4[6](rowW + rowX, rowW - rowX, rowW + rowY, rowW - rowY, rowZ, rowW - rowZ);
+
+    for (int i = 0; i < 6; ++i)
+    {
+        // The planes are not normalized, so the radius is scaled by the length of the plane normal instead.
+        if (dot(planes[i].xyz, bounds.xyz) + planes[i].w < -bounds.w * length(planes[i].xyz)) return;
+    }
+
+    // Compact the visible instances at the front of the command slots of this draw
+    const uint slot = atomicAdd(counters.u_drawCounts[draw], 1U);
+    draw_commands.u_commands[draw * culling_consts.u_maxDrawCount + slot] = DrawIndexedIndirectCommand(culling_consts.u_indexCount, 1U, 0U, 0, objectIndex);
+}
+
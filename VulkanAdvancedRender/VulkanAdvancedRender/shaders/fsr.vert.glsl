@@ -1,74 +1,40 @@
 
 #version 450 core
 
-#extension GL_EXT_scalar_block_layout : enable
 #extension GL_EXT_fragment_shading_rate : enable
 
 layout(location = 0) in vec4 inPos;
 layout(location = 1) in vec4 inColor;
-layout(location = 0) out flat lowp vec4 fragColor;
 
-layout(std430, set = 0, binding = 0, scalar) uniform transform_block {
-    vec2 u_factor;
-    float u_angle;
-} trans_consts;
+// Per-instance attributes, see InstanceData in common.h
+layout(location = 3) in vec4 inInstanceTransform;
+layout(location = 4) in vec4 inInstanceColor;
 
-/** Model view translation matrix *
- * [ 1  0  0  0
-     0  1  0  0
-     0  0  1  0
-     x  y  z  1
- * ]
-*/
+layout(location = 0) out flat lowp vec4 fragColor;
 
-/** Ortho projection matrix *
- * [ 2/(r-l)       0             0             0
-     0             2/(t-b)       0             0
-     0             0             -2/(f-n)      0
-     -(r+l)/(r-l)  -(t+b)/(t-b)  -(f+n)/(f-n)  1
- * ]
-*/
+// The model-view-projection matrices of all the draws in a frame are built on the CPU.
+// The array length MUST BE coherent with TOTAL_DRAW_TRANSFORM_COUNT in main.c.
+layout(std140, set = 0, binding = 0) uniform transform_block {
+    mat4 u_mvp[8];
+    // Decodes the quantized positions of the quad, see QuantizeVertexAttributes
+    vec4 u_positionScale;
+    vec4 u_positionBias;
+} trans_consts;
 
-/** rotate matrix *
- * [x^2*(1-c)+c  xy*(1-c)+zs  xz(1-c)-ys  0
-    xy(1-c)-zs   y^2*(1-c)+c  yz(1-c)+xs  0
-    xz(1-c)+ys   yz(1-c)-xs   z^2(1-c)+c  0
-    0            0            0           1
- * ]
- * |(x, y, z)| must be 1.0
-*/
+// Selects the matrix of the current draw
+layout(push_constant) uniform draw_block {
+    uint u_drawIndex;
+} draw_consts;
 
 void main()
 {
-    const float offset = -0.6f;
-    // glTranslate(offset, offset, -2.3, 1.0)
-    mat4 translateMatrix = mat4(1.0f, 0.0f, 0.0f, offset,      // column 0
-                                0.0f, 1.0f, 0.0f, offset,      // column 1
-                                0.0f, 0.0f, 1.0f, -2.3f,       // column 2
-                                0.0f, 0.0f, 0.0f, 1.0f         // column 3
-                                );
-
-    const float radian = radians(trans_consts.u_angle);
-
-    // glRotate(radian, 0.0, 1.0, 0.0)
-    mat4 rotateMatrix = mat4(cos(radian), 0.0, sin(radian), 0.0,   // column 0
-                             0.0, 1.0, 0.0, 0.0,                   // column 1
-                             -sin(radian), 0.0, cos(radian), 0.0,  // column 2
-                             0.0, 0.0, 0.0, 1.0                    // column 3
-                            );
-
-    // glOrtho(left, right, bottom, top, near, far) and here uses:
-    // glOrtho(-u_factor.x, u_factor.x, -u_factor.y, u_factor.y, 1.0, 3.0)
-    // Here upside down the bottom and top to make the front face as counter-clockwise
-    mat4 projectionMatrix = mat4(1.0f / trans_consts.u_factor.x, 0.0f, 0.0f, 0.0f,  // column 0
-                                 0.0f, 1.0f / trans_consts.u_factor.y, 0.0f, 0.0f,  // column 1
-                                 0.0f, 0.0f, -1.0f, -2.0f,                          // column 2
-                                 0.0f, 0.0f, 0.0f, 1.0f                             // colimn 3
-                                 );
+    const vec4 pos = inPos * trans_consts.u_positionScale + trans_consts.u_positionBias;
 
-    gl_Position = inPos * (rotateMatrix * (translateMatrix * projectionMatrix));
+    // Place the instance in the plane of the quad before the model-view-projection transform
+    const vec4 instancePos = vec4(pos.xy * inInstanceTransform.z + inInstanceTransform.xy, pos.zw);
+    gl_Position = trans_consts.u_mvp[draw_consts.u_drawIndex] * instancePos;
     
-    fragColor = inColor;
+    fragColor = inColor * inInstanceColor;
 
     gl_PrimitiveShadingRateEXT = 11; // gl_ShadingRateFlag2HorizontalPixelsEXT | gl_ShadingRateFlag4VerticalPixelsEXT;
 }
@@ -12,4 +12,12 @@
 %VK_SDK_PATH%/Bin/glslangValidator  --target-env vulkan1.2  -Os  -o basic_ms.task.spv  basic_ms.task.glsl
 %VK_SDK_PATH%/Bin/glslangValidator  --target-env vulkan1.2  -Os  -o basic_ms.mesh.spv  basic_ms.mesh.glsl
 %VK_SDK_PATH%/Bin/glslangValidator  --target-env vulkan1.1  -Os  -o basic_ms.frag.spv  basic_ms.frag.glsl
+%VK_SDK_PATH%/Bin/glslangValidator  --target-env vulkan1.1  -Os  -o vertbench_legacy.vert.spv  vertbench_legacy.vert.glsl
+%VK_SDK_PATH%/Bin/glslangValidator  --target-env vulkan1.1  -Os  -o vertbench_mvp.vert.spv  vertbench_mvp.vert.glsl
+%VK_SDK_PATH%/Bin/glslangValidator  --target-env vulkan1.1  -Os  -o cull_objects.comp.spv  cull_objects.comp.glsl
+%VK_SDK_PATH%/Bin/glslangValidator  --target-env vulkan1.1  -Os  -o meshlet_ref.vert.spv  meshlet_ref.vert.glsl
+%VK_SDK_PATH%/Bin/glslangValidator  --target-env vulkan1.1  -Os  -o vertbench_indexed.vert.spv  vertbench_indexed.vert.glsl
+%VK_SDK_PATH%/Bin/glslangValidator  --target-env vulkan1.1  -Os  -o vertbench_fetch.vert.spv  vertbench_fetch.vert.glsl
+%VK_SDK_PATH%/Bin/glslangValidator  --target-env vulkan1.1  -Os  -o vertbench_fetch_position.vert.spv  vertbench_fetch_position.vert.glsl
+%VK_SDK_PATH%/Bin/glslangValidator  --target-env vulkan1.1  -Os  -o mipgen.comp.spv  mipgen.comp.glsl
 
@@ -0,0 +1,40 @@
+#version 450 core
+
+// Draws the meshlet source mesh through the vertex pipeline with the original index buffer, for the meshlet throughput benchmark.
+// The vertices are pulled from the same storage buffer as basic_ms.mesh.glsl reads.
+
+// The model-view-projection matrices of all the draws in a frame are built on the CPU.
+// The array length MUST BE coherent with TOTAL_DRAW_TRANSFORM_COUNT in main.c.
+layout(std140, set = 0, binding = 0) uniform transform_block {
+    mat4 u_mvp[8];
+} trans_consts;
+
+struct MeshVertex
+{
+    float position[3];
+    float normal[3];
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer vertex_block {
+    MeshVertex u_vertices[];
+} mesh_vertices;
+
+// The instances draw the copies of the mesh as the task work group rows of the mesh shader pipeline do.
+layout(push_constant) uniform draw_block {
+    uint u_drawIndex;
+} draw_consts;
+
+layout(location = 0) out MeshletVertexAttribute
+{
+    lowp smooth vec4 color;
+} outVertAttr;
+
+void main()
+{
+    const MeshVertex vertex = mesh_vertices.u_vertices[gl_VertexIndex];
+    const vec3 position = vec3(vertex.position[0], vertex.position[1], vertex.position[2]);
+
+    gl_Position = trans_consts.u_mvp[draw_consts.u_drawIndex + uint(gl_InstanceIndex) % 4U] * vec4(position, 1.0f);
+    outVertAttr.color = vec4(vec3(0.4f + 0.6f * max(vertex.normal[2], 0.0f)), 1.0f);
+}
+
@@ -0,0 +1,41 @@
+#version 450 core
+
+// One invocation per texel of the destination level, and one work group layer per array layer
+// The work group size MUST BE coherent with MIPMAP_WORK_GROUP_SIZE in MipGeneration.c.
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+// The level above, sampled through a view of the texture format
+layout(set = 0, binding = 0) uniform sampler2DArray srcLevel;
+
+// The level to fill, stored through an R8G8B8A8_UNORM view of the texture
+layout(set = 0, binding = 1, rgba8) uniform writeonly image2DArray dstLevel;
+
+// See MipmapPushConstants in MipGeneration.c
+layout(push_constant) uniform mipgen_block {
+    uvec2 u_dstSize;
+    uint u_swapRedBlue;
+    uint u_encodeSRGB;
+} consts;
+
+void main()
+{
+    const uvec3 texel = gl_GlobalInvocationID;
+    if (texel.x >= consts.u_dstSize.x || texel.y >= consts.u_dstSize.y) return;
+
+    // The bilinear tap at the shared corner of a 2 x 2 footprint of the level above averages the 4 texels
+    const vec2 uv = (vec2(texel.xy) + 0.5) / vec2(consts.u_dstSize);
+    vec4 color = textureLod(srcLevel, vec3(uv, float(texel.z)), 0.0);
+
+    if (consts.u_encodeSRGB != 0U)
+    {
+        const vec3 low = color.rgb * 12.92;
+        const vec3 high = 1.055 * pow(color.rgb, vec3(1.0 / 2.4)) - 0.055;
+        color.rgb = mix(low, high, greaterThan(color.rgb, vec3(0.0031308)));
+    }
+    if (consts.u_swapRedBlue != 0U) {
+        color = color.bgra;
+    }
+
+    imageStore(dstLevel, ivec3(texel), color);
+}
+
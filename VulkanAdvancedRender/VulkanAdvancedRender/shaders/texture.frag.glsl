@@ -5,13 +5,16 @@ precision mediump int;
 precision highp float;
 
 layout(location = 0) in highp vec2 varyingTexCoords;
+layout(location = 1) flat in highp uint varyingTextureLayer;
 layout(location = 0) out lowp vec4 outColor;
 
-// Combined Texture + Sampler
-layout(set = 0, binding = 1) uniform sampler2D imageSampler;
+// Combined Texture + Sampler, one layer per texture file
+layout(set = 0, binding = 1) uniform sampler2DArray imageSampler;
 
 void main()
 {
-    outColor = texture(imageSampler, varyingTexCoords);
+    // There are fewer layers than instances, so they are reused in turn
+    const highp uint layer = varyingTextureLayer % uint(textureSize(imageSampler, 0).z);
+    outColor = texture(imageSampler, vec3(varyingTexCoords, float(layer)));
 }
 
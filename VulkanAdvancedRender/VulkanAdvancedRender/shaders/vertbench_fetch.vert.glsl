@@ -0,0 +1,21 @@
+#version 450 core
+
+// Every attribute of the vertex layout benchmark is consumed, so that all of its streams are fetched.
+layout(location = 0) in vec4 inPos;
+layout(location = 1) in vec4 inColor;
+layout(location = 2) in vec2 inTexCoords;
+
+layout(location = 0) out flat lowp vec4 fragColor;
+
+// The model-view-projection matrix built on the CPU
+layout(push_constant) uniform transform_block {
+    mat4 u_mvp;
+} trans_consts;
+
+void main()
+{
+    gl_Position = trans_consts.u_mvp * inPos;
+
+    fragColor = inColor * vec4(inTexCoords, 1.0f, 1.0f);
+}
+
@@ -0,0 +1,19 @@
+#version 450 core
+
+// Only the position of the vertex layout benchmark is consumed, like in a depth only pass.
+layout(location = 0) in vec4 inPos;
+
+layout(location = 0) out flat lowp vec4 fragColor;
+
+// The model-view-projection matrix built on the CPU
+layout(push_constant) uniform transform_block {
+    mat4 u_mvp;
+} trans_consts;
+
+void main()
+{
+    gl_Position = trans_consts.u_mvp * inPos;
+
+    fragColor = vec4(1.0f, 0.0f, 0.0f, 1.0f);
+}
+
@@ -0,0 +1,25 @@
+#version 450 core
+
+layout(location = 0) in vec3 inPos;
+
+layout(location = 0) out flat lowp vec4 fragColor;
+
+// The model-view-projection matrix built on the CPU
+layout(push_constant) uniform transform_block {
+    mat4 u_mvp;
+} trans_consts;
+
+// The copies of the mesh are laid out in a square grid over the clip space.
+// This MUST BE coherent with INDEX_BENCHMARK_GRID_SIZE in VertexBenchmark.c.
+const uint gridSize = 16U;
+
+void main()
+{
+    const uint cell = uint(gl_InstanceIndex) % (gridSize * gridSize);
+    const vec2 offset = (vec2(float(cell % gridSize), float(cell / gridSize)) + 0.5f) * (2.0f / float(gridSize)) - 1.0f;
+
+    gl_Position = trans_consts.u_mvp * vec4(inPos.xy + offset, inPos.z, 1.0f);
+
+    fragColor = vec4(1.0f, 0.0f, 0.0f, 1.0f);
+}
+
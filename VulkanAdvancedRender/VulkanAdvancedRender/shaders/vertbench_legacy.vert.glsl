@@ -0,0 +1,46 @@
+
+#version 450 core
+
+#extension GL_EXT_scalar_block_layout : enable
+
+layout(location = 0) out flat lowp vec4 fragColor;
+
+// The same transform inputs as the former per-vertex transform shaders
+layout(std430, push_constant, scalar) uniform transform_block {
+    vec2 u_factor;
+    float u_angle;
+} trans_consts;
+
+void main()
+{
+    // All the 3 vertices of a triangle share the same position, so every triangle is degenerate and culled before rasterization.
+    const uint triangleIndex = uint(gl_VertexIndex) / 3U;
+    const vec4 inPos = vec4(float(triangleIndex & 1023U) / 1024.0f - 0.5f, float((triangleIndex >> 10U) & 1023U) / 1024.0f - 0.5f, 0.0f, 1.0f);
+
+    // Rebuild the translate, rotate and ortho matrices per vertex as the former shaders did
+    const float offset = -0.6f;
+    mat4 translateMatrix = mat4(1.0f, 0.0f, 0.0f, offset,      // column 0
+                                0.0f, 1.0f, 0.0f, offset,      // column 1
+                                0.0f, 0.0f, 1.0f, -2.3f,       // column 2
+                                0.0f, 0.0f, 0.0f, 1.0f         // column 3
+                                );
+
+    const float radian = radians(trans_consts.u_angle);
+
+    mat4 rotateMatrix = mat4(cos(radian), 0.0, sin(radian), 0.0,   // column 0
+                             0.0, 1.0, 0.0, 0.0,                   // column 1
+                             -sin(radian), 0.0, cos(radian), 0.0,  // column 2
+                             0.0, 0.0, 0.0, 1.0                    // column 3
+                            );
+
+    mat4 projectionMatrix = mat4(1.0f / trans_consts.u_factor.x, 0.0f, 0.0f, 0.0f,  // column 0
+                                 0.0f, 1.0f / trans_consts.u_factor.y, 0.0f, 0.0f,  // column 1
+                                 0.0f, 0.0f, -1.0f, -2.0f,                          // column 2
+                                 0.0f, 0.0f, 0.0f, 1.0f                             // column 3
+                                 );
+
+    gl_Position = inPos * (rotateMatrix * (translateMatrix * projectionMatrix));
+
+    fragColor = vec4(1.0f, 0.0f, 0.0f, 1.0f);
+}
+
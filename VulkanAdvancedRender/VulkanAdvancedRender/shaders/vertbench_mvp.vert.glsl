@@ -0,0 +1,21 @@
+
+#version 450 core
+
+layout(location = 0) out flat lowp vec4 fragColor;
+
+// The model-view-projection matrix built on the CPU
+layout(push_constant) uniform transform_block {
+    mat4 u_mvp;
+} trans_consts;
+
+void main()
+{
+    // All the 3 vertices of a triangle share the same position, so every triangle is degenerate and culled before rasterization.
+    const uint triangleIndex = uint(gl_VertexIndex) / 3U;
+    const vec4 inPos = vec4(float(triangleIndex & 1023U) / 1024.0f - 0.5f, float((triangleIndex >> 10U) & 1023U) / 1024.0f - 0.5f, 0.0f, 1.0f);
+
+    gl_Position = trans_consts.u_mvp * inPos;
+
+    fragColor = vec4(1.0f, 0.0f, 0.0f, 1.0f);
+}
+
@@ -1,157 +1,96 @@
 #include "common.h"
 
-static VkImage CreateTextureResource(VkPhysicalDevice currPhysicalDevice, VkDevice specDevice, uint32_t textureWidth, uint32_t textureHeight, void* srcImageData, uint32_t graphicsQueueFamilyIndex,
-                                    VkImageView *outImageView, VkSampler *outSampler, VkBuffer *outHostUploadBuffer, VkDeviceMemory *outDeviceMemory, VkDeviceMemory *outHostUploadMemory)
-{
-    VkImage dstImage = VK_NULL_HANDLE;
+enum { CHECKERBOARD_TEXTURE_SIZE = 256, CHECKERBOARD_CELL_SIZE = 32 };
 
-    VkPhysicalDeviceMemoryProperties memoryProperties = { 0 };
-    vkGetPhysicalDeviceMemoryProperties(currPhysicalDevice, &memoryProperties);
+static const char* const s_defaultTextureFilePath = "images/geom.bmp";
 
-    const VkDeviceSize imageBufferSize = textureWidth * textureHeight * 4U;
-
-    const VkBufferCreateInfo hostUploadBufferCreateInfo = {
-        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-        .pNext = NULL,
-        .flags = 0,
-        .size = imageBufferSize,
-        .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-        .queueFamilyIndexCount = 1,
-        .pQueueFamilyIndices = &graphicsQueueFamilyIndex
-    };
-    VkResult res = vkCreateBuffer(specDevice, &hostUploadBufferCreateInfo, NULL, outHostUploadBuffer);
-    if (res != VK_SUCCESS)
-    {
-        fprintf(stderr, "vkCreateBuffer for host upload buffer failed: %d\n", res);
-        return dstImage;
+// The source of the generated levels, `mipmapGeneration`, decides the usage of the image along with the way its data gets there
+static VkImageUsageFlags GetTextureImageUsage(MipmapGeneration mipmapGeneration, bool isCopiedFromHost, VkImageCreateFlags* outFlags)
+{
+    // image with sampler. The levels stay in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL for a generation even when they are copied from the host.
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT;
+    if (isCopiedFromHost) {
+        usage |= VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT;
     }
-
-    do
+    if (!isCopiedFromHost || mipmapGeneration != MIPMAP_GENERATION_NONE) {
+        usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    }
+    *outFlags = 0;
+    if (mipmapGeneration == MIPMAP_GENERATION_BLIT) {
+        usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
+    else if (mipmapGeneration == MIPMAP_GENERATION_COMPUTE)
     {
-        VkMemoryRequirements hostUploadMemoryRequirements = { 0 };
-        vkGetBufferMemoryRequirements(specDevice, *outHostUploadBuffer, &hostUploadMemoryRequirements);
-
-        uint32_t memoryTypeIndex;
-        // Find host visible property memory type index
-        for (memoryTypeIndex = 0; memoryTypeIndex < memoryProperties.memoryTypeCount; ++memoryTypeIndex)
-        {
-            if ((hostUploadMemoryRequirements.memoryTypeBits & (1U << memoryTypeIndex)) == 0U) {
-                continue;
-            }
-            const VkMemoryType memoryType = memoryProperties.memoryTypes[memoryTypeIndex];
-            if ((memoryType.propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0 &&
-                (memoryType.propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0 &&
-                memoryProperties.memoryHeaps[memoryType.heapIndex].size >= hostUploadMemoryRequirements.size)
-            {
-                // found our memory type!
-                break;
-            }
-        }
-
-        const VkMemoryAllocateInfo hostMemAllocInfo = {
-            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-            .pNext = NULL,
-            .allocationSize = hostUploadMemoryRequirements.size,
-            .memoryTypeIndex = memoryTypeIndex
-        };
+        // The compute shader stores through an R8G8B8A8_UNORM view, whatever storage support the texture format itself has
+        usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+        *outFlags |= VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT | VK_IMAGE_CREATE_EXTENDED_USAGE_BIT;
+    }
+    return usage;
+}
 
-        res = vkAllocateMemory(specDevice, &hostMemAllocInfo, NULL, outHostUploadMemory);
-        if (res != VK_SUCCESS)
-        {
-            fprintf(stderr, "vkAllocateMemory for host vertex and uniform memory failed: %d\n", res);
-            break;
-        }
+// `levelCount` counts the generated levels too
+static VkImage CreateTextureResource(VkDevice specDevice, const ImageFile* layerInfo, uint32_t levelCount, uint32_t layerCount, MipmapGeneration mipmapGeneration,
+                                    bool isCopiedFromHost, uint32_t graphicsQueueFamilyIndex, VkImageView *outImageView, VkSampler *outSampler,
+                                    DeviceMemoryAllocation *outDeviceMemory)
+{
+    VkImage dstImage = VK_NULL_HANDLE;
 
-        res = vkBindBufferMemory(specDevice, *outHostUploadBuffer, *outHostUploadMemory, 0);
-        if (res != VK_SUCCESS)
-        {
-            fprintf(stderr, "vkBindBufferMemory failed: %d\n", res);
-            break;
-        }
+    VkImageCreateFlags flags;
+    const VkImageUsageFlags usage = GetTextureImageUsage(mipmapGeneration, isCopiedFromHost, &flags);
 
+    do
+    {
         const VkImageCreateInfo imageCreateInfo = {
             .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
             .pNext = NULL,
-            .flags = 0,
+            .flags = flags,
             .imageType = VK_IMAGE_TYPE_2D,
-            .format = VK_FORMAT_R8G8B8A8_UNORM,
-            .extent = { textureWidth, textureHeight, 1U },
-            .mipLevels = 1,
-            .arrayLayers = 1,
+            .format = layerInfo->format,
+            .extent = { layerInfo->width, layerInfo->height, 1U },
+            .mipLevels = levelCount,
+            .arrayLayers = layerCount,
             .samples = VK_SAMPLE_COUNT_1_BIT,
             .tiling = VK_IMAGE_TILING_OPTIMAL,
-            .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,      // image with sampler
+            .usage = usage,
             .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
             .queueFamilyIndexCount = 1,
             .pQueueFamilyIndices = (uint32_t[]){ graphicsQueueFamilyIndex },
             .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
         };
 
-        res = vkCreateImage(specDevice, &imageCreateInfo, NULL, &dstImage);
+        VkResult res = vkCreateImage(specDevice, &imageCreateInfo, NULL, &dstImage);
         if (res != VK_SUCCESS)
         {
             fprintf(stderr, "vkCreateImage for texture faild: %d\n", res);
             return dstImage;
         }
 
-        VkMemoryRequirements memoryRequirements = { 0 };
-        vkGetImageMemoryRequirements(specDevice, dstImage, &memoryRequirements);
-
-        // Find host visible property memory type index
-        for (memoryTypeIndex = 0; memoryTypeIndex < memoryProperties.memoryTypeCount; ++memoryTypeIndex)
-        {
-            if ((memoryRequirements.memoryTypeBits & (1U << memoryTypeIndex)) == 0U) {
-                continue;
-            }
-            const VkMemoryType memoryType = memoryProperties.memoryTypes[memoryTypeIndex];
-            if ((memoryType.propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0 &&
-                memoryProperties.memoryHeaps[memoryType.heapIndex].size >= memoryRequirements.size) {
-                // found our memory type!
-                break;
-            }
-        }
-
-        const VkMemoryAllocateInfo memAllocInfo = {
-            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-            .pNext = NULL,
-            .allocationSize = memoryRequirements.size,
-            .memoryTypeIndex = memoryTypeIndex
-        };
-
-        res = vkAllocateMemory(specDevice, &memAllocInfo, NULL, outDeviceMemory);
-        if (res != VK_SUCCESS)
-        {
-            fprintf(stderr, "vkAllocateMemory for texture failed: %d\n", res);
-            break;
-        }
-
-        res = vkBindImageMemory(specDevice, dstImage, *outDeviceMemory, 0);
-        if (res != VK_SUCCESS)
+        if (!AllocateAndBindImageMemory(dstImage, DEVICE_MEMORY_USAGE_GPU_ONLY, outDeviceMemory))
         {
-            fprintf(stderr, "vkBindImageMemory for texture failed: %d\n", res);
+            fprintf(stderr, "Allocating the device memory for texture failed!\n");
             break;
         }
 
+        // The array view lets one descriptor sample every loaded texture
         const VkImageViewCreateInfo imageViewCreateInfo = {
             .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
             .pNext = NULL,
             .flags = 0,
             .image = dstImage,
-            .viewType = VK_IMAGE_VIEW_TYPE_2D,
-            .format = VK_FORMAT_R8G8B8A8_UNORM,
+            .viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY,
+            .format = layerInfo->format,
             .components = {
                 .r = VK_COMPONENT_SWIZZLE_IDENTITY,
                 .g = VK_COMPONENT_SWIZZLE_IDENTITY,
                 .b = VK_COMPONENT_SWIZZLE_IDENTITY,
-                .a = VK_COMPONENT_SWIZZLE_IDENTITY
+                .a = layerInfo->isOpaque ? VK_COMPONENT_SWIZZLE_ONE : VK_COMPONENT_SWIZZLE_IDENTITY
             },
             .subresourceRange = {
                 .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
                 .baseMipLevel = 0U,
-                .levelCount = 1U,
+                .levelCount = levelCount,
                 .baseArrayLayer = 0U,
-                .layerCount = 1U
+                .layerCount = layerCount
             }
         };
 
@@ -168,7 +107,7 @@ static VkImage CreateTextureResource(VkPhysicalDevice currPhysicalDevice, VkDevi
             .flags = 0,
             .magFilter = VK_FILTER_LINEAR,
             .minFilter = VK_FILTER_LINEAR,
-            .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+            .mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
             .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
             .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
             .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
@@ -178,7 +117,7 @@ static VkImage CreateTextureResource(VkPhysicalDevice currPhysicalDevice, VkDevi
             .compareEnable = VK_FALSE,
             .compareOp = VK_COMPARE_OP_NEVER,
             .minLod = 0.0f,
-            .maxLod = 0.0f,
+            .maxLod = (float)(levelCount - 1U),     // trilinear filtering over the whole chain
             .borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK,
             .unnormalizedCoordinates = VK_FALSE      // We're going to use normalized coordinates here...
         };
@@ -190,30 +129,10 @@ static VkImage CreateTextureResource(VkPhysicalDevice currPhysicalDevice, VkDevi
             break;
         }
 
-        void* hostData = NULL;
-        res = vkMapMemory(specDevice, *outHostUploadMemory, 0U, hostUploadMemoryRequirements.size, 0U, &hostData);
-        if (res != VK_SUCCESS)
-        {
-            fprintf(stderr, "vkMapMemory failed for upload texture memory: %d\n", res);
-            break;
-        }
-        memcpy(hostData, srcImageData, imageBufferSize);
-        vkUnmapMemory(specDevice, *outHostUploadMemory);
-
         return dstImage;
     }
     while (false);
 
-    if (*outHostUploadBuffer != VK_NULL_HANDLE)
-    {
-        vkDestroyBuffer(specDevice, *outHostUploadBuffer, NULL);
-        *outHostUploadBuffer = VK_NULL_HANDLE;
-    }
-    if (*outHostUploadMemory != VK_NULL_HANDLE)
-    {
-        vkFreeMemory(specDevice, *outHostUploadMemory, NULL);
-        *outHostUploadMemory = NULL;
-    }
     if (dstImage != VK_NULL_HANDLE)
     {
         vkDestroyImage(specDevice, dstImage, NULL);
@@ -229,19 +148,23 @@ static VkImage CreateTextureResource(VkPhysicalDevice currPhysicalDevice, VkDevi
         vkDestroySampler(specDevice, *outSampler, NULL);
         *outSampler = VK_NULL_HANDLE;
     }
-    if (*outDeviceMemory != VK_NULL_HANDLE)
-    {
-        vkFreeMemory(specDevice, *outDeviceMemory, NULL);
-        *outDeviceMemory = VK_NULL_HANDLE;
-    }
+    FreeDeviceMemory(outDeviceMemory);
 
     return dstImage;
 }
 
-static void CopyImageDataToDeviceTextureBuffer(VkCommandBuffer commandBuffer, VkBuffer hostUploadBuffer, VkImage textureImage, uint32_t textureWidth, uint32_t textureHeight,
-                                            uint32_t graphicsQueueFamilyIndex)
+// Copies every level of every layer in `layerInfo`, the layers following each other `layerStride` bytes apart from `stagingOffset` of the staging ring,
+// or from the beginning of `hostUploadBuffer` when it is not VK_NULL_HANDLE, in the current batch of `uploadManager`. With `generatesMipmaps`, all the `levelCount` levels are left in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+// for the generation to take over with `mipmapDstStageMask` and `mipmapDstAccessMask`.
+static bool CopyImageDataToDeviceTextureBuffer(UploadManager* uploadManager, VkBuffer hostUploadBuffer, VkDeviceSize stagingOffset, VkImage textureImage, const ImageFile* layerInfo,
+                                            uint32_t levelCount, uint32_t layerCount, VkDeviceSize layerStride, bool generatesMipmaps,
+                                            VkPipelineStageFlags mipmapDstStageMask, VkAccessFlags mipmapDstAccessMask)
 {
-    VkImageMemoryBarrier imageBarriers[] = {
+    const VkCommandBuffer commandBuffer = BeginUploadBatch(uploadManager, true);
+    if (commandBuffer == VK_NULL_HANDLE) return false;
+
+    // The contents are undefined before the copy, so the queue family recording it takes the image over without any ownership transfer
+    const VkImageMemoryBarrier imageBarriers[] = {
         {
             .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
             .pNext = NULL,
@@ -249,48 +172,169 @@ static void CopyImageDataToDeviceTextureBuffer(VkCommandBuffer commandBuffer, Vk
             .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
             .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
             .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            .srcQueueFamilyIndex = graphicsQueueFamilyIndex,
-            .dstQueueFamilyIndex = graphicsQueueFamilyIndex,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
             .image = textureImage,
             .subresourceRange = {
                 .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
                 .baseMipLevel = 0U,
-                .levelCount = 1U,
+                .levelCount = levelCount,
                 .baseArrayLayer = 0U,
-                .layerCount = 1U
+                .layerCount = layerCount
             }
         }
     };
-    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+    // Nothing earlier accesses the new image, so the transition waits for no stage at all.
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
         0, NULL, 0, NULL, (uint32_t)(sizeof(imageBarriers) / sizeof(imageBarriers[0])), imageBarriers);
 
-    const VkBufferImageCopy copyRegions[] = {
+    VkBufferImageCopy copyRegions[MAX_TEXTURE_FILE_COUNT * MAX_IMAGE_FILE_LEVEL_COUNT];
+    uint32_t copyRegionCount = 0;
+    for (uint32_t layer = 0; layer < layerCount; ++layer)
+    {
+        for (uint32_t level = 0; level < layerInfo->levelCount; ++level)
         {
-            .bufferOffset = 0U,
-            .bufferRowLength = textureWidth,
-            .bufferImageHeight = textureHeight,
-            .imageSubresource = {
-                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                .mipLevel = 0U,
-                .baseArrayLayer = 0U,
-                .layerCount = 1U
-            },
-            .imageOffset = { .x = 0U, .y = 0U, .z = 0U },
-            .imageExtent = { .width = textureWidth, .height = textureHeight, .depth = 1U }
+            copyRegions[copyRegionCount++] = (VkBufferImageCopy){
+                .bufferOffset = stagingOffset + layer * layerStride + layerInfo->levelOffsets[level],
+                .bufferRowLength = 0U,      // tightly packed
+                .bufferImageHeight = 0U,
+                .imageSubresource = {
+                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .mipLevel = level,
+                    .baseArrayLayer = layer,
+                    .layerCount = 1U
+                },
+                .imageOffset = { .x = 0U, .y = 0U, .z = 0U },
+                .imageExtent = { .width = max(layerInfo->width >> level, 1U), .height = max(layerInfo->height >> level, 1U), .depth = 1U }
+            };
         }
+    }
+    if (hostUploadBuffer != VK_NULL_HANDLE) {
+        vkCmdCopyBufferToImage(commandBuffer, hostUploadBuffer, textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, copyRegionCount, copyRegions);
+    }
+    else
+    {
+        for (uint32_t i = 0; i < copyRegionCount; ++i)
+        {
+            if (!QueueImageUpload(uploadManager, textureImage, &copyRegions[i])) return false;
+        }
+    }
+
+    if (generatesMipmaps)
+    {
+        return ReleaseUploadedImage(uploadManager, textureImage, &imageBarriers[0].subresourceRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipmapDstStageMask, mipmapDstAccessMask);
+    }
+    return ReleaseUploadedImage(uploadManager, textureImage, &imageBarriers[0].subresourceRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+}
+
+static bool IsHostImageCopyLayoutSupported(const HostImageCopySupport* hostImageCopy, VkImageLayout layout)
+{
+    for (uint32_t i = 0; i < hostImageCopy->copyDstLayoutCount; ++i)
+    {
+        if (hostImageCopy->copyDstLayouts[i] == layout) return true;
+    }
+    return false;
+}
+
+bool CanCopyImageFromHost(VkPhysicalDevice physicalDevice, const HostImageCopySupport* hostImageCopy, VkFormat format, VkImageUsageFlags usage,
+                                VkImageCreateFlags flags, VkImageLayout dstLayout, bool* outIsOptimal)
+{
+    *outIsOptimal = false;
+    if (hostImageCopy == NULL || !IsHostImageCopyLayoutSupported(hostImageCopy, dstLayout)) return false;
+
+    VkHostImageCopyDevicePerformanceQueryEXT performanceQuery = {
+        .sType = VK_STRUCTURE_TYPE_HOST_IMAGE_COPY_DEVICE_PERFORMANCE_QUERY_EXT,
+        .pNext = NULL
     };
-    vkCmdCopyBufferToImage(commandBuffer, hostUploadBuffer, textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)(sizeof(copyRegions) / sizeof(copyRegions[0])), copyRegions);
+    VkImageFormatProperties2 formatProperties = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_FORMAT_PROPERTIES_2,
+        .pNext = &performanceQuery
+    };
+    const VkPhysicalDeviceImageFormatInfo2 formatInfo = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGE_FORMAT_INFO_2,
+        .pNext = NULL,
+        .format = format,
+        .type = VK_IMAGE_TYPE_2D,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = usage,
+        .flags = flags
+    };
+    if (vkGetPhysicalDeviceImageFormatProperties2(physicalDevice, &formatInfo, &formatProperties) != VK_SUCCESS) return false;
 
-    imageBarriers[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    imageBarriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-    imageBarriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    imageBarriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    *outIsOptimal = performanceQuery.optimalDeviceAccess != VK_FALSE;
+    return true;
+}
 
-    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-        0, NULL, 0, NULL, (uint32_t)(sizeof(imageBarriers) / sizeof(imageBarriers[0])), imageBarriers);
+bool CopyImageDataFromHost(VkDevice specDevice, const HostImageCopySupport* hostImageCopy, VkImage image, const ImageFile* layerInfo, const uint8_t* hostData,
+                        uint32_t levelCount, uint32_t layerCount, VkDeviceSize layerStride, VkImageLayout dstLayout)
+{
+    // The previous contents are discarded, so every level goes straight from UNDEFINED to `dstLayout`
+    const VkHostImageLayoutTransitionInfoEXT transitionInfo = {
+        .sType = VK_STRUCTURE_TYPE_HOST_IMAGE_LAYOUT_TRANSITION_INFO_EXT,
+        .pNext = NULL,
+        .image = image,
+        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = dstLayout,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0U,
+            .levelCount = levelCount,
+            .baseArrayLayer = 0U,
+            .layerCount = layerCount
+        }
+    };
+    VkResult res = hostImageCopy->transitionImageLayout(specDevice, 1, &transitionInfo);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkTransitionImageLayoutEXT for texture failed: %d\n", res);
+        return false;
+    }
+
+    VkMemoryToImageCopyEXT copyRegions[MAX_TEXTURE_FILE_COUNT * MAX_IMAGE_FILE_LEVEL_COUNT];
+    uint32_t copyRegionCount = 0;
+    for (uint32_t layer = 0; layer < layerCount; ++layer)
+    {
+        for (uint32_t level = 0; level < layerInfo->levelCount; ++level)
+        {
+            copyRegions[copyRegionCount++] = (VkMemoryToImageCopyEXT){
+                .sType = VK_STRUCTURE_TYPE_MEMORY_TO_IMAGE_COPY_EXT,
+                .pNext = NULL,
+                .pHostPointer = &hostData[layer * layerStride + layerInfo->levelOffsets[level]],
+                .memoryRowLength = 0U,      // tightly packed
+                .memoryImageHeight = 0U,
+                .imageSubresource = {
+                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .mipLevel = level,
+                    .baseArrayLayer = layer,
+                    .layerCount = 1U
+                },
+                .imageOffset = { .x = 0U, .y = 0U, .z = 0U },
+                .imageExtent = { .width = max(layerInfo->width >> level, 1U), .height = max(layerInfo->height >> level, 1U), .depth = 1U }
+            };
+        }
+    }
+    const VkCopyMemoryToImageInfoEXT copyInfo = {
+        .sType = VK_STRUCTURE_TYPE_COPY_MEMORY_TO_IMAGE_INFO_EXT,
+        .pNext = NULL,
+        .flags = 0,
+        .dstImage = image,
+        .dstImageLayout = dstLayout,
+        .regionCount = copyRegionCount,
+        .pRegions = copyRegions
+    };
+    res = hostImageCopy->copyMemoryToImage(specDevice, &copyInfo);
+    if (res != VK_SUCCESS)
+    {
+        fprintf(stderr, "vkCopyMemoryToImageEXT for texture failed: %d\n", res);
+        return false;
+    }
+    return true;
 }
 
-static VkPipeline CreateGraphicsPipeline(VkDevice specDevice, const char* vertSPVFilePath, const char* fragSPVFilePath, VkPipelineLayout pipelineLayout, VkRenderPass renderPass, VkPipelineCache *outPipelineCache)
+VkPipeline CreateTextureGraphicsPipeline(VkDevice specDevice, const char* vertSPVFilePath, const char* fragSPVFilePath, const VertexLayout* vertexLayout,
+                                        VkPipelineLayout pipelineLayout, const RenderTarget* renderTarget, VkPipelineCache pipelineCache)
 {
     VkShaderModule vertexShaderModule = VK_NULL_HANDLE;
     VkShaderModule fragmentShaderModule = VK_NULL_HANDLE;
@@ -325,45 +369,42 @@ static VkPipeline CreateGraphicsPipeline(VkDevice specDevice, const char* vertSP
             }
         };
 
-        const VkVertexInputBindingDescription vertexInputBindings[] = {
-            // vertex coords buffer
-            {
-                .binding = VERTEX_BUFFER_LOCATION_INDEX,
-                .stride = sizeof(float[4]),
-                .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
-            },
-            // texture coords buffer
-            {
-                .binding = TEXCOORDS_BUFFER_LOCATION_INDEX,
-                .stride = sizeof(float[2]),
-                .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
-            }
+        // inPos and inTexCoords attributes, from the streams of `vertexLayout` that hold them
+        VkVertexInputBindingDescription vertexInputBindings[MAX_VERTEX_STREAM_COUNT + 1];
+        VkVertexInputAttributeDescription vertexInputAttributes[MAX_VERTEX_ATTRIBUTE_COUNT + 2];
+        uint32_t vertexInputAttributeCount = 0;
+        uint32_t vertexInputBindingCount = FillVertexInputDescriptions(vertexLayout, (1U << VERTEX_BUFFER_LOCATION_INDEX) | (1U << TEXCOORDS_BUFFER_LOCATION_INDEX),
+                                                                        vertexInputBindings, vertexInputAttributes, &vertexInputAttributeCount);
+
+        // per-instance attributes buffer
+        vertexInputBindings[vertexInputBindingCount++] = (VkVertexInputBindingDescription){
+            .binding = INSTANCE_BUFFER_LOCATION_INDEX,
+            .stride = sizeof(InstanceData),
+            .inputRate = VK_VERTEX_INPUT_RATE_INSTANCE
         };
 
-        const VkVertexInputAttributeDescription vertexInputAttributes[] = {
-            // inPos attribute
-            {
-                .location = VERTEX_BUFFER_LOCATION_INDEX,
-                .binding = VERTEX_BUFFER_LOCATION_INDEX,
-                .format = VK_FORMAT_R32G32B32A32_SFLOAT,
-                .offset = 0
-            },
-            // inTexCoords attribute
-            {
-                .location = TEXCOORDS_BUFFER_LOCATION_INDEX,
-                .binding = TEXCOORDS_BUFFER_LOCATION_INDEX,
-                .format = VK_FORMAT_R32G32_SFLOAT,
-                .offset = 0
-            }
+        // inInstanceTransform attribute
+        vertexInputAttributes[vertexInputAttributeCount++] = (VkVertexInputAttributeDescription){
+            .location = INSTANCE_BUFFER_LOCATION_INDEX,
+            .binding = INSTANCE_BUFFER_LOCATION_INDEX,
+            .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+            .offset = (uint32_t)offsetof(InstanceData, transform)
+        };
+        // inInstanceTextureIndex attribute
+        vertexInputAttributes[vertexInputAttributeCount++] = (VkVertexInputAttributeDescription){
+            .location = INSTANCE_TEXTURE_INDEX_LOCATION_INDEX,
+            .binding = INSTANCE_BUFFER_LOCATION_INDEX,
+            .format = VK_FORMAT_R32_UINT,
+            .offset = (uint32_t)offsetof(InstanceData, textureIndex)
         };
 
         const VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo = {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
             .pNext = NULL,
             .flags = 0,
-            .vertexBindingDescriptionCount = (uint32_t)(sizeof(vertexInputBindings) / sizeof(vertexInputBindings[0])),
+            .vertexBindingDescriptionCount = vertexInputBindingCount,
             .pVertexBindingDescriptions = vertexInputBindings,
-            .vertexAttributeDescriptionCount = (uint32_t)(sizeof(vertexInputAttributes) / sizeof(vertexInputAttributes[0])),
+            .vertexAttributeDescriptionCount = vertexInputAttributeCount,
             .pVertexAttributeDescriptions = vertexInputAttributes
         };
 
@@ -371,7 +412,7 @@ static VkPipeline CreateGraphicsPipeline(VkDevice specDevice, const char* vertSP
             .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
             .pNext = NULL,
             .flags = 0,
-            .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
+            .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
             .primitiveRestartEnable = VK_FALSE
         };
 
@@ -406,7 +447,7 @@ static VkPipeline CreateGraphicsPipeline(VkDevice specDevice, const char* vertSP
             .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
             .pNext = NULL,
             .flags = 0,
-            .rasterizationSamples = USE_MSAA_SAMPLE_COUNT > 0 ? (VkSampleCountFlagBits)(USE_MSAA_SAMPLE_COUNT) : VK_SAMPLE_COUNT_1_BIT,
+            .rasterizationSamples = renderTarget->sampleCount,
             .sampleShadingEnable = VK_FALSE,
             .minSampleShading = 0.0f,
             .pSampleMask = NULL,
@@ -471,10 +512,14 @@ static VkPipeline CreateGraphicsPipeline(VkDevice specDevice, const char* vertSP
             .pDynamicStates = (VkDynamicState[]) { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR }
         };
 
+        PipelineCreationFeedbackRecord feedbackRecord;
+        VkPipelineRenderingCreateInfoKHR renderingCreateInfo;
+        const uint32_t stageCount = (uint32_t)(sizeof(shaderStages) / sizeof(shaderStages[0]));
+
         const VkGraphicsPipelineCreateInfo pipelineCreateInfo = {
             .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-            .pNext = NULL,
-            .stageCount = (uint32_t)(sizeof(shaderStages) / sizeof(shaderStages[0])),
+            .pNext = PreparePipelineCreationFeedback(&feedbackRecord, PrepareRenderTargetPipelineInfo(renderTarget, &renderingCreateInfo, NULL), stageCount),
+            .stageCount = stageCount,
             .pStages = shaderStages,
             .pVertexInputState = &vertexInputStateCreateInfo,
             .pInputAssemblyState = &inputAssemblyStateCreateInfo,
@@ -486,33 +531,21 @@ static VkPipeline CreateGraphicsPipeline(VkDevice specDevice, const char* vertSP
             .pColorBlendState = &colorBlendStateCreateInfo,
             .pDynamicState = &dynamicStateCreateInfo,
             .layout = pipelineLayout,
-            .renderPass = renderPass,
+            .renderPass = renderTarget->renderPass,
             .subpass = 0,
             .basePipelineHandle = VK_NULL_HANDLE,
             .basePipelineIndex = 0
         };
 
-        const VkPipelineCacheCreateInfo pipelineCacheInfo = {
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
-            .pNext = NULL,
-            .flags = 0,
-            .initialDataSize = 0,
-            .pInitialData = NULL
-        };
-
-        VkResult res = vkCreatePipelineCache(specDevice, &pipelineCacheInfo, NULL, outPipelineCache);
-        if (res != VK_SUCCESS)
-        {
-            fprintf(stderr, "vkCreatePipelineCache failed: %d\n", res);
-            break;
-        }
-
-        res = vkCreateGraphicsPipelines(specDevice, *outPipelineCache, 1, &pipelineCreateInfo, NULL, &dstPipeline);
+        const double startTime = GetCurrentTimeInMilliseconds();
+        VkResult res = vkCreateGraphicsPipelines(specDevice, pipelineCache, 1, &pipelineCreateInfo, NULL, &dstPipeline);
         if (res != VK_SUCCESS)
         {
             fprintf(stderr, "vkCreateGraphicsPipelines failed: %d\n", res);
             break;
         }
+
+        RecordPipelineCreation("texture", &feedbackRecord, GetCurrentTimeInMilliseconds() - startTime);
     }
     while (false);
 
@@ -526,92 +559,294 @@ static VkPipeline CreateGraphicsPipeline(VkDevice specDevice, const char* vertSP
     return dstPipeline;
 }
 
-static HBITMAP LoadBMPFile(BITMAP* outBitmapInfo)
+// Writes an RGBA checkerboard into `dst`, for when there is no image file to sample
+static void GenerateCheckerboardImage(uint32_t* dst, uint32_t width, uint32_t height)
 {
-    HBITMAP hBmp = (HBITMAP)LoadImageA(NULL, "images/geom.bmp", IMAGE_BITMAP, 0, 0, LR_LOADFROMFILE | LR_CREATEDIBSECTION);
-    if (hBmp == NULL)
+    for (uint32_t y = 0; y < height; ++y)
     {
-        fprintf(stderr, "Load image file failed!\n");
-        return NULL;
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            const bool isOddCell = (((x / CHECKERBOARD_CELL_SIZE) + (y / CHECKERBOARD_CELL_SIZE)) & 1U) != 0;
+            dst[y * width + x] = isOddCell ? 0xff303030U : 0xffd0d0d0U;
+        }
     }
+}
 
-    if (GetObjectA(hBmp, sizeof(*outBitmapInfo), outBitmapInfo) == 0)
+// Every texture becomes a layer of the same image, so the files have to agree on everything but their pixels.
+static bool AreImageFilesCompatible(const ImageFile* first, const ImageFile* image, const char* path)
+{
+    if (image->width != first->width || image->height != first->height || image->format != first->format ||
+        image->levelCount != first->levelCount || image->isOpaque != first->isOpaque)
     {
-        fprintf(stderr, "Bitmap get failed!\n");
-        return NULL;
+        fprintf(stderr, "%s (%u x %u, format %d, %u levels) does not match the first texture (%u x %u, format %d, %u levels)!\n", path,
+            image->width, image->height, image->format, image->levelCount, first->width, first->height, first->format, first->levelCount);
+        return false;
     }
-
-    return hBmp;
+    return true;
 }
 
-bool CreateTexturePipelineAssets(VkPhysicalDevice currPhysicalDevice, VkDevice specDevice, uint32_t graphicsQueueFamilyIndex, VkCommandBuffer commandBuffer,
-                                const char* vertSPVFilePath, const char* fragSPVFilePath, VkPipelineLayout pipelineLayout, VkRenderPass renderPass,
-                                VkImage *outImage, VkImageView *outImageView, VkSampler *outSampler, VkBuffer *pHostUploadBuffer, VkDeviceMemory *pHostUploadMemory, VkDeviceMemory *pTextureImageMemory,
-                                VkPipelineCache* outPipelineCache, VkPipeline* outPipeline)
+bool CreateTextureAssets(VkPhysicalDevice currPhysicalDevice, VkDevice specDevice, uint32_t graphicsQueueFamilyIndex, VkCommandBuffer commandBuffer, UploadManager* uploadManager,
+                        const HostImageCopySupport* hostImageCopy,
+                        const char* const* texturePaths, uint32_t textureCount, MipmapGeneration mipmapGeneration, VkPipelineCache pipelineCache,
+                        MipmapComputeResources *pMipmapComputeResources, VkImage *outImage, VkImageView *outImageView, VkSampler *outSampler, VkBuffer *pHostUploadBuffer, DeviceMemoryAllocation *pHostUploadMemory, DeviceMemoryAllocation *pTextureImageMemory)
 {
-    BITMAP bitmapInfo;
-    HBITMAP hBitmap = LoadBMPFile(&bitmapInfo);
-    if (hBitmap == NULL) return false;
+    const bool isDefaultTexture = textureCount == 0;
+    if (isDefaultTexture)
+    {
+        texturePaths = &s_defaultTextureFilePath;
+        textureCount = 1;
+    }
+    if (textureCount > MAX_TEXTURE_FILE_COUNT)
+    {
+        fprintf(stderr, "At most %d textures can be loaded, not %u!\n", MAX_TEXTURE_FILE_COUNT, textureCount);
+        return false;
+    }
 
+    ImageFile imageFiles[MAX_TEXTURE_FILE_COUNT];
+    double openTimes[MAX_TEXTURE_FILE_COUNT];
+    uint32_t imageFileCount = 0;
+    VkImage textureImage = VK_NULL_HANDLE;
     VkImageView textureImageView = VK_NULL_HANDLE;
     VkSampler textureSampler = VK_NULL_HANDLE;
     VkBuffer hostUploadBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory textureMemory = VK_NULL_HANDLE;
-    VkDeviceMemory hostUploadMemory = VK_NULL_HANDLE;
-    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
-    VkPipeline pipeline = VK_NULL_HANDLE;
+    DeviceMemoryAllocation textureMemory = { 0 };
+    DeviceMemoryAllocation hostUploadMemory = { 0 };
+    uint8_t* hostData = NULL;
+    bool succeeded = false;
 
-    VkImage textureImage = CreateTextureResource(currPhysicalDevice, specDevice, bitmapInfo.bmWidth, bitmapInfo.bmHeight, bitmapInfo.bmBits, graphicsQueueFamilyIndex,
-                                                &textureImageView, &textureSampler, &hostUploadBuffer, &textureMemory, &hostUploadMemory);
+    do
+    {
+        // Only the headers are read here. The pixels are paged in from the mapped files while they are decoded into the staging buffer.
+        bool areFilesOpen = true;
+        for (uint32_t i = 0; i < textureCount && areFilesOpen; ++i)
+        {
+            const double startTime = GetCurrentTimeInMilliseconds();
+            areFilesOpen = OpenImageFile(texturePaths[i], &imageFiles[i]) && (i == 0 || AreImageFilesCompatible(&imageFiles[0], &imageFiles[i], texturePaths[i]));
+            openTimes[i] = GetCurrentTimeInMilliseconds() - startTime;
+            if (areFilesOpen || imageFiles[i].fileData != NULL) {
+                ++imageFileCount;
+            }
+        }
 
-    if (hBitmap != NULL) {
-        DeleteObject(hBitmap);
-    }
+        // The checkerboard stands in for the default texture when it is missing
+        ImageFile checkerboard = { 0 };
+        const ImageFile* layerInfo = &imageFiles[0];
+        uint32_t layerCount = imageFileCount;
+        if (!areFilesOpen)
+        {
+            if (!isDefaultTexture) break;
+
+            printf("The default texture %s could not be loaded, so a generated checkerboard is sampled instead.\n", s_defaultTextureFilePath);
+            checkerboard.format = VK_FORMAT_R8G8B8A8_UNORM;
+            checkerboard.isOpaque = true;
+            checkerboard.width = CHECKERBOARD_TEXTURE_SIZE;
+            checkerboard.height = CHECKERBOARD_TEXTURE_SIZE;
+            checkerboard.levelCount = 1;
+            checkerboard.levelSizes[0] = CHECKERBOARD_TEXTURE_SIZE * CHECKERBOARD_TEXTURE_SIZE * 4U;
+            checkerboard.decodedSize = checkerboard.levelSizes[0];
+            layerInfo = &checkerboard;
+            layerCount = 1;
+        }
+        else
+        {
+            // Compressed textures that the device cannot sample are decompressed while they are decoded into the staging buffer
+            VkFormatProperties formatProperties;
+            vkGetPhysicalDeviceFormatProperties(currPhysicalDevice, layerInfo->format, &formatProperties);
+            const VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+            if ((formatProperties.optimalTilingFeatures & requiredFeatures) != requiredFeatures)
+            {
+                printf("The device cannot sample %s textures, so they are decompressed on the CPU.\n", GetTextureFormatInfo(layerInfo->format)->name);
+                bool areFilesDecompressed = true;
+                for (uint32_t i = 0; i < layerCount && areFilesDecompressed; ++i) {
+                    areFilesDecompressed = RequestImageFileDecompression(&imageFiles[i]);
+                }
+                if (!areFilesDecompressed) break;
+            }
+        }
+
+        // Precomputed levels of the files are used as they are, and a single level is extended to a full chain on the device.
+        uint32_t levelCount = layerInfo->levelCount;
+        const uint32_t fullLevelCount = GetFullMipLevelCount(layerInfo->width, layerInfo->height);
+        if (levelCount == 1 && fullLevelCount > 1)
+        {
+            mipmapGeneration = ResolveMipmapGeneration(currPhysicalDevice, layerInfo->format, mipmapGeneration);
+            if (mipmapGeneration != MIPMAP_GENERATION_NONE) {
+                levelCount = fullLevelCount;
+            }
+        }
+        else {
+            mipmapGeneration = MIPMAP_GENERATION_NONE;
+        }
+
+        // With host image copies, the layers are decoded into host memory and written into the image by the CPU, with no command at all.
+        // The generated levels are left in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL for the generation on the device.
+        const bool generatesMipmaps = mipmapGeneration != MIPMAP_GENERATION_NONE;
+        const VkImageLayout hostCopyLayout = generatesMipmaps ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        VkImageCreateFlags hostCopyFlags;
+        const VkImageUsageFlags hostCopyUsage = GetTextureImageUsage(mipmapGeneration, true, &hostCopyFlags);
+        bool isHostCopyOptimal;
+        const bool isCopiedFromHost = CanCopyImageFromHost(currPhysicalDevice, hostImageCopy, layerInfo->format, hostCopyUsage, hostCopyFlags, hostCopyLayout,
+                                                            &isHostCopyOptimal);
+
+        // Otherwise they are decoded into the staging ring, or into a staging buffer of their own when they do not fit in it
+        const VkDeviceSize layerStride = layerInfo->decodedSize;
+        VkDeviceSize stagingOffset = 0;
+        uint8_t* stagingData = NULL;
+        if (isCopiedFromHost)
+        {
+            hostData = malloc((size_t)(layerStride * layerCount));
+            if (hostData == NULL)
+            {
+                fprintf(stderr, "Allocating %.1f MB of host memory for the texture failed!\n", (double)(layerStride * layerCount) / (1024.0 * 1024.0));
+                break;
+            }
+            stagingData = hostData;
+        }
+        else {
+            stagingData = AllocateUploadStagingMemory(uploadManager, layerStride * layerCount, 16U, true, &stagingOffset);
+        }
+        if (stagingData == NULL)
+        {
+            const VkBufferCreateInfo hostUploadBufferCreateInfo = {
+                .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                .pNext = NULL,
+                .flags = 0,
+                .size = layerStride * layerCount,
+                .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+                .queueFamilyIndexCount = 1,
+                .pQueueFamilyIndices = &graphicsQueueFamilyIndex
+            };
+            VkResult res = vkCreateBuffer(specDevice, &hostUploadBufferCreateInfo, NULL, &hostUploadBuffer);
+            if (res != VK_SUCCESS)
+            {
+                fprintf(stderr, "vkCreateBuffer for host upload buffer failed: %d\n", res);
+                break;
+            }
+            if (!AllocateAndBindBufferMemory(hostUploadBuffer, DEVICE_MEMORY_USAGE_STAGING_UPLOAD, &hostUploadMemory))
+            {
+                fprintf(stderr, "Allocating the host upload memory for texture failed!\n");
+                break;
+            }
+            // Host visible allocations are persistently mapped, so the pixels go from the mapped files straight into the staging buffer.
+            stagingData = hostUploadMemory.mappedData;
+            printf("The %.1f MB of texture data cannot be taken from the staging ring, so they are uploaded through a staging buffer of their own.\n",
+                (double)(layerStride * layerCount) / (1024.0 * 1024.0));
+        }
 
-    if (textureImage == VK_NULL_HANDLE) return false;
+        if (layerInfo == &checkerboard) {
+            GenerateCheckerboardImage((uint32_t*)stagingData, CHECKERBOARD_TEXTURE_SIZE, CHECKERBOARD_TEXTURE_SIZE);
+        }
+        else
+        {
+            bool areFilesDecoded = true;
+            double totalTime = 0.0;
+            double totalMegabytes = 0.0;
+            for (uint32_t i = 0; i < layerCount && areFilesDecoded; ++i)
+            {
+                const ImageFile* image = &imageFiles[i];
+                const double startTime = GetCurrentTimeInMilliseconds();
+                areFilesDecoded = DecodeImageFile(image, &stagingData[i * layerStride]);
+                const double loadTime = openTimes[i] + GetCurrentTimeInMilliseconds() - startTime;
+                if (!areFilesDecoded)
+                {
+                    fprintf(stderr, "Decoding the texture %s failed!\n", texturePaths[i]);
+                    break;
+                }
+
+                const double megabytes = (double)image->fileSize / (1024.0 * 1024.0);
+                printf("Texture %s: %s, %u x %u, %u level(s), %.3f MB loaded in %.3f ms (%.3f ms/MB)\n", texturePaths[i], GetImageFileTypeName(image->type),
+                    image->width, image->height, image->levelCount, megabytes, loadTime, loadTime / megabytes);
+                totalTime += loadTime;
+                totalMegabytes += megabytes;
+            }
+            if (!areFilesDecoded) break;
 
-    CopyImageDataToDeviceTextureBuffer(commandBuffer, hostUploadBuffer, textureImage, bitmapInfo.bmWidth, bitmapInfo.bmHeight, graphicsQueueFamilyIndex);
+            if (layerCount > 1) {
+                printf("%u textures, %.3f MB loaded in %.3f ms (%.3f ms/MB)\n", layerCount, totalMegabytes, totalTime, totalTime / totalMegabytes);
+            }
+        }
 
-    do
-    {
-        pipeline = CreateGraphicsPipeline(specDevice, vertSPVFilePath, fragSPVFilePath, pipelineLayout, renderPass, &pipelineCache);
-        if (pipeline == VK_NULL_HANDLE) break;
-
-        *outImage = textureImage;
-        *outImageView = textureImageView;
-        *outSampler = textureSampler;
-        *pHostUploadBuffer = hostUploadBuffer;
-        *pHostUploadMemory = hostUploadMemory;
-        *pTextureImageMemory = textureMemory;
-        *outPipelineCache = pipelineCache;
-        *outPipeline = pipeline;
-
-        return true;
+        textureImage = CreateTextureResource(specDevice, layerInfo, levelCount, layerCount, mipmapGeneration, isCopiedFromHost, graphicsQueueFamilyIndex,
+                                            &textureImageView, &textureSampler, &textureMemory);
+        if (textureImage == VK_NULL_HANDLE) break;
+
+        const bool usesBlits = mipmapGeneration == MIPMAP_GENERATION_BLIT;
+        if (isCopiedFromHost)
+        {
+            const double startTime = GetCurrentTimeInMilliseconds();
+            if (!CopyImageDataFromHost(specDevice, hostImageCopy, textureImage, layerInfo, hostData, levelCount, layerCount, layerStride, hostCopyLayout)) break;
+
+            printf("Texture upload: %.1f KB copied from the host into the image in %.3f ms, %s for the device to access\n",
+                (double)(layerStride * layerCount) / 1024.0, GetCurrentTimeInMilliseconds() - startTime, isHostCopyOptimal ? "optimal" : "not optimal");
+        }
+        else if (!CopyImageDataToDeviceTextureBuffer(uploadManager, hostUploadBuffer, stagingOffset, textureImage, layerInfo, levelCount, layerCount, layerStride, generatesMipmaps,
+                                                usesBlits ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                                usesBlits ? VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT : VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT)) {
+            break;
+        }
+
+        // The generation runs on the graphics queue, after the copies of the upload batch that the init submission waits for
+        if (generatesMipmaps) {
+            RecordUploadAcquireBarriers(uploadManager, commandBuffer, UINT64_MAX);
+        }
+        if (usesBlits) {
+            RecordMipmapBlits(commandBuffer, textureImage, layerInfo->width, layerInfo->height, levelCount, layerCount);
+        }
+        else if (mipmapGeneration == MIPMAP_GENERATION_COMPUTE &&
+                !RecordMipmapCompute(specDevice, commandBuffer, textureImage, layerInfo->format, layerInfo->width, layerInfo->height, levelCount, layerCount,
+                                    pipelineCache, pMipmapComputeResources)) {
+            break;
+        }
+        if (generatesMipmaps) {
+            printf("Texture mip chain: %u levels generated with %s\n", levelCount, GetMipmapGenerationName(mipmapGeneration));
+        }
+
+        const TextureFormatInfo* formatInfo = GetTextureFormatInfo(layerInfo->format);
+        VkDeviceSize textureSize = 0;
+        VkDeviceSize uncompressedSize = 0;
+        for (uint32_t level = 0; level < levelCount; ++level)
+        {
+            textureSize += GetTextureLevelSize(formatInfo, layerInfo->width, layerInfo->height, level) * layerCount;
+            uncompressedSize += (VkDeviceSize)max(layerInfo->width >> level, 1U) * max(layerInfo->height >> level, 1U) * 4U * layerCount;
+        }
+        printf("Texture memory: %.1f KB of %s, uploaded from %.1f KB of %s (%.1fx smaller than RGBA8)\n", (double)textureSize / 1024.0, formatInfo->name,
+            (double)(layerStride * layerCount) / 1024.0, isCopiedFromHost ? "host memory" : "staging", (double)uncompressedSize / (double)textureSize);
+        succeeded = true;
     }
     while (false);
 
-    if (textureImage != VK_NULL_HANDLE) {
-        vkDestroyImage(specDevice, textureImage, NULL);
-    }
-    if (textureImageView != VK_NULL_HANDLE) {
-        vkDestroyImageView(specDevice, textureImageView, NULL);
-    }
-    if (textureSampler != VK_NULL_HANDLE) {
-        vkDestroySampler(specDevice, textureSampler, NULL);
+    for (uint32_t i = 0; i < imageFileCount; ++i) {
+        CloseImageFile(&imageFiles[i]);
     }
-    if (hostUploadBuffer != VK_NULL_HANDLE) {
-        vkDestroyBuffer(specDevice, hostUploadBuffer, NULL);
-    }
-    if (hostUploadMemory != VK_NULL_HANDLE) {
-        vkFreeMemory(specDevice, hostUploadMemory, NULL);
-    }
-    if (pipelineCache != VK_NULL_HANDLE) {
-        vkDestroyPipelineCache(specDevice, pipelineCache, NULL);
-    }
-    if (pipeline != VK_NULL_HANDLE) {
-        vkDestroyPipeline(specDevice, pipeline, NULL);
+    free(hostData);
+
+    if (!succeeded)
+    {
+        DestroyMipmapComputeResources(specDevice, pMipmapComputeResources);
+        if (textureImageView != VK_NULL_HANDLE) {
+            vkDestroyImageView(specDevice, textureImageView, NULL);
+        }
+        if (textureImage != VK_NULL_HANDLE) {
+            vkDestroyImage(specDevice, textureImage, NULL);
+        }
+        if (textureSampler != VK_NULL_HANDLE) {
+            vkDestroySampler(specDevice, textureSampler, NULL);
+        }
+        FreeDeviceMemory(&textureMemory);
+        if (hostUploadBuffer != VK_NULL_HANDLE) {
+            vkDestroyBuffer(specDevice, hostUploadBuffer, NULL);
+        }
+        FreeDeviceMemory(&hostUploadMemory);
+        return false;
     }
 
-    return false;
-}
+    *outImage = textureImage;
+    *outImageView = textureImageView;
+    *outSampler = textureSampler;
+    *pHostUploadBuffer = hostUploadBuffer;
+    *pHostUploadMemory = hostUploadMemory;
+    *pTextureImageMemory = textureMemory;
 
+    return true;
+}